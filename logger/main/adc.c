@@ -2,14 +2,22 @@
 #include "driver/spi_master.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "dlog.h"
+#include "metrics.h"
+#include "prof.h"
+#include "trace.h"
+#include "tasks.h"
 
 static const char *TAG = "ADC";
 uint16_t frontBrakePress = 0, rearBrakePress = 0, steerPos = 0, flShock = 0, frShock = 0, rlShock = 0, rrShock = 0;
 static SemaphoreHandle_t adc_data_mutex = NULL;
+static StaticSemaphore_t adc_data_mutex_buffer;
 
 static uint8_t buffer[2];
 static spi_device_handle_t spi_handle;
 
+const uint32_t adc_ram_bytes = sizeof(adc_data_mutex_buffer) + sizeof(buffer);
+
 void adc_reading_task(void *pvParameters) {
     const TickType_t xFrequency = pdMS_TO_TICKS(10); // 100Hz sampling rate
     TickType_t xLastWakeTime = xTaskGetTickCount();
@@ -21,10 +29,16 @@ void adc_reading_task(void *pvParameters) {
     uint16_t local_fls, local_frs, local_rrs, local_rls;
     
     while (1) {
-        // Wait for the next cycle
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+        // Wait for the next cycle; no wait means the previous scan ran past its slot
+        if (xTaskDelayUntil(&xLastWakeTime, xFrequency) == pdFALSE) {
+            metrics_inc(METRIC_ADC_OVERRUNS);
+            trace_event(TRACE_MARK, TRACE_MARK_ADC_OVERRUN, 0);
+        }
+        trace_event(TRACE_TASK_WAKE, TRACE_TASK_ADC, 0);
+        metrics_inc(METRIC_ADC_SCANS);
         
         // Read all ADC channels (this takes time due to SPI operations)
+        PROF_BEGIN(ADC_SCAN);
         local_fbp = adc_get_channel(ADC_FBP);
         local_rbp = adc_get_channel(ADC_RBP);
         local_stp = adc_get_channel(ADC_STP);
@@ -32,6 +46,7 @@ void adc_reading_task(void *pvParameters) {
         local_frs = adc_get_channel(ADC_FRS);
         local_rrs = adc_get_channel(ADC_RRS);
         local_rls = adc_get_channel(ADC_RLS);
+        PROF_END(ADC_SCAN);
         
         // Update global variables atomically
         if (xSemaphoreTake(adc_data_mutex, pdMS_TO_TICKS(5)) == pdTRUE) {
@@ -45,8 +60,9 @@ void adc_reading_task(void *pvParameters) {
             
             xSemaphoreGive(adc_data_mutex);
         } else {
-            ESP_LOGW(TAG, "Failed to acquire ADC mutex for writing");
+            DLOGW(TAG, "Failed to acquire ADC mutex for writing");
         }
+        trace_event(TRACE_TASK_BLOCK, TRACE_TASK_ADC, 0);
     }
 }
 
@@ -90,11 +106,9 @@ esp_err_t adc_init(void) {
     buffer[0] = 0;
     buffer[1] = 0;
 
-    adc_data_mutex = xSemaphoreCreateMutex();
-    // Create ADC reading task (high priority for consistent sampling)
-    BaseType_t result = xTaskCreate(adc_reading_task, "adc_reader", 4096, NULL, 8, NULL);
-    if (result != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create ADC reading task");
+    adc_data_mutex = xSemaphoreCreateMutexStatic(&adc_data_mutex_buffer);
+    // ADC reading task on the acquisition core (tasks.h)
+    if (tasks_create(TASK_ADC, adc_reading_task, NULL, NULL) != ESP_OK) {
         return ESP_FAIL;
     }
 
@@ -120,7 +134,8 @@ uint16_t adc_get_channel(uint8_t channel) {
 
     esp_err_t ret = spi_device_transmit(spi_handle, &t);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "SPI transmit failed: %s", esp_err_to_name(ret));
+        DLOGE(TAG, "SPI transmit failed: %s", esp_err_to_name(ret));
+        metrics_inc(METRIC_ADC_ERRORS);
         return 0;
     }
 
@@ -144,7 +159,7 @@ esp_err_t adc_get_values(uint16_t *fbp, uint16_t *rbp, uint16_t *stp,
         xSemaphoreGive(adc_data_mutex);
         return ESP_OK;
     } else {
-        ESP_LOGW(TAG, "Failed to acquire ADC mutex for reading");
+        DLOGW(TAG, "Failed to acquire ADC mutex for reading");
         return ESP_ERR_TIMEOUT;
     }
 }
\ No newline at end of file
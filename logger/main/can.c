@@ -1,64 +1,68 @@
 #include "can.h"
-#include "esp_twai.h"
-#include "esp_twai_onchip.h"
+#include <string.h>
 #include <esp_err.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
-
+#include "metrics.h"
+#include "prof.h"
+#include "trace.h"
+#include "tasks.h"
 
 static const char *TAG = "CAN";
 
-#define BITRATE 1000000
-#define TX GPIO_NUM_18
-#define RX GPIO_NUM_8
-
-twai_node_handle_t hfdcan = NULL;
-
 // Queue to store received messages
 static QueueHandle_t rx_queue;
+static uint8_t rx_queue_storage[CAN_RX_QUEUE_MAX * sizeof(safe_can_frame_t)];
+static StaticQueue_t rx_queue_buffer;
 
-// Semaphore for synchronization
-static SemaphoreHandle_t rx_sem;
+const uint32_t can_ram_bytes = sizeof(rx_queue_storage) + sizeof(rx_queue_buffer);
 
 static can_message_callback_t process = NULL;
 
-static bool can_rx_cb(twai_node_handle_t handle, const twai_rx_done_event_data_t *edata, void *user_ctx)
+static volatile can_stats_t can_stats;
+
+bool can_rx_from_isr(const twai_frame_header_t *header, const uint8_t *data)
 {
-    uint8_t recv_buff[64];
-    twai_frame_t rx_frame = {
-        .buffer = recv_buff,
-        .buffer_len = sizeof(recv_buff),
-    };
-    
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-    
-    if (ESP_OK == twai_node_receive_from_isr(handle, &rx_frame)) {
-        // Create a safe copy with embedded data
-        typedef struct {
-            twai_frame_header_t header;
-            uint8_t data[64];  // Actual data copy, not pointer
-        } safe_can_frame_t;
-        
-        safe_can_frame_t safe_frame;
-        safe_frame.header = rx_frame.header;
-        memcpy(safe_frame.data, rx_frame.buffer, rx_frame.header.dlc);
-        
-        xQueueSendFromISR(rx_queue, &safe_frame, &xHigherPriorityTaskWoken);
-        
-        if (xHigherPriorityTaskWoken == pdTRUE) {
-            portYIELD_FROM_ISR();
-        }
+
+    // Create a safe copy with embedded data
+    safe_can_frame_t safe_frame;
+    safe_frame.header = *header;
+    memcpy(safe_frame.data, data, header->dlc < sizeof(safe_frame.data) ? header->dlc : sizeof(safe_frame.data));
+
+    can_stats.rx_frames++;
+    PROF_BEGIN(CAN_PUSH);
+    BaseType_t sent = xQueueSendFromISR(rx_queue, &safe_frame, &xHigherPriorityTaskWoken);
+    PROF_END(CAN_PUSH);
+    trace_event(TRACE_QUEUE_SEND, TRACE_QUEUE_CAN_RX, sent == pdTRUE ? TRACE_SEND_QUEUED : TRACE_SEND_FULL);
+    if (sent != pdTRUE) {
+        can_stats.rx_dropped++;
+        trace_event(TRACE_MARK, TRACE_MARK_CAN_DROP, (uint16_t)header->id);
     }
-    return false;
+    return xHigherPriorityTaskWoken == pdTRUE;
+}
+
+void can_rx_overrun(uint32_t frames)
+{
+    can_stats.rx_overruns += frames;
 }
 
 static void can_receive_task(void *pvParameters) {
+    (void)pvParameters;
 
     
     safe_can_frame_t rx_frame;
     
     while (1) {
         if (xQueueReceive(rx_queue, &rx_frame, pdMS_TO_TICKS(100)) == pdPASS) {
+            trace_event(TRACE_TASK_WAKE, TRACE_TASK_CAN_RX, 0);
+            trace_event(TRACE_QUEUE_RECV, TRACE_QUEUE_CAN_RX, 0);
+            UBaseType_t queued = uxQueueMessagesWaiting(rx_queue) + 1;
+            if (queued > can_stats.rx_max_queued) {
+                can_stats.rx_max_queued = queued;
+            }
+            metrics_gauge_max(GAUGE_CAN_QUEUE_PEAK, queued);
             // Convert to the format your callback expects
             twai_frame_t processed_frame = {
                 .header = rx_frame.header,
@@ -67,46 +71,47 @@ static void can_receive_task(void *pvParameters) {
             };
             
             if (process != NULL) {
+                PROF_BEGIN(CAN_DECODE);
                 process(&processed_frame);  // ✅ SAFE
+                PROF_END(CAN_DECODE);
             }
+            trace_event(TRACE_TASK_BLOCK, TRACE_TASK_CAN_RX, 0);
         }
         
         vTaskDelay(pdMS_TO_TICKS(1));
     }
 }
 
-void can_init(can_message_callback_t callback_function){
+esp_err_t can_init_transport(const can_transport_t *transport, uint16_t rx_queue_len,
+                             can_message_callback_t callback_function){
     process = callback_function;
     // Create queue for received messages
-    rx_queue = xQueueCreate(10, sizeof(safe_can_frame_t));
-    
-    // Create semaphore for RX notifications
-    rx_sem = xSemaphoreCreateBinary();
-
-        // Configure TWAI node with ISR callback
-    const twai_onchip_node_config_t can_config = {
-        .io_cfg = {
-            .tx = TX,
-            .rx = RX,
-            .quanta_clk_out = -1,
-            .bus_off_indicator = -1
-        },
-        .bit_timing = {
-            .bitrate = BITRATE
-        },
-        .tx_queue_depth = 64,
-    };
-    const twai_event_callbacks_t callbacks = {
-        .on_rx_done = can_rx_cb
-    };
-    ESP_ERROR_CHECK(twai_new_node_onchip(&can_config, &hfdcan));
-    ESP_ERROR_CHECK(twai_node_register_event_callbacks(hfdcan, &callbacks, NULL));
-    ESP_ERROR_CHECK(twai_node_enable(hfdcan));
-
-    BaseType_t result = xTaskCreate(can_receive_task, "can_rx", 4096, NULL, 5, NULL);
-    if (result != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create can_receive_task");
-        return;
+    if (rx_queue_len > CAN_RX_QUEUE_MAX) {
+        ESP_LOGE(TAG, "Queue of %u frames exceeds CAN_RX_QUEUE_MAX (%d)", rx_queue_len, CAN_RX_QUEUE_MAX);
+        return ESP_ERR_INVALID_ARG;
     }
+    rx_queue = xQueueCreateStatic(rx_queue_len, sizeof(safe_can_frame_t), rx_queue_storage, &rx_queue_buffer);
 
-}
\ No newline at end of file
+    esp_err_t err = transport->start(transport);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start %s transport: %s", transport->name, esp_err_to_name(err));
+        return err;
+    }
+
+    if (tasks_create(TASK_CAN_RX, can_receive_task, NULL, NULL) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Receiving from %s, queue of %u frames", transport->name, rx_queue_len);
+    return ESP_OK;
+}
+
+void can_init(can_message_callback_t callback_function){
+    ESP_ERROR_CHECK(can_init_transport(&can_transport_twai, CAN_RX_QUEUE_LEN, callback_function));
+}
+
+void can_get_stats(can_stats_t *stats) {
+    stats->rx_frames = can_stats.rx_frames;
+    stats->rx_dropped = can_stats.rx_dropped;
+    stats->rx_max_queued = can_stats.rx_max_queued;
+    stats->rx_overruns = can_stats.rx_overruns;
+}
@@ -4,6 +4,12 @@
 #include "esp_twai.h"
 #include "esp_twai_onchip.h"
 #include "freertos/FreeRTOS.h"
+#include "can_transport.h"
+
+#define CAN_RX_QUEUE_LEN 10 // Frames between the transport and the receive task
+#ifndef CAN_RX_QUEUE_MAX
+#define CAN_RX_QUEUE_MAX CAN_RX_QUEUE_LEN // Static queue storage: the longest queue can_init_transport accepts
+#endif
 
 extern twai_node_handle_t hfdcan;
 
@@ -12,9 +18,21 @@ typedef struct {
         uint8_t data[64];
 } safe_can_frame_t;
 
+// Receive counters, updated from the transport's ISR or reader
+typedef struct {
+        uint32_t rx_frames;  // Frames taken from the transport
+        uint32_t rx_dropped; // Frames lost because rx_queue was full
+        uint32_t rx_max_queued; // Deepest rx_queue level seen by the receive task
+        uint32_t rx_overruns; // Frames the transport lost before handing them over
+} can_stats_t;
+
 // Callback function type for message processing
 typedef void (*can_message_callback_t)(twai_frame_t *message);
 
 
+// Receive from the TWAI node with the default queue length
 void can_init(can_message_callback_t callback_function);
+esp_err_t can_init_transport(const can_transport_t *transport, uint16_t rx_queue_len,
+                             can_message_callback_t callback_function);
+void can_get_stats(can_stats_t *stats);
 #endif
\ No newline at end of file
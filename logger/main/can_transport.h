@@ -0,0 +1,39 @@
+/*
+ * can_transport.h
+ *
+ * Where received CAN frames come from. can.c owns the receive queue, the
+ * statistics and the receive task; a transport only hands frames over with
+ * can_rx_from_isr(). The firmware reads the on-chip TWAI node (can_twai.c);
+ * the host build can read a Linux SocketCAN interface instead
+ * (tools/can_socketcan.c).
+ */
+#ifndef CAN_TRANSPORT_H
+#define CAN_TRANSPORT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_twai.h"
+
+typedef struct can_transport {
+        const char *name;
+        // Start delivering frames; called once the receive queue exists
+        esp_err_t (*start)(const struct can_transport *transport);
+        const void *config; // Backend settings, e.g. the SocketCAN interface name
+} can_transport_t;
+
+// On-chip TWAI node at 1 Mbit/s (can_twai.c)
+extern const can_transport_t can_transport_twai;
+
+/**
+ * @brief Queue one received frame for the receive task. Never blocks; safe from an ISR
+ * @return true if a higher priority task was woken (the caller yields)
+ */
+bool can_rx_from_isr(const twai_frame_header_t *header, const uint8_t *data);
+
+/**
+ * @brief Count frames lost inside the transport (controller FIFO or socket buffer overruns)
+ */
+void can_rx_overrun(uint32_t frames);
+
+#endif
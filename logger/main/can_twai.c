@@ -0,0 +1,72 @@
+#include "can.h"
+#include "esp_twai.h"
+#include "esp_twai_onchip.h"
+#include <esp_err.h>
+#include "freertos/FreeRTOS.h"
+#include "prof.h"
+#include "trace.h"
+
+
+#define BITRATE 1000000
+#define TX GPIO_NUM_18
+#define RX GPIO_NUM_8
+
+twai_node_handle_t hfdcan = NULL;
+
+static bool can_rx_cb(twai_node_handle_t handle, const twai_rx_done_event_data_t *edata, void *user_ctx)
+{
+    (void)edata;
+    (void)user_ctx;
+    trace_event(TRACE_ISR_ENTER, TRACE_ISR_CAN, 0);
+    PROF_BEGIN(CAN_ISR);
+    uint8_t recv_buff[64];
+    twai_frame_t rx_frame = {
+        .buffer = recv_buff,
+        .buffer_len = sizeof(recv_buff),
+    };
+    bool woken = false;
+
+    if (ESP_OK == twai_node_receive_from_isr(handle, &rx_frame)) {
+        woken = can_rx_from_isr(&rx_frame.header, rx_frame.buffer);
+    }
+    PROF_END(CAN_ISR);
+    trace_event(TRACE_ISR_EXIT, TRACE_ISR_CAN, 0);
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+    return false;
+}
+
+static esp_err_t twai_start(const can_transport_t *transport)
+{
+    (void)transport;
+    // Configure TWAI node with ISR callback
+    const twai_onchip_node_config_t can_config = {
+        .io_cfg = {
+            .tx = TX,
+            .rx = RX,
+            .quanta_clk_out = -1,
+            .bus_off_indicator = -1
+        },
+        .bit_timing = {
+            .bitrate = BITRATE
+        },
+        .tx_queue_depth = 64,
+    };
+    const twai_event_callbacks_t callbacks = {
+        .on_rx_done = can_rx_cb
+    };
+    esp_err_t err = twai_new_node_onchip(&can_config, &hfdcan);
+    if (err == ESP_OK) {
+        err = twai_node_register_event_callbacks(hfdcan, &callbacks, NULL);
+    }
+    if (err == ESP_OK) {
+        err = twai_node_enable(hfdcan);
+    }
+    return err;
+}
+
+const can_transport_t can_transport_twai = {
+    .name = "TWAI",
+    .start = twai_start,
+};
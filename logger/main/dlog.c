@@ -0,0 +1,228 @@
+#include "dlog.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "tasks.h"
+
+typedef struct {
+    dlog_site_t *site;
+    uint32_t time_ms;
+    uint16_t suppressed; // Entries of this site suppressed just before this one
+    uint64_t args[DLOG_MAX_ARGS];
+} dlog_entry_t;
+
+static dlog_entry_t ring[DLOG_RING_LEN];
+static uint32_t ring_head = 0; // Written by any task under the lock
+static uint32_t ring_tail = 0; // Advanced by the dlog task only
+static dlog_site_t *sites = NULL;
+static dlog_stats_t stats;
+static portMUX_TYPE dlog_lock = portMUX_INITIALIZER_UNLOCKED;
+
+const uint32_t dlog_ram_bytes = sizeof(ring);
+
+static uint32_t hash_args(const uint64_t *args, uint8_t argc) {
+    uint32_t hash = 2166136261u; // FNV-1a over the argument words
+    for (uint8_t i = 0; i < argc; i++) {
+        for (int b = 0; b < 64; b += 8) {
+            hash = (hash ^ (uint8_t)(args[i] >> b)) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+void dlog_write(dlog_site_t *site, const char *tag, const uint64_t *args) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    uint32_t hash = hash_args(args, site->argc);
+
+    portENTER_CRITICAL(&dlog_lock);
+    if (!site->registered) {
+        site->tag = tag;
+        site->next = sites;
+        sites = site;
+        site->registered = 1;
+        site->window_start_ms = now_ms;
+    }
+    if (now_ms - site->window_start_ms >= DLOG_WINDOW_MS) {
+        site->window_start_ms = now_ms;
+        site->window_count = 0;
+    }
+    if (site->window_count >= DLOG_SITE_BURST || (site->window_count > 0 && hash == site->last_hash)) {
+        if (site->suppressed < UINT16_MAX) {
+            site->suppressed++;
+        }
+        stats.suppressed++;
+        portEXIT_CRITICAL(&dlog_lock);
+        return;
+    }
+    uint32_t used = ring_head - ring_tail;
+    if (used >= DLOG_RING_LEN) {
+        stats.dropped++;
+        portEXIT_CRITICAL(&dlog_lock);
+        return;
+    }
+    dlog_entry_t *entry = &ring[ring_head & (DLOG_RING_LEN - 1)];
+    entry->site = site;
+    entry->time_ms = now_ms;
+    entry->suppressed = site->suppressed;
+    memcpy(entry->args, args, site->argc * sizeof(uint64_t));
+    ring_head++;
+    site->suppressed = 0;
+    site->window_count++;
+    site->last_hash = hash;
+    stats.written++;
+    if (used + 1 > stats.ring_peak) {
+        stats.ring_peak = (uint16_t)(used + 1);
+    }
+    portEXIT_CRITICAL(&dlog_lock);
+}
+
+/*
+ * printf for the stored arguments: walks the format and hands each
+ * conversion to snprintf with the argument narrowed back to the type the
+ * conversion expects. '*' widths are not supported.
+ */
+static void format_entry(const dlog_site_t *site, const uint64_t *args, char *out, size_t size) {
+    const char *f = site->fmt;
+    size_t len = 0;
+    uint8_t arg = 0;
+
+    while (*f != '\0' && len < size - 1) {
+        if (*f != '%') {
+            out[len++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            out[len++] = '%';
+            f += 2;
+            continue;
+        }
+        char spec[24];
+        size_t n = 0;
+        spec[n++] = *f++;
+        while (*f != '\0' && strchr("-+ #0123456789.", *f) != NULL && n < sizeof(spec) - 4) {
+            spec[n++] = *f++;
+        }
+        int longs = 0;
+        bool size_t_arg = false;
+        while (*f != '\0' && strchr("hlzjt", *f) != NULL && n < sizeof(spec) - 2) {
+            longs += *f == 'l';
+            size_t_arg |= *f == 'z' || *f == 't';
+            spec[n++] = *f++;
+        }
+        char conv = *f;
+        if (conv == '\0') {
+            break;
+        }
+        spec[n++] = *f++;
+        spec[n] = '\0';
+
+        uint64_t v = arg < site->argc ? args[arg++] : 0;
+        size_t room = size - len;
+        int written;
+        switch (conv) {
+            case 'd': case 'i': case 'c':
+                written = longs >= 2 ? snprintf(out + len, room, spec, (long long)v) :
+                          longs == 1 ? snprintf(out + len, room, spec, (long)v) :
+                          size_t_arg ? snprintf(out + len, room, spec, (size_t)v) :
+                                       snprintf(out + len, room, spec, (int)v);
+                break;
+            case 'u': case 'x': case 'X': case 'o':
+                written = longs >= 2 ? snprintf(out + len, room, spec, (unsigned long long)v) :
+                          longs == 1 ? snprintf(out + len, room, spec, (unsigned long)v) :
+                          size_t_arg ? snprintf(out + len, room, spec, (size_t)v) :
+                                       snprintf(out + len, room, spec, (unsigned)v);
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': {
+                double d;
+                memcpy(&d, &v, sizeof(d));
+                written = snprintf(out + len, room, spec, d);
+                break;
+            }
+            case 's':
+                written = snprintf(out + len, room, spec, v != 0 ? (const char *)(uintptr_t)v : "(null)");
+                break;
+            case 'p':
+                written = snprintf(out + len, room, spec, (void *)(uintptr_t)v);
+                break;
+            default:
+                written = snprintf(out + len, room, "%s", spec);
+                break;
+        }
+        if (written < 0) {
+            break;
+        }
+        len += (size_t)written < room ? (size_t)written : room - 1;
+    }
+    out[len] = '\0';
+}
+
+static char level_letter(uint8_t level) {
+    static const char letters[] = "NEWIDV";
+    return level < sizeof(letters) - 1 ? letters[level] : '?';
+}
+
+void dlog_flush(void) {
+    static char line[DLOG_LINE_LEN];
+    dlog_entry_t entry;
+
+    while (1) {
+        portENTER_CRITICAL(&dlog_lock);
+        if (ring_tail == ring_head) {
+            portEXIT_CRITICAL(&dlog_lock);
+            break;
+        }
+        entry = ring[ring_tail & (DLOG_RING_LEN - 1)];
+        ring_tail++;
+        portEXIT_CRITICAL(&dlog_lock);
+
+        const dlog_site_t *site = entry.site;
+        format_entry(site, entry.args, line, sizeof(line));
+        if (entry.suppressed > 0) {
+            esp_log_write(site->level, site->tag, "%c (%lu) %s: %s [%u similar suppressed]\n",
+                          level_letter(site->level), (unsigned long)entry.time_ms, site->tag, line,
+                          (unsigned)entry.suppressed);
+        } else {
+            esp_log_write(site->level, site->tag, "%c (%lu) %s: %s\n", level_letter(site->level),
+                          (unsigned long)entry.time_ms, site->tag, line);
+        }
+        stats.printed++;
+    }
+
+    // Sites that went quiet while rate limited: report the count on its own
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    for (dlog_site_t *site = sites; site != NULL; site = site->next) {
+        uint16_t suppressed = 0;
+        portENTER_CRITICAL(&dlog_lock);
+        if (site->suppressed > 0 && now_ms - site->window_start_ms >= DLOG_WINDOW_MS) {
+            suppressed = site->suppressed;
+            site->suppressed = 0;
+        }
+        portEXIT_CRITICAL(&dlog_lock);
+        if (suppressed > 0) {
+            esp_log_write(site->level, site->tag, "%c (%lu) %s: [%u suppressed] %s\n", level_letter(site->level),
+                          (unsigned long)now_ms, site->tag, (unsigned)suppressed, site->fmt);
+        }
+    }
+}
+
+void dlog_get_stats(dlog_stats_t *out) {
+    portENTER_CRITICAL(&dlog_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&dlog_lock);
+}
+
+static void dlog_task(void *pvParameters) {
+    (void)pvParameters;
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(DLOG_DRAIN_MS));
+        dlog_flush();
+    }
+}
+
+esp_err_t dlog_start_task(void) {
+    // Just above idle: formatting only uses time nothing else wants
+    return tasks_create(TASK_DLOG, dlog_task, NULL, NULL);
+}
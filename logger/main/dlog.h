@@ -0,0 +1,135 @@
+/*
+ * dlog.h
+ *
+ * Deferred logging for time-critical tasks. DLOGW(TAG, "fmt", args...) does
+ * not format anything: each call site owns a static descriptor holding its
+ * level, tag and format string, so a log entry is just that descriptor's
+ * address, a millisecond timestamp and up to DLOG_MAX_ARGS raw arguments
+ * copied into a ring. The low-priority dlog task formats the entries and
+ * writes them through esp_log_write when the CPU is otherwise idle, stamped
+ * with the time they were logged.
+ *
+ * Each site is rate limited: at most DLOG_SITE_BURST entries per
+ * DLOG_WINDOW_MS, and a repeat of the site's previous arguments inside the
+ * window is not logged again. What a site suppresses is counted and printed
+ * with its next entry, or on its own once the window has passed.
+ *
+ * Arguments are integers, floats/doubles or pointers; %s arguments must
+ * point at strings that outlive the ring (literals, static tables), since
+ * only the pointer is kept. Use ESP_LOGx for messages with buffer contents.
+ */
+#ifndef INC_DLOG_H_
+#define INC_DLOG_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#define DLOG_RING_LEN 64      // Entries (power of two), 64 bytes each
+#define DLOG_MAX_ARGS 6
+#define DLOG_WINDOW_MS 1000
+#define DLOG_SITE_BURST 4     // Entries per site per window
+#define DLOG_DRAIN_MS 50      // dlog task polling period
+#define DLOG_LINE_LEN 256
+
+// Same ceiling as ESP_LOGx: sites above it compile to nothing
+#ifdef CONFIG_LOG_MAXIMUM_LEVEL
+#define DLOG_MAX_LEVEL CONFIG_LOG_MAXIMUM_LEVEL
+#else
+#define DLOG_MAX_LEVEL ESP_LOG_INFO
+#endif
+
+// One per call site; only the dlog functions touch the mutable part
+typedef struct dlog_site {
+    const char *fmt;
+    const char *tag;            // Set on the first entry: TAG is not a constant expression
+    uint8_t level;              // esp_log_level_t
+    uint8_t argc;
+    uint8_t registered;
+    uint16_t suppressed;        // Since the last entry of this site
+    uint32_t window_start_ms;
+    uint32_t window_count;
+    uint32_t last_hash;         // Arguments of the last entry, for the repeat check
+    struct dlog_site *next;     // Registered sites, for the suppression summary
+} dlog_site_t;
+
+/**
+ * @brief Queue one entry for a site (use the DLOGx macros)
+ */
+void dlog_write(dlog_site_t *site, const char *tag, const uint64_t *args);
+
+// Arguments are widened to 64 bits; the format's conversion narrows them again
+static inline uint64_t dlog_from_int(int64_t v) { return (uint64_t)v; }
+static inline uint64_t dlog_from_double(double v) {
+    uint64_t bits;
+    __builtin_memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+static inline uint64_t dlog_from_ptr(const void *p) { return (uint64_t)(uintptr_t)p; }
+
+#define DLOG_ARG(x) _Generic((x), \
+    float: dlog_from_double, \
+    double: dlog_from_double, \
+    char *: dlog_from_ptr, \
+    const char *: dlog_from_ptr, \
+    void *: dlog_from_ptr, \
+    const void *: dlog_from_ptr, \
+    default: dlog_from_int)(x)
+
+#define DLOG_NARGS(...) DLOG_NARGS_(0, ##__VA_ARGS__, 6, 5, 4, 3, 2, 1, 0)
+#define DLOG_NARGS_(_0, _1, _2, _3, _4, _5, _6, n, ...) n
+#define DLOG_CAT(a, b) DLOG_CAT_(a, b)
+#define DLOG_CAT_(a, b) a##b
+#define DLOG_MAP(...) DLOG_CAT(DLOG_MAP_, DLOG_NARGS(__VA_ARGS__))(__VA_ARGS__)
+#define DLOG_MAP_0()
+#define DLOG_MAP_1(a) , DLOG_ARG(a)
+#define DLOG_MAP_2(a, ...) , DLOG_ARG(a) DLOG_MAP_1(__VA_ARGS__)
+#define DLOG_MAP_3(a, ...) , DLOG_ARG(a) DLOG_MAP_2(__VA_ARGS__)
+#define DLOG_MAP_4(a, ...) , DLOG_ARG(a) DLOG_MAP_3(__VA_ARGS__)
+#define DLOG_MAP_5(a, ...) , DLOG_ARG(a) DLOG_MAP_4(__VA_ARGS__)
+#define DLOG_MAP_6(a, ...) , DLOG_ARG(a) DLOG_MAP_5(__VA_ARGS__)
+
+static inline void dlog_check_format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static inline void dlog_check_format(const char *fmt, ...) { (void)fmt; }
+
+#define DLOG_AT(lvl, tag_, fmt_, ...) do { \
+    if ((lvl) <= DLOG_MAX_LEVEL) { \
+        static dlog_site_t dlog_site_ = {.fmt = (fmt_), .level = (lvl), .argc = DLOG_NARGS(__VA_ARGS__)}; \
+        const uint64_t dlog_args_[DLOG_MAX_ARGS + 1] = {0 DLOG_MAP(__VA_ARGS__)}; \
+        if (0) { /* Type-check the format like ESP_LOGx, without evaluating anything */ \
+            dlog_check_format(fmt_, ##__VA_ARGS__); \
+        } \
+        dlog_write(&dlog_site_, (tag_), dlog_args_ + 1); \
+    } \
+} while (0)
+
+#define DLOGE(tag, fmt, ...) DLOG_AT(ESP_LOG_ERROR, tag, fmt, ##__VA_ARGS__)
+#define DLOGW(tag, fmt, ...) DLOG_AT(ESP_LOG_WARN, tag, fmt, ##__VA_ARGS__)
+#define DLOGI(tag, fmt, ...) DLOG_AT(ESP_LOG_INFO, tag, fmt, ##__VA_ARGS__)
+#define DLOGD(tag, fmt, ...) DLOG_AT(ESP_LOG_DEBUG, tag, fmt, ##__VA_ARGS__)
+
+typedef struct {
+    uint32_t written;    // Entries queued
+    uint32_t suppressed; // Rate limited or repeated
+    uint32_t dropped;    // Ring full
+    uint32_t printed;
+    uint16_t ring_peak;
+} dlog_stats_t;
+
+/**
+ * @brief Format and print every queued entry and due suppression summary (dlog task)
+ */
+void dlog_flush(void);
+
+/**
+ * @brief Copy the deferred logging counters
+ */
+void dlog_get_stats(dlog_stats_t *stats);
+
+/**
+ * @brief Start the low-priority task that formats queued entries
+ */
+esp_err_t dlog_start_task(void);
+
+#endif /* INC_DLOG_H_ */
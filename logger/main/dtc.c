@@ -1,9 +1,18 @@
 #include "dtc.h"
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
 #include "esp_log.h" 
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
+#include "dtc_journal.h"
+#include "sdcard.h"
+#include "trace.h"
+#include "dlog.h"
+#include "tasks.h"
 
 
 const char* dtc_device_names[] = {
@@ -15,153 +24,371 @@ const char* dtc_device_names[] = {
 static const char *TAG = "DTC_MODULE";
 can_dtc *dtc_devices[DTC_COUNT];
 
-// Task that runs DTC error checking at 50Hz
-void dtc_task(void *pvParameters) {
-    const TickType_t xFrequency = pdMS_TO_TICKS(20); // 50Hz = 20ms period
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    
-    ESP_LOGI(TAG, "DTC error check task started at 50Hz");
-    
-    while (1) {
-        // Wait for the next cycle (50Hz = every 20ms)
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
-        
-        // Get current time in ticks for DTC functions
-        uint32_t current_time = pdTICKS_TO_MS(xTaskGetTickCount());
-        
-        // Run the DTC error check
-        DTC_Error_Check(current_time);
-    }
-}
-
-// Optional helper function to create and start the DTC task
-esp_err_t dtc_start_task(void) {
-    BaseType_t result = xTaskCreate(
-        dtc_task,           // Function
-        "dtc_check",        // Name
-        2048,              // Stack size
-        NULL,              // Parameters
-        6,                 // Priority
-        NULL               // Task handle
-    );
-    
-    if (result != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create DTC task");
-        return ESP_FAIL;
-    }
-    
-    ESP_LOGI(TAG, "DTC task created successfully");
+volatile uint32_t dtc_status[DTC_STATUS_WORDS];
+static portMUX_TYPE state_lock = portMUX_INITIALIZER_UNLOCKED; // errState and dtc_status transitions
+
+// Devices and their sliding windows live in static blocks instead of a heap buffer each
+static can_dtc dtc_storage[DTC_COUNT];
+static dtc_window_t dtc_windows[DTC_COUNT];
+
+/*
+ * Hashed timer wheel of per-device deadlines. Every measurement re-arms its
+ * device at (now + window max + threshold). A one-shot esp_timer is kept
+ * armed for the earliest occupied slot, so the timer only wakes when a
+ * deadline may be due and cost scales with traffic rather than with time or
+ * DTC_COUNT; an error is raised within a millisecond of its deadline.
+ * Devices are linked into slots through index arrays (no allocation), and a
+ * bitmap of occupied slots finds the next one to wake for.
+ */
+static uint16_t wheel_head[DTC_WHEEL_SLOTS];
+static uint32_t wheel_used[DTC_WHEEL_SLOTS / 32]; // Bit per slot with a device linked in
+static uint16_t wheel_next[DTC_COUNT];
+static uint16_t wheel_prev[DTC_COUNT];
+static uint32_t wheel_deadline[DTC_COUNT]; // ms, esp_timer time base
+static bool wheel_armed[DTC_COUNT];
+static uint32_t wheel_now = 0; // Last slot visited
+static uint32_t wheel_due = 0; // When the one-shot timer fires, valid while wheel_scheduled
+static bool wheel_scheduled = false;
+static portMUX_TYPE wheel_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t wheel_timer = NULL;
+/*
+ * Inter-arrival statistics, triple banked: measurements go into the active
+ * bank, the done bank holds the last completed DTC_STATS_PERIOD_MS interval
+ * for the console and the jitter log, and the spare bank is cleared by the
+ * stats task while nobody else looks at it. The rotation itself is two
+ * index stores under stats_lock.
+ */
+static dtc_stats_t dtc_stats[3][DTC_COUNT];
+static uint8_t stats_active = 0;
+static uint8_t stats_done = 1;
+static uint32_t stats_boot_max_gap[DTC_COUNT];
+static float stats_baseline_mean[DTC_COUNT]; // Lowest interval mean seen, 0 until known
+static bool stats_drifting[DTC_COUNT];
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+const uint32_t dtc_ram_bytes = sizeof(dtc_storage) + sizeof(dtc_windows) + sizeof(dtc_stats) + sizeof(wheel_head) +
+                               sizeof(wheel_used) + sizeof(wheel_next) + sizeof(wheel_prev) + sizeof(wheel_deadline) + sizeof(wheel_armed);
+
+/*
+ * Single place errState changes after init, so every transition is journaled.
+ * Called from the CAN task and the wheel's esp_timer callback on the other
+ * core: the compare and both updates happen under state_lock so neither
+ * caller can lose the other's transition.
+ */
+static void dtc_set_state(can_dtc *dtc, uint8_t new_state) {
+    uint32_t bit = 1U << (dtc->DTC_Idx % 32);
+
+    portENTER_CRITICAL(&state_lock);
+    uint8_t old_state = dtc->errState;
+    if (old_state == new_state) {
+        portEXIT_CRITICAL(&state_lock);
+        return;
+    }
+    dtc->errState = new_state;
+    if (new_state) {
+        __atomic_fetch_or(&dtc_status[dtc->DTC_Idx / 32], bit, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_and(&dtc_status[dtc->DTC_Idx / 32], ~bit, __ATOMIC_RELAXED);
+    }
+    uint32_t last_delta = dtc->lastDelta;
+    portEXIT_CRITICAL(&state_lock);
+
+    dtc_journal_record(dtc->DTC_Idx, old_state, new_state, last_delta);
+}
+
+uint64_t DTC_Now_Ms(void) {
+    return (uint64_t)(esp_timer_get_time() / 1000);
+}
+
+static inline uint32_t wheel_time_ms(void) {
+    return (uint32_t)DTC_Now_Ms();
+}
+
+// Callers hold wheel_lock
+static void wheel_unlink(uint16_t idx) {
+    uint16_t slot = wheel_deadline[idx] & (DTC_WHEEL_SLOTS - 1);
+    if (wheel_prev[idx] != DTC_WHEEL_NONE) {
+        wheel_next[wheel_prev[idx]] = wheel_next[idx];
+    } else {
+        wheel_head[slot] = wheel_next[idx];
+    }
+    if (wheel_next[idx] != DTC_WHEEL_NONE) {
+        wheel_prev[wheel_next[idx]] = wheel_prev[idx];
+    }
+    if (wheel_head[slot] == DTC_WHEEL_NONE) {
+        wheel_used[slot / 32] &= ~(1U << (slot % 32));
+    }
+    wheel_armed[idx] = false;
+}
+
+// Callers hold wheel_lock
+static void wheel_link(uint16_t idx, uint32_t deadline) {
+    uint16_t slot = deadline & (DTC_WHEEL_SLOTS - 1);
+    wheel_deadline[idx] = deadline;
+    wheel_prev[idx] = DTC_WHEEL_NONE;
+    wheel_next[idx] = wheel_head[slot];
+    if (wheel_head[slot] != DTC_WHEEL_NONE) {
+        wheel_prev[wheel_head[slot]] = idx;
+    }
+    wheel_head[slot] = idx;
+    wheel_used[slot / 32] |= 1U << (slot % 32);
+    wheel_armed[idx] = true;
+}
+
+// Callers hold wheel_lock. Time of the first occupied slot after `from`; false if the wheel is empty
+static bool wheel_next_due(uint32_t from, uint32_t *due) {
+    uint32_t offset = 1;
+    while (offset <= DTC_WHEEL_SLOTS) {
+        uint32_t slot = (from + offset) & (DTC_WHEEL_SLOTS - 1);
+        uint32_t bits = wheel_used[slot / 32] >> (slot % 32);
+        if (bits != 0) {
+            *due = from + offset + __builtin_ctz(bits);
+            return true;
+        }
+        offset += 32 - slot % 32;
+    }
+    return false;
+}
+
+/*
+ * Callers hold wheel_lock. (Re)start the one-shot timer for `due`; the
+ * esp_timer calls nest inside the critical section so an arm from the CAN
+ * task and a reschedule from the timer callback can't overtake each other.
+ */
+static void wheel_schedule(uint32_t due) {
+    if (wheel_timer == NULL) {
+        return;
+    }
+    int32_t wait_ms = (int32_t)(due - wheel_time_ms());
+    if (wait_ms < 1) {
+        wait_ms = 1; // Overdue slots are visited on the next callback
+    }
+    esp_timer_stop(wheel_timer); // May have expired with its callback still queued; ESP_ERR_INVALID_STATE then
+    wheel_scheduled = esp_timer_start_once(wheel_timer, (uint64_t)wait_ms * 1000) == ESP_OK;
+    wheel_due = due;
+}
+
+static void dtc_wheel_arm(uint16_t idx, uint64_t timeout_ms) {
+    // Wheel times are compared as signed 32-bit differences
+    if (timeout_ms > INT32_MAX) {
+        timeout_ms = INT32_MAX;
+    }
+    uint32_t deadline = wheel_time_ms() + (uint32_t)timeout_ms;
+    if (deadline == wheel_now) {
+        deadline++; // The current slot has already been visited
+    }
+
+    portENTER_CRITICAL(&wheel_lock);
+    if (wheel_armed[idx]) {
+        wheel_unlink(idx);
+    }
+    wheel_link(idx, deadline);
+    // Deadlines only move later while a device responds, so this rarely restarts the timer
+    if (!wheel_scheduled || (int32_t)(deadline - wheel_due) < 0) {
+        wheel_schedule(deadline);
+    }
+    portEXIT_CRITICAL(&wheel_lock);
+}
+
+// esp_timer callback: expire every device whose deadline has passed, then wait for the next occupied slot
+static void dtc_wheel_tick(void *arg) {
+    uint16_t expired[DTC_COUNT];
+    uint16_t expired_count = 0;
+    uint32_t now = wheel_time_ms();
+    uint32_t due;
+    (void)arg;
+
+    trace_event(TRACE_TASK_WAKE, TRACE_TASK_DTC, 0);
+    portENTER_CRITICAL(&wheel_lock);
+    wheel_scheduled = false;
+    // After a long sleep every slot only needs one visit
+    if ((int32_t)(now - wheel_now) > DTC_WHEEL_SLOTS) {
+        wheel_now = now - DTC_WHEEL_SLOTS;
+    }
+    while ((int32_t)(now - wheel_now) > 0) {
+        wheel_now++;
+        uint16_t idx = wheel_head[wheel_now & (DTC_WHEEL_SLOTS - 1)];
+        while (idx != DTC_WHEEL_NONE) {
+            uint16_t next = wheel_next[idx];
+            // Deadlines further than one revolution away share the slot; leave them armed
+            if ((int32_t)(wheel_deadline[idx] - now) <= 0) {
+                wheel_unlink(idx);
+                expired[expired_count++] = idx;
+            }
+            idx = next;
+        }
+    }
+    if (!wheel_scheduled && wheel_next_due(wheel_now, &due)) {
+        wheel_schedule(due);
+    }
+    portEXIT_CRITICAL(&wheel_lock);
+
+    for (uint16_t i = 0; i < expired_count; i++) {
+        if (dtc_devices[expired[i]] != NULL) {
+            dtc_set_state(dtc_devices[expired[i]], 0);
+        }
+    }
+    trace_event(TRACE_TASK_BLOCK, TRACE_TASK_DTC, expired_count);
+}
+
+// Create the one-shot esp_timer that drives the DTC deadline wheel and arm it for the devices DTC_Init queued
+esp_err_t dtc_start_timer(void) {
+    const esp_timer_create_args_t timer_args = {
+        .callback = dtc_wheel_tick,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "dtc_wheel",
+    };
+
+    esp_timer_handle_t timer;
+    esp_err_t ret = esp_timer_create(&timer_args, &timer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create DTC wheel timer: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    uint32_t due;
+    portENTER_CRITICAL(&wheel_lock);
+    wheel_timer = timer;
+    if (wheel_next_due(wheel_now, &due)) {
+        wheel_schedule(due);
+    }
+    portEXIT_CRITICAL(&wheel_lock);
+
+    ESP_LOGI(TAG, "DTC deadline wheel started (%d slots, one-shot timer)", DTC_WHEEL_SLOTS);
     return ESP_OK;
 }
 
 /**
  * @brief Initialize a CAN DTC (Diagnostic Trouble Code) structure
  * 
- * Sets up the DTC structure with initial values and allocates memory for the 
- * time buffer used to calculate average response times.
+ * Sets up the DTC structure with initial values and attaches its slot in the
+ * static sliding window array used to track the maximum response time.
  * 
  * @param dtc       Pointer to the can_dtc structure to initialize
  * @param index     Index of the DTC code in the array
- * @param measures  Goal number of measurements to calculate average response time
- * @param threshold Additional time above average before triggering error (in ms)
+ * @param measures  Number of measurements in the sliding window
+ * @param threshold Additional time above the window maximum before triggering error (in ms)
  * @param start_time Initial time to set for totalTime and prevTime
  * 
- * @note Memory allocation failure will set errState to 1 and log an error
+ * @note The window is seeded with start_time, which acts as the maximum until
+ *       `measures` real measurements have arrived
  */
 void DTC_CAN_Init_Device(can_dtc *dtc, uint8_t index, uint8_t measures, uint16_t threshold, uint64_t start_time){
     dtc->errState = 0; // Clear error state
     dtc->DTC_Idx = index; // Set DTC index
-    dtc->measures = measures; // Set goal number of measurements
-    dtc->bufferIndex = 0; // Initialize buffer index
+    dtc->measures = measures; // Set window length
     dtc->totalTime = start_time; // Reset total time
     dtc->prevTime = start_time; // Set previous time to start time
     dtc->threshold = threshold; // Set threshold for error state
-    dtc->timeBuffer = (uint64_t *)malloc(measures * sizeof(uint64_t)); // Allocate memory for time buffer
+    dtc->lastDelta = 0;
 
-    if (dtc->timeBuffer == NULL) {
-        // Handle memory allocation failure
+    if (index >= DTC_COUNT) {
+        dtc->window = NULL;
         dtc->errState = 1; // Set error state
-        ESP_LOGE(TAG, "Failed to allocate memory for DTC time buffer -> Index: %d", index);
-    }
-    for (int i = 0; i < measures; i++) {
-        dtc->timeBuffer[i] = start_time;
+        ESP_LOGE(TAG, "No DTC window slot for index %d", index);
+        return;
     }
+
+    dtc->window = &dtc_windows[index];
+    dtc_window_init(dtc->window, measures, (uint32_t)start_time);
+    dtc->windowMax = dtc_window_max(dtc->window);
 	return;
 }
 
 /**
  * @brief Add a new response time measurement to the CAN DTC structure
- * This function updates the time buffer with the latest response time,
+ * This function pushes the latest inter-arrival time into the sliding window
+ * and refreshes the cached window maximum (amortised O(1)).
  * 
  * @param dtc Pointer to the can_dtc structure to update
  * @param response_time Current response time in milliseconds
  */
 void DTC_CAN_Response_Measurement(can_dtc *dtc, uint64_t response_time) {
-    if (dtc == NULL || dtc->timeBuffer == NULL) {
-        ESP_LOGE(TAG, "Invalid DTC structure or time buffer -> Index: %d", dtc ? dtc->DTC_Idx : -1);
+    if (dtc == NULL || dtc->window == NULL) {
+        ESP_LOGE(TAG, "Invalid DTC structure or time window -> Index: %d", dtc ? dtc->DTC_Idx : -1);
         return;
     }
 
-    // Update the time buffer with the new response time
-    dtc->timeBuffer[dtc->bufferIndex] = response_time - dtc->prevTime; // Calculate time since last measurement
-    dtc->totalTime += dtc->timeBuffer[dtc->bufferIndex]; // Update total time
-    dtc->bufferIndex = (dtc->bufferIndex + 1) % dtc->measures; // Increment buffer index and wrap around if necessary
+    // Calculate time since last measurement; a negative one means the caller mixed time bases
+    int64_t elapsed = (int64_t)(response_time - dtc->prevTime);
+    if (elapsed < 0) {
+        DLOGE(TAG, "%s: response time %llu ms is before the previous one (%llu ms), dropped",
+              dtc_device_names[dtc->DTC_Idx], (unsigned long long)response_time, (unsigned long long)dtc->prevTime);
+        return;
+    }
+    // Only a gap of more than 49 days exceeds 32 bits
+    uint32_t delta = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
 
+    dtc->lastDelta = delta;
+    dtc_window_push(dtc->window, delta);
 
+    portENTER_CRITICAL(&stats_lock);
+    dtc_stats_push(&dtc_stats[stats_active][dtc->DTC_Idx], delta);
+    if (delta > stats_boot_max_gap[dtc->DTC_Idx]) {
+        stats_boot_max_gap[dtc->DTC_Idx] = delta;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+    dtc->windowMax = dtc_window_max(dtc->window);
+    dtc->totalTime += delta; // Update total time
 
     dtc->prevTime = response_time; // Update previous time to current response time
 
+    // A response clears the error straight away and pushes the deadline out
+    dtc_set_state(dtc, 1);
+    dtc_wheel_arm(dtc->DTC_Idx, (uint64_t)dtc->windowMax + dtc->threshold);
+
     return;
 }
 
 /**
  * @brief Update the error state of a CAN DTC based on response time
  * 
- * Checks if the current response time exceeds the average response time by a certain threshold.
- * If it does, sets the error state to indicate an error condition.
+ * Checks if the current response time exceeds the maximum response time in
+ * the window by a certain threshold. If it does, sets the error state to
+ * indicate an error condition. Constant time: the maximum is maintained by
+ * DTC_CAN_Response_Measurement.
  * 
  * @param dtc Pointer to the can_dtc structure to update
  * @param current_time Current time in milliseconds
  */
 void DTC_CAN_Update_Error_State(can_dtc *dtc, uint64_t current_time) {
-    if (dtc == NULL || dtc->timeBuffer == NULL) {
-        ESP_LOGE(TAG, "Invalid DTC structure or time buffer -> Index: %d", dtc ? dtc->DTC_Idx : -1);
+    if (dtc == NULL || dtc->window == NULL) {
+        ESP_LOGE(TAG, "Invalid DTC structure or time window -> Index: %d", dtc ? dtc->DTC_Idx : -1);
         return;
     }
 
     current_time = current_time - dtc->prevTime; // Calculate time since last measurement
 
-    // Find max in current buffer
-    uint64_t max_response = 0;
-    for (uint8_t i = 0; i < dtc->measures; i++) {
-        if (dtc->timeBuffer[i] > max_response) {
-            max_response = dtc->timeBuffer[i];
-        }
-    }
-    
     // Error if current response is much larger than recent maximum
-    if (current_time > (max_response + dtc->threshold)) {
-        dtc->errState = 0;
+    if (current_time > ((uint64_t)dtc->windowMax + dtc->threshold)) {
+        dtc_set_state(dtc, 0);
     }
     else {
-        dtc->errState = 1; // Clear error state if within threshold
+        dtc_set_state(dtc, 1); // Clear error state if within threshold
     }
 
     return;
 }
 
 void DTC_Init(uint64_t start_time){
+    for (int i = 0; i < DTC_WHEEL_SLOTS; i++) {
+        wheel_head[i] = DTC_WHEEL_NONE;
+    }
+    wheel_now = wheel_time_ms();
+
     for(int i = 0; i < DTC_COUNT; i++) {
-        dtc_devices[i] = (can_dtc *)malloc(sizeof(can_dtc));
-        if (dtc_devices[i] == NULL) {
-            ESP_LOGE(TAG, "Failed to allocate memory for DTC device %d", i);
-            continue;
-        }
+        dtc_devices[i] = &dtc_storage[i];
         DTC_CAN_Init_Device(dtc_devices[i], i, DTC_MEASURES, DTC_THRESHOLD_MS, start_time);
+        // Devices count as healthy until their first deadline passes
+        dtc_devices[i]->errState = 1;
+        dtc_status[i / 32] |= 1U << (i % 32);
+        dtc_wheel_arm(i, (uint64_t)dtc_devices[i]->windowMax + dtc_devices[i]->threshold);
     }
 
 }
 
+// Full poll of every device, independent of the deadline wheel
 void DTC_Error_Check(uint64_t current_time) {
     for (int i = 0; i < DTC_COUNT; i++) {
         if (dtc_devices[i] != NULL) {
@@ -170,4 +397,135 @@ void DTC_Error_Check(uint64_t current_time) {
             ESP_LOGE(TAG, "DTC device %d is NULL", i);
         }
     }
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Packed errState of every device (bit i of word i / 32 = device i, 1 = OK)
+ *
+ * One relaxed 32-bit load per word; replaces reading errState through
+ * dtc_devices[] one device at a time.
+ */
+void DTC_Get_Status(uint32_t status[DTC_STATUS_WORDS]) {
+    for (int w = 0; w < DTC_STATUS_WORDS; w++) {
+        status[w] = __atomic_load_n(&dtc_status[w], __ATOMIC_RELAXED);
+    }
+}
+
+// Summary word logged next to the bitmap, see DTC_HEALTH_* in dtc.h
+uint16_t DTC_Get_Health(void) {
+    uint32_t status[DTC_STATUS_WORDS];
+    DTC_Get_Status(status);
+    uint16_t errors = 0;
+    for (int w = 0; w < DTC_STATUS_WORDS; w++) {
+        int bits = DTC_COUNT - 32 * w;
+        uint32_t valid = bits >= 32 ? UINT32_MAX : ((1U << bits) - 1);
+        errors += __builtin_popcount(~status[w] & valid);
+    }
+    uint16_t health = errors > DTC_HEALTH_ERR_COUNT_MASK ? DTC_HEALTH_ERR_COUNT_MASK : errors;
+
+    if (errors > 0) {
+        health |= DTC_HEALTH_ANY_ERROR;
+    }
+    if (dtc_journal_dropped() > 0) {
+        health |= DTC_HEALTH_JOURNAL_DROP;
+    }
+    if (wheel_timer == NULL) {
+        health |= DTC_HEALTH_WHEEL_STOPPED;
+    }
+    return health;
+}
+
+// Copy of a device's last completed interval, taken under the stats lock
+static void stats_snapshot(int idx, dtc_stats_t *out) {
+    portENTER_CRITICAL(&stats_lock);
+    *out = dtc_stats[stats_done][idx];
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+/**
+ * @brief Close the current statistics interval
+ *
+ * Makes the interval just measured available to readers, then updates every
+ * device's baseline and drift flag. A device drifts when its interval mean
+ * exceeds DTC_STATS_DRIFT_RATIO times the lowest mean it has shown, which
+ * catches a slowing source long before it reaches the DTC deadline.
+ */
+static void stats_roll(void) {
+    // Neither the CAN task nor a reader can reach the spare bank, so it is cleared outside the lock
+    uint8_t spare = 3 - stats_active - stats_done;
+    for (int i = 0; i < DTC_COUNT; i++) {
+        dtc_stats_reset(&dtc_stats[spare][i]);
+    }
+    portENTER_CRITICAL(&stats_lock);
+    stats_done = stats_active;
+    stats_active = spare;
+    portEXIT_CRITICAL(&stats_lock);
+
+    // Only this task moves stats_done, and nothing writes the done bank
+    for (int i = 0; i < DTC_COUNT; i++) {
+        const dtc_stats_t *s = &dtc_stats[stats_done][i];
+        if (s->count < DTC_STATS_MIN_SAMPLES) {
+            continue;
+        }
+        if (stats_baseline_mean[i] == 0.0f || s->mean < stats_baseline_mean[i]) {
+            stats_baseline_mean[i] = s->mean;
+        }
+
+        bool drifting = s->mean > stats_baseline_mean[i] * DTC_STATS_DRIFT_RATIO;
+        if (drifting && !stats_drifting[i]) {
+            ESP_LOGW(TAG, "%s period drifting: %.1f ms (baseline %.1f ms, p99 %lu ms)", dtc_device_names[i],
+                     s->mean, stats_baseline_mean[i], (unsigned long)dtc_stats_percentile(s, 99));
+        }
+        stats_drifting[i] = drifting;
+    }
+}
+
+// Append the last completed interval to <log>_jitter.csv
+static void stats_write_log(void) {
+    FILE *f = log_file_open_sidecar(DTC_STATS_SUFFIX, "time_ms,device,count,mean_ms,std_ms,p50_ms,p99_ms,max_ms,drift\n");
+    if (f == NULL) {
+        return;
+    }
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    for (int i = 0; i < DTC_COUNT; i++) {
+        const dtc_stats_t *s = &dtc_stats[stats_done][i];
+        if (s->count == 0) {
+            continue;
+        }
+        fprintf(f, "%lu,%s,%lu,%.2f,%.2f,%lu,%lu,%lu,%d\n", (unsigned long)now_ms, dtc_device_names[i],
+                (unsigned long)s->count, s->mean, sqrtf(dtc_stats_variance(s)),
+                (unsigned long)dtc_stats_percentile(s, 50), (unsigned long)dtc_stats_percentile(s, 99),
+                (unsigned long)s->max_gap, stats_drifting[i]);
+    }
+    fclose(f);
+}
+
+static void dtc_stats_task(void *pvParameters) {
+    (void)pvParameters;
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(DTC_STATS_PERIOD_MS));
+        stats_roll();
+        stats_write_log();
+    }
+}
+
+esp_err_t dtc_start_stats_task(void) {
+    return tasks_create(TASK_DTC_STATS, dtc_stats_task, NULL, NULL);
+}
+
+// Console table of the last completed statistics interval
+void DTC_Print_Stats(void) {
+    printf("Interval: %d ms, '*' = mean above %.1fx baseline\n", DTC_STATS_PERIOD_MS, DTC_STATS_DRIFT_RATIO);
+    printf("%-20s %6s %8s %7s %5s %5s %5s %8s %9s\n", "Device", "count", "mean_ms", "std_ms", "p50", "p99", "max",
+           "boot_max", "base_ms");
+    for (int i = 0; i < DTC_COUNT; i++) {
+        dtc_stats_t s;
+        stats_snapshot(i, &s);
+        printf("%-20s %6lu %8.2f %7.2f %5lu %5lu %5lu %8lu %9.2f%s\n", dtc_device_names[i], (unsigned long)s.count,
+               s.mean, sqrtf(dtc_stats_variance(&s)), (unsigned long)dtc_stats_percentile(&s, 50),
+               (unsigned long)dtc_stats_percentile(&s, 99), (unsigned long)s.max_gap,
+               (unsigned long)stats_boot_max_gap[i], stats_baseline_mean[i], stats_drifting[i] ? " *" : "");
+    }
+}
@@ -1,9 +1,13 @@
 #ifndef INC_DTC_H_
 #define INC_DTC_H_
 
+#include <assert.h>
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "dtc_window.h"
+#include "dtc_devices.h"
+#include "dtc_stats.h"
 
 
 // DTC Bitwise Macros for Updating the Code Status
@@ -13,7 +17,12 @@
 
 #define DTC_THRESHOLD_MS 20
 #define DTC_CHECK_INTERVAL_MS 1000 // 1 second interval for DTC checks
-#define DTC_MEASURES 64 // Number of measures to calculate average response time
+#define DTC_WHEEL_SLOTS 256 // Deadline timer wheel slots, 1 ms apart (power of 2, at least 32)
+#define DTC_WHEEL_NONE 0xFFFF // End of a wheel slot list
+#define DTC_STATS_PERIOD_MS 5000 // Jitter statistics interval, also the jitter log period
+#define DTC_STATS_MIN_SAMPLES 10 // Intervals with fewer measurements don't update baselines
+#define DTC_STATS_DRIFT_RATIO 1.5f // Mean above this multiple of the baseline flags drift
+#define DTC_STATS_SUFFIX "_jitter.csv"
 extern uint32_t DTC_PREV_CHECK_TIME;
 
 typedef struct {
@@ -21,41 +30,18 @@ typedef struct {
 	uint8_t DTC_Idx; // Index of the DTC Code in the Array
 	
     //Corresponds to the 32 addresses in the DTC Code Handler
-	uint8_t measures; // Goal Number of Measurements to Calculate Average Response Time (MAX: 256)
-	uint8_t bufferIndex; // Index of the Current Measurement in the Buffer
+	uint8_t measures; // Number of Measurements in the Sliding Window (MAX: DTC_MEASURES)
 
 	uint64_t totalTime; //Time (ms) from Last Average Response Time Calculation
 	//This data can be received from the CAN_RDTxR register (I copied the data type hehe)
 	uint64_t prevTime;
 	uint16_t threshold; //Store the percentage of avg response time over allowed before throwing an error
-	uint64_t *timeBuffer; //Buffer to Store the Last N Response Times (N = measures)
+	volatile uint32_t windowMax; //Largest Response Time in the Window, refreshed on every measurement
+	uint32_t lastDelta; //Most Recent Response Time (ms)
+	dtc_window_t *window; //Sliding Window of the Last N Response Times (N = measures)
 
 }can_dtc; //This name needs work I know... <- Have confidence, can_dtc is a great name!
 
-#define DTC_DEVICES \
-    X(frWheelBoard_DTC) \
-    X(flWheelBoard_DTC) \
-    X(rrWheelBoard_DTC) \
-    X(rlWheelBoard_DTC) \
-    X(fBrakePress_DTC) \
-    X(rBrakePress_DTC) \
-    X(steer_DTC) \
-    X(flShock_DTC) \
-    X(frShock_DTC) \
-    X(rlShock_DTC) \
-    X(rrShock_DTC) \
-    X(flStrainGauge_DTC) \
-    X(frStrainGauge_DTC) \
-    X(rlStrainGauge_DTC) \
-    X(rrStrainGauge_DTC) \
-    X(imu_DTC) \
-    X(brakeNthrottle_DTC) \
-    X(gps_0_DTC) \
-    X(gps_1_DTC) \
-    X(shifter_DTC)
-
-
-
 // DTC Index Enum
 typedef enum {
     #define X(device) device,
@@ -68,15 +54,31 @@ extern const char* dtc_device_names[DTC_COUNT];
 
 extern can_dtc *dtc_devices[DTC_COUNT];
 
+// Packed status of every device: bit i = errState of device i (1 = OK, 0 = Error).
+// Words are updated with atomic and/or so readers never need a lock.
+extern volatile uint32_t dtc_status[DTC_STATUS_WORDS];
+static_assert(DTC_STATUS_WORDS == (DTC_COUNT + 31) / 32, "DTC_STATUS_WORDS in dtc_devices.h must be ceil(DTC_COUNT / 32)");
+
+// DTC_HEALTH word layout
+#define DTC_HEALTH_ERR_COUNT_MASK 0x00FF // Devices currently in error
+#define DTC_HEALTH_ANY_ERROR      (1U << 8)
+#define DTC_HEALTH_JOURNAL_DROP   (1U << 9)  // DTC journal has dropped entries
+#define DTC_HEALTH_WHEEL_STOPPED  (1U << 10) // Deadline timer not running, states are stale
+
 
+// DTC time base (esp_timer milliseconds): every time passed to the functions below uses it
+uint64_t DTC_Now_Ms(void);
 void DTC_CAN_Init_Device(can_dtc *dtc, uint8_t index, uint8_t measures, uint16_t threshold, uint64_t start_time);
 void DTC_CAN_Update_Error_State(can_dtc *dtc, uint64_t current_time);
 void DTC_CAN_Response_Measurement(can_dtc *dtc, uint64_t response_time);
 void DTC_Init(uint64_t start_time);
 void DTC_Error_Check(uint64_t current_time);
 
-void dtc_task(void *pvParameters);
-esp_err_t dtc_start_task(void);
+esp_err_t dtc_start_timer(void);
+void DTC_Get_Status(uint32_t status[DTC_STATUS_WORDS]);
+uint16_t DTC_Get_Health(void);
+esp_err_t dtc_start_stats_task(void);
+void DTC_Print_Stats(void);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,39 @@
+/*
+ * dtc_devices.h
+ *
+ * Monitored DTC devices. Kept free of ESP-IDF includes so host tools can
+ * expand the DTC_MAP bitmap back into named per-device traces.
+ * Bit i of DTC_MAP is the errState of the i-th device listed here.
+ */
+#ifndef INC_DTC_DEVICES_H_
+#define INC_DTC_DEVICES_H_
+
+#define DTC_DEVICES \
+    X(frWheelBoard_DTC) \
+    X(flWheelBoard_DTC) \
+    X(rrWheelBoard_DTC) \
+    X(rlWheelBoard_DTC) \
+    X(fBrakePress_DTC) \
+    X(rBrakePress_DTC) \
+    X(steer_DTC) \
+    X(flShock_DTC) \
+    X(frShock_DTC) \
+    X(rlShock_DTC) \
+    X(rrShock_DTC) \
+    X(flStrainGauge_DTC) \
+    X(frStrainGauge_DTC) \
+    X(rlStrainGauge_DTC) \
+    X(rrStrainGauge_DTC) \
+    X(imu_DTC) \
+    X(brakeNthrottle_DTC) \
+    X(gps_0_DTC) \
+    X(gps_1_DTC) \
+    X(shifter_DTC)
+
+// 32-bit status words needed for the list above: ceil(device count / 32).
+// The preprocessor cannot count DTC_DEVICES, so this is kept by hand and
+// dtc.h fails the build when it disagrees with DTC_COUNT. log_chnl.h sizes
+// the DTC_MAP channel from it (up to 8 words / 256 devices).
+#define DTC_STATUS_WORDS 1
+
+#endif /* INC_DTC_DEVICES_H_ */
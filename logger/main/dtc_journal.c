@@ -0,0 +1,170 @@
+#include "dtc_journal.h"
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "dtc.h"
+#include "sdcard.h"
+
+static const char *TAG = "DTC_JOURNAL";
+
+static QueueHandle_t journal_queue = NULL;
+static uint8_t journal_queue_storage[DTC_JOURNAL_QUEUE_LEN * sizeof(dtc_journal_entry_t)];
+static StaticQueue_t journal_queue_buffer;
+static uint32_t dropped_entries = 0;
+static uint8_t boot_id = 0;
+
+static int64_t last_write_us = 0;
+static int64_t last_nvs_commit_us = 0;
+
+// RAM copy of the NVS fallback ring
+static dtc_journal_ring_t nvs_ring;
+static bool nvs_ring_dirty = false;
+
+const uint32_t dtc_journal_ram_bytes = sizeof(journal_queue_storage) + sizeof(journal_queue_buffer) + sizeof(nvs_ring);
+
+/**
+ * @brief Queue a DTC transition for the journal
+ *
+ * Never blocks; safe from the esp_timer task and the CAN task. Entries are
+ * dropped (and counted) if the log writer falls behind.
+ */
+void dtc_journal_record(uint8_t device, uint8_t old_state, uint8_t new_state, uint32_t last_delta_ms) {
+    if (journal_queue == NULL) {
+        return;
+    }
+
+    dtc_journal_entry_t entry = {
+        .time_us = (uint64_t)esp_timer_get_time(),
+        .last_delta_ms = last_delta_ms,
+        .device = device,
+        .old_state = old_state,
+        .new_state = new_state,
+        .boot = boot_id,
+    };
+    if (xQueueSend(journal_queue, &entry, 0) != pdTRUE) {
+        __atomic_fetch_add(&dropped_entries, 1, __ATOMIC_RELAXED);
+    }
+}
+
+uint32_t dtc_journal_dropped(void) {
+    return __atomic_load_n(&dropped_entries, __ATOMIC_RELAXED);
+}
+
+static bool write_header(FILE *f) {
+    char names[DTC_COUNT * 24];
+    size_t names_len = 0;
+    for (int i = 0; i < DTC_COUNT; i++) {
+        int written = snprintf(names + names_len, sizeof(names) - names_len, "%s,", dtc_device_names[i]);
+        if (written < 0 || names_len + written >= sizeof(names)) {
+            ESP_LOGW(TAG, "Device name table truncated");
+            break;
+        }
+        names_len += written;
+    }
+
+    uint16_t version = DTC_JOURNAL_VERSION;
+    uint16_t entry_size = sizeof(dtc_journal_entry_t);
+    uint32_t len = names_len;
+    return fwrite(DTC_JOURNAL_MAGIC, 1, 4, f) == 4 &&
+           fwrite(&version, sizeof(version), 1, f) == 1 &&
+           fwrite(&entry_size, sizeof(entry_size), 1, f) == 1 &&
+           fwrite(&len, sizeof(len), 1, f) == 1 &&
+           fwrite(names, 1, names_len, f) == names_len;
+}
+
+// The journal of the current log, created with its header on first use; NULL while no log is open
+static FILE *journal_open(void) {
+    FILE *f = log_file_open_sidecar(DTC_JOURNAL_SUFFIX, NULL);
+    if (f != NULL && ftell(f) == 0 && !write_header(f)) {
+        ESP_LOGE(TAG, "Failed to write DTC journal header");
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+static void ring_push(const dtc_journal_entry_t *entry) {
+    uint16_t tail = (nvs_ring.head + nvs_ring.count) % DTC_JOURNAL_NVS_ENTRIES;
+    nvs_ring.entries[tail] = *entry;
+    if (nvs_ring.count < DTC_JOURNAL_NVS_ENTRIES) {
+        nvs_ring.count++;
+    } else {
+        // Full: overwrite the oldest entry
+        nvs_ring.head = (nvs_ring.head + 1) % DTC_JOURNAL_NVS_ENTRIES;
+    }
+    nvs_ring_dirty = true;
+}
+
+// Move entries held in the NVS ring into the SD journal
+static void ring_drain(FILE *f) {
+    nvs_ring_dirty = true;
+    while (nvs_ring.count > 0) {
+        if (fwrite(&nvs_ring.entries[nvs_ring.head], sizeof(dtc_journal_entry_t), 1, f) != 1) {
+            return;
+        }
+        nvs_ring.head = (nvs_ring.head + 1) % DTC_JOURNAL_NVS_ENTRIES;
+        nvs_ring.count--;
+    }
+    nvs_ring.head = 0;
+    ESP_LOGI(TAG, "Recovered DTC journal entries from NVS");
+}
+
+/*
+ * Called by the log writer between record batches, so the card keeps a
+ * single writer. Transitions are rare: a batch is one open, append and close
+ * of the journal at most every DTC_JOURNAL_FLUSH_MS, and nothing stays
+ * buffered in an open FILE between batches.
+ */
+void dtc_journal_write(void) {
+    if (journal_queue == NULL) {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+    UBaseType_t waiting = uxQueueMessagesWaiting(journal_queue);
+    if (now_us - last_write_us < (int64_t)DTC_JOURNAL_FLUSH_MS * 1000 && waiting < DTC_JOURNAL_QUEUE_LEN / 2) {
+        return;
+    }
+    last_write_us = now_us;
+
+    if (waiting > 0 || nvs_ring.count > 0) {
+        FILE *f = journal_open();
+        if (f != NULL && nvs_ring.count > 0) {
+            ring_drain(f);
+        }
+        dtc_journal_entry_t entry;
+        while (xQueueReceive(journal_queue, &entry, 0) == pdTRUE) {
+            if (f == NULL || fwrite(&entry, sizeof(entry), 1, f) != 1) {
+                ring_push(&entry);
+            }
+        }
+        if (f != NULL) {
+            fclose(f);
+        }
+    }
+
+    if (nvs_ring_dirty && now_us - last_nvs_commit_us >= (int64_t)DTC_JOURNAL_NVS_INTERVAL_MS * 1000) {
+        if (nvs_set_dtc_ring(&nvs_ring) == ESP_OK) {
+            nvs_ring_dirty = false;
+        }
+        last_nvs_commit_us = now_us;
+    }
+}
+
+esp_err_t dtc_journal_init(void) {
+    if (nvs_increment_boot_count(&boot_id) != ESP_OK) {
+        ESP_LOGW(TAG, "No boot count, journal entries of this boot may not be told apart from the last one");
+    }
+    if (nvs_get_dtc_ring(&nvs_ring) != ESP_OK) {
+        memset(&nvs_ring, 0, sizeof(nvs_ring));
+    }
+    if (nvs_ring.count > 0) {
+        ESP_LOGI(TAG, "%u DTC journal entries pending in NVS", nvs_ring.count);
+    }
+
+    journal_queue = xQueueCreateStatic(DTC_JOURNAL_QUEUE_LEN, sizeof(dtc_journal_entry_t), journal_queue_storage,
+                                       &journal_queue_buffer);
+    return ESP_OK;
+}
@@ -0,0 +1,58 @@
+/*
+ * dtc_journal.h
+ *
+ * Binary journal of DTC state transitions. Entries are queued from the DTC
+ * engine and appended in batches by the log writer task, the card's only
+ * writer, to a companion file of the current log (<log>_dtc.bin). While the
+ * SD card is unavailable they are
+ * kept in a small ring persisted to NVS and moved to the card once it is back,
+ * possibly after a reboot: time_us restarts at every boot, so each entry
+ * carries the boot it was recorded in.
+ *
+ * File layout (little-endian):
+ *   char     magic[4]      "DTCJ"
+ *   uint16_t version
+ *   uint16_t entry_size
+ *   uint32_t names_len
+ *   char     names[names_len]   comma-terminated device names, index = device id
+ *   dtc_journal_entry_t entries[]
+ */
+#ifndef INC_DTC_JOURNAL_H_
+#define INC_DTC_JOURNAL_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define DTC_JOURNAL_MAGIC "DTCJ"
+#define DTC_JOURNAL_VERSION 2 // v1: no boot id (always 0)
+#define DTC_JOURNAL_SUFFIX "_dtc.bin"
+#define DTC_JOURNAL_QUEUE_LEN 64
+#define DTC_JOURNAL_FLUSH_MS 1000        // Longest time an entry waits for the log writer (sooner if half the queue is used)
+#define DTC_JOURNAL_NVS_ENTRIES 32       // Fallback ring depth while the SD card is missing
+#define DTC_JOURNAL_NVS_INTERVAL_MS 5000 // Minimum time between NVS ring commits (flash wear)
+
+typedef struct __attribute__((packed)) {
+    uint64_t time_us;       // esp_timer time of the transition (TS base x1000), within boot
+    uint32_t last_delta_ms; // Last measured inter-arrival time of the device
+    uint8_t device;         // DTC_Channel index
+    uint8_t old_state;      // errState before (1 = OK, 0 = Error)
+    uint8_t new_state;      // errState after
+    uint8_t boot;           // Low byte of the NVS boot count; entries of one boot share a time base
+} dtc_journal_entry_t;
+
+typedef struct {
+    uint16_t head;   // Index of the oldest entry
+    uint16_t count;
+    dtc_journal_entry_t entries[DTC_JOURNAL_NVS_ENTRIES];
+} dtc_journal_ring_t;
+
+esp_err_t dtc_journal_init(void);
+void dtc_journal_record(uint8_t device, uint8_t old_state, uint8_t new_state, uint32_t last_delta_ms);
+
+/**
+ * @brief Append the queued entries to the journal, or to the NVS ring without a card (log writer task)
+ */
+void dtc_journal_write(void);
+uint32_t dtc_journal_dropped(void);
+
+#endif /* INC_DTC_JOURNAL_H_ */
@@ -0,0 +1,75 @@
+/*
+ * dtc_stats.h
+ *
+ * Streaming inter-arrival statistics for a DTC device: running mean and
+ * variance (Welford), the largest gap, and a fixed 1 ms bucket histogram for
+ * percentiles. Each push is O(1) with no allocation. Header-only and free of
+ * ESP-IDF dependencies so host tools can include it directly.
+ */
+#ifndef INC_DTC_STATS_H_
+#define INC_DTC_STATS_H_
+
+#include <stdint.h>
+
+#define DTC_STATS_BUCKETS 64 // 1 ms buckets; the last one collects every gap >= 63 ms
+
+typedef struct {
+    uint32_t count;
+    float mean;    // ms
+    float m2;      // Sum of squared differences from the mean (Welford)
+    uint32_t max_gap;
+    uint32_t hist[DTC_STATS_BUCKETS];
+} dtc_stats_t;
+
+static inline void dtc_stats_reset(dtc_stats_t *s) {
+    s->count = 0;
+    s->mean = 0.0f;
+    s->m2 = 0.0f;
+    s->max_gap = 0;
+    for (int i = 0; i < DTC_STATS_BUCKETS; i++) {
+        s->hist[i] = 0;
+    }
+}
+
+static inline void dtc_stats_push(dtc_stats_t *s, uint32_t delta_ms) {
+    s->count++;
+    float d = (float)delta_ms - s->mean;
+    s->mean += d / (float)s->count;
+    s->m2 += d * ((float)delta_ms - s->mean);
+
+    if (delta_ms > s->max_gap) {
+        s->max_gap = delta_ms;
+    }
+    s->hist[delta_ms < DTC_STATS_BUCKETS ? delta_ms : DTC_STATS_BUCKETS - 1]++;
+}
+
+static inline float dtc_stats_variance(const dtc_stats_t *s) {
+    return s->count > 1 ? s->m2 / (float)(s->count - 1) : 0.0f;
+}
+
+/**
+ * @brief Percentile of the recorded gaps, to 1 ms resolution
+ *
+ * @param pct Percentile (0-100)
+ * @return Gap in ms; DTC_STATS_BUCKETS - 1 means "at least that long"
+ */
+static inline uint32_t dtc_stats_percentile(const dtc_stats_t *s, uint32_t pct) {
+    if (s->count == 0) {
+        return 0;
+    }
+    // Smallest bucket whose cumulative count reaches ceil(count * pct / 100)
+    uint32_t rank = (uint32_t)(((uint64_t)s->count * pct + 99) / 100);
+    if (rank == 0) {
+        rank = 1;
+    }
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < DTC_STATS_BUCKETS; i++) {
+        seen += s->hist[i];
+        if (seen >= rank) {
+            return i;
+        }
+    }
+    return DTC_STATS_BUCKETS - 1;
+}
+
+#endif /* INC_DTC_STATS_H_ */
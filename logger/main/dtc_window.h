@@ -0,0 +1,69 @@
+/*
+ * dtc_window.h
+ *
+ * Sliding-window maximum of DTC inter-arrival times, kept incrementally as a
+ * monotonic deque so the current maximum is always at the front. Push is
+ * amortised O(1) and reading the maximum is O(1), replacing the scan over
+ * every buffered measurement. Header-only and free of ESP-IDF dependencies
+ * so the host benchmark can include it directly.
+ */
+#ifndef INC_DTC_WINDOW_H_
+#define INC_DTC_WINDOW_H_
+
+#include <stdint.h>
+
+#define DTC_MEASURES 64 // Number of measures in the sliding window (max 128, sequence numbers are 8-bit)
+
+typedef struct {
+    uint32_t delta[DTC_MEASURES]; // Deque storage, decreasing from head to tail
+    uint8_t seq[DTC_MEASURES];    // Measurement number each entry was pushed at
+    uint8_t head;                 // Ring index of the front entry (the window maximum)
+    uint8_t count;                // Entries currently in the deque
+    uint8_t next_seq;             // Sequence number of the next measurement
+    uint8_t span;                 // Window length in measurements (<= DTC_MEASURES)
+} dtc_window_t;
+
+/**
+ * @brief Reset the window to hold a single seed value
+ *
+ * The seed behaves like a full window of identical measurements: it is the
+ * maximum until `span` real measurements have been pushed.
+ */
+static inline void dtc_window_init(dtc_window_t *w, uint8_t span, uint32_t seed) {
+    w->span = (span == 0 || span > DTC_MEASURES) ? DTC_MEASURES : span;
+    w->head = 0;
+    w->count = 1;
+    w->delta[0] = seed;
+    w->seq[0] = 0;
+    w->next_seq = 1;
+}
+
+static inline void dtc_window_push(dtc_window_t *w, uint32_t delta) {
+    uint8_t seq_now = w->next_seq++;
+
+    // Drop the front once it falls out of the last `span` measurements
+    while (w->count > 0 && (uint8_t)(seq_now - w->seq[w->head]) >= w->span) {
+        w->head = (w->head + 1) % DTC_MEASURES;
+        w->count--;
+    }
+
+    // Entries smaller than the new one can never be the maximum again
+    while (w->count > 0) {
+        uint8_t back = (w->head + w->count - 1) % DTC_MEASURES;
+        if (w->delta[back] > delta) {
+            break;
+        }
+        w->count--;
+    }
+
+    uint8_t tail = (w->head + w->count) % DTC_MEASURES;
+    w->delta[tail] = delta;
+    w->seq[tail] = seq_now;
+    w->count++;
+}
+
+static inline uint32_t dtc_window_max(const dtc_window_t *w) {
+    return w->count > 0 ? w->delta[w->head] : 0;
+}
+
+#endif /* INC_DTC_WINDOW_H_ */
@@ -0,0 +1,104 @@
+#include "filexfer.h"
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "uart.h"
+#include "sdcard.h"
+#include "telemetry.h"
+#include "filexfer_core.h"
+
+static const char *TAG = "FILEXFER";
+
+static size_t xfer_read(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms) {
+    return uart_console_read(buf, len, pdMS_TO_TICKS(timeout_ms));
+}
+
+static void xfer_write(void *ctx, const uint8_t *buf, size_t len) {
+    uart_write_bytes(UART_PORT, (const char *)buf, len);
+}
+
+// Give the SD card back to the log writer between chunks
+static void xfer_yield(void *ctx) {
+    taskYIELD();
+}
+
+void filexfer_list(void) {
+    if (!sdcard_is_initialized()) {
+        printf("SD card not mounted\n");
+        return;
+    }
+
+    DIR *dir = opendir(MOUNT_POINT);
+    if (dir == NULL) {
+        printf("Cannot open %s\n", MOUNT_POINT);
+        return;
+    }
+
+    const char *current = sdcard_get_current_log_filename();
+    struct dirent *entry;
+    uint32_t files = 0;
+    uint64_t total = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        char path[MAX_FILE_NAME_LENGTH];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s%s", MOUNT_POINT, entry->d_name);
+        if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        bool active = current != NULL && strstr(current, entry->d_name) != NULL;
+        printf("%10lu  %s%s\n", (unsigned long)st.st_size, entry->d_name, active ? "  (logging)" : "");
+        files++;
+        total += st.st_size;
+    }
+    closedir(dir);
+    printf("%lu files, %llu bytes\n", (unsigned long)files, (unsigned long long)total);
+}
+
+/**
+ * @brief Serve file downloads on the console port until the host quits
+ *
+ * Runs on the console task. Logging continues throughout: the task drops to
+ * FILEXFER_PRIORITY and yields after every chunk.
+ */
+esp_err_t filexfer_run(void) {
+    if (!sdcard_is_initialized()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (telemetry_active()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    printf("%s %d\n", FILEXFER_READY, FILEXFER_BAUD);
+    fflush(stdout);
+    uart_wait_tx_done(UART_PORT, pdMS_TO_TICKS(100));
+
+    UBaseType_t priority = uxTaskPriorityGet(NULL);
+    vTaskPrioritySet(NULL, FILEXFER_PRIORITY);
+    esp_log_level_set("*", ESP_LOG_NONE);
+    uart_set_baudrate(UART_PORT, FILEXFER_BAUD);
+
+    const filexfer_io_t io = {
+        .read = xfer_read,
+        .write = xfer_write,
+        .yield = xfer_yield,
+        .ctx = NULL,
+        .root = MOUNT_POINT,
+    };
+    filexfer_stats_t stats = {0};
+    int result = filexfer_serve(&io, &stats);
+
+    uart_wait_tx_done(UART_PORT, pdMS_TO_TICKS(100));
+    uart_set_baudrate(UART_PORT, TELEMETRY_CONSOLE_BAUD);
+    esp_log_level_set("*", CONFIG_LOG_DEFAULT_LEVEL);
+    vTaskPrioritySet(NULL, priority);
+
+    ESP_LOGI(TAG, "Transfer session %s: %lu requests, %lu chunks, %llu bytes, %lu bad frames",
+             result == 0 ? "closed" : "timed out", (unsigned long)stats.requests, (unsigned long)stats.chunks,
+             (unsigned long long)stats.bytes, (unsigned long)stats.bad_frames);
+    return ESP_OK;
+}
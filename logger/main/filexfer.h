@@ -0,0 +1,21 @@
+/*
+ * filexfer.h
+ *
+ * Log file download over the console UART. 'ls' lists the SD card; 'xfer'
+ * switches the port to FILEXFER_BAUD and serves the protocol described in
+ * filexfer_core.h until the host quits or goes quiet. The transfer runs at
+ * FILEXFER_PRIORITY, below the log writer, so active logging is not starved.
+ * The host client is tools/benji_fetch.
+ */
+#ifndef INC_FILEXFER_H_
+#define INC_FILEXFER_H_
+
+#include "esp_err.h"
+
+#define FILEXFER_BAUD 921600
+#define FILEXFER_PRIORITY 1 // Console task priority while serving
+
+void filexfer_list(void);
+esp_err_t filexfer_run(void);
+
+#endif /* INC_FILEXFER_H_ */
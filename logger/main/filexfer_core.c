@@ -0,0 +1,235 @@
+#include "filexfer_core.h"
+#include <stdio.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define FILEXFER_PATH_LENGTH 160
+
+// Frame buffers are static: the server runs on one task at a time and the
+// console task stack is too small to hold them
+static uint8_t rx_block[TELEM_MAX_ENCODED];
+static uint8_t rx_frame[TELEM_MAX_FRAME];
+static uint8_t tx_payload[TELEM_MAX_PAYLOAD];
+static uint8_t tx_scratch[TELEM_MAX_FRAME];
+static uint8_t tx_encoded[TELEM_MAX_ENCODED];
+
+static FILE *xfer_file = NULL;
+
+static void send_frame(const filexfer_io_t *io, uint8_t type, uint16_t seq, size_t len) {
+    size_t encoded = telem_frame_encode(type, seq, tx_payload, len, tx_scratch, tx_encoded);
+    if (encoded > 0) {
+        io->write(io->ctx, tx_encoded, encoded);
+    }
+}
+
+static void send_error(const filexfer_io_t *io, uint16_t seq, const char *message) {
+    size_t len = strlen(message);
+    memcpy(tx_payload, message, len);
+    send_frame(io, FILEXFER_ERROR, seq, len);
+}
+
+// Only plain names inside the served directory
+static int build_path(const filexfer_io_t *io, const uint8_t *name, size_t len, char *path) {
+    if (len == 0 || len >= FILEXFER_PATH_LENGTH - strlen(io->root)) {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (name[i] == '/' || name[i] == '\\' || name[i] < 32) {
+            return -1;
+        }
+    }
+    if (len == 2 && name[0] == '.' && name[1] == '.') {
+        return -1;
+    }
+    snprintf(path, FILEXFER_PATH_LENGTH, "%s%.*s", io->root, (int)len, (const char *)name);
+    return 0;
+}
+
+static void handle_list(const filexfer_io_t *io, uint16_t seq) {
+    DIR *dir = opendir(io->root);
+    if (dir == NULL) {
+        send_error(io, seq, "cannot open directory");
+        return;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char path[FILEXFER_PATH_LENGTH];
+        size_t name_len = strlen(entry->d_name);
+        struct stat st;
+        if (build_path(io, (const uint8_t *)entry->d_name, name_len, path) != 0 || stat(path, &st) != 0 ||
+            !S_ISREG(st.st_mode)) {
+            continue;
+        }
+        filexfer_put_u32(tx_payload, (uint32_t)st.st_size);
+        memcpy(tx_payload + 4, entry->d_name, name_len);
+        send_frame(io, FILEXFER_ENTRY, seq, 4 + name_len);
+    }
+    closedir(dir);
+    send_frame(io, FILEXFER_ACK, seq, 0);
+}
+
+static void handle_open(const filexfer_io_t *io, uint16_t seq, const uint8_t *payload, size_t len) {
+    char path[FILEXFER_PATH_LENGTH];
+    if (build_path(io, payload, len, path) != 0) {
+        send_error(io, seq, "invalid name");
+        return;
+    }
+
+    if (xfer_file != NULL) {
+        fclose(xfer_file);
+    }
+    xfer_file = fopen(path, "rb");
+    if (xfer_file == NULL) {
+        send_error(io, seq, "not found");
+        return;
+    }
+
+    fseek(xfer_file, 0, SEEK_END);
+    filexfer_put_u32(tx_payload, (uint32_t)ftell(xfer_file));
+    tx_payload[4] = (uint8_t)FILEXFER_CHUNK_SIZE;
+    tx_payload[5] = (uint8_t)(FILEXFER_CHUNK_SIZE >> 8);
+    tx_payload[6] = (uint8_t)FILEXFER_WINDOW;
+    tx_payload[7] = 0;
+    send_frame(io, FILEXFER_INFO, seq, 8);
+}
+
+static void handle_read(const filexfer_io_t *io, uint16_t seq, const uint8_t *payload, size_t len,
+                        filexfer_stats_t *stats) {
+    if (xfer_file == NULL || len < 6) {
+        send_error(io, seq, "no file open");
+        return;
+    }
+    uint32_t offset = filexfer_get_u32(payload);
+    uint16_t chunks = payload[4] | payload[5] << 8;
+    if (chunks > FILEXFER_WINDOW) {
+        chunks = FILEXFER_WINDOW;
+    }
+
+    // The file may still be growing if it is the active log
+    clearerr(xfer_file);
+    if (fseek(xfer_file, offset, SEEK_SET) != 0) {
+        send_error(io, seq, "seek failed");
+        return;
+    }
+
+    for (uint16_t i = 0; i < chunks; i++) {
+        size_t n = fread(tx_payload + 4, 1, FILEXFER_CHUNK_SIZE, xfer_file);
+        filexfer_put_u32(tx_payload, offset);
+        send_frame(io, FILEXFER_CHUNK, seq, 4 + n);
+        if (n == 0) {
+            break; // End of file marker sent
+        }
+        offset += n;
+        if (stats != NULL) {
+            stats->chunks++;
+            stats->bytes += n;
+        }
+        if (io->yield != NULL) {
+            io->yield(io->ctx);
+        }
+    }
+}
+
+static void handle_check(const filexfer_io_t *io, uint16_t seq, const uint8_t *payload, size_t len) {
+    if (xfer_file == NULL || len < 8) {
+        send_error(io, seq, "no file open");
+        return;
+    }
+    uint32_t offset = filexfer_get_u32(payload);
+    uint32_t remaining = filexfer_get_u32(payload + 4);
+    uint32_t crc = 0;
+    uint32_t covered = 0;
+
+    clearerr(xfer_file);
+    if (fseek(xfer_file, offset, SEEK_SET) == 0) {
+        while (remaining > 0) {
+            size_t want = remaining < FILEXFER_CHUNK_SIZE ? remaining : FILEXFER_CHUNK_SIZE;
+            size_t n = fread(tx_payload, 1, want, xfer_file);
+            if (n == 0) {
+                break;
+            }
+            crc = filexfer_crc32_update(crc, tx_payload, n);
+            covered += n;
+            remaining -= n;
+        }
+    }
+    filexfer_put_u32(tx_payload, crc);
+    filexfer_put_u32(tx_payload + 4, covered);
+    send_frame(io, FILEXFER_SUM, seq, 8);
+}
+
+int filexfer_serve(const filexfer_io_t *io, filexfer_stats_t *stats) {
+    size_t block_len = 0;
+    int overflow = 0;
+    int result = 1;
+
+    while (result != 0) {
+        uint8_t byte;
+        if (io->read(io->ctx, &byte, 1, FILEXFER_IDLE_TIMEOUT_MS) == 0) {
+            break; // Host went away
+        }
+        if (byte != 0) {
+            if (block_len < sizeof(rx_block)) {
+                rx_block[block_len++] = byte;
+            } else {
+                overflow = 1;
+            }
+            continue;
+        }
+
+        size_t len = (overflow || block_len == 0) ? 0 : telem_cobs_decode(rx_block, block_len, rx_frame, sizeof(rx_frame));
+        int empty = block_len == 0;
+        block_len = 0;
+        overflow = 0;
+        if (empty) {
+            continue;
+        }
+        if (len < TELEM_FRAME_OVERHEAD ||
+            telem_crc16(rx_frame, len - 2) != (uint16_t)(rx_frame[len - 2] | rx_frame[len - 1] << 8)) {
+            if (stats != NULL) {
+                stats->bad_frames++;
+            }
+            continue;
+        }
+
+        uint16_t seq = rx_frame[1] | rx_frame[2] << 8;
+        const uint8_t *payload = rx_frame + 3;
+        size_t payload_len = len - TELEM_FRAME_OVERHEAD;
+        if (stats != NULL) {
+            stats->requests++;
+        }
+
+        switch (rx_frame[0]) {
+            case FILEXFER_PING:
+                send_frame(io, FILEXFER_ACK, seq, 0);
+                break;
+            case FILEXFER_LIST:
+                handle_list(io, seq);
+                break;
+            case FILEXFER_OPEN:
+                handle_open(io, seq, payload, payload_len);
+                break;
+            case FILEXFER_READ:
+                handle_read(io, seq, payload, payload_len, stats);
+                break;
+            case FILEXFER_CHECK:
+                handle_check(io, seq, payload, payload_len);
+                break;
+            case FILEXFER_QUIT:
+                send_frame(io, FILEXFER_ACK, seq, 0);
+                result = 0;
+                break;
+            default:
+                send_error(io, seq, "unknown request");
+                break;
+        }
+    }
+
+    if (xfer_file != NULL) {
+        fclose(xfer_file);
+        xfer_file = NULL;
+    }
+    return result;
+}
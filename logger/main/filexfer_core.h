@@ -0,0 +1,98 @@
+/*
+ * filexfer_core.h
+ *
+ * Host-driven file download protocol used by the console 'xfer' mode.
+ * Frames use the COBS/CRC-16 framing of telemetry_frame.h; the frame seq
+ * field carries a request id that every response echoes.
+ *
+ *   Host -> device                      Device -> host
+ *   'P' PING                            'Z' ACK
+ *   'L' LIST                            'N' {u32 size, name} per file, then 'Z'
+ *   'O' OPEN  {name}                    'I' {u32 size, u16 chunk, u16 window} or 'E' {message}
+ *   'R' READ  {u32 offset, u16 chunks}  'C' {u32 offset, data[<= chunk]} x chunks,
+ *                                       a 'C' without data marks end of file
+ *   'K' CHECK {u32 offset, u32 length}  'S' {u32 crc32, u32 length covered}
+ *   'Q' QUIT                            'Z' ACK
+ *
+ * All integers are little-endian. The host keeps one READ of up to `window`
+ * chunks outstanding and re-requests from the first missing offset after a
+ * bad or missing frame (go-back-N). Resume is a CHECK of the partial local
+ * file followed by READs from its end.
+ *
+ * Pure C (stdio + dirent) so the firmware and the host pty stand-in run the
+ * same server.
+ */
+#ifndef INC_FILEXFER_CORE_H_
+#define INC_FILEXFER_CORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "telemetry_frame.h"
+
+#define FILEXFER_PING 'P'
+#define FILEXFER_LIST 'L'
+#define FILEXFER_OPEN 'O'
+#define FILEXFER_READ 'R'
+#define FILEXFER_CHECK 'K'
+#define FILEXFER_QUIT 'Q'
+
+#define FILEXFER_ACK 'Z'
+#define FILEXFER_ENTRY 'N'
+#define FILEXFER_INFO 'I'
+#define FILEXFER_ERROR 'E'
+#define FILEXFER_CHUNK 'C'
+#define FILEXFER_SUM 'S'
+
+#define FILEXFER_CHUNK_SIZE 1024
+#define FILEXFER_WINDOW 16          // Chunks per READ the server will honour
+#define FILEXFER_IDLE_TIMEOUT_MS 10000 // Server exits when the host goes quiet
+#define FILEXFER_READY "XFER READY" // Console line sent before binary mode starts
+
+typedef struct {
+    // Read up to len bytes, waiting at most timeout_ms; returns 0 on timeout
+    size_t (*read)(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms);
+    void (*write)(void *ctx, const uint8_t *buf, size_t len);
+    // Called after every data chunk so the firmware can give way to the log writer; may be NULL
+    void (*yield)(void *ctx);
+    void *ctx;
+    const char *root; // Directory served, with trailing '/'
+} filexfer_io_t;
+
+typedef struct {
+    uint32_t requests;
+    uint32_t chunks;
+    uint32_t bad_frames;
+    uint64_t bytes;
+} filexfer_stats_t;
+
+static inline uint32_t filexfer_crc32_update(uint32_t crc, const uint8_t *data, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static inline void filexfer_put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t filexfer_get_u32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/**
+ * @brief Serve requests until QUIT or FILEXFER_IDLE_TIMEOUT_MS without a frame
+ *
+ * @param stats Optional counters for the session
+ * @return 0 on QUIT, 1 on idle timeout
+ */
+int filexfer_serve(const filexfer_io_t *io, filexfer_stats_t *stats);
+
+#endif /* INC_FILEXFER_CORE_H_ */
@@ -0,0 +1,266 @@
+/*
+ * fusion.c
+ *
+ * Planar error-state Kalman filter (ESKF). The nominal state is integrated
+ * from body-frame acceleration and yaw rate on every IMU sample; the error
+ * covariance is propagated alongside it and GNSS position/velocity are
+ * applied as sequential scalar updates, so every step has a fixed cost and
+ * no matrix inversion.
+ *
+ * Frames: N/E local tangent plane at the first fix, body x forward, y right,
+ * yaw clockwise from north.
+ */
+#include "fusion.h"
+#include <math.h>
+#include <string.h>
+
+#define PI_F 3.14159265f
+#define DEG_TO_RAD (PI_F / 180.0f)
+#define RAD_TO_DEG (180.0f / PI_F)
+#define M_PER_LAT_E7 0.0111320f // 111320 m per degree of latitude
+
+// Error state indices
+#define S_PN  0
+#define S_PE  1
+#define S_VN  2
+#define S_VE  3
+#define S_YAW 4
+#define S_BAX 5
+#define S_BAY 6
+#define S_BGZ 7
+
+// Process noise spectral densities
+#define Q_ACC       0.5f    // (m/s^2)^2 / Hz
+#define Q_GYRO      1e-4f   // (rad/s)^2 / Hz
+#define Q_ACC_BIAS  1e-5f
+#define Q_GYRO_BIAS 1e-8f
+
+// GNSS measurement noise
+#define R_POS 4.0f     // m^2
+#define R_VEL 0.25f    // (m/s)^2
+
+static float wrap_pi(float a) {
+    while (a >= PI_F)  a -= 2.0f * PI_F;
+    while (a < -PI_F)  a += 2.0f * PI_F;
+    return a;
+}
+
+static void reset_covariance(fusion_t *f) {
+    memset(f->P, 0, sizeof(f->P));
+    f->P[S_PN][S_PN]   = R_POS;
+    f->P[S_PE][S_PE]   = R_POS;
+    f->P[S_VN][S_VN]   = R_VEL;
+    f->P[S_VE][S_VE]   = R_VEL;
+    f->P[S_YAW][S_YAW] = 0.1f;  // ~18 deg
+    f->P[S_BAX][S_BAX] = 0.25f;
+    f->P[S_BAY][S_BAY] = 0.25f;
+    f->P[S_BGZ][S_BGZ] = 1e-4f;
+}
+
+static void update_output(fusion_t *f) {
+    fusion_output_t *o = &f->out;
+    float c = cosf(f->yaw), s = sinf(f->yaw);
+
+    o->pos_n = f->pos[0];
+    o->pos_e = f->pos[1];
+    o->vel_n = f->vel[0];
+    o->vel_e = f->vel[1];
+    o->speed = sqrtf(f->vel[0] * f->vel[0] + f->vel[1] * f->vel[1]);
+
+    float heading = f->yaw * RAD_TO_DEG;
+    o->heading_deg = heading < 0.0f ? heading + 360.0f : heading;
+
+    if (o->speed > FUSION_SLIP_SPEED_MS) {
+        // Rotate velocity into the body frame
+        float vx =  c * f->vel[0] + s * f->vel[1];
+        float vy = -s * f->vel[0] + c * f->vel[1];
+        o->slip_deg = atan2f(vy, vx) * RAD_TO_DEG;
+    } else {
+        o->slip_deg = 0.0f;
+    }
+    o->valid = f->aligned;
+}
+
+/**
+ * @brief Reset the filter to an unaligned state
+ *
+ * Outputs stay invalid until a GNSS fix above FUSION_ALIGN_SPEED_MS provides
+ * an initial heading.
+ */
+void fusion_init(fusion_t *f) {
+    memset(f, 0, sizeof(*f));
+    reset_covariance(f);
+}
+
+float fusion_raw_accel(uint32_t raw) {
+    return (float)(int32_t)raw * FUSION_ACCEL_LSB_MS2;
+}
+
+float fusion_raw_gyro(uint32_t raw) {
+    return (float)(int32_t)raw * FUSION_GYRO_LSB_RADS;
+}
+
+/**
+ * @brief Propagate the nominal state and error covariance by one IMU sample
+ *
+ * @param f       Filter state
+ * @param ax      Body longitudinal acceleration (m/s^2)
+ * @param ay      Body lateral acceleration (m/s^2, positive right)
+ * @param gz      Yaw rate (rad/s, positive clockwise from above)
+ * @param time_us Sample timestamp in microseconds
+ */
+void fusion_predict(fusion_t *f, float ax, float ay, float gz, int64_t time_us) {
+    int64_t prev_us = f->last_imu_us;
+    f->last_imu_us = time_us;
+
+    if (!f->aligned || prev_us == 0) {
+        return;
+    }
+
+    float dt = (float)(time_us - prev_us) * 1e-6f;
+    if (dt <= 0.0f || dt > FUSION_MAX_DT_S) {
+        return;
+    }
+
+    // Bias-corrected body acceleration rotated into N/E
+    float abx = ax - f->acc_bias[0];
+    float aby = ay - f->acc_bias[1];
+    float c = cosf(f->yaw), s = sinf(f->yaw);
+    float an = c * abx - s * aby;
+    float ae = s * abx + c * aby;
+
+    f->pos[0] += f->vel[0] * dt + 0.5f * an * dt * dt;
+    f->pos[1] += f->vel[1] * dt + 0.5f * ae * dt * dt;
+    f->vel[0] += an * dt;
+    f->vel[1] += ae * dt;
+    f->yaw = wrap_pi(f->yaw + (gz - f->gyro_bias) * dt);
+
+    // Error state transition F = I + A*dt
+    float F[FUSION_STATES][FUSION_STATES] = {0};
+    for (int i = 0; i < FUSION_STATES; i++) {
+        F[i][i] = 1.0f;
+    }
+    F[S_PN][S_VN]  = dt;
+    F[S_PE][S_VE]  = dt;
+    F[S_VN][S_YAW] = -ae * dt;
+    F[S_VE][S_YAW] =  an * dt;
+    F[S_VN][S_BAX] = -c * dt;
+    F[S_VN][S_BAY] =  s * dt;
+    F[S_VE][S_BAX] = -s * dt;
+    F[S_VE][S_BAY] = -c * dt;
+    F[S_YAW][S_BGZ] = -dt;
+
+    // P = F P F^T + Q
+    float FP[FUSION_STATES][FUSION_STATES];
+    for (int i = 0; i < FUSION_STATES; i++) {
+        for (int j = 0; j < FUSION_STATES; j++) {
+            float sum = 0.0f;
+            for (int k = 0; k < FUSION_STATES; k++) {
+                sum += F[i][k] * f->P[k][j];
+            }
+            FP[i][j] = sum;
+        }
+    }
+    for (int i = 0; i < FUSION_STATES; i++) {
+        for (int j = i; j < FUSION_STATES; j++) {
+            float sum = 0.0f;
+            for (int k = 0; k < FUSION_STATES; k++) {
+                sum += FP[i][k] * F[j][k];
+            }
+            f->P[i][j] = sum;
+            f->P[j][i] = sum;
+        }
+    }
+    f->P[S_VN][S_VN]   += Q_ACC * dt;
+    f->P[S_VE][S_VE]   += Q_ACC * dt;
+    f->P[S_YAW][S_YAW] += Q_GYRO * dt;
+    f->P[S_BAX][S_BAX] += Q_ACC_BIAS * dt;
+    f->P[S_BAY][S_BAY] += Q_ACC_BIAS * dt;
+    f->P[S_BGZ][S_BGZ] += Q_GYRO_BIAS * dt;
+
+    update_output(f);
+}
+
+// Scalar measurement of a single error-state component (H = unit vector)
+static void scalar_update(fusion_t *f, float dx[FUSION_STATES], int idx, float innovation, float r) {
+    float S = f->P[idx][idx] + r;
+    if (S <= 0.0f) {
+        return;
+    }
+
+    float K[FUSION_STATES];
+    float y = innovation - dx[idx];
+    for (int i = 0; i < FUSION_STATES; i++) {
+        K[i] = f->P[i][idx] / S;
+        dx[i] += K[i] * y;
+    }
+
+    float Prow[FUSION_STATES];
+    memcpy(Prow, f->P[idx], sizeof(Prow));
+    for (int i = 0; i < FUSION_STATES; i++) {
+        for (int j = 0; j < FUSION_STATES; j++) {
+            f->P[i][j] -= K[i] * Prow[j];
+        }
+    }
+}
+
+/**
+ * @brief Apply a GNSS fix to the filter
+ *
+ * The first fix sets the local origin. The filter aligns on the first fix
+ * moving faster than FUSION_ALIGN_SPEED_MS (course taken as heading); after
+ * that every fix is applied as position and, while moving, velocity updates.
+ */
+void fusion_update_gnss(fusion_t *f, const fusion_gnss_fix_t *fix) {
+    if (fix == NULL || fix->fix_type == 0) {
+        return;
+    }
+
+    if (!f->has_origin) {
+        f->has_origin = true;
+        f->lat0_e7 = fix->lat_e7;
+        f->lon0_e7 = fix->lon_e7;
+        f->m_per_lon_e7 = M_PER_LAT_E7 * cosf((float)fix->lat_e7 * 1e-7f * DEG_TO_RAD);
+    }
+
+    float pn = (float)(fix->lat_e7 - f->lat0_e7) * M_PER_LAT_E7;
+    float pe = (float)(fix->lon_e7 - f->lon0_e7) * f->m_per_lon_e7;
+    float course = fix->course_deg * DEG_TO_RAD;
+    float vn = fix->speed_ms * cosf(course);
+    float ve = fix->speed_ms * sinf(course);
+
+    if (!f->aligned) {
+        if (fix->speed_ms < FUSION_ALIGN_SPEED_MS) {
+            return;
+        }
+        f->pos[0] = pn;
+        f->pos[1] = pe;
+        f->vel[0] = vn;
+        f->vel[1] = ve;
+        f->yaw = wrap_pi(course);
+        reset_covariance(f);
+        f->aligned = true;
+        update_output(f);
+        return;
+    }
+
+    float dx[FUSION_STATES] = {0};
+    scalar_update(f, dx, S_PN, pn - f->pos[0], R_POS);
+    scalar_update(f, dx, S_PE, pe - f->pos[1], R_POS);
+    if (fix->speed_ms >= FUSION_SLIP_SPEED_MS) {
+        scalar_update(f, dx, S_VN, vn - f->vel[0], R_VEL);
+        scalar_update(f, dx, S_VE, ve - f->vel[1], R_VEL);
+    }
+
+    // Inject the error estimate into the nominal state
+    f->pos[0]      += dx[S_PN];
+    f->pos[1]      += dx[S_PE];
+    f->vel[0]      += dx[S_VN];
+    f->vel[1]      += dx[S_VE];
+    f->yaw          = wrap_pi(f->yaw + dx[S_YAW]);
+    f->acc_bias[0] += dx[S_BAX];
+    f->acc_bias[1] += dx[S_BAY];
+    f->gyro_bias   += dx[S_BGZ];
+
+    update_output(f);
+}
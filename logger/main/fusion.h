@@ -0,0 +1,74 @@
+/*
+ * fusion.h
+ *
+ * Planar error-state Kalman filter fusing the CAN IMU (0x360-0x362) with
+ * GNSS fixes. Produces position, velocity, heading and slip angle at the
+ * IMU rate. Plain C with no ESP-IDF dependencies so the same file builds
+ * into the host replay tool.
+ */
+#ifndef INC_FUSION_H_
+#define INC_FUSION_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Raw IMU CAN units -> SI (IMU sends signed 32-bit values, 1 LSB = 1 mg / 1 mdeg/s)
+#define FUSION_ACCEL_LSB_MS2   (9.80665f / 1000.0f)
+#define FUSION_GYRO_LSB_RADS   (0.017453293f / 1000.0f)
+
+#define FUSION_ALIGN_SPEED_MS  3.0f   // GNSS speed needed before the course is trusted as heading
+#define FUSION_SLIP_SPEED_MS   1.0f   // Below this speed slip angle is reported as 0
+#define FUSION_MAX_DT_S        0.1f   // IMU gaps longer than this skip the prediction step
+
+// Error state: [dPosN, dPosE, dVelN, dVelE, dYaw, dAccBiasX, dAccBiasY, dGyroBiasZ]
+#define FUSION_STATES 8
+
+typedef struct {
+    int32_t lat_e7;     // Latitude  (1e-7 deg)
+    int32_t lon_e7;     // Longitude (1e-7 deg)
+    float speed_ms;     // Ground speed (m/s)
+    float course_deg;   // Course over ground (deg, clockwise from north)
+    uint8_t fix_type;   // 0 = no fix
+    int64_t time_us;
+} fusion_gnss_fix_t;
+
+typedef struct {
+    float pos_n;        // Metres north of the first fix
+    float pos_e;        // Metres east of the first fix
+    float vel_n;        // m/s
+    float vel_e;        // m/s
+    float speed;        // m/s
+    float heading_deg;  // 0-360, clockwise from north
+    float slip_deg;     // Body slip angle, positive = velocity to the right of the nose
+    bool valid;         // False until the filter has aligned to a moving GNSS fix
+} fusion_output_t;
+
+typedef struct {
+    // Nominal state
+    float pos[2];
+    float vel[2];
+    float yaw;
+    float acc_bias[2];
+    float gyro_bias;
+
+    float P[FUSION_STATES][FUSION_STATES];
+
+    // Local tangent plane origin
+    bool has_origin;
+    int32_t lat0_e7;
+    int32_t lon0_e7;
+    float m_per_lon_e7;
+
+    bool aligned;
+    int64_t last_imu_us;
+
+    fusion_output_t out;
+} fusion_t;
+
+void fusion_init(fusion_t *f);
+void fusion_predict(fusion_t *f, float ax, float ay, float gz, int64_t time_us);
+void fusion_update_gnss(fusion_t *f, const fusion_gnss_fix_t *fix);
+float fusion_raw_accel(uint32_t raw);
+float fusion_raw_gyro(uint32_t raw);
+
+#endif /* INC_FUSION_H_ */
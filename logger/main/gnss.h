@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stddef.h>
 
 // DMA buffer configuration
 #define GNSS_DMA_BUF_SIZE 2048
@@ -35,12 +36,20 @@ typedef struct
 	signed long gSpeed;
 	uint8_t gSpeedBytes[4];
 	signed long headMot;
+	float fSpeed;   // Ground speed (m/s)
+	float fCourse;  // Course over ground (deg)
 
 }GNSS_StateHandle;
 
 extern GNSS_StateHandle GNSS_Handle;
 
+// Callback invoked from the GNSS task on every RMC sentence with an active fix
+typedef void (*gnss_fix_callback_t)(const GNSS_StateHandle *gps);
+
 // Function declarations
 void gnss_init(void);
+void gnss_set_fix_callback(gnss_fix_callback_t callback_function);
+// Parse one NMEA sentence (without the trailing newline) into GNSS_Handle (gnss_nmea.c)
+void gnss_process_sentence(const char *sentence, size_t len);
 void gnss_start_task(void);
 void gnss_stop(void);
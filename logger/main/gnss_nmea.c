@@ -0,0 +1,171 @@
+/*
+ * gnss_nmea.c
+ *
+ * NMEA sentence parsing for the GNSS receiver, split from the UART driver in
+ * gnss.c so the host build can feed recorded sentences through it.
+ */
+#include "gnss.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "dlog.h"
+#include "string.h"
+
+static const char *TAG = "GNSS_DMA";
+static gnss_fix_callback_t fix_callback = NULL;
+
+GNSS_StateHandle GNSS_Handle = {0};
+
+static bool parse_gngga(const char* sentence, GNSS_StateHandle* gps) {
+    // $GNGGA,hhmmss.ss,ddmm.mmmmm,N/S,dddmm.mmmmm,E/W,q,nn,h.h,a.a,M,g.g,M,d.d,nnnn*hh
+    char time_str[16] = {0};
+    char lat_str[16] = {0}, lat_ns = 0;
+    char lon_str[16] = {0}, lon_ew = 0;
+    int quality = 0, satellites = 0;
+    float hdop = 0.0, altitude = 0.0;
+
+    int parsed = sscanf(sentence, "$GNGGA,%[^,],%[^,],%c,%[^,],%c,%d,%d,%f,%f,M",
+                       time_str, lat_str, &lat_ns, lon_str, &lon_ew,
+                       &quality, &satellites, &hdop, &altitude);
+
+    if (parsed >= 6) {
+        gps->fixType = quality;
+
+        // Parse time (HHMMSS format)
+        if (strlen(time_str) >= 6) {
+            gps->hour = (time_str[0] - '0') * 10 + (time_str[1] - '0');
+            gps->min = (time_str[2] - '0') * 10 + (time_str[3] - '0');
+            gps->sec = (time_str[4] - '0') * 10 + (time_str[5] - '0');
+        }
+
+        // Parse latitude (DDMM.MMMMM format)
+        if (strlen(lat_str) > 0 && lat_ns != 0) {
+            double lat_deg = atof(lat_str);
+            int degrees = (int)(lat_deg / 100);
+            double minutes = lat_deg - (degrees * 100);
+            double lat = degrees + (minutes / 60.0);
+            if (lat_ns == 'S') lat = -lat;
+            gps->fLat = lat;
+            gps->lat = (signed long)(lat * 10000000); // Convert to 1e-7 degrees (kept in double to hold cm resolution)
+        }
+
+        // Parse longitude (DDDMM.MMMMM format)
+        if (strlen(lon_str) > 0 && lon_ew != 0) {
+            double lon_deg = atof(lon_str);
+            int degrees = (int)(lon_deg / 100);
+            double minutes = lon_deg - (degrees * 100);
+            double lon = degrees + (minutes / 60.0);
+            if (lon_ew == 'W') lon = -lon;
+            gps->fLon = lon;
+            gps->lon = (signed long)(lon * 10000000); // Convert to 1e-7 degrees
+        }
+
+        gps->hMSL = altitude;
+
+        DLOGI(TAG, "GGA: Fix=%d, Sats=%d, Lat=%.6f, Lon=%.6f, Alt=%.1fm",
+                 quality, satellites, gps->fLat, gps->fLon, altitude);
+        return true;
+    }
+    return false;
+}
+
+static bool parse_gnrmc(const char* sentence, GNSS_StateHandle* gps) {
+    // $GNRMC,hhmmss.ss,A/V,ddmm.mmmmm,N/S,dddmm.mmmmm,E/W,s.s,c.c,ddmmyy,d.d,E/W,m*hh
+    char time_str[16] = {0};
+    char status = 0;
+    char lat_str[16] = {0}, lat_ns = 0;
+    char lon_str[16] = {0}, lon_ew = 0;
+    float speed = 0.0, course = 0.0;
+    char date_str[16] = {0};
+
+    int parsed = sscanf(sentence, "$GNRMC,%[^,],%c,%[^,],%c,%[^,],%c,%f,%f,%[^,]",
+                       time_str, &status, lat_str, &lat_ns, lon_str, &lon_ew,
+                       &speed, &course, date_str);
+
+    if (parsed >= 9) {
+        // Parse date (DDMMYY format)
+        if (strlen(date_str) >= 6) {
+            gps->day = (date_str[0] - '0') * 10 + (date_str[1] - '0');
+            gps->month = (date_str[2] - '0') * 10 + (date_str[3] - '0');
+            gps->year = 2000 + (date_str[4] - '0') * 10 + (date_str[5] - '0');
+        }
+
+        gps->gSpeed = (signed long)(speed * 1.151); // Convert knots to mph
+        gps->headMot = course;
+        gps->fSpeed = speed * 0.514444f; // Convert knots to m/s
+        gps->fCourse = course;
+
+        DLOGI(TAG, "RMC: Status=%c, Speed=%.1fkn, Course=%.1f°, Date=%02d/%02d/%04d",
+                 status, speed, course, gps->day, gps->month, gps->year);
+        return (status == 'A'); // Return true if fix is active
+    }
+    return false;
+}
+
+static void parse_gsv_satellites(const char* sentence) {
+    // $GPGSV,total_msgs,msg_num,total_sats,sat1_prn,sat1_elev,sat1_azim,sat1_snr,...*hh
+    int total_msgs, msg_num, total_sats;
+
+    int parsed = sscanf(sentence, "$%*2cGSV,%d,%d,%d", &total_msgs, &msg_num, &total_sats);
+
+    if (parsed == 3) {
+        char constellation[3] = {0};
+        strncpy(constellation, sentence + 1, 2);
+        // ESP_LOGI(TAG, "GSV %s: Total satellites in view: %d", constellation, total_sats);
+    }
+}
+
+void gnss_process_sentence(const char* sentence, size_t len) {
+    if (!sentence || len == 0) {
+        DLOGW(TAG, "Invalid NMEA sentence: null or empty");
+        return;
+    }
+
+    char nmea_line[512];
+    if (len >= sizeof(nmea_line)) {
+        DLOGW(TAG, "NMEA sentence too long (%u bytes), truncating", (unsigned)len);
+        len = sizeof(nmea_line) - 1;
+    }
+    memcpy(nmea_line, sentence, len);
+    nmea_line[len] = '\0';
+
+    while (len > 0 && (nmea_line[len-1] == '\r' || nmea_line[len-1] == '\n' || nmea_line[len-1] == ' ')) {
+        nmea_line[--len] = '\0';
+    }
+
+    // Validate NMEA format (should start with $)
+    if (len > 0 && nmea_line[0] == '$') {
+        ESP_LOGD(TAG, "GPS: %s", nmea_line);
+
+        if (strncmp(nmea_line, "$GNGGA", 6) == 0) {
+            parse_gngga(nmea_line, &GNSS_Handle);
+        } else if (strncmp(nmea_line, "$GNRMC", 6) == 0) {
+            bool fix_active = parse_gnrmc(nmea_line, &GNSS_Handle);
+            if (fix_active && fix_callback != NULL) {
+                fix_callback(&GNSS_Handle);
+            }
+            if (fix_active) {
+                DLOGI(TAG, "gps fix");
+                DLOGI(TAG, "Location: %.6f°, %.6f°", GNSS_Handle.fLat, GNSS_Handle.fLon);
+                DLOGI(TAG, "Time: %02d:%02d:%02d Date: %02d/%02d/%04d",
+                         GNSS_Handle.hour, GNSS_Handle.min, GNSS_Handle.sec,
+                         GNSS_Handle.day, GNSS_Handle.month, GNSS_Handle.year);
+            }
+        } else if (strstr(nmea_line, "GSV") != NULL) {
+            parse_gsv_satellites(nmea_line);
+        } else if (strncmp(nmea_line, "$GNGSA", 6) == 0) {
+            DLOGD(TAG, "GSA: DOP and active satellites info");
+        } else if (strncmp(nmea_line, "$GNVTG", 6) == 0) {
+            DLOGD(TAG, "VTG: Track made good and ground speed");
+        } else if (strncmp(nmea_line, "$GNGLL", 6) == 0) {
+            DLOGD(TAG, "GLL: Geographic position - latitude/longitude");
+        }
+    } else {
+        ESP_LOGD(TAG, "Non-NMEA data (%zu bytes): %.*s", len, (int)len, nmea_line);
+    }
+}
+
+void gnss_set_fix_callback(gnss_fix_callback_t callback_function) {
+    fix_callback = callback_function;
+}
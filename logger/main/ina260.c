@@ -1,7 +1,9 @@
 //Created by Alex Rumer 9/6/2025
 #include "driver/i2c.h"
 #include "esp_log.h"
+#include "dlog.h"
 #include "ina260.h"
+#include "metrics.h"
 
 
 static uint8_t buffer[2];
@@ -42,6 +44,9 @@ static esp_err_t i2c_read_register(uint8_t dev_addr, uint8_t reg_addr, uint8_t *
 
     esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, I2C_MASTER_TIMEOUT_MS / portTICK_PERIOD_MS);
     i2c_cmd_link_delete(cmd);
+    if (ret != ESP_OK) {
+        metrics_inc(METRIC_I2C_ERRORS);
+    }
     return ret;
 }
 
@@ -53,7 +58,7 @@ void ina260Init() {
 uint16_t getCurrent() {
     esp_err_t ret = i2c_read_register(INA260_DEV_ID, INA260_REG_CURR, buffer, 2);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2C read failed: %s", esp_err_to_name(ret));
+        DLOGE(TAG, "I2C read failed: %s", esp_err_to_name(ret));
         return 0;
     }
     return (buffer[0] << 8) | buffer[1];
@@ -62,7 +67,7 @@ uint16_t getCurrent() {
 uint16_t getVoltage() {
     esp_err_t ret = i2c_read_register(INA260_DEV_ID, INA260_REG_VBUS, buffer, 2);
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "I2C read failed: %s", esp_err_to_name(ret));
+        DLOGE(TAG, "I2C read failed: %s", esp_err_to_name(ret));
         return 0;
     }
     return (buffer[0] << 8) | buffer[1];
@@ -0,0 +1,305 @@
+#include "laptimer.h"
+#include <math.h>
+#include <string.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "dlog.h"
+#include "sdcard.h"
+
+static const char *TAG = "LAPTIMER";
+
+#define M_PER_LAT_E7 0.0111320f // 111320 m per degree of latitude
+#define DEG_TO_RAD 0.017453293f
+
+lap_status_t lap_status = {0};
+
+// The console edits the gate table, the GNSS task copies it once per fix
+static lap_gate_t gates[LAP_MAX_GATES];
+static uint8_t gate_count = 0;
+static bool laps_reset = false; // Set by laptimer_clear_gates(), applied by the GNSS task
+static portMUX_TYPE gate_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// GNSS task only from here on
+// Previous fix, kept to form the movement segment checked against every gate
+static bool have_prev = false;
+static int32_t prev_lat, prev_lon;
+static int64_t prev_time_us;
+
+static int64_t gate_cross_us[LAP_MAX_GATES];
+static int64_t lap_start_us = 0;
+static int64_t sector_start_us = 0;
+static uint32_t sector_ms[LAP_MAX_GATES];
+
+
+// One completed lap, queued for the summary file
+typedef struct {
+    uint16_t lap;
+    uint8_t sectors;
+    uint32_t start_ms;
+    uint32_t lap_ms;
+    uint32_t sector_ms[LAP_MAX_GATES];
+} lap_summary_t;
+
+static QueueHandle_t summary_queue = NULL;
+static uint8_t summary_queue_storage[LAP_SUMMARY_QUEUE_LEN * sizeof(lap_summary_t)];
+static StaticQueue_t summary_queue_buffer;
+
+const uint32_t laptimer_ram_bytes = sizeof(gates) + sizeof(summary_queue_storage) + sizeof(summary_queue_buffer);
+
+/**
+ * @brief Test a movement segment against a gate
+ *
+ * Works in a local metric frame anchored at the gate's first point, which is
+ * accurate to well under a centimetre over the few metres between fixes.
+ *
+ * @param frac Receives the fraction (0-1) along the movement at which the gate is crossed
+ * @return true if the gate was crossed in the counted direction
+ */
+static bool gate_crossed(const lap_gate_t *g, int32_t lat0, int32_t lon0, int32_t lat1, int32_t lon1, float *frac) {
+    float m_per_lon = M_PER_LAT_E7 * cosf((float)g->lat1_e7 * 1e-7f * DEG_TO_RAD);
+
+    // Gate vector e and movement vector d, both relative to gate point 1 (x = east, y = north)
+    float ex = (g->lon2_e7 - g->lon1_e7) * m_per_lon;
+    float ey = (g->lat2_e7 - g->lat1_e7) * M_PER_LAT_E7;
+    float px = (lon0 - g->lon1_e7) * m_per_lon;
+    float py = (lat0 - g->lat1_e7) * M_PER_LAT_E7;
+    float dx = (lon1 - lon0) * m_per_lon;
+    float dy = (lat1 - lat0) * M_PER_LAT_E7;
+
+    // Only count crossings left-to-right across the gate
+    float denom = ex * dy - ey * dx;
+    if (denom <= 0.0f) {
+        return false;
+    }
+
+    // Solve p + t*d = u*e
+    float t = (ey * px - ex * py) / denom;
+    float u = (dy * px - dx * py) / denom;
+    if (t < 0.0f || t > 1.0f || u < 0.0f || u > 1.0f) {
+        return false;
+    }
+
+    *frac = t;
+    return true;
+}
+
+// Keep the summary file next to the current log: data_log_001.benji2 -> data_log_001_laps.csv
+static FILE *open_summary(uint8_t sectors) {
+    char header[32 + LAP_MAX_GATES * 8] = "lap,start_ms,lap_ms";
+    size_t len = strlen(header);
+    for (int i = 0; i < sectors; i++) {
+        len += snprintf(header + len, sizeof(header) - len, ",s%d_ms", i + 1);
+    }
+    snprintf(header + len, sizeof(header) - len, "\n");
+    return log_file_open_sidecar(LAP_SUMMARY_SUFFIX, header);
+}
+
+// GNSS fix path: hand the lap to the summary writer, never blocks
+static void queue_lap_summary(uint32_t lap_ms, uint8_t sectors) {
+    lap_summary_t entry = {
+        .lap = lap_status.lap,
+        .sectors = sectors,
+        .start_ms = (uint32_t)(lap_start_us / 1000),
+        .lap_ms = lap_ms,
+    };
+    memcpy(entry.sector_ms, sector_ms, sizeof(entry.sector_ms));
+    if (summary_queue == NULL || xQueueSend(summary_queue, &entry, 0) != pdTRUE) {
+        DLOGW(TAG, "Lap summary queue full, lap %u not written", entry.lap);
+    }
+}
+
+/**
+ * @brief Append the laps completed since the last call to the lap summary file
+ *
+ * Called once per second from the metrics task, off the GNSS fix path.
+ */
+void laptimer_write_summary(void) {
+    lap_summary_t entry;
+    if (summary_queue == NULL || xQueueReceive(summary_queue, &entry, 0) != pdTRUE) {
+        return;
+    }
+
+    // Without the file the queue is still drained; the laps stay in lap_status and on the console
+    FILE *f = open_summary(entry.sectors);
+    do {
+        if (f != NULL) {
+            fprintf(f, "%u,%lu,%lu", entry.lap, (unsigned long)entry.start_ms, (unsigned long)entry.lap_ms);
+            for (int i = 0; i < entry.sectors; i++) {
+                fprintf(f, ",%lu", (unsigned long)entry.sector_ms[i]);
+            }
+            fprintf(f, "\n");
+        }
+    } while (xQueueReceive(summary_queue, &entry, 0) == pdTRUE);
+    if (f != NULL) {
+        fclose(f);
+    }
+}
+
+static void handle_crossing(uint8_t gate, uint8_t sectors, int64_t cross_us) {
+    if (cross_us - gate_cross_us[gate] < (int64_t)LAP_MIN_CROSS_INTERVAL_MS * 1000 && gate_cross_us[gate] != 0) {
+        return;
+    }
+    gate_cross_us[gate] = cross_us;
+    lap_status.last_cross_ms = (uint32_t)(cross_us / 1000);
+
+    if (gate == 0) {
+        if (lap_start_us != 0) {
+            // Close out the lap; the last sector runs from the final split to the line
+            uint8_t last_sector = lap_status.sector > 0 ? lap_status.sector - 1 : 0;
+            sector_ms[last_sector] = (uint32_t)((cross_us - sector_start_us) / 1000);
+            uint32_t lap_ms = (uint32_t)((cross_us - lap_start_us) / 1000);
+
+            lap_status.lap++;
+            lap_status.last_lap_ms = lap_ms;
+            if (lap_status.best_lap_ms == 0 || lap_ms < lap_status.best_lap_ms) {
+                lap_status.best_lap_ms = lap_ms;
+            }
+            queue_lap_summary(lap_ms, sectors);
+            DLOGI(TAG, "Lap %u: %lu.%03lu s", lap_status.lap, (unsigned long)(lap_ms / 1000), (unsigned long)(lap_ms % 1000));
+        }
+        lap_start_us = cross_us;
+        sector_start_us = cross_us;
+        memset(sector_ms, 0, sizeof(sector_ms));
+        lap_status.sector = 1;
+    } else if (lap_start_us != 0 && gate == lap_status.sector) {
+        // Sector split, only accepted in driving order
+        sector_ms[gate - 1] = (uint32_t)((cross_us - sector_start_us) / 1000);
+        sector_start_us = cross_us;
+        lap_status.sector = gate + 1;
+    }
+}
+
+// Forget the lap in progress after the gates were cleared
+static void reset_laps(void) {
+    memset(gate_cross_us, 0, sizeof(gate_cross_us));
+    lap_start_us = 0;
+    lap_status.sector = 0;
+}
+
+/**
+ * @brief Check the movement since the previous fix against every gate
+ *
+ * Crossing times are interpolated linearly between the two fixes, giving
+ * sub-sample precision regardless of the GNSS update rate.
+ */
+void laptimer_process_fix(int32_t lat_e7, int32_t lon_e7, int64_t time_us) {
+    // Work on a copy so a console edit never lands mid-loop
+    lap_gate_t active[LAP_MAX_GATES];
+    portENTER_CRITICAL(&gate_lock);
+    uint8_t count = gate_count;
+    memcpy(active, gates, count * sizeof(gates[0]));
+    bool reset = laps_reset;
+    laps_reset = false;
+    portEXIT_CRITICAL(&gate_lock);
+    if (reset) {
+        reset_laps();
+    }
+
+    if (have_prev && count > 0) {
+        for (uint8_t i = 0; i < count; i++) {
+            float frac;
+            if (gate_crossed(&active[i], prev_lat, prev_lon, lat_e7, lon_e7, &frac)) {
+                int64_t cross_us = prev_time_us + (int64_t)(frac * (float)(time_us - prev_time_us));
+                handle_crossing(i, count, cross_us);
+            }
+        }
+    }
+    prev_lat = lat_e7;
+    prev_lon = lon_e7;
+    prev_time_us = time_us;
+    have_prev = true;
+}
+
+/**
+ * @brief Add a gate across the track at the given position
+ *
+ * The gate is perpendicular to the course and spans LAP_GATE_HALF_WIDTH_M on
+ * either side. The first gate added is start/finish.
+ */
+esp_err_t laptimer_add_gate(int32_t lat_e7, int32_t lon_e7, float course_deg) {
+    float m_per_lon = M_PER_LAT_E7 * cosf((float)lat_e7 * 1e-7f * DEG_TO_RAD);
+    float course = course_deg * DEG_TO_RAD;
+    // Unit vector pointing to the right of travel (x = east, y = north)
+    float rx = cosf(course);
+    float ry = -sinf(course);
+
+    lap_gate_t g = {
+        .lat1_e7 = lat_e7 - (int32_t)(ry * LAP_GATE_HALF_WIDTH_M / M_PER_LAT_E7),
+        .lon1_e7 = lon_e7 - (int32_t)(rx * LAP_GATE_HALF_WIDTH_M / m_per_lon),
+        .lat2_e7 = lat_e7 + (int32_t)(ry * LAP_GATE_HALF_WIDTH_M / M_PER_LAT_E7),
+        .lon2_e7 = lon_e7 + (int32_t)(rx * LAP_GATE_HALF_WIDTH_M / m_per_lon),
+    };
+
+    // Saved from a copy: the NVS write happens outside the lock
+    lap_gate_t saved[LAP_MAX_GATES];
+    bool added = false;
+    portENTER_CRITICAL(&gate_lock);
+    uint8_t count = gate_count;
+    if (count < LAP_MAX_GATES) {
+        gates[count++] = g;
+        gate_count = count;
+        memcpy(saved, gates, count * sizeof(gates[0]));
+        added = true;
+    }
+    portEXIT_CRITICAL(&gate_lock);
+    if (!added) {
+        ESP_LOGE(TAG, "Gate table full (%d gates)", LAP_MAX_GATES);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = nvs_set_lap_gates(saved, count);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save gates to NVS: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t laptimer_clear_gates(void) {
+    portENTER_CRITICAL(&gate_lock);
+    gate_count = 0;
+    laps_reset = true;
+    portEXIT_CRITICAL(&gate_lock);
+    return nvs_set_lap_gates(gates, 0);
+}
+
+void laptimer_init(void) {
+    if (summary_queue == NULL) {
+        summary_queue = xQueueCreateStatic(LAP_SUMMARY_QUEUE_LEN, sizeof(lap_summary_t), summary_queue_storage,
+                                           &summary_queue_buffer);
+    }
+    lap_gate_t loaded[LAP_MAX_GATES];
+    uint8_t count = LAP_MAX_GATES;
+    if (nvs_get_lap_gates(loaded, &count) != ESP_OK) {
+        count = 0;
+    }
+    portENTER_CRITICAL(&gate_lock);
+    memcpy(gates, loaded, count * sizeof(gates[0]));
+    gate_count = count;
+    portEXIT_CRITICAL(&gate_lock);
+    ESP_LOGI(TAG, "Lap timer ready with %u gates", count);
+}
+
+void laptimer_print_summary(void) {
+    lap_gate_t shown[LAP_MAX_GATES];
+    portENTER_CRITICAL(&gate_lock);
+    uint8_t count = gate_count;
+    memcpy(shown, gates, count * sizeof(gates[0]));
+    portEXIT_CRITICAL(&gate_lock);
+
+    printf("Gates: %u (gate 1 = start/finish)\n", count);
+    for (int i = 0; i < count; i++) {
+        printf("  %d: (%.7f, %.7f) -> (%.7f, %.7f)\n", i + 1,
+               shown[i].lat1_e7 * 1e-7, shown[i].lon1_e7 * 1e-7,
+               shown[i].lat2_e7 * 1e-7, shown[i].lon2_e7 * 1e-7);
+    }
+    printf("Laps completed: %u\n", lap_status.lap);
+    printf("Current sector: %u\n", lap_status.sector);
+    printf("Last lap: %lu.%03lu s\n", (unsigned long)(lap_status.last_lap_ms / 1000), (unsigned long)(lap_status.last_lap_ms % 1000));
+    printf("Best lap: %lu.%03lu s\n", (unsigned long)(lap_status.best_lap_ms / 1000), (unsigned long)(lap_status.best_lap_ms % 1000));
+    char summary_path[MAX_FILE_NAME_LENGTH];
+    if (sdcard_get_session_path(LAP_SUMMARY_SUFFIX, summary_path, sizeof(summary_path)) == ESP_OK) {
+        printf("Summary file: %s\n", summary_path);
+    }
+}
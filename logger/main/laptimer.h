@@ -0,0 +1,48 @@
+/*
+ * laptimer.h
+ *
+ * Lap and sector timing from GNSS line crossings. Gate 0 is start/finish,
+ * gates 1..n-1 are sector splits in driving order. Gates are persisted in NVS.
+ * Completed laps are queued by the GNSS fix path and appended to the session's
+ * lap summary by the metrics task, so no SD write happens in the fix callback.
+ */
+#ifndef INC_LAPTIMER_H_
+#define INC_LAPTIMER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define LAP_MAX_GATES 8
+#define LAP_GATE_HALF_WIDTH_M 12.0f   // Gates created at the car span +/- this much across the track
+#define LAP_MIN_CROSS_INTERVAL_MS 5000 // Ignore re-crossing the same gate within this time
+#define LAP_SUMMARY_SUFFIX "_laps.csv"
+#define LAP_SUMMARY_QUEUE_LEN 4 // Laps awaiting the summary file (written once per second)
+
+// Gate line segment. Point 1 is on the left and point 2 on the right when
+// driving in the counted direction; crossings the other way are ignored.
+typedef struct {
+    int32_t lat1_e7;
+    int32_t lon1_e7;
+    int32_t lat2_e7;
+    int32_t lon2_e7;
+} lap_gate_t;
+
+typedef struct {
+    uint16_t lap;           // Laps completed this session
+    uint8_t sector;         // Sector currently being driven (0 before the first start/finish crossing)
+    uint32_t last_lap_ms;
+    uint32_t best_lap_ms;
+    uint32_t last_cross_ms; // Interpolated time of the last gate crossing (ms since boot, same base as TS)
+} lap_status_t;
+
+extern lap_status_t lap_status;
+
+void laptimer_init(void);
+void laptimer_process_fix(int32_t lat_e7, int32_t lon_e7, int64_t time_us);
+esp_err_t laptimer_add_gate(int32_t lat_e7, int32_t lon_e7, float course_deg);
+esp_err_t laptimer_clear_gates(void);
+void laptimer_write_summary(void);
+void laptimer_print_summary(void);
+
+#endif /* INC_LAPTIMER_H_ */
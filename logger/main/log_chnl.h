@@ -1,6 +1,28 @@
 #ifndef LOG_CHANNELS_H
 #define LOG_CHANNELS_H
 
+#include "dtc_devices.h"
+
+// DTC_MAP spans 4 bytes per DTC status word, most significant word first
+#define DTC_MAP_WORD0 X(DTC_MAP) X(DTC_MAP1) X(DTC_MAP2) X(DTC_MAP3)
+#define DTC_MAP_WORD1 X(DTC_MAP4) X(DTC_MAP5) X(DTC_MAP6) X(DTC_MAP7)
+#define DTC_MAP_WORD2 X(DTC_MAP8) X(DTC_MAP9) X(DTC_MAP10) X(DTC_MAP11)
+#define DTC_MAP_WORD3 X(DTC_MAP12) X(DTC_MAP13) X(DTC_MAP14) X(DTC_MAP15)
+#define DTC_MAP_WORD4 X(DTC_MAP16) X(DTC_MAP17) X(DTC_MAP18) X(DTC_MAP19)
+#define DTC_MAP_WORD5 X(DTC_MAP20) X(DTC_MAP21) X(DTC_MAP22) X(DTC_MAP23)
+#define DTC_MAP_WORD6 X(DTC_MAP24) X(DTC_MAP25) X(DTC_MAP26) X(DTC_MAP27)
+#define DTC_MAP_WORD7 X(DTC_MAP28) X(DTC_MAP29) X(DTC_MAP30) X(DTC_MAP31)
+#define DTC_MAP_WORDS_1 DTC_MAP_WORD0
+#define DTC_MAP_WORDS_2 DTC_MAP_WORDS_1 DTC_MAP_WORD1
+#define DTC_MAP_WORDS_3 DTC_MAP_WORDS_2 DTC_MAP_WORD2
+#define DTC_MAP_WORDS_4 DTC_MAP_WORDS_3 DTC_MAP_WORD3
+#define DTC_MAP_WORDS_5 DTC_MAP_WORDS_4 DTC_MAP_WORD4
+#define DTC_MAP_WORDS_6 DTC_MAP_WORDS_5 DTC_MAP_WORD5
+#define DTC_MAP_WORDS_7 DTC_MAP_WORDS_6 DTC_MAP_WORD6
+#define DTC_MAP_WORDS_8 DTC_MAP_WORDS_7 DTC_MAP_WORD7
+#define DTC_MAP_CHANNELS_(words) DTC_MAP_WORDS_##words
+#define DTC_MAP_CHANNELS(words) DTC_MAP_CHANNELS_(words)
+
 // Define all log channels with preprocessor macros for enum and file header generation
 // Need an index for every byte each channel stores - indicate a reserved following byte
 // by copying the name of the previous channel and adding the index of the byte 
@@ -104,6 +126,35 @@
     X(GPS_SPD2) \
     X(GPS_SPD3) \
     X(GPS_FIX) \
+    X(GPS_HDG) \
+    X(GPS_HDG1) \
+    X(FUS_POS_N) \
+    X(FUS_POS_N1) \
+    X(FUS_POS_N2) \
+    X(FUS_POS_N3) \
+    X(FUS_POS_E) \
+    X(FUS_POS_E1) \
+    X(FUS_POS_E2) \
+    X(FUS_POS_E3) \
+    X(FUS_VN) \
+    X(FUS_VN1) \
+    X(FUS_VE) \
+    X(FUS_VE1) \
+    X(FUS_HDG) \
+    X(FUS_HDG1) \
+    X(FUS_SLIP) \
+    X(FUS_SLIP1) \
+    X(LAP_NUM) \
+    X(LAP_NUM1) \
+    X(LAP_SECTOR) \
+    X(LAP_LAST) \
+    X(LAP_LAST1) \
+    X(LAP_LAST2) \
+    X(LAP_LAST3) \
+    X(LAP_CROSS) \
+    X(LAP_CROSS1) \
+    X(LAP_CROSS2) \
+    X(LAP_CROSS3) \
     X(ECT) \
     X(OIL_PSR) \
     X(OIL_PSR1) \
@@ -112,17 +163,12 @@
     X(DRIVEN_WSPD) \
     X(DRIVEN_WSPD1) \
     X(TESTNO) \
-    X(DTC_FLW) \
-    X(DTC_FRW) \
-    X(DTC_RLW) \
-    X(DTC_RRW) \
-    X(DTC_FLSG) \
-    X(DTC_FRSG) \
-    X(DTC_RLSG) \
-    X(DTC_RRSG) \
-    X(DTC_IMU) \
-    X(GPS_0_) \
-    X(GPS_1_) \
+    DTC_MAP_CHANNELS(DTC_STATUS_WORDS) \
+    X(DTC_HEALTH) \
+    X(DTC_HEALTH1) \
+    X(MET_FIELD) \
+    X(MET_VALUE) \
+    X(MET_VALUE1) \
     X(CH_COUNT)
 
 // Generate the enum using the macro
@@ -138,7 +184,7 @@ extern uint8_t logBuffer[CH_COUNT];
 // Optional: Generate string names for debugging/logging
 #ifdef LOG_CHANNEL_NAMES
 static const char* log_channel_names[] = {
-    #define X(channel) {#channel ","},
+    #define X(channel) #channel ",",
     LOG_CHANNELS
     #undef X
 };
@@ -0,0 +1,221 @@
+#include "log_file.h"
+#include <stdarg.h>
+#include <string.h>
+#include "esp_log.h"
+#include "dlog.h"
+#include "esp_timer.h"
+#include "metrics.h"
+#include "prof.h"
+
+#define LOG_CHANNEL_NAMES
+#include "log_chnl.h"
+
+static const char* TAG = "FILE_SYS";
+
+FILE *log_file = NULL;
+SemaphoreHandle_t log_file_mutex;
+static char current_log_filepath[MAX_FILE_NAME_LENGTH];
+static StaticSemaphore_t log_file_mutex_buffer;
+static char csv_header[2048]; // Built under log_file_mutex when a file is opened
+
+const uint32_t log_file_ram_bytes = sizeof(csv_header) + sizeof(log_file_mutex_buffer);
+
+esp_err_t log_file_init(void) {
+    // Create mutex if not already created
+    if (log_file_mutex == NULL) {
+        log_file_mutex = xSemaphoreCreateMutexStatic(&log_file_mutex_buffer);
+    }
+    return ESP_OK;
+}
+
+// Comma-terminated channel names, as stored after the length word of every log
+size_t log_file_build_header(char *out, size_t size) {
+    size_t header_len = 0;
+    for (size_t i = 0; i < (sizeof(log_channel_names)/sizeof(log_channel_names[0])) - 1; i++) {
+        size_t name_len = strlen(log_channel_names[i]);
+        if (header_len + name_len < size - 1) {  // Leave room for \0
+            memcpy(out + header_len, log_channel_names[i], name_len);
+            header_len += name_len;
+        } else {
+            ESP_LOGW(TAG, "CSV header buffer too small, truncating");
+            break;
+        }
+    }
+    out[header_len] = '\0';
+    return header_len;
+}
+
+// Open a new log file
+esp_err_t log_file_open(const char *filename) {
+    xSemaphoreTake(log_file_mutex, portMAX_DELAY);
+    
+    // Close existing file if open
+    if (log_file != NULL) {
+        fflush(log_file);
+        fclose(log_file);
+        log_file = NULL;
+        ESP_LOGI(TAG, "Closed previous log file");
+    }
+    
+    // Open new file
+    log_file = fopen(filename, "a");
+    if (log_file == NULL) {
+        ESP_LOGE(TAG, "Failed to open log file: %s", filename);
+        xSemaphoreGive(log_file_mutex);
+        return ESP_FAIL;
+    }
+    
+    // Set buffer mode for better performance
+    setvbuf(log_file, NULL, _IOFBF, 4096);  // Full buffering with 4KB buffer
+    
+    // Update current filename
+    strncpy(current_log_filepath, filename, sizeof(current_log_filepath) - 1);
+    current_log_filepath[sizeof(current_log_filepath) - 1] = '\0';
+    
+    ESP_LOGI(TAG, "Opened log file: %s", filename);
+    
+    // Build CSV header string
+    size_t header_len = log_file_build_header(csv_header, sizeof(csv_header));
+
+    // Write header length as first 4 bytes (little-endian format)
+    uint32_t header_len_le = header_len;  // Convert to little-endian if needed
+    size_t len_written = fwrite(&header_len_le, sizeof(uint32_t), 1, log_file);
+    if (len_written != 1) {
+        ESP_LOGE(TAG, "Failed to write header length");
+        fclose(log_file);
+        log_file = NULL;
+        xSemaphoreGive(log_file_mutex);
+        return ESP_FAIL;
+    }
+    
+    // Write CSV header data
+    size_t written = fwrite(csv_header, 1, header_len, log_file);
+    if (written != header_len) {
+        ESP_LOGE(TAG, "Failed to write CSV header");
+        fclose(log_file);
+        log_file = NULL;
+        xSemaphoreGive(log_file_mutex);
+        return ESP_FAIL;
+    }
+    
+    // Flush to ensure header is written immediately
+    fflush(log_file);
+    
+    
+    xSemaphoreGive(log_file_mutex);
+    return ESP_OK;
+}
+
+esp_err_t fast_log_buffer(const uint8_t *data_buffer, uint8_t buffer_len) {
+    if (data_buffer == NULL || buffer_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    
+    if (log_file_mutex == NULL || log_file == NULL) {
+        DLOGW(TAG, "SD card not initialized or file not open");
+        metrics_inc(METRIC_RECORDS_FAILED);
+        return ESP_ERR_INVALID_STATE;
+    }
+    
+    // Take mutex with timeout to avoid indefinite blocking
+    if (xSemaphoreTake(log_file_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        DLOGW(TAG, "Failed to acquire log file mutex within timeout");
+        metrics_inc(METRIC_RECORDS_FAILED);
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t result = ESP_OK;
+    
+    // Critical section - file operations
+    if (log_file != NULL) {
+        int64_t start_us = esp_timer_get_time();
+        PROF_BEGIN(SD_WRITE);
+        size_t written = fwrite(data_buffer, sizeof(uint8_t), buffer_len, log_file);
+        PROF_END(SD_WRITE);
+        
+        if (written != buffer_len) {
+            DLOGE(TAG, "Log write failed: %zu/%u bytes", written, (unsigned)buffer_len);
+            result = ESP_FAIL;
+        } else {
+            // Only flush periodically for performance
+            static uint32_t write_count = 0;
+            if (++write_count % 10 == 0) {
+                PROF_BEGIN(SD_FLUSH);
+                fflush(log_file);
+                PROF_END(SD_FLUSH);
+                metrics_inc(METRIC_SD_FLUSHES);
+            }
+        }
+        metrics_record_sd_latency((uint32_t)(esp_timer_get_time() - start_us));
+    } else {
+        result = ESP_ERR_INVALID_STATE;
+    }
+    
+    // Always release the mutex
+    xSemaphoreGive(log_file_mutex);
+    metrics_inc(result == ESP_OK ? METRIC_RECORDS_WRITTEN : METRIC_RECORDS_FAILED);
+    
+    return result;
+}
+
+// Add this function to allow read-only access from outside
+const char* sdcard_get_current_log_filename(void) {
+    return current_log_filepath;
+}
+
+// Path of a companion file for the current log: /sdcard/data_log_001.benji2 -> /sdcard/data_log_001<suffix>
+esp_err_t sdcard_get_session_path(const char *suffix, char *buffer, size_t buffer_size) {
+    if (suffix == NULL || buffer == NULL || buffer_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    buffer[0] = '\0';
+
+    if (current_log_filepath[0] == '\0') {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t base_len = strlen(current_log_filepath);
+    size_t type_len = strlen(LOG_TYPE);
+    if (base_len >= type_len && strcmp(current_log_filepath + base_len - type_len, LOG_TYPE) == 0) {
+        base_len -= type_len;
+    }
+
+    if (base_len + strlen(suffix) >= buffer_size) {
+        ESP_LOGE(TAG, "Session path too long for buffer");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memcpy(buffer, current_log_filepath, base_len);
+    strcpy(buffer + base_len, suffix);
+    return ESP_OK;
+}
+
+FILE *log_file_open_sidecar(const char *suffix, const char *header) {
+    char path[MAX_FILE_NAME_LENGTH];
+    if (log_file == NULL || sdcard_get_session_path(suffix, path, sizeof(path)) != ESP_OK) {
+        return NULL;
+    }
+
+    FILE *f = fopen(path, "a");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return NULL;
+    }
+    // A new session starts a new file; the header goes in once
+    fseek(f, 0, SEEK_END);
+    if (header != NULL && ftell(f) == 0) {
+        fputs(header, f);
+    }
+    return f;
+}
+
+esp_err_t log_file_append_sidecar(const char *suffix, const char *header, const char *fmt, ...) {
+    FILE *f = log_file_open_sidecar(suffix, header);
+    if (f == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    va_list args;
+    va_start(args, fmt);
+    int written = vfprintf(f, fmt, args);
+    va_end(args);
+    return fclose(f) == 0 && written >= 0 ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,59 @@
+/*
+ * log_file.h
+ *
+ * The open .benji2 log: header, record appends and the session path. Plain
+ * stdio on whatever filesystem is mounted, so the host build writes the same
+ * file into a directory.
+ */
+#ifndef LOG_FILE_H
+#define LOG_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#define LOG_TYPE ".benji2"
+
+#define MAX_FILE_NAME_LENGTH 128
+
+extern FILE *log_file;
+extern SemaphoreHandle_t log_file_mutex;
+
+/**
+ * @brief Create the log file mutex (idempotent)
+ */
+esp_err_t log_file_init(void);
+
+/**
+ * @brief Close any open log and start a new one at path, writing the channel header
+ */
+esp_err_t log_file_open(const char *path);
+
+/**
+ * @brief Write the channel header (comma-terminated names, NUL-terminated) into out; returns its length
+ */
+size_t log_file_build_header(char *out, size_t size);
+
+esp_err_t fast_log_buffer(const uint8_t *data_buffer, uint8_t buffer_len);
+const char* sdcard_get_current_log_filename(void);
+esp_err_t sdcard_get_session_path(const char *suffix, char *buffer, size_t buffer_size);
+
+/**
+ * @brief Open the companion file <log><suffix> for appending, writing header first if the file is new
+ *
+ * Returns NULL while no log is open. The caller writes its rows and fcloses
+ * the file, so a card pulled mid-session keeps everything written so far.
+ * header may be NULL for a caller that writes its own (check ftell() == 0).
+ */
+FILE *log_file_open_sidecar(const char *suffix, const char *header);
+
+/**
+ * @brief Append one printf-formatted row to <log><suffix> (see log_file_open_sidecar)
+ */
+esp_err_t log_file_append_sidecar(const char *suffix, const char *header, const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+#endif
@@ -0,0 +1,90 @@
+#include "log_ring.h"
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "dtc_journal.h"
+#include "log_chnl.h"
+#include "log_file.h"
+#include "memmap.h"
+#include "sdcard.h"
+#include "metrics.h"
+#include "tasks.h"
+
+static const char *TAG = "LOG_RING";
+
+#if CONFIG_SPIRAM_ALLOW_BSS_SEG_EXTERNAL_MEMORY
+#define LOG_RING_ATTR EXT_RAM_BSS_ATTR
+#else
+#define LOG_RING_ATTR
+#endif
+
+static LOG_RING_ATTR uint8_t ring[LOG_RING_RECORDS][CH_COUNT];
+static volatile uint32_t ring_head = 0; // Sampler only
+static volatile uint32_t ring_tail = 0; // Log writer only
+static log_ring_stats_t stats;
+
+const uint32_t log_ring_ram_bytes = sizeof(ring);
+
+bool log_ring_push(const uint8_t *record) {
+    uint32_t head = ring_head;
+    uint32_t used = head - __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE);
+
+    if (stats.first_sample_ms == 0) {
+        stats.first_sample_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    }
+    if (used >= LOG_RING_RECORDS) {
+        stats.dropped++;
+        metrics_inc(METRIC_RECORDS_DROPPED);
+        return false;
+    }
+    memcpy(ring[head % LOG_RING_RECORDS], record, CH_COUNT);
+    __atomic_store_n(&ring_head, head + 1, __ATOMIC_RELEASE);
+
+    if (used + 1 > stats.peak) {
+        stats.peak = used + 1;
+    }
+    metrics_gauge_max(GAUGE_LOG_RING_PEAK, used + 1);
+    return true;
+}
+
+static void log_writer_task(void *pvParameters) {
+    (void)pvParameters;
+    // Mount off the acquisition path: records wait in the ring meanwhile
+    sdcard_init();
+    stats.storage_ok = sdcard_is_initialized();
+    stats.buffered = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE) - ring_tail;
+    stats.storage_ready_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    if (stats.storage_ok) {
+        ESP_LOGI(TAG, "First sample at %lu ms, storage ready at %lu ms with %lu records buffered (%lu dropped)",
+                 (unsigned long)stats.first_sample_ms, (unsigned long)stats.storage_ready_ms,
+                 (unsigned long)stats.buffered, (unsigned long)stats.dropped);
+    } else {
+        ESP_LOGE(TAG, "No SD card: records are counted as not written");
+    }
+    // Boot is over once the mount has allocated (or failed to allocate) the FAT buffers
+    memmap_boot_report();
+
+    while (1) {
+        uint32_t head = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE);
+        uint32_t tail = ring_tail;
+        while (tail != head) {
+            fast_log_buffer(ring[tail % LOG_RING_RECORDS], CH_COUNT);
+            tail++;
+            __atomic_store_n(&ring_tail, tail, __ATOMIC_RELEASE);
+        }
+        dtc_journal_write();
+        vTaskDelay(pdMS_TO_TICKS(LOG_WRITER_PERIOD_MS));
+    }
+}
+
+esp_err_t log_ring_start_writer(void) {
+    return tasks_create(TASK_LOG_WRITER, log_writer_task, NULL, NULL);
+}
+
+void log_ring_get_stats(log_ring_stats_t *out) {
+    *out = stats;
+    out->waiting = __atomic_load_n(&ring_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring_tail, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,69 @@
+/*
+ * log_ring.h
+ *
+ * Records between the sampler and the SD card. The sampler copies each
+ * record into a static single-producer/single-consumer ring and never
+ * blocks; the log writer task on the I/O core mounts the card first and then
+ * drains the ring through fast_log_buffer, followed by the DTC journal: it is
+ * the card's only writer of streamed data. Acquisition therefore starts as
+ * soon as the sources are up, and whatever is sampled while the card mounts
+ * waits in RAM and lands at the start of the log. Once the card is up, the
+ * ring also absorbs SD write stalls.
+ *
+ * If the ring fills, the newest records are dropped, so the first ones after
+ * key-on are kept. With PSRAM mapped for .bss the ring moves there and grows.
+ *
+ * Sizing without PSRAM: the mount is card identification at 400 kHz plus
+ * reading the FAT, under a second, and the ring covers it at 1 kHz.
+ * It is the largest entry of the RAM budget (memmap.h), so it holds one mount
+ * and no more: once the card runs at SD_SPI_FREQ_KHZ the writer drains
+ * several times faster than the sampler fills, and the backlog is gone within
+ * a fraction of a second. A card stuck at the 400 kHz probing clock can't keep
+ * up with ~141 KB/s at any ring size. logger_host --ring --mount-ms N
+ * --sd-kbps N measures the peak and the drops at a given mount time and card
+ * throughput.
+ */
+#ifndef INC_LOG_RING_H_
+#define INC_LOG_RING_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifndef LOG_RING_RECORDS
+#if CONFIG_SPIRAM_ALLOW_BSS_SEG_EXTERNAL_MEMORY
+#define LOG_RING_RECORDS 16384 // ~2.3 MiB of PSRAM, 16 s at 1 kHz
+#else
+#define LOG_RING_RECORDS 1024  // CH_COUNT bytes each (141 KiB of internal RAM), about 1 s at 1 kHz: one mount
+#endif
+#endif
+
+#define LOG_WRITER_PERIOD_MS 10
+
+typedef struct {
+    uint32_t first_sample_ms;  // esp_timer time (since app start, bootloader excluded) of the first record
+    uint32_t storage_ready_ms; // Card mounted and log open; 0 while mounting
+    uint32_t buffered;         // Records waiting in RAM when storage became ready
+    uint32_t dropped;          // Records lost to a full ring
+    uint32_t peak;             // Most records ever waiting
+    uint32_t waiting;          // Records in the ring now
+    bool storage_ok;           // False if the mount failed
+} log_ring_stats_t;
+
+/**
+ * @brief Queue one record (CH_COUNT bytes) for the card; never blocks (sampler)
+ */
+bool log_ring_push(const uint8_t *record);
+
+/**
+ * @brief Start the log writer task: mounts the SD card, then drains the ring
+ */
+esp_err_t log_ring_start_writer(void);
+
+/**
+ * @brief Copy the boot timing and ring counters
+ */
+void log_ring_get_stats(log_ring_stats_t *out);
+
+#endif /* INC_LOG_RING_H_ */
@@ -8,7 +8,6 @@
 #include "esp_freertos_hooks.h"
 #include <string.h>
 #include "dtc.h"
-#include "logger.h"
 #include "ina260.h"
 #include "adc.h"
 #include "gnss.h"
@@ -17,6 +16,17 @@
 #include "sdcard.h"
 #include "log_chnl.h"
 #include "uart.h"
+#include "laptimer.h"
+#include "dtc_journal.h"
+#include "metrics.h"
+#include "record.h"
+#include "prof.h"
+#include "dlog.h"
+#include "tasks.h"
+#include "log_ring.h"
+
+#define LOG_RATE_HZ 1000
+#define LOG_PERIOD_US (1000000 / LOG_RATE_HZ)
 
 uint8_t logBuffer[CH_COUNT];
 uint8_t usbBuffer[64];
@@ -28,268 +38,36 @@ const char compileDateTime[] = __DATE__ " " __TIME__;
 static const char *TAG = "MAIN_APP";
 
 
-typedef struct {
-	uint16_t ambTemp;
-	uint16_t objTemp;
-	uint16_t rpm;
-} wheel_data_s_t;
-
-//Logging variables
-uint8_t				  TXDAT[8];
-uint32_t count = 0;
-uint32_t imuCount = 0;
-uint32_t xAccel = 0, yAccel = 0, zAccel = 0;
-uint32_t xGyro = 0, yGyro = 0, zGyro = 0;
-uint16_t frsg = 0, flsg = 0, rrsg = 0, rlsg = 0;
-wheel_data_s_t frw, flw, rlw, rrw;
-uint8_t testNo = 0;
-uint8_t canFifoFull = 0;
-uint8_t drs = 0;
-uint16_t brakeFluid = 0, throttleLoad = 0, brakeLoad = 0;
-uint16_t oilPress = 0, driven_wspd = 0;
-uint8_t ect = 0, tps = 0, aps = 0, shift0 = 0, shift1 = 0, shift2 = 0;
-
-
-
-
+// CAN receive task callback
 static void process_can_message(twai_frame_t *message) {
-
-    uint8_t data[8];
-    memcpy(data, message->buffer, message->header.dlc);
-    switch(message->header.id) {
-        case 0x35F:
-            drs = data[0];
-            break;
-            
-        case 0x360:
-            //IMU Data
-            xAccel = data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3];
-            yAccel = data[4] << 24 | data[5] << 16 | data[6] << 8 | data[7];
-            imuCount++;
-            
-            //IMU DTC Check
-            break;
-            
-        case 0x361:
-            //IMU Data
-            zAccel = data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3];
-            xGyro = data[4] << 24 | data[5] << 16 | data[6] << 8 | data[7];
-            imuCount++;
-
-            //IMU DTC Check
-            break;
-            
-        case 0x362:
-            //IMU Data
-            yGyro = data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3];
-            zGyro = data[4] << 24 | data[5] << 16 | data[6] << 8 | data[7];
-            imuCount++;
-
-            //IMU DTC Response Update
-            DTC_CAN_Response_Measurement(dtc_devices[imu_DTC], pdMS_TO_TICKS(xTaskGetTickCount()));
-            break;
-            
-        case 0x363:
-            //Front Left Wheel Board
-            flw.rpm = data[0] << 8 | data[1];
-            flw.objTemp = data[2] << 8 | data[3];
-            flw.ambTemp = data[4] << 8 | data[5];
-
-            //DTC Response Update
-            DTC_CAN_Response_Measurement(dtc_devices[flWheelBoard_DTC], pdMS_TO_TICKS(xTaskGetTickCount()));
-            break;
-            
-        case 0x364:
-            //Front Right Wheel Board
-            frw.rpm = data[0] << 8 | data[1];
-            frw.objTemp = data[2] << 8 | data[3];
-            frw.ambTemp = data[4] << 8 | data[5];
-
-            //DTC Response Update
-            DTC_CAN_Response_Measurement(dtc_devices[frWheelBoard_DTC], pdMS_TO_TICKS(xTaskGetTickCount()));
-            break;
-            
-        case 0x365:
-            //Rear Right Wheel Board
-            rrw.rpm = data[0] << 8 | data[1];
-            rrw.objTemp = data[2] << 8 | data[3];
-            rrw.ambTemp = data[4] << 8 | data[5];
-
-            //DTC Response Update
-            DTC_CAN_Response_Measurement(dtc_devices[rrWheelBoard_DTC], pdMS_TO_TICKS(xTaskGetTickCount()));
-            break;
-            
-        case 0x366:
-            //Rear Left Wheel Board
-            rlw.rpm = data[0] << 8 | data[1];
-            rlw.objTemp = data[2] << 8 | data[3];
-            rlw.ambTemp = data[4] << 8 | data[5];
-
-            //DTC Response Update
-            DTC_CAN_Response_Measurement(dtc_devices[rlWheelBoard_DTC], pdMS_TO_TICKS(xTaskGetTickCount()));
-            break;
-            
-        case 0x4e2:
-            //Front Left String Gauge
-            flsg = data[0] << 8 | data[1];
-
-            //String Gauge DTC Check
-            DTC_CAN_Response_Measurement(dtc_devices[flStrainGauge_DTC], pdMS_TO_TICKS(xTaskGetTickCount()));
-
-            break;
-            
-        case 0x4e3:
-            //Front Right String Gauge
-            frsg = data[0] << 8 | data[1];
-
-            //String Gauge DTC Check
-            DTC_CAN_Response_Measurement(dtc_devices[frStrainGauge_DTC], pdMS_TO_TICKS(xTaskGetTickCount()));
-            break;
-            
-        case 0x4e4:
-            //Rear Right String Gauge
-            rrsg = data[0] << 8 | data[1];
-
-            //String Gauge DTC Check
-            DTC_CAN_Response_Measurement(dtc_devices[rrStrainGauge_DTC], pdMS_TO_TICKS(xTaskGetTickCount()));
-            break;
-            
-        case 0x4e5:
-            //Rear Left String Gauge
-            rlsg = data[0] << 8 | data[1];
-
-            //String Gauge DTC Check
-            DTC_CAN_Response_Measurement(dtc_devices[rlStrainGauge_DTC], pdMS_TO_TICKS(xTaskGetTickCount()));
-            break;
-            
-        case 0x3e8:
-            //Engine CAN Stream 2
-            switch(data[0]){
-                //Frame 1
-                case 0x0:
-                    // engine_speed = message->data[1] << 8 | message->data[2];
-                    ect = data[3];
-                    // oilTemp = message->data[4];
-                    oilPress = data[5] << 8 | data[6];
-                    //TODO: Could also add Park/Neutral Status (Stored on message->data[7])
-                    break;
-
-                case 0x1:
-                    tps = data[2];
-                    driven_wspd = data[4] << 8 | data[5];
-                    break;
-                    
-                case 0x2:
-                    aps = data[1];
-                    break;
-            }
-            break;
-
-        case 0x40:
-            // Shifter Data
-            shift0 = data[0];
-            shift1 = data[1];
-            shift2 = data[2];
-            if((shift1 != 1) | (shift2 != 1)) {
-                TXDAT[1] = shift1;
-                TXDAT[2] = shift2;
-            }
-            DTC_CAN_Response_Measurement(dtc_devices[shifter_DTC], pdMS_TO_TICKS(xTaskGetTickCount()));
-            break;
-    }
+    record_process_can(message->header.id, message->buffer, message->header.dlc);
 }
 
+static TaskHandle_t log_task_handle = NULL;
 
+// esp_timer task (I/O core): wake the sampler on the acquisition core
+static void log_period_callback(void *arg) {
+    xTaskNotifyGive(log_task_handle);
+}
 
 void logBuffer_task(void *pvParamaters){
-    uint16_t fbp, rbp, stp, fls, frs, rrs, rls;
-    
+    int64_t last_us = 0;
     while(1){
-
-
-        // //Log Analog Sensor Data
-        // Get ADC values quickly (no SPI operations here)
-        if (adc_get_values(&fbp, &rbp, &stp, &fls, &frs, &rrs, &rls) == ESP_OK) {
-            // Log Analog Sensor Data using cached values
-            loggerEmplaceU16(logBuffer, F_BRAKEPRESSURE, fbp);
-            loggerEmplaceU16(logBuffer, R_BRAKEPRESSURE, rbp);
-            loggerEmplaceU16(logBuffer, STEERING, stp);
-            loggerEmplaceU16(logBuffer, FLSHOCK, fls);
-            loggerEmplaceU16(logBuffer, FRSHOCK, frs);
-            loggerEmplaceU16(logBuffer, RRSHOCK, rrs);
-            loggerEmplaceU16(logBuffer, RLSHOCK, rls);
-        } else {
-            ESP_LOGW(TAG, "Using previous ADC values due to mutex timeout");
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t now_us = esp_timer_get_time();
+        if (last_us != 0) {
+            int64_t period = now_us - last_us;
+            metrics_record_sample_jitter((uint32_t)(period > LOG_PERIOD_US ? period - LOG_PERIOD_US : LOG_PERIOD_US - period));
         }
+        last_us = now_us;
 
+        PROF_BEGIN(RECORD_PACK);
+        record_pack(logBuffer, (uint32_t)(esp_timer_get_time() / 1000));
+        PROF_END(RECORD_PACK);
 
-
-        // //Report Battery Current and Voltage
-        loggerEmplaceU16(logBuffer, CURRENT, getCurrent());
-        loggerEmplaceU16(logBuffer, BATTERY, getVoltage());
-
-        //Report IMU Data
-        loggerEmplaceU32(logBuffer, IMU_X_ACCEL, xAccel);
-        loggerEmplaceU32(logBuffer, IMU_Y_ACCEL, yAccel);
-        loggerEmplaceU32(logBuffer, IMU_Z_ACCEL, zAccel);
-
-        loggerEmplaceU32(logBuffer, IMU_X_GYRO, xGyro);
-        loggerEmplaceU32(logBuffer, IMU_Y_GYRO, yGyro);
-        loggerEmplaceU32(logBuffer, IMU_Z_GYRO, zGyro);
-
-        //Report Wheel Board Sensor Data
-        loggerEmplaceU16(logBuffer, FLW_AMB, flw.ambTemp);
-        loggerEmplaceU16(logBuffer, FLW_OBJ, flw.objTemp);
-        loggerEmplaceU16(logBuffer, FLW_RPM, flw.rpm);
-
-        loggerEmplaceU16(logBuffer, FRW_AMB, frw.ambTemp);
-        loggerEmplaceU16(logBuffer, FRW_OBJ, frw.objTemp);
-        loggerEmplaceU16(logBuffer, FRW_RPM, frw.rpm);
-
-        loggerEmplaceU16(logBuffer, RRW_AMB, rrw.ambTemp);
-        loggerEmplaceU16(logBuffer, RRW_OBJ, rrw.objTemp);
-        loggerEmplaceU16(logBuffer, RRW_RPM, rrw.rpm);
-
-        loggerEmplaceU16(logBuffer, RLW_AMB, rlw.ambTemp);
-        loggerEmplaceU16(logBuffer, RLW_OBJ, rlw.objTemp);
-        loggerEmplaceU16(logBuffer, RLW_RPM, rlw.rpm);
-
-        //Report String Gauge Data
-        loggerEmplaceU16(logBuffer, FR_SG, frsg);
-        loggerEmplaceU16(logBuffer, FL_SG, flsg);
-        loggerEmplaceU16(logBuffer, RR_SG, rrsg);
-        loggerEmplaceU16(logBuffer, RL_SG, rlsg);
-
-        //Report Brakes and Throttle
-        loggerEmplaceU16(logBuffer, BRAKE_FLUID, brakeFluid);
-        loggerEmplaceU16(logBuffer, THROTTLE_LOAD, throttleLoad);
-        loggerEmplaceU16(logBuffer, BRAKE_LOAD, brakeLoad);
-
-        //Report ECU Data
-        loggerEmplaceU16(logBuffer, DRIVEN_WSPD, driven_wspd);
-        loggerEmplaceU16(logBuffer, OIL_PSR, oilPress);
-        logBuffer[TPS] = tps;
-        logBuffer[ECT] = ect;
-        logBuffer[APS] = aps;
-
-        //Report DTC Data
-        logBuffer[DTC_FLW]  = dtc_devices[flWheelBoard_DTC]->errState;
-        logBuffer[DTC_FRW]  = dtc_devices[frWheelBoard_DTC]->errState;
-        logBuffer[DTC_RRW]  = dtc_devices[rrWheelBoard_DTC]->errState;
-        logBuffer[DTC_RLW]  = dtc_devices[rlWheelBoard_DTC]->errState;
-        logBuffer[DTC_FLSG] = dtc_devices[flStrainGauge_DTC]->errState;
-        logBuffer[DTC_FRSG] = dtc_devices[frStrainGauge_DTC]->errState;
-        logBuffer[DTC_RLSG] = dtc_devices[flStrainGauge_DTC]->errState;
-        logBuffer[DTC_RRSG] = dtc_devices[rrStrainGauge_DTC]->errState;
-        logBuffer[DTC_IMU]  = dtc_devices[imu_DTC]->errState;
-        logBuffer[GPS_0_]   = dtc_devices[gps_0_DTC]->errState;
-        logBuffer[GPS_1_]   = dtc_devices[gps_1_DTC]->errState;
-
-        // // Write Data to SD Card - mutex handling is internal
-        // esp_err_t result = fast_log_buffer(logBuffer, CH_COUNT);
-        // if (result != ESP_OK) {
-        //     ESP_LOGW(TAG, "Failed to write log buffer to SD card");
-        // }
+        // The log writer task puts it on the SD card; never blocks here
+        log_ring_push(logBuffer);
+        metrics_inc(METRIC_RECORDS_PRODUCED);
 
     }
 }
@@ -299,31 +77,54 @@ void app_main(void)
     esp_log_level_set("GNSS_DMA", ESP_LOG_DEBUG);
 
     
-    // Initialize UART
-    sdcard_init();
+    // Acquisition first: the SD card mounts in the background once sampling runs
+    nvs_init();
+    ESP_ERROR_CHECK(log_file_init());
+    laptimer_init();
     gnss_init();
     ESP_ERROR_CHECK(uart_init());
-    DTC_Init(pdTICKS_TO_MS(xTaskGetTickCount()));
+    DTC_Init(DTC_Now_Ms());
+    dtc_journal_init();
     i2c_master_init();
     adc_init();
+
+    ESP_ERROR_CHECK(record_init());
+    gnss_set_fix_callback(record_process_gnss_fix);
     can_init(process_can_message);
+    gnss_start_task();
 
-    
+    // Sampler on the acquisition core, paced by a periodic esp_timer
+    if (tasks_create(TASK_SAMPLER, logBuffer_task, NULL, &log_task_handle) == ESP_OK) {
+        const esp_timer_create_args_t log_timer_args = {
+            .callback = log_period_callback,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "log_period",
+        };
+        esp_timer_handle_t log_timer;
+        if (esp_timer_create(&log_timer_args, &log_timer) != ESP_OK ||
+            esp_timer_start_periodic(log_timer, LOG_PERIOD_US) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to start log period timer");
+        }
+    }
+    // Records wait in the log ring until the writer has mounted the card
+    if (log_ring_start_writer() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start log writer task");
+    }
 
     ESP_ERROR_CHECK(uart_create_tasks());
 
-    if (dtc_start_task() != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create dtc_task");
+    if (dtc_start_timer() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start DTC deadline timer");
         return;
     }
-
-
-    gnss_start_task();
-
-        // Create ADC reading task (high priority for consistent sampling)
-    BaseType_t result = xTaskCreate(logBuffer_task, "log buffer", 4096, NULL, 8, NULL);
-    if (result != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create Logging task");
+    if (dtc_start_stats_task() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start DTC stats task");
+    }
+    if (metrics_start_task() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start metrics task");
+    }
+    if (dlog_start_task() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start deferred log task");
     }
 
     ESP_LOGI(TAG, "All tasks created successfully");
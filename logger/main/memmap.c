@@ -0,0 +1,56 @@
+#include "memmap.h"
+#include <stdio.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "MEMMAP";
+
+// Linker script symbols bounding the internal RAM sections
+extern int _data_start, _data_end, _bss_start, _bss_end;
+
+static size_t boot_heap_free = 0;
+
+static const struct {
+    const char *subsystem;
+    const char *what;
+    const uint32_t *bytes;
+} ram_table[] = {
+    #define X(symbol, subsystem, what) {subsystem, what, &symbol},
+    LOGGER_RAM
+    #undef X
+};
+#define RAM_TABLE_COUNT (sizeof(ram_table) / sizeof(ram_table[0]))
+
+static void print_budget(void) {
+    uint32_t total = 0;
+
+    printf("\n%-14s %8s  %s\n", "Subsystem", "Bytes", "Static storage");
+    printf("==========================================================\n");
+    for (size_t i = 0; i < RAM_TABLE_COUNT; i++) {
+        printf("%-14s %8lu  %s\n", ram_table[i].subsystem, (unsigned long)*ram_table[i].bytes, ram_table[i].what);
+        total += *ram_table[i].bytes;
+    }
+    printf("%-14s %8lu\n", "Logger total", (unsigned long)total);
+    printf("%-14s %8lu  (IDF and drivers included)\n", ".data + .bss",
+           (unsigned long)((char *)&_data_end - (char *)&_data_start + (char *)&_bss_end - (char *)&_bss_start));
+
+    printf("\nHeap: %lu of %lu bytes free, minimum %lu, largest block %lu\n",
+           (unsigned long)heap_caps_get_free_size(MALLOC_CAP_8BIT),
+           (unsigned long)heap_caps_get_total_size(MALLOC_CAP_8BIT),
+           (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+           (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
+
+void memmap_boot_report(void) {
+    boot_heap_free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    print_budget();
+    ESP_LOGI(TAG, "Boot done, %lu bytes of heap left to the drivers", (unsigned long)boot_heap_free);
+}
+
+void memmap_print(void) {
+    print_budget();
+    if (boot_heap_free != 0) {
+        long drift = (long)heap_caps_get_free_size(MALLOC_CAP_8BIT) - (long)boot_heap_free;
+        printf("Heap change since boot: %+ld bytes\n", drift);
+    }
+}
@@ -0,0 +1,51 @@
+/*
+ * memmap.h
+ *
+ * RAM budget of the logger. Every task stack, queue and buffer is reserved
+ * statically at link time; each subsystem exports the size of its share as a
+ * const next to the storage, and the table below prints them with the .data
+ * and .bss totals and the heap left to the drivers. The log writer prints the
+ * boot report once the card mount has allocated its buffers (or failed); the
+ * heap should not move after that: 'mem' shows how far it drifted since.
+ *
+ * At build time, 'idf.py size-files' breaks the same storage down per object.
+ */
+#ifndef INC_MEMMAP_H_
+#define INC_MEMMAP_H_
+
+#include <stdint.h>
+
+// symbol, subsystem, what it holds
+#define LOGGER_RAM \
+    X(tasks_ram_bytes,       "Tasks",        "Stacks and TCBs") \
+    X(can_ram_bytes,         "CAN",          "Receive queue") \
+    X(dtc_ram_bytes,         "DTC",          "Devices, windows, deadline wheel, stats") \
+    X(dtc_journal_ram_bytes, "DTC journal",  "Entry queue, NVS ring") \
+    X(gnss_ram_bytes,        "GNSS",         "Sentence buffer") \
+    X(log_ring_ram_bytes,    "Log ring",     "Records sampled during one SD mount (PSRAM if mapped)") \
+    X(record_ram_bytes,      "Record",       "Fusion filter, fix queue") \
+    X(laptimer_ram_bytes,    "Lap timer",    "Gates, lap summary queue") \
+    X(log_file_ram_bytes,    "Log file",     "Header buffer, mutex") \
+    X(adc_ram_bytes,         "ADC",          "Mutex, SPI buffer") \
+    X(console_ram_bytes,     "Console",      "Stream buffer") \
+    X(telemetry_ram_bytes,   "Telemetry",    "Frame buffers") \
+    X(metrics_ram_bytes,     "Metrics",      "Snapshots, histograms") \
+    X(prof_ram_bytes,        "Profiler",     "Stage histograms") \
+    X(trace_ram_bytes,       "Trace",        "Per-core event rings") \
+    X(dlog_ram_bytes,        "Deferred log", "Entry ring")
+
+#define X(symbol, subsystem, what) extern const uint32_t symbol;
+LOGGER_RAM
+#undef X
+
+/**
+ * @brief Print the RAM budget after the card mount and remember the heap as the baseline (log writer task)
+ */
+void memmap_boot_report(void);
+
+/**
+ * @brief Print the RAM budget and the heap drift since the boot report
+ */
+void memmap_print(void);
+
+#endif /* INC_MEMMAP_H_ */
@@ -0,0 +1,325 @@
+#include "metrics.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "can.h"
+#include "prof.h"
+#include "laptimer.h"
+#include "tasks.h"
+
+static const char *TAG = "METRICS";
+
+volatile uint32_t metrics_counters[METRIC_COUNT];
+volatile uint32_t metrics_gauges[GAUGE_COUNT];
+static volatile uint32_t sd_latency_hist[METRICS_LATENCY_BUCKETS];
+static volatile uint32_t jitter_hist[METRICS_JITTER_BUCKETS];
+static volatile uint32_t jitter_max_us;
+
+static const char *counter_names[] = {
+    #define X(name, desc) desc,
+    METRICS_COUNTERS
+    #undef X
+};
+
+static const char *gauge_names[] = {
+    #define X(name, desc) desc,
+    METRICS_GAUGES
+    #undef X
+};
+
+typedef struct {
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t number;     // xTaskNumber, stable for the life of the task
+    uint64_t runtime;       // Cumulative run time counter, for the next delta
+    uint16_t cpu_permille;  // Share of one core over the last period
+    uint32_t stack_hwm;     // Bytes never used
+    UBaseType_t priority;
+    BaseType_t core;
+} metrics_task_t;
+
+typedef struct {
+    uint32_t seq;
+    uint32_t total[METRIC_COUNT];
+    uint32_t delta[METRIC_COUNT];
+    uint32_t gauge[GAUGE_COUNT];
+    uint32_t hist[METRICS_LATENCY_BUCKETS];
+    uint8_t cpu_load;
+    uint32_t heap_free;
+    uint32_t heap_min;
+    uint16_t task_count;
+    metrics_task_t tasks[METRICS_MAX_TASKS];
+} metrics_snapshot_t;
+
+// Built by the metrics task, published under the lock
+static metrics_snapshot_t work;
+static metrics_snapshot_t published;
+static metrics_summary_t summary;
+static portMUX_TYPE snapshot_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static TaskStatus_t task_status[METRICS_MAX_TASKS];
+static uint64_t last_total_runtime = 0;
+
+void metrics_record_sd_latency(uint32_t us) {
+    int bucket = us == 0 ? 0 : 32 - __builtin_clz(us);
+    if (bucket >= METRICS_LATENCY_BUCKETS) {
+        bucket = METRICS_LATENCY_BUCKETS - 1;
+    }
+    __atomic_fetch_add(&sd_latency_hist[bucket], 1, __ATOMIC_RELAXED);
+    metrics_gauge_max(GAUGE_SD_WRITE_MAX_US, us);
+}
+
+void metrics_record_sample_jitter(uint32_t us) {
+    uint32_t bucket = us / METRICS_JITTER_BUCKET_US;
+    if (bucket >= METRICS_JITTER_BUCKETS) {
+        bucket = METRICS_JITTER_BUCKETS - 1;
+    }
+    __atomic_fetch_add(&jitter_hist[bucket], 1, __ATOMIC_RELAXED);
+    if (us > jitter_max_us) {
+        jitter_max_us = us; // Single writer: the sampler
+    }
+}
+
+void metrics_reset_jitter(void) {
+    for (int b = 0; b < METRICS_JITTER_BUCKETS; b++) {
+        __atomic_store_n(&jitter_hist[b], 0, __ATOMIC_RELAXED);
+    }
+    jitter_max_us = 0;
+}
+
+// Upper edge of the bucket holding the given fraction (permille) of the samples
+static uint32_t jitter_percentile(const uint32_t *hist, uint32_t count, uint32_t permille) {
+    uint64_t target = ((uint64_t)count * permille + 999) / 1000;
+    uint32_t seen = 0;
+    for (int b = 0; b < METRICS_JITTER_BUCKETS; b++) {
+        seen += hist[b];
+        if (seen >= target) {
+            return (uint32_t)(b + 1) * METRICS_JITTER_BUCKET_US;
+        }
+    }
+    return METRICS_JITTER_BUCKETS * METRICS_JITTER_BUCKET_US;
+}
+
+void metrics_print_jitter(void) {
+    uint32_t hist[METRICS_JITTER_BUCKETS];
+    uint32_t count = 0;
+    for (int b = 0; b < METRICS_JITTER_BUCKETS; b++) {
+        hist[b] = __atomic_load_n(&jitter_hist[b], __ATOMIC_RELAXED);
+        count += hist[b];
+    }
+    if (count == 0) {
+        printf("No sampler periods recorded\n");
+        return;
+    }
+    printf("\nSampler period error (%lu periods, %s)\n", (unsigned long)count,
+           TASKS_PINNING ? "pinned" : "unpinned");
+    printf("  %-6s <= %lu us\n", "p50", (unsigned long)jitter_percentile(hist, count, 500));
+    printf("  %-6s <= %lu us\n", "p99", (unsigned long)jitter_percentile(hist, count, 990));
+    printf("  %-6s <= %lu us\n", "p99.9", (unsigned long)jitter_percentile(hist, count, 999));
+    printf("  %-6s    %lu us\n", "max", (unsigned long)jitter_max_us);
+}
+
+static uint64_t previous_runtime(UBaseType_t number, uint64_t fallback) {
+    for (int i = 0; i < published.task_count; i++) {
+        if (published.tasks[i].number == number) {
+            return published.tasks[i].runtime;
+        }
+    }
+    return fallback; // New task: no share until the next period
+}
+
+static void snapshot_tasks(void) {
+    uint64_t total_runtime = 0;
+    UBaseType_t count = uxTaskGetSystemState(task_status, METRICS_MAX_TASKS, &total_runtime);
+    if (count == 0) {
+        ESP_LOGW(TAG, "More than %d tasks, task table skipped", METRICS_MAX_TASKS);
+        work.task_count = 0;
+        return;
+    }
+
+    uint64_t elapsed = total_runtime - last_total_runtime;
+    last_total_runtime = total_runtime;
+    uint64_t idle = 0;
+
+    for (UBaseType_t i = 0; i < count; i++) {
+        const TaskStatus_t *ts = &task_status[i];
+        metrics_task_t *t = &work.tasks[i];
+        uint64_t ran = ts->ulRunTimeCounter - previous_runtime(ts->xTaskNumber, ts->ulRunTimeCounter);
+
+        strncpy(t->name, ts->pcTaskName, sizeof(t->name) - 1);
+        t->name[sizeof(t->name) - 1] = '\0';
+        t->number = ts->xTaskNumber;
+        t->runtime = ts->ulRunTimeCounter;
+        t->cpu_permille = elapsed > 0 ? (uint16_t)(ran * 1000 / elapsed) : 0;
+        t->stack_hwm = ts->usStackHighWaterMark;
+        t->priority = ts->uxCurrentPriority;
+        t->core = ts->xCoreID;
+        if (strncmp(ts->pcTaskName, "IDLE", 4) == 0) {
+            idle += ran;
+        }
+    }
+    work.task_count = count;
+
+    uint64_t capacity = elapsed * portNUM_PROCESSORS;
+    work.cpu_load = capacity > 0 && idle < capacity ? (uint8_t)(100 - idle * 100 / capacity) : 0;
+}
+
+static uint16_t sat16(uint32_t v) {
+    return v > UINT16_MAX ? UINT16_MAX : v;
+}
+
+static uint8_t sat8(uint32_t v) {
+    return v > UINT8_MAX ? UINT8_MAX : v;
+}
+
+static void take_snapshot(void) {
+    can_stats_t can;
+    can_get_stats(&can);
+    metrics_set(METRIC_CAN_RX, can.rx_frames);
+    metrics_set(METRIC_CAN_DROPPED, can.rx_dropped + can.rx_overruns);
+
+    work.seq = published.seq + 1;
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        work.total[i] = metrics_counters[i];
+        work.delta[i] = work.total[i] - published.total[i];
+    }
+    for (int i = 0; i < GAUGE_COUNT; i++) {
+        work.gauge[i] = __atomic_exchange_n(&metrics_gauges[i], 0, __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+        work.hist[i] = sd_latency_hist[i];
+    }
+    work.heap_free = esp_get_free_heap_size();
+    work.heap_min = esp_get_minimum_free_heap_size();
+    snapshot_tasks();
+
+    uint32_t stack_min = UINT32_MAX;
+    for (int i = 0; i < work.task_count; i++) {
+        if (work.tasks[i].stack_hwm < stack_min) {
+            stack_min = work.tasks[i].stack_hwm;
+        }
+    }
+
+    metrics_summary_t next = {
+        .seq = (uint16_t)work.seq,
+        .records_per_s = sat16(work.delta[METRIC_RECORDS_WRITTEN]),
+        .sd_write_max_us = sat16(work.gauge[GAUGE_SD_WRITE_MAX_US]),
+        .can_dropped = sat16(work.delta[METRIC_CAN_DROPPED]),
+        .adc_overruns = sat8(work.delta[METRIC_ADC_OVERRUNS]),
+        .i2c_errors = sat8(work.delta[METRIC_I2C_ERRORS]),
+        .cpu_load = work.cpu_load,
+        .stack_min = sat16(stack_min),
+        .heap_free_kib = sat16(work.heap_free / 1024),
+    };
+
+    portENTER_CRITICAL(&snapshot_lock);
+    published = work;
+    summary = next;
+    portEXIT_CRITICAL(&snapshot_lock);
+}
+
+void metrics_get_summary(metrics_summary_t *out) {
+    portENTER_CRITICAL(&snapshot_lock);
+    *out = summary;
+    portEXIT_CRITICAL(&snapshot_lock);
+}
+
+uint16_t metrics_summary_field(const metrics_summary_t *s, metrics_field_t field) {
+    switch (field) {
+        #define X(name) case METRICS_FIELD_##name: return s->name;
+        METRICS_SUMMARY_FIELDS
+        #undef X
+        default: return 0;
+    }
+}
+
+// Console task only
+static metrics_snapshot_t view;
+
+const uint32_t metrics_ram_bytes = sizeof(work) + sizeof(published) + sizeof(view) + sizeof(task_status) +
+                                   sizeof(sd_latency_hist) + sizeof(jitter_hist);
+
+static void copy_published(void) {
+    portENTER_CRITICAL(&snapshot_lock);
+    view = published;
+    portEXIT_CRITICAL(&snapshot_lock);
+}
+
+static void print_tasks(void) {
+    printf("\n%-16s %4s %4s %7s %10s\n", "Task", "Core", "Prio", "CPU %", "Stack free");
+    printf("===============================================\n");
+    for (int i = 0; i < view.task_count; i++) {
+        const metrics_task_t *t = &view.tasks[i];
+        char core[12] = "-"; // Fits any int
+        if (t->core != tskNO_AFFINITY) {
+            snprintf(core, sizeof(core), "%d", (int)t->core);
+        }
+        printf("%-16s %4s %4u %5u.%u %10lu\n", t->name, core, (unsigned)t->priority, t->cpu_permille / 10,
+               t->cpu_permille % 10, (unsigned long)t->stack_hwm);
+    }
+    printf("CPU load: %u%% of %d cores\n", view.cpu_load, portNUM_PROCESSORS);
+}
+
+void metrics_print_tasks(void) {
+    copy_published();
+    if (view.seq == 0) {
+        printf("No metrics snapshot yet\n");
+        return;
+    }
+    print_tasks();
+}
+
+void metrics_print(void) {
+    copy_published();
+    if (view.seq == 0) {
+        printf("No metrics snapshot yet\n");
+        return;
+    }
+
+    printf("\n=== Metrics (snapshot %lu) ===\n\n", (unsigned long)view.seq);
+    printf("%-28s %10s %8s\n", "Counter", "Total", "Per s");
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        printf("%-28s %10lu %8lu\n", counter_names[i], (unsigned long)view.total[i], (unsigned long)view.delta[i]);
+    }
+
+    printf("\n%-28s %10s\n", "Gauge", "Peak");
+    for (int i = 0; i < GAUGE_COUNT; i++) {
+        printf("%-28s %10lu\n", gauge_names[i], (unsigned long)view.gauge[i]);
+    }
+
+    printf("\nSD write latency (since boot)\n");
+    for (int b = 0; b < METRICS_LATENCY_BUCKETS; b++) {
+        if (view.hist[b] == 0) {
+            continue;
+        }
+        if (b == 0) {
+            printf("  %12s %10lu\n", "0 us", (unsigned long)view.hist[b]);
+        } else {
+            char range[24];
+            if (b == METRICS_LATENCY_BUCKETS - 1) {
+                snprintf(range, sizeof(range), ">= %lu us", 1UL << (b - 1));
+            } else {
+                snprintf(range, sizeof(range), "%lu-%lu us", 1UL << (b - 1), (1UL << b) - 1);
+            }
+            printf("  %12s %10lu\n", range, (unsigned long)view.hist[b]);
+        }
+    }
+
+    printf("\nHeap free: %lu bytes (minimum %lu)\n", (unsigned long)view.heap_free, (unsigned long)view.heap_min);
+    print_tasks();
+}
+
+static void metrics_task(void *pvParameters) {
+    (void)pvParameters;
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(METRICS_PERIOD_MS));
+        take_snapshot();
+        laptimer_write_summary();
+        prof_trace_write();
+    }
+}
+
+esp_err_t metrics_start_task(void) {
+    return tasks_create(TASK_METRICS, metrics_task, NULL, NULL);
+}
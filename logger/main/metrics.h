@@ -0,0 +1,152 @@
+/*
+ * metrics.h
+ *
+ * Runtime performance counters shared by every subsystem. Counters and
+ * gauges are plain 32-bit words updated with relaxed atomics, so they are
+ * safe (and cheap) to bump from any task or ISR. The metrics task takes a
+ * snapshot once per second: per-second rates, gauge peaks, per-task CPU
+ * share and stack high-water marks. The console 'metrics' command prints the
+ * snapshot; the log records carry a summary multiplexed over the
+ * MET_FIELD/MET_VALUE channels, one field per record (see record_pack()),
+ * so 3 bytes per record instead of the whole summary.
+ */
+#ifndef INC_METRICS_H_
+#define INC_METRICS_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "metrics_fields.h"
+
+#define METRICS_PERIOD_MS 1000
+#define METRICS_MAX_TASKS 32      // Tasks tracked in the snapshot
+#define METRICS_LATENCY_BUCKETS 16 // Bucket b counts latencies in [2^(b-1), 2^b) us, the last is open-ended
+#define METRICS_JITTER_BUCKET_US 4  // Linear: percentiles need finer steps than powers of two
+#define METRICS_JITTER_BUCKETS 128  // The last is open-ended (>= 508 us)
+
+// Monotonic counters: name, description
+#define METRICS_COUNTERS \
+    X(RECORDS_PRODUCED, "Log records produced") \
+    X(RECORDS_WRITTEN,  "Log records written") \
+    X(RECORDS_FAILED,   "Log records not written") \
+    X(RECORDS_DROPPED,  "Log records dropped (ring full)") \
+    X(SD_FLUSHES,       "SD flushes") \
+    X(CAN_RX,           "CAN frames received") \
+    X(CAN_DROPPED,      "CAN frames dropped") \
+    X(ADC_SCANS,        "ADC scans") \
+    X(ADC_OVERRUNS,     "ADC scans overrun") \
+    X(ADC_ERRORS,       "ADC SPI errors") \
+    X(I2C_ERRORS,       "I2C errors")
+
+// Gauges holding the peak seen since the last snapshot: name, description
+#define METRICS_GAUGES \
+    X(SD_WRITE_MAX_US,  "SD write max (us)") \
+    X(CAN_QUEUE_PEAK,   "CAN queue peak") \
+    X(LOG_RING_PEAK,    "Log ring peak (records)") \
+    X(CONSOLE_FILL_PEAK, "Console buffer peak (bytes)")
+
+typedef enum {
+    #define X(name, desc) METRIC_##name,
+    METRICS_COUNTERS
+    #undef X
+    METRIC_COUNT
+} metric_counter_t;
+
+typedef enum {
+    #define X(name, desc) GAUGE_##name,
+    METRICS_GAUGES
+    #undef X
+    GAUGE_COUNT
+} metric_gauge_t;
+
+extern volatile uint32_t metrics_counters[METRIC_COUNT];
+extern volatile uint32_t metrics_gauges[GAUGE_COUNT];
+
+static inline void metrics_inc(metric_counter_t id) {
+    __atomic_fetch_add(&metrics_counters[id], 1, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_add(metric_counter_t id, uint32_t n) {
+    __atomic_fetch_add(&metrics_counters[id], n, __ATOMIC_RELAXED);
+}
+
+// Counters owned by another module's statistics are mirrored in at snapshot time
+static inline void metrics_set(metric_counter_t id, uint32_t value) {
+    __atomic_store_n(&metrics_counters[id], value, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_gauge_max(metric_gauge_t id, uint32_t value) {
+    uint32_t cur = __atomic_load_n(&metrics_gauges[id], __ATOMIC_RELAXED);
+    while (value > cur &&
+           !__atomic_compare_exchange_n(&metrics_gauges[id], &cur, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+// Summary of one snapshot, one member per METRICS_SUMMARY_FIELDS entry
+typedef struct {
+    uint16_t seq;
+    uint16_t records_per_s;  // Records written in the last period
+    uint16_t sd_write_max_us; // Saturates at 65535
+    uint16_t can_dropped;    // In the last period
+    uint8_t adc_overruns;    // In the last period, saturating
+    uint8_t i2c_errors;      // In the last period, saturating
+    uint8_t cpu_load;        // Percent of all cores, from the idle tasks
+    uint16_t stack_min;      // Smallest stack high-water mark of any task (bytes)
+    uint16_t heap_free_kib;
+} metrics_summary_t;
+
+// MET_FIELD values
+typedef enum {
+    #define X(field) METRICS_FIELD_##field,
+    METRICS_SUMMARY_FIELDS
+    #undef X
+    METRICS_FIELD_COUNT
+} metrics_field_t;
+
+/**
+ * @brief Record the duration of one SD write into the latency histogram
+ */
+void metrics_record_sd_latency(uint32_t us);
+
+/**
+ * @brief Record how far one sampler period deviated from nominal
+ */
+void metrics_record_sample_jitter(uint32_t us);
+
+/**
+ * @brief Print p50/p99/max of the sampler period error since boot or the last reset
+ */
+void metrics_print_jitter(void);
+
+/**
+ * @brief Clear the sampler jitter histogram
+ */
+void metrics_reset_jitter(void);
+
+/**
+ * @brief Copy the summary of the latest snapshot
+ */
+void metrics_get_summary(metrics_summary_t *out);
+
+/**
+ * @brief One field of a summary, as logged in MET_VALUE
+ */
+uint16_t metrics_summary_field(const metrics_summary_t *s, metrics_field_t field);
+
+/**
+ * @brief Print counters, gauges, the SD latency histogram and the task table
+ */
+void metrics_print(void);
+
+/**
+ * @brief Print per-task CPU share and stack high-water marks from the last snapshot
+ */
+void metrics_print_tasks(void);
+
+/**
+ * @brief Start the once-per-second snapshot task
+ */
+esp_err_t metrics_start_task(void);
+
+#endif /* INC_METRICS_H_ */
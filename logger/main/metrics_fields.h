@@ -0,0 +1,22 @@
+/*
+ * metrics_fields.h
+ *
+ * Fields of the once-per-second metrics summary, in MET_FIELD order. Kept
+ * free of ESP-IDF includes so host tools can expand the multiplexed
+ * MET_FIELD/MET_VALUE channels back into one row per snapshot.
+ */
+#ifndef INC_METRICS_FIELDS_H_
+#define INC_METRICS_FIELDS_H_
+
+#define METRICS_SUMMARY_FIELDS \
+    X(seq) \
+    X(records_per_s) \
+    X(sd_write_max_us) \
+    X(can_dropped) \
+    X(adc_overruns) \
+    X(i2c_errors) \
+    X(cpu_load) \
+    X(stack_min) \
+    X(heap_free_kib)
+
+#endif /* INC_METRICS_FIELDS_H_ */
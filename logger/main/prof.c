@@ -0,0 +1,124 @@
+#include "prof.h"
+#include <stdio.h>
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdcard.h"
+
+static const char *TAG = "PROF";
+
+volatile uint32_t prof_hist[PROF_STAGE_COUNT][PROF_BUCKETS];
+volatile uint32_t prof_max[PROF_STAGE_COUNT];
+
+static const char *stage_names[] = {
+    #define X(name, desc) desc,
+    PROF_STAGES
+    #undef X
+};
+
+static volatile bool trace_enabled = false;
+static uint32_t trace_last[PROF_STAGE_COUNT][PROF_BUCKETS]; // Totals at the previous trace line
+
+const uint32_t prof_ram_bytes = sizeof(prof_hist) + sizeof(prof_max) + sizeof(trace_last);
+
+// Upper bound of the bucket holding percentile p of counts
+static uint32_t bucket_percentile(const uint32_t *counts, uint32_t total, uint32_t p) {
+    uint32_t target = (uint32_t)((uint64_t)total * p / 100);
+    uint32_t seen = 0;
+    for (int b = 0; b < PROF_BUCKETS; b++) {
+        seen += counts[b];
+        if (seen > target) {
+            return b == 0 ? 0 : (1U << b) - 1;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static uint32_t copy_stage(prof_stage_t stage, uint32_t *counts) {
+    uint32_t total = 0;
+    for (int b = 0; b < PROF_BUCKETS; b++) {
+        counts[b] = __atomic_load_n(&prof_hist[stage][b], __ATOMIC_RELAXED);
+        total += counts[b];
+    }
+    return total;
+}
+
+void prof_print(void) {
+    const float mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    if (!LOGGER_PROFILING) {
+        printf("Profiling compiled out (LOGGER_PROFILING=0)\n");
+        return;
+    }
+    printf("\n=== Stage profile (cycles at %d MHz, p50/p99 are bucket upper bounds) ===\n",
+           CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    printf("%-16s %10s %10s %10s %10s %10s\n", "Stage", "Count", "p50", "p99", "Max", "Max us");
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        uint32_t counts[PROF_BUCKETS];
+        uint32_t total = copy_stage(s, counts);
+        if (total == 0) {
+            printf("%-16s %10s\n", stage_names[s], "-");
+            continue;
+        }
+        uint32_t max = __atomic_load_n(&prof_max[s], __ATOMIC_RELAXED);
+        printf("%-16s %10lu %10lu %10lu %10lu %10.1f\n", stage_names[s], (unsigned long)total,
+               (unsigned long)bucket_percentile(counts, total, 50), (unsigned long)bucket_percentile(counts, total, 99),
+               (unsigned long)max, max / mhz);
+    }
+}
+
+void prof_reset(void) {
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        for (int b = 0; b < PROF_BUCKETS; b++) {
+            __atomic_store_n(&prof_hist[s][b], 0, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&prof_max[s], 0, __ATOMIC_RELAXED);
+    }
+    memset(trace_last, 0, sizeof(trace_last));
+}
+
+void prof_trace_enable(bool enable) {
+    if (enable && !trace_enabled) {
+        // Start the trace from the current totals
+        for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+            copy_stage(s, trace_last[s]);
+        }
+    }
+    trace_enabled = enable;
+    ESP_LOGI(TAG, "Trace %s", enable ? "on" : "off");
+}
+
+bool prof_trace_enabled(void) {
+    return trace_enabled;
+}
+
+// Append one line per active stage to <log>_prof.csv: samples and percentiles since the last line
+void prof_trace_write(void) {
+    if (!trace_enabled) {
+        return;
+    }
+    FILE *f = log_file_open_sidecar(PROF_TRACE_SUFFIX, "time_ms,stage,count,p50_cycles,p99_cycles,max_cycles_since_reset\n");
+    if (f == NULL) {
+        return;
+    }
+
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    for (int s = 0; s < PROF_STAGE_COUNT; s++) {
+        uint32_t counts[PROF_BUCKETS];
+        copy_stage(s, counts);
+        uint32_t total = 0;
+        for (int b = 0; b < PROF_BUCKETS; b++) {
+            uint32_t now = counts[b];
+            counts[b] = now - trace_last[s][b];
+            trace_last[s][b] = now;
+            total += counts[b];
+        }
+        if (total == 0) {
+            continue;
+        }
+        fprintf(f, "%lu,%s,%lu,%lu,%lu,%lu\n", (unsigned long)now_ms, stage_names[s], (unsigned long)total,
+                (unsigned long)bucket_percentile(counts, total, 50), (unsigned long)bucket_percentile(counts, total, 99),
+                (unsigned long)__atomic_load_n(&prof_max[s], __ATOMIC_RELAXED));
+    }
+    fclose(f);
+}
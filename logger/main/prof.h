@@ -0,0 +1,95 @@
+/*
+ * prof.h
+ *
+ * Cycle-count profiling of the acquisition pipeline stages. PROF_BEGIN and
+ * PROF_END around a stage add the esp_cpu_get_cycle_count() delta to that
+ * stage's histogram of power-of-two buckets with relaxed atomics, so they are
+ * safe in ISRs and cost a few cycles. Build with -DLOGGER_PROFILING=0 and
+ * the macros compile to nothing. While trace.h is recording, each span is
+ * also logged as a STAGE_BEGIN/STAGE_END event pair.
+ *
+ * The console 'prof' command prints the histograms; in trace mode the
+ * metrics task appends each second's distribution to <log>_prof.csv.
+ */
+#ifndef INC_PROF_H_
+#define INC_PROF_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_cpu.h"
+#include "trace.h"
+
+#ifndef LOGGER_PROFILING
+#define LOGGER_PROFILING 1
+#endif
+
+#define PROF_BUCKETS 24 // Bucket b counts [2^(b-1), 2^b) cycles, the last is open-ended (~52 ms at 160 MHz)
+#define PROF_TRACE_SUFFIX "_prof.csv"
+
+// Profiled stages: name, description
+#define PROF_STAGES \
+    X(CAN_ISR,     "CAN ISR") \
+    X(CAN_PUSH,    "CAN queue push") \
+    X(CAN_DECODE,  "CAN decode") \
+    X(ADC_SCAN,    "ADC scan") \
+    X(RECORD_PACK, "Record pack") \
+    X(SD_WRITE,    "SD write") \
+    X(SD_FLUSH,    "SD flush")
+
+typedef enum {
+    #define X(name, desc) PROF_##name,
+    PROF_STAGES
+    #undef X
+    PROF_STAGE_COUNT
+} prof_stage_t;
+
+extern volatile uint32_t prof_hist[PROF_STAGE_COUNT][PROF_BUCKETS];
+extern volatile uint32_t prof_max[PROF_STAGE_COUNT];
+
+static inline void prof_record(prof_stage_t stage, uint32_t cycles) {
+    int bucket = cycles == 0 ? 0 : 32 - __builtin_clz(cycles);
+    if (bucket >= PROF_BUCKETS) {
+        bucket = PROF_BUCKETS - 1;
+    }
+    __atomic_fetch_add(&prof_hist[stage][bucket], 1, __ATOMIC_RELAXED);
+    uint32_t cur = __atomic_load_n(&prof_max[stage], __ATOMIC_RELAXED);
+    while (cycles > cur &&
+           !__atomic_compare_exchange_n(&prof_max[stage], &cur, cycles, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+#if LOGGER_PROFILING
+// Cycle counters are per core: a task that migrates mid-stage lands one sample in a wild bucket
+#define PROF_BEGIN(stage) \
+    uint32_t prof_start_##stage = (trace_event(TRACE_STAGE_BEGIN, PROF_##stage, 0), esp_cpu_get_cycle_count())
+#define PROF_END(stage) \
+    (prof_record(PROF_##stage, esp_cpu_get_cycle_count() - prof_start_##stage), \
+     trace_event(TRACE_STAGE_END, PROF_##stage, 0))
+#else
+#define PROF_BEGIN(stage) do { } while (0)
+#define PROF_END(stage) do { } while (0)
+#endif
+
+/**
+ * @brief Print count, p50, p99 and max of every stage, in cycles and microseconds
+ */
+void prof_print(void);
+
+/**
+ * @brief Clear every histogram
+ */
+void prof_reset(void);
+
+/**
+ * @brief Start or stop appending per-second distributions to the session's _prof.csv
+ */
+void prof_trace_enable(bool enable);
+
+bool prof_trace_enabled(void);
+
+/**
+ * @brief Append the distribution since the last call to the trace file, if tracing (metrics task)
+ */
+void prof_trace_write(void);
+
+#endif /* INC_PROF_H_ */
@@ -0,0 +1,358 @@
+/*
+ * record.c
+ *
+ * CAN decode, IMU/GNSS fusion and record packing, moved out of main.c so the
+ * host build runs the same code (see record.h).
+ */
+#include "record.h"
+#include <string.h>
+#include "esp_log.h"
+#include "dlog.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "dtc.h"
+#include "logger.h"
+#include "ina260.h"
+#include "adc.h"
+#include "fusion.h"
+#include "laptimer.h"
+#include "metrics.h"
+#include "log_chnl.h"
+#include "trace.h"
+
+static const char *TAG = "RECORD";
+
+typedef struct {
+	uint16_t ambTemp;
+	uint16_t objTemp;
+	uint16_t rpm;
+} wheel_data_s_t;
+
+//Logging variables
+static uint8_t TXDAT[8];
+static uint32_t imuCount = 0;
+static uint32_t xAccel = 0, yAccel = 0, zAccel = 0;
+static uint32_t xGyro = 0, yGyro = 0, zGyro = 0;
+static uint16_t frsg = 0, flsg = 0, rrsg = 0, rlsg = 0;
+static wheel_data_s_t frw, flw, rlw, rrw;
+static uint8_t drs = 0;
+static uint16_t brakeFluid = 0, throttleLoad = 0, brakeLoad = 0;
+static uint16_t oilPress = 0, driven_wspd = 0;
+static uint8_t ect = 0, tps = 0, aps = 0, shift0 = 0, shift1 = 0, shift2 = 0;
+
+//Sensor fusion (IMU + GNSS)
+static fusion_t fusion;
+static fusion_output_t fusion_nav; // fusion.out as of the last IMU step, published under nav_lock
+static portMUX_TYPE nav_lock = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t gnss_fix_queue = NULL;
+static uint8_t gnss_fix_storage[sizeof(fusion_gnss_fix_t)];
+static StaticQueue_t gnss_fix_buffer;
+
+const uint32_t record_ram_bytes = sizeof(fusion) + sizeof(fusion_nav) + sizeof(gnss_fix_storage) + sizeof(gnss_fix_buffer);
+
+esp_err_t record_init(void) {
+    fusion_init(&fusion);
+    gnss_fix_queue = xQueueCreateStatic(1, sizeof(fusion_gnss_fix_t), gnss_fix_storage, &gnss_fix_buffer);
+    return ESP_OK;
+}
+
+// Called from the GNSS task - hand the fix over to the CAN task, which owns the filter
+void record_process_gnss_fix(const GNSS_StateHandle *gps) {
+    fusion_gnss_fix_t fix = {
+        .lat_e7 = gps->lat,
+        .lon_e7 = gps->lon,
+        .speed_ms = gps->fSpeed,
+        .course_deg = gps->fCourse,
+        .fix_type = gps->fixType,
+        .time_us = esp_timer_get_time(),
+    };
+    bool replaced = uxQueueMessagesWaiting(gnss_fix_queue) > 0;
+    xQueueOverwrite(gnss_fix_queue, &fix);
+    trace_event(TRACE_QUEUE_SEND, TRACE_QUEUE_GNSS_FIX, replaced ? TRACE_SEND_OVERWROTE : TRACE_SEND_QUEUED);
+
+    laptimer_process_fix(fix.lat_e7, fix.lon_e7, fix.time_us);
+}
+
+// Runs once per complete IMU frame set (0x362 closes the 0x360-0x362 group)
+static void fusion_imu_step(void) {
+    fusion_gnss_fix_t fix;
+
+    fusion_predict(&fusion, fusion_raw_accel(xAccel), fusion_raw_accel(yAccel),
+                   fusion_raw_gyro(zGyro), esp_timer_get_time());
+
+    // Apply the newest GNSS fix if one arrived since the last IMU sample
+    if (gnss_fix_queue != NULL && xQueueReceive(gnss_fix_queue, &fix, 0) == pdTRUE) {
+        trace_event(TRACE_QUEUE_RECV, TRACE_QUEUE_GNSS_FIX, 0);
+        fusion_update_gnss(&fusion, &fix);
+    }
+
+    // The sampler packs records on the other core; hand it a consistent copy
+    portENTER_CRITICAL(&nav_lock);
+    fusion_nav = fusion.out;
+    portEXIT_CRITICAL(&nav_lock);
+}
+
+void record_process_can(uint32_t id, const uint8_t *payload, uint8_t dlc) {
+
+    uint8_t data[8] = {0};
+    memcpy(data, payload, dlc > sizeof(data) ? sizeof(data) : dlc);
+    switch(id) {
+        case 0x35F:
+            drs = data[0];
+            break;
+            
+        case 0x360:
+            //IMU Data
+            xAccel = data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3];
+            yAccel = data[4] << 24 | data[5] << 16 | data[6] << 8 | data[7];
+            imuCount++;
+            
+            //IMU DTC Check
+            break;
+            
+        case 0x361:
+            //IMU Data
+            zAccel = data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3];
+            xGyro = data[4] << 24 | data[5] << 16 | data[6] << 8 | data[7];
+            imuCount++;
+
+            //IMU DTC Check
+            break;
+            
+        case 0x362:
+            //IMU Data
+            yGyro = data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3];
+            zGyro = data[4] << 24 | data[5] << 16 | data[6] << 8 | data[7];
+            imuCount++;
+            fusion_imu_step();
+
+            //IMU DTC Response Update
+            DTC_CAN_Response_Measurement(dtc_devices[imu_DTC], DTC_Now_Ms());
+            break;
+            
+        case 0x363:
+            //Front Left Wheel Board
+            flw.rpm = data[0] << 8 | data[1];
+            flw.objTemp = data[2] << 8 | data[3];
+            flw.ambTemp = data[4] << 8 | data[5];
+
+            //DTC Response Update
+            DTC_CAN_Response_Measurement(dtc_devices[flWheelBoard_DTC], DTC_Now_Ms());
+            break;
+            
+        case 0x364:
+            //Front Right Wheel Board
+            frw.rpm = data[0] << 8 | data[1];
+            frw.objTemp = data[2] << 8 | data[3];
+            frw.ambTemp = data[4] << 8 | data[5];
+
+            //DTC Response Update
+            DTC_CAN_Response_Measurement(dtc_devices[frWheelBoard_DTC], DTC_Now_Ms());
+            break;
+            
+        case 0x365:
+            //Rear Right Wheel Board
+            rrw.rpm = data[0] << 8 | data[1];
+            rrw.objTemp = data[2] << 8 | data[3];
+            rrw.ambTemp = data[4] << 8 | data[5];
+
+            //DTC Response Update
+            DTC_CAN_Response_Measurement(dtc_devices[rrWheelBoard_DTC], DTC_Now_Ms());
+            break;
+            
+        case 0x366:
+            //Rear Left Wheel Board
+            rlw.rpm = data[0] << 8 | data[1];
+            rlw.objTemp = data[2] << 8 | data[3];
+            rlw.ambTemp = data[4] << 8 | data[5];
+
+            //DTC Response Update
+            DTC_CAN_Response_Measurement(dtc_devices[rlWheelBoard_DTC], DTC_Now_Ms());
+            break;
+            
+        case 0x4e2:
+            //Front Left String Gauge
+            flsg = data[0] << 8 | data[1];
+
+            //String Gauge DTC Check
+            DTC_CAN_Response_Measurement(dtc_devices[flStrainGauge_DTC], DTC_Now_Ms());
+
+            break;
+            
+        case 0x4e3:
+            //Front Right String Gauge
+            frsg = data[0] << 8 | data[1];
+
+            //String Gauge DTC Check
+            DTC_CAN_Response_Measurement(dtc_devices[frStrainGauge_DTC], DTC_Now_Ms());
+            break;
+            
+        case 0x4e4:
+            //Rear Right String Gauge
+            rrsg = data[0] << 8 | data[1];
+
+            //String Gauge DTC Check
+            DTC_CAN_Response_Measurement(dtc_devices[rrStrainGauge_DTC], DTC_Now_Ms());
+            break;
+            
+        case 0x4e5:
+            //Rear Left String Gauge
+            rlsg = data[0] << 8 | data[1];
+
+            //String Gauge DTC Check
+            DTC_CAN_Response_Measurement(dtc_devices[rlStrainGauge_DTC], DTC_Now_Ms());
+            break;
+            
+        case 0x3e8:
+            //Engine CAN Stream 2
+            switch(data[0]){
+                //Frame 1
+                case 0x0:
+                    // engine_speed = message->data[1] << 8 | message->data[2];
+                    ect = data[3];
+                    // oilTemp = message->data[4];
+                    oilPress = data[5] << 8 | data[6];
+                    //TODO: Could also add Park/Neutral Status (Stored on message->data[7])
+                    break;
+
+                case 0x1:
+                    tps = data[2];
+                    driven_wspd = data[4] << 8 | data[5];
+                    break;
+                    
+                case 0x2:
+                    aps = data[1];
+                    break;
+            }
+            break;
+
+        case 0x40:
+            // Shifter Data
+            shift0 = data[0];
+            shift1 = data[1];
+            shift2 = data[2];
+            if((shift1 != 1) | (shift2 != 1)) {
+                TXDAT[1] = shift1;
+                TXDAT[2] = shift2;
+            }
+            DTC_CAN_Response_Measurement(dtc_devices[shifter_DTC], DTC_Now_Ms());
+            break;
+    }
+}
+
+void record_pack(uint8_t *record, uint32_t ts_ms) {
+    uint16_t fbp, rbp, stp, fls, frs, rrs, rls;
+
+    //Report Timestamp (ms since boot)
+    loggerEmplaceU32(record, TS, ts_ms);
+
+    // //Log Analog Sensor Data
+    // Get ADC values quickly (no SPI operations here)
+    if (adc_get_values(&fbp, &rbp, &stp, &fls, &frs, &rrs, &rls) == ESP_OK) {
+        // Log Analog Sensor Data using cached values
+        loggerEmplaceU16(record, F_BRAKEPRESSURE, fbp);
+        loggerEmplaceU16(record, R_BRAKEPRESSURE, rbp);
+        loggerEmplaceU16(record, STEERING, stp);
+        loggerEmplaceU16(record, FLSHOCK, fls);
+        loggerEmplaceU16(record, FRSHOCK, frs);
+        loggerEmplaceU16(record, RRSHOCK, rrs);
+        loggerEmplaceU16(record, RLSHOCK, rls);
+    } else {
+        DLOGW(TAG, "Using previous ADC values due to mutex timeout");
+    }
+
+
+
+    // //Report Battery Current and Voltage
+    loggerEmplaceU16(record, CURRENT, getCurrent());
+    loggerEmplaceU16(record, BATTERY, getVoltage());
+
+    //Report IMU Data
+    loggerEmplaceU32(record, IMU_X_ACCEL, xAccel);
+    loggerEmplaceU32(record, IMU_Y_ACCEL, yAccel);
+    loggerEmplaceU32(record, IMU_Z_ACCEL, zAccel);
+
+    loggerEmplaceU32(record, IMU_X_GYRO, xGyro);
+    loggerEmplaceU32(record, IMU_Y_GYRO, yGyro);
+    loggerEmplaceU32(record, IMU_Z_GYRO, zGyro);
+
+    //Report GNSS Data
+    loggerEmplaceU32(record, GPS_LON, GNSS_Handle.lon);
+    loggerEmplaceU32(record, GPS_LAT, GNSS_Handle.lat);
+    loggerEmplaceU32(record, GPS_SPD, GNSS_Handle.gSpeed);
+    record[GPS_FIX] = GNSS_Handle.fixType;
+    loggerEmplaceU16(record, GPS_HDG, (uint16_t)(GNSS_Handle.fCourse * 100));
+
+    //Report Fused Trajectory (cm, cm/s, 0.01 deg)
+    fusion_output_t nav;
+    portENTER_CRITICAL(&nav_lock);
+    nav = fusion_nav;
+    portEXIT_CRITICAL(&nav_lock);
+    loggerEmplaceU32(record, FUS_POS_N, (int32_t)(nav.pos_n * 100));
+    loggerEmplaceU32(record, FUS_POS_E, (int32_t)(nav.pos_e * 100));
+    loggerEmplaceU16(record, FUS_VN, (int16_t)(nav.vel_n * 100));
+    loggerEmplaceU16(record, FUS_VE, (int16_t)(nav.vel_e * 100));
+    loggerEmplaceU16(record, FUS_HDG, (uint16_t)(nav.heading_deg * 100));
+    loggerEmplaceU16(record, FUS_SLIP, (int16_t)(nav.slip_deg * 100));
+
+    //Report Lap Timing (LAP_CROSS is the interpolated gate crossing time, same base as TS)
+    loggerEmplaceU16(record, LAP_NUM, lap_status.lap);
+    record[LAP_SECTOR] = lap_status.sector;
+    loggerEmplaceU32(record, LAP_LAST, lap_status.last_lap_ms);
+    loggerEmplaceU32(record, LAP_CROSS, lap_status.last_cross_ms);
+
+    //Report Wheel Board Sensor Data
+    loggerEmplaceU16(record, FLW_AMB, flw.ambTemp);
+    loggerEmplaceU16(record, FLW_OBJ, flw.objTemp);
+    loggerEmplaceU16(record, FLW_RPM, flw.rpm);
+
+    loggerEmplaceU16(record, FRW_AMB, frw.ambTemp);
+    loggerEmplaceU16(record, FRW_OBJ, frw.objTemp);
+    loggerEmplaceU16(record, FRW_RPM, frw.rpm);
+
+    loggerEmplaceU16(record, RRW_AMB, rrw.ambTemp);
+    loggerEmplaceU16(record, RRW_OBJ, rrw.objTemp);
+    loggerEmplaceU16(record, RRW_RPM, rrw.rpm);
+
+    loggerEmplaceU16(record, RLW_AMB, rlw.ambTemp);
+    loggerEmplaceU16(record, RLW_OBJ, rlw.objTemp);
+    loggerEmplaceU16(record, RLW_RPM, rlw.rpm);
+
+    //Report String Gauge Data
+    loggerEmplaceU16(record, FR_SG, frsg);
+    loggerEmplaceU16(record, FL_SG, flsg);
+    loggerEmplaceU16(record, RR_SG, rrsg);
+    loggerEmplaceU16(record, RL_SG, rlsg);
+
+    //Report Brakes and Throttle
+    loggerEmplaceU16(record, BRAKE_FLUID, brakeFluid);
+    loggerEmplaceU16(record, THROTTLE_LOAD, throttleLoad);
+    loggerEmplaceU16(record, BRAKE_LOAD, brakeLoad);
+
+    //Report ECU Data
+    loggerEmplaceU16(record, DRIVEN_WSPD, driven_wspd);
+    loggerEmplaceU16(record, OIL_PSR, oilPress);
+    record[TPS] = tps;
+    record[ECT] = ect;
+    record[APS] = aps;
+
+    //Report DTC Data (DTC_MAP bit i = device i OK, see dtc_devices.h)
+    uint32_t dtc_map[DTC_STATUS_WORDS];
+    DTC_Get_Status(dtc_map);
+    for (int w = 0; w < DTC_STATUS_WORDS; w++) {
+        loggerEmplaceU32(record, DTC_MAP + 4 * (DTC_STATUS_WORDS - 1 - w), dtc_map[w]);
+    }
+    loggerEmplaceU16(record, DTC_HEALTH, DTC_Get_Health());
+
+    //Report Metrics: one summary field per record, the summary is latched at field 0 so each cycle is one snapshot
+    static metrics_summary_t met;
+    static uint8_t met_field = 0;
+    if (met_field == 0) {
+        metrics_get_summary(&met);
+    }
+    record[MET_FIELD] = met_field;
+    loggerEmplaceU16(record, MET_VALUE, metrics_summary_field(&met, met_field));
+    met_field = (met_field + 1) % METRICS_FIELD_COUNT;
+}
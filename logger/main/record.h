@@ -0,0 +1,37 @@
+/*
+ * record.h
+ *
+ * Acquisition core: decodes CAN frames into the vehicle state, runs the
+ * IMU/GNSS fusion and packs one log record from every source. No driver
+ * calls of its own - sources are reached through adc.h, ina260.h, gnss.h,
+ * laptimer.h, dtc.h and metrics.h - so the host build links the same file
+ * against stand-in sources (tools/logger_host.c).
+ */
+#ifndef INC_RECORD_H_
+#define INC_RECORD_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "gnss.h"
+
+/**
+ * @brief Initialise the fusion filter and the GNSS fix hand-over queue
+ */
+esp_err_t record_init(void);
+
+/**
+ * @brief Decode one CAN frame into the vehicle state (CAN receive task)
+ */
+void record_process_can(uint32_t id, const uint8_t *data, uint8_t dlc);
+
+/**
+ * @brief GNSS fix callback: hands the fix to the fusion filter and the lap timer (GNSS task)
+ */
+void record_process_gnss_fix(const GNSS_StateHandle *gps);
+
+/**
+ * @brief Fill every channel of a record (CH_COUNT bytes) from the current state, stamped with ts_ms
+ */
+void record_pack(uint8_t *record, uint32_t ts_ms);
+
+#endif /* INC_RECORD_H_ */
@@ -8,9 +8,9 @@
 #include "esp_vfs_fat.h"
 #include "sdmmc_cmd.h"
 #include "driver/sdmmc_host.h"
+#include "esp_timer.h"
+#include "metrics.h"
 
-#define LOG_CHANNEL_NAMES
-#include "log_chnl.h"
 
 static const char* TAG = "FILE_SYS";
 
@@ -21,127 +21,13 @@ static const char* TAG = "FILE_SYS";
 static sdmmc_card_t* g_card = NULL;
 // static sdmmc_host_t g_host;
 // static sdspi_device_config_t g_slot_config;
-static bool g_sdcard_initialized = false;
+static volatile bool g_sdcard_initialized = false; // Set by the log writer task once mounted
 
 nvs_handle_t hnvs;
-FILE *log_file = NULL;
-SemaphoreHandle_t log_file_mutex;
-static char current_log_filepath[MAX_FILE_NAME_LENGTH];
 
+static esp_err_t validate_filename(const char *filename);
+static bool is_valid_fat32_filename_char(char ch);
 
-// Open a new log file
-static esp_err_t open_log_file(const char *filename) {
-    xSemaphoreTake(log_file_mutex, portMAX_DELAY);
-    
-    // Close existing file if open
-    if (log_file != NULL) {
-        fflush(log_file);
-        fclose(log_file);
-        log_file = NULL;
-        ESP_LOGI(TAG, "Closed previous log file");
-    }
-    
-    // Open new file
-    log_file = fopen(filename, "a");
-    if (log_file == NULL) {
-        ESP_LOGE(TAG, "Failed to open log file: %s", filename);
-        xSemaphoreGive(log_file_mutex);
-        return ESP_FAIL;
-    }
-    
-    // Set buffer mode for better performance
-    setvbuf(log_file, NULL, _IOFBF, 4096);  // Full buffering with 4KB buffer
-    
-    // Update current filename
-    strncpy(current_log_filepath, filename, sizeof(current_log_filepath) - 1);
-    current_log_filepath[sizeof(current_log_filepath) - 1] = '\0';
-    
-    ESP_LOGI(TAG, "Opened log file: %s", filename);
-    
-    // Build CSV header string
-    char csv_header[2048] = {0};  // Adjust size as needed
-    size_t header_len = 0;
-    
-    for (int i = 0; i < (sizeof(log_channel_names)/sizeof(log_channel_names[0])) - 1; i++) {
-        size_t name_len = strlen(log_channel_names[i]);
-        if (header_len + name_len < sizeof(csv_header) - 1) {  // Leave room for \0
-            memcpy(csv_header + header_len, log_channel_names[i], name_len);
-            header_len += name_len;
-        } else {
-            ESP_LOGW(TAG, "CSV header buffer too small, truncating");
-            break;
-        }
-    }
-
-    // Write header length as first 4 bytes (little-endian format)
-    uint32_t header_len_le = header_len;  // Convert to little-endian if needed
-    size_t len_written = fwrite(&header_len_le, sizeof(uint32_t), 1, log_file);
-    if (len_written != 1) {
-        ESP_LOGE(TAG, "Failed to write header length");
-        fclose(log_file);
-        log_file = NULL;
-        xSemaphoreGive(log_file_mutex);
-        return ESP_FAIL;
-    }
-    
-    // Write CSV header data
-    size_t written = fwrite(csv_header, 1, header_len, log_file);
-    if (written != header_len) {
-        ESP_LOGE(TAG, "Failed to write CSV header");
-        fclose(log_file);
-        log_file = NULL;
-        xSemaphoreGive(log_file_mutex);
-        return ESP_FAIL;
-    }
-    
-    // Flush to ensure header is written immediately
-    fflush(log_file);
-    
-    
-    xSemaphoreGive(log_file_mutex);
-    return ESP_OK;
-}
-
-esp_err_t fast_log_buffer(const uint8_t *data_buffer, uint8_t buffer_len) {
-    if (data_buffer == NULL || buffer_len == 0) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    if (log_file_mutex == NULL || log_file == NULL) {
-        ESP_LOGW(TAG, "SD card not initialized or file not open");
-        return ESP_ERR_INVALID_STATE;
-    }
-    
-    // Take mutex with timeout to avoid indefinite blocking
-    if (xSemaphoreTake(log_file_mutex, pdMS_TO_TICKS(100)) != pdTRUE) {
-        ESP_LOGW(TAG, "Failed to acquire log file mutex within timeout");
-        return ESP_ERR_TIMEOUT;
-    }
-    esp_err_t result = ESP_OK;
-    
-    // Critical section - file operations
-    if (log_file != NULL) {
-        size_t written = fwrite(data_buffer, sizeof(uint8_t), buffer_len, log_file);
-        
-        if (written != buffer_len) {
-            ESP_LOGE(TAG, "Log write failed: %zu/%zu bytes", written, buffer_len);
-            result = ESP_FAIL;
-        } else {
-            // Only flush periodically for performance
-            static uint32_t write_count = 0;
-            if (++write_count % 10 == 0) {
-                fflush(log_file);
-            }
-        }
-    } else {
-        result = ESP_ERR_INVALID_STATE;
-    }
-    
-    // Always release the mutex
-    xSemaphoreGive(log_file_mutex);
-    
-    return result;
-}
 
 esp_err_t nvs_get_log_name(char *buffer, size_t buffer_size) {
     if (buffer == NULL || buffer_size == 0) {
@@ -283,6 +169,35 @@ esp_err_t nvs_increment_testno(uint8_t *testno){
     return err;
 }
 
+// Boot count, wrapping at 256; tells apart DTC journal entries recorded in different boots
+esp_err_t nvs_increment_boot_count(uint8_t *boot) {
+    if (boot == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (hnvs == 0) {
+        ESP_LOGE(TAG, "NVS handle not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t count = 0;
+    esp_err_t err = nvs_get_u8(hnvs, "boot_count", &count);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "Failed to read boot count from NVS: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    *boot = count + 1;
+    err = nvs_set_u8(hnvs, "boot_count", *boot);
+    if (err == ESP_OK) {
+        err = nvs_commit(hnvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save boot count: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
 esp_err_t nvs_set_testno(uint8_t testno){
     if(hnvs == 0){
         ESP_LOGE(TAG, "NVS handle not initialized");
@@ -304,6 +219,159 @@ esp_err_t nvs_set_testno(uint8_t testno){
     return err;
 }
 
+esp_err_t nvs_set_lap_gates(const lap_gate_t *gates, uint8_t count) {
+    if (gates == NULL && count > 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (hnvs == 0) {
+        ESP_LOGE(TAG, "NVS handle not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err;
+    if (count == 0) {
+        err = nvs_erase_key(hnvs, "lap_gates");
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    } else {
+        err = nvs_set_blob(hnvs, "lap_gates", gates, count * sizeof(lap_gate_t));
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(hnvs);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save lap gates: %s", esp_err_to_name(err));
+    } else {
+        ESP_LOGI(TAG, "Saved %u lap gates", count);
+    }
+    return err;
+}
+
+// count holds the capacity of gates on entry and the number loaded on return
+esp_err_t nvs_get_lap_gates(lap_gate_t *gates, uint8_t *count) {
+    if (gates == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (hnvs == 0) {
+        ESP_LOGE(TAG, "NVS handle not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t size = *count * sizeof(lap_gate_t);
+    esp_err_t err = nvs_get_blob(hnvs, "lap_gates", gates, &size);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        *count = 0;
+        return ESP_OK;
+    } else if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read lap gates from NVS: %s", esp_err_to_name(err));
+        *count = 0;
+        return err;
+    }
+
+    *count = size / sizeof(lap_gate_t);
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_dtc_ring(const dtc_journal_ring_t *ring) {
+    if (ring == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (hnvs == 0) {
+        ESP_LOGE(TAG, "NVS handle not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err;
+    if (ring->count == 0) {
+        err = nvs_erase_key(hnvs, "dtc_ring");
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    } else {
+        err = nvs_set_blob(hnvs, "dtc_ring", ring, sizeof(dtc_journal_ring_t));
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(hnvs);
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save DTC ring: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t nvs_get_dtc_ring(dtc_journal_ring_t *ring) {
+    if (ring == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (hnvs == 0) {
+        ESP_LOGE(TAG, "NVS handle not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t size = sizeof(dtc_journal_ring_t);
+    esp_err_t err = nvs_get_blob(hnvs, "dtc_ring", ring, &size);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        memset(ring, 0, sizeof(dtc_journal_ring_t));
+        return ESP_OK;
+    } else if (err != ESP_OK || size != sizeof(dtc_journal_ring_t)) {
+        ESP_LOGE(TAG, "Failed to read DTC ring from NVS: %s", esp_err_to_name(err));
+        memset(ring, 0, sizeof(dtc_journal_ring_t));
+        return err != ESP_OK ? err : ESP_ERR_INVALID_SIZE;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_telemetry_config(const char *config) {
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (hnvs == 0) {
+        ESP_LOGE(TAG, "NVS handle not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = nvs_set_str(hnvs, "telem_cfg", config);
+    if (err == ESP_OK) {
+        err = nvs_commit(hnvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save telemetry config: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+// Leaves buffer empty when no config has been saved
+esp_err_t nvs_get_telemetry_config(char *buffer, size_t buffer_size) {
+    if (buffer == NULL || buffer_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    buffer[0] = '\0';
+
+    if (hnvs == 0) {
+        ESP_LOGE(TAG, "NVS handle not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    size_t size = buffer_size;
+    esp_err_t err = nvs_get_str(hnvs, "telem_cfg", buffer, &size);
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return ESP_OK;
+    } else if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to read telemetry config from NVS: %s", esp_err_to_name(err));
+        buffer[0] = '\0';
+    }
+    return err;
+}
+
 void nvs_init(){
     esp_err_t ret;
 
@@ -324,17 +392,15 @@ void nvs_init(){
     }
 }
 
+// Mounts the card and opens the first log; app_main has already run nvs_init
 void sdcard_init(){
     esp_err_t ret;
-    nvs_init();
+    if (hnvs == 0) {
+        nvs_init();
+    }
 
-    // Create mutex if not already created
-    if (log_file_mutex == NULL) {
-        log_file_mutex = xSemaphoreCreateMutex();
-        if (log_file_mutex == NULL) {
-            ESP_LOGE(TAG, "Failed to create log file mutex");
-            return;
-        }
+    if (log_file_init() != ESP_OK) {
+        return;
     }
 
     // Prevent double initialization
@@ -372,7 +438,8 @@ void sdcard_init(){
     gpio_config(&cs_config);
     gpio_set_level(GPIO_NUM_13, 1);
 
-    vTaskDelay(pdMS_TO_TICKS(500));
+    // No settle delay: the card has been powered since reset, and the mount
+    // sends the 74+ idle clocks with CS high that SPI mode needs before CMD0
 
     // Configure SPI device for SD card
     sdspi_device_config_t slot_config = SDSPI_DEVICE_CONFIG_DEFAULT();
@@ -381,7 +448,7 @@ void sdcard_init(){
 
     // Configure SDMMC host for SPI
     sdmmc_host_t host = SDSPI_HOST_DEFAULT();
-    host.max_freq_khz = 400;  // Start with low frequency
+    host.max_freq_khz = SD_SPI_FREQ_KHZ;
 
     // Configure mount options
     esp_vfs_fat_sdmmc_mount_config_t mount_config = {
@@ -396,20 +463,20 @@ void sdcard_init(){
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "Failed to mount SD card in SPI mode: %s", esp_err_to_name(ret));
         
-        // Try even slower speed
-        host.max_freq_khz = 200;
-        ESP_LOGW(TAG, "Retrying with 200kHz clock...");
+        // Try a slower data clock
+        host.max_freq_khz = SD_SPI_RETRY_FREQ_KHZ;
+        ESP_LOGW(TAG, "Retrying with %d kHz clock...", SD_SPI_RETRY_FREQ_KHZ);
         
         ret = esp_vfs_fat_sdspi_mount(MOUNT_POINT, &host, &slot_config, &mount_config, &g_card);
         if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "SD card mount failed even at 200kHz: %s", esp_err_to_name(ret));
+            ESP_LOGE(TAG, "SD card mount failed even at %d kHz: %s", SD_SPI_RETRY_FREQ_KHZ, esp_err_to_name(ret));
             spi_bus_free(SPI2_HOST);
             return;
         }
     }
 
     g_sdcard_initialized = true;
-    ESP_LOGI(TAG, "SD card mounted successfully in SPI mode");
+    ESP_LOGI(TAG, "SD card mounted successfully in SPI mode at %d kHz", g_card->real_freq_khz);
 
     // Rest of your existing code for card info and log file creation...
     if (g_card != NULL) {
@@ -472,12 +539,8 @@ esp_err_t sdcard_create_numbered_log_file(const char *filename){
     
     ESP_LOGI(TAG, "Created new log filename: %s (testno: %u)", log_path, testno);
 
-    //Copy file path into global
-    strncpy(current_log_filepath, log_path, sizeof(current_log_filepath));
-    current_log_filepath[sizeof(current_log_filepath) - 1] = '\0';
-
     // Open the new log file
-    return open_log_file(log_path);
+    return log_file_open(log_path);
 }
 
 static bool is_valid_fat32_filename_char(char ch) {
@@ -549,8 +612,6 @@ static esp_err_t validate_filename(const char *filename) {
     return ESP_OK;
 }
 
-// Add this function to allow read-only access from outside
-const char* sdcard_get_current_log_filename(void) {
-    return current_log_filepath;
+bool sdcard_is_initialized(void) {
+    return g_sdcard_initialized;
 }
-
@@ -5,32 +5,38 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "sdmmc_cmd.h"
+#include "laptimer.h"
+#include "dtc_journal.h"
+#include "log_file.h"
 
 #define MOUNT_POINT "/sdcard/"
-#define LOG_TYPE ".benji2"
-
-#define MAX_FILE_NAME_LENGTH 128
 
 #define PIN_NUM_MISO  GPIO_NUM_10  // D0
 #define PIN_NUM_MOSI  GPIO_NUM_9 // D1
 #define PIN_NUM_CLK   GPIO_NUM_11 // CLK
 #define PIN_NUM_CS    13 // CS
 
-extern FILE *log_file;
-extern SemaphoreHandle_t log_file_mutex;
+// SPI data clock after identification, which the driver always runs at 400 kHz.
+// The sampler produces CH_COUNT bytes x 1 kHz (~141 KB/s); 400 kHz moves ~50 KB/s
+#define SD_SPI_FREQ_KHZ       20000 // SDMMC_FREQ_DEFAULT
+#define SD_SPI_RETRY_FREQ_KHZ 5000  // Second attempt for marginal wiring, still above the log rate
 
 // Function declarations
+void nvs_init(void);
 void sdcard_init(void);
 void sdcard_deinit(void);
 bool sdcard_is_initialized(void);
 sdmmc_card_t* sdcard_get_card_handle(void);
-esp_err_t fast_log_buffer(const uint8_t *data_buffer, uint8_t buffer_len);
 esp_err_t sdcard_create_numbered_log_file(const char *filename);
 esp_err_t nvs_set_log_name(const char *log_name);
 esp_err_t nvs_get_log_name(char *buffer, size_t buffer_size);
-static esp_err_t validate_filename(const char *filename);
-static bool is_valid_fat32_filename_char(char ch);
-const char* sdcard_get_current_log_filename(void);
 esp_err_t nvs_set_testno(uint8_t testno);
 esp_err_t nvs_increment_testno(uint8_t *testno);
+esp_err_t nvs_increment_boot_count(uint8_t *boot);
+esp_err_t nvs_set_lap_gates(const lap_gate_t *gates, uint8_t count);
+esp_err_t nvs_get_lap_gates(lap_gate_t *gates, uint8_t *count);
+esp_err_t nvs_set_dtc_ring(const dtc_journal_ring_t *ring);
+esp_err_t nvs_get_dtc_ring(dtc_journal_ring_t *ring);
+esp_err_t nvs_set_telemetry_config(const char *config);
+esp_err_t nvs_get_telemetry_config(char *buffer, size_t buffer_size);
 #endif
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "tasks.h"
+#include <stdio.h>
+#include "esp_log.h"
+
+static const char *TAG = "TASKS";
+
+#if TASKS_PINNING
+#define TASK_CORE(core) (core)
+#else
+#define TASK_CORE(core) tskNO_AFFINITY
+#endif
+
+const logger_task_config_t logger_task_config[TASK_COUNT] = {
+    #define X(name, label, core, prio, stack, is_static) \
+        [TASK_##name] = {label, TASK_CORE(core), prio, stack, is_static},
+    LOGGER_TASKS
+    #undef X
+};
+
+// Stack and TCB of the static tasks (zero-length for the dynamic ones)
+#define X(name, label, core, prio, stack, is_static) \
+    static StackType_t stack_##name[(is_static) ? (stack) / sizeof(StackType_t) : 0]; \
+    static StaticTask_t tcb_##name[(is_static) ? 1 : 0];
+LOGGER_TASKS
+#undef X
+
+static StackType_t *const static_stacks[TASK_COUNT] = {
+    #define X(name, label, core, prio, stack, is_static) [TASK_##name] = stack_##name,
+    LOGGER_TASKS
+    #undef X
+};
+
+static StaticTask_t *const static_tcbs[TASK_COUNT] = {
+    #define X(name, label, core, prio, stack, is_static) [TASK_##name] = tcb_##name,
+    LOGGER_TASKS
+    #undef X
+};
+
+const uint32_t tasks_ram_bytes = 0
+    #define X(name, label, core, prio, stack, is_static) + sizeof(stack_##name) + sizeof(tcb_##name)
+    LOGGER_TASKS
+    #undef X
+    ;
+
+static TaskHandle_t static_created[TASK_COUNT];
+
+esp_err_t tasks_create(logger_task_t task, TaskFunction_t function, void *param, TaskHandle_t *handle) {
+    const logger_task_config_t *cfg = &logger_task_config[task];
+    TaskHandle_t created = NULL;
+
+    if (cfg->is_static && static_created[task] != NULL) {
+        ESP_LOGE(TAG, "%s already created", cfg->name);
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (cfg->is_static) {
+        // ESP-IDF stack sizes are in bytes, and StackType_t is a byte
+        created = xTaskCreateStaticPinnedToCore(function, cfg->name, cfg->stack, param, cfg->priority,
+                                                static_stacks[task], static_tcbs[task], cfg->core);
+    } else if (xTaskCreatePinnedToCore(function, cfg->name, cfg->stack, param, cfg->priority, &created,
+                                       cfg->core) != pdPASS) {
+        created = NULL;
+    }
+    if (created == NULL) {
+        ESP_LOGE(TAG, "Failed to create %s", cfg->name);
+        return ESP_FAIL;
+    }
+    if (cfg->is_static) {
+        static_created[task] = created;
+    }
+    if (handle != NULL) {
+        *handle = created;
+    }
+    return ESP_OK;
+}
+
+void tasks_print(void) {
+    printf("\n%-18s %4s %4s %6s %6s\n", "Task", "Core", "Prio", "Stack", "Static");
+    printf("==========================================\n");
+    for (int i = 0; i < TASK_COUNT; i++) {
+        const logger_task_config_t *cfg = &logger_task_config[i];
+        char core[12] = "-"; // Fits any int
+        if (cfg->core != tskNO_AFFINITY) {
+            snprintf(core, sizeof(core), "%d", (int)cfg->core);
+        }
+        printf("%-18s %4s %4u %6lu %6s\n", cfg->name, core, (unsigned)cfg->priority, (unsigned long)cfg->stack,
+               cfg->is_static ? "yes" : "no");
+    }
+}
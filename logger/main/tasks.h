@@ -0,0 +1,85 @@
+/*
+ * tasks.h
+ *
+ * Every FreeRTOS task of the logger in one table: core, priority, stack and
+ * whether its stack and TCB are static. The acquisition core runs only the
+ * sampler, the ADC scan and the CAN drain, so nothing else can preempt or
+ * cache-thrash them; SD writes, GNSS parsing, the console and housekeeping
+ * share the I/O core with the esp_timer task (CONFIG_ESP_TIMER_TASK_AFFINITY
+ * is CPU0) and the driver ISRs installed from app_main.
+ *
+ * Build with -DTASKS_PINNING=0 to let every task float as before; 'jitter'
+ * on the console compares the sampler's period error between the two.
+ */
+#ifndef INC_TASKS_H_
+#define INC_TASKS_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#ifndef TASKS_PINNING
+#define TASKS_PINNING 1
+#endif
+
+#ifndef TASKS_CORE_ACQ
+#define TASKS_CORE_ACQ 1 // APP CPU: acquisition only
+#endif
+#ifndef TASKS_CORE_IO
+#define TASKS_CORE_IO 0  // PRO CPU: storage, console, GNSS, housekeeping
+#endif
+
+/*
+ * name, FreeRTOS name, core, priority, stack bytes, static
+ * Acquisition priorities: the sampler must not wait behind an ADC scan
+ * (~150 us of SPI), and the CAN drain soaks up what is left. Every task is
+ * created once at boot; the ones with start/stop commands park between runs
+ * instead of being deleted, so their stacks can be static too.
+ */
+#define LOGGER_TASKS \
+    X(SAMPLER,     "log buffer",       TASKS_CORE_ACQ, 12, 4096, 1) \
+    X(ADC,         "adc_reader",       TASKS_CORE_ACQ, 11, 4096, 1) \
+    X(CAN_RX,      "can_rx",           TASKS_CORE_ACQ, 10, 4096, 1) \
+    X(UART_INPUT,  "uart_input",       TASKS_CORE_IO,  10, 4096, 1) \
+    X(GNSS,        "gnss_uart_task",   TASKS_CORE_IO,   9, 4096, 1) \
+    X(LOG_WRITER,  "log_writer",       TASKS_CORE_IO,   7, 4096, 1) \
+    X(DTC_INFO,    "dtc_info_display", TASKS_CORE_IO,   6, 4096, 1) \
+    X(CONSOLE,     "console",          TASKS_CORE_IO,   5, 8192, 1) \
+    X(TELEMETRY,   "telemetry",        TASKS_CORE_IO,   3, 3072, 1) \
+    X(DTC_STATS,   "dtc_stats",        TASKS_CORE_IO,   2, 3072, 1) \
+    X(METRICS,     "metrics",          TASKS_CORE_IO,   2, 3072, 1) \
+    X(DLOG,        "dlog",             TASKS_CORE_IO,   1, 3072, 1)
+
+typedef enum {
+    #define X(name, label, core, prio, stack, is_static) TASK_##name,
+    LOGGER_TASKS
+    #undef X
+    TASK_COUNT
+} logger_task_t;
+
+typedef struct {
+    const char *name;
+    BaseType_t core;     // tskNO_AFFINITY when TASKS_PINNING is 0
+    UBaseType_t priority;
+    uint32_t stack;      // Bytes
+    uint8_t is_static;
+} logger_task_config_t;
+
+extern const logger_task_config_t logger_task_config[TASK_COUNT];
+extern const uint32_t tasks_ram_bytes; // Static stacks and TCBs
+
+/**
+ * @brief Create a task from its table entry (logs and returns ESP_FAIL if it cannot)
+ *
+ * A static task can only be created once: its stack and TCB cannot be
+ * reused safely while the idle task may still be cleaning up a deleted one.
+ */
+esp_err_t tasks_create(logger_task_t task, TaskFunction_t function, void *param, TaskHandle_t *handle);
+
+/**
+ * @brief Print the task table as configured
+ */
+void tasks_print(void);
+
+#endif /* INC_TASKS_H_ */
@@ -0,0 +1,260 @@
+#include "telemetry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "uart.h"
+#include "sdcard.h"
+#include "telemetry_frame.h"
+#define LOG_CHANNEL_NAMES
+#include "log_chnl.h"
+#include "tasks.h"
+
+static const char *TAG = "TELEMETRY";
+
+// logBuffer byte index of every streamed byte, in frame order
+static uint8_t telem_index[CH_COUNT];
+static uint16_t telem_count = 0;
+static uint16_t telem_rate_hz = TELEMETRY_DEFAULT_RATE_HZ;
+
+static TaskHandle_t telem_task_handle = NULL;
+static esp_timer_handle_t telem_timer = NULL;
+static volatile bool telem_running = false;
+static volatile bool telem_busy = false; // From telemetry_start until the console is restored
+
+// Frame buffers are only touched by the telemetry task
+static uint8_t frame_payload[TELEM_MAX_PAYLOAD];
+static uint8_t frame_scratch[TELEM_MAX_FRAME];
+static uint8_t frame_encoded[TELEM_MAX_ENCODED];
+
+const uint32_t telemetry_ram_bytes = sizeof(frame_payload) + sizeof(frame_scratch) + sizeof(frame_encoded);
+
+// log_channel_names entries carry a trailing comma
+static size_t channel_name_len(int ch) {
+    return strlen(log_channel_names[ch]) - 1;
+}
+
+static int find_channel(const char *name, size_t len) {
+    for (int ch = 0; ch < CH_COUNT; ch++) {
+        if (channel_name_len(ch) == len && strncmp(log_channel_names[ch], name, len) == 0) {
+            return ch;
+        }
+    }
+    return -1;
+}
+
+// Multi-byte channels continue as NAME1, NAME2, ... after the base NAME
+static bool is_continuation(int ch, const char *base, size_t len) {
+    const char *name = log_channel_names[ch];
+    size_t name_len = channel_name_len(ch);
+    if (name_len <= len || strncmp(name, base, len) != 0) {
+        return false;
+    }
+    for (size_t i = len; i < name_len; i++) {
+        if (!isdigit((unsigned char)name[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Parse "<rate_hz> [CH,CH,...]" into the streamed byte list
+ *
+ * Channels are given by their base name (TS, IMU_X_ACCEL, ...) and expand to
+ * all of their bytes. No channel list streams every channel.
+ */
+static esp_err_t parse_config(const char *config) {
+    char *end;
+    long rate = strtol(config, &end, 10);
+    if (end == config || rate <= 0 || rate > TELEMETRY_MAX_RATE_HZ) {
+        ESP_LOGE(TAG, "Rate must be 1-%d Hz", TELEMETRY_MAX_RATE_HZ);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    while (*end == ' ') {
+        end++;
+    }
+
+    uint16_t count = 0;
+    if (*end == '\0') {
+        for (int ch = 0; ch < CH_COUNT; ch++) {
+            telem_index[count++] = ch;
+        }
+    } else {
+        const char *tok = end;
+        while (*tok != '\0') {
+            size_t len = strcspn(tok, ", ");
+            if (len > 0) {
+                int ch = find_channel(tok, len);
+                if (ch < 0) {
+                    ESP_LOGE(TAG, "Unknown channel '%.*s'", (int)len, tok);
+                    return ESP_ERR_NOT_FOUND;
+                }
+                do {
+                    if (count >= CH_COUNT) {
+                        return ESP_ERR_INVALID_SIZE;
+                    }
+                    telem_index[count++] = ch++;
+                } while (ch < CH_COUNT && is_continuation(ch, tok, len));
+            }
+            tok += len;
+            while (*tok == ',' || *tok == ' ') {
+                tok++;
+            }
+        }
+    }
+
+    if (count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    telem_count = count;
+    telem_rate_hz = (uint16_t)rate;
+    return ESP_OK;
+}
+
+static void send_frame(uint8_t type, uint16_t seq, size_t len) {
+    size_t encoded = telem_frame_encode(type, seq, frame_payload, len, frame_scratch, frame_encoded);
+    if (encoded > 0) {
+        uart_write_bytes(UART_PORT, (const char *)frame_encoded, encoded);
+    }
+}
+
+static void send_schema(void) {
+    size_t len = 0;
+    frame_payload[len++] = (uint8_t)telem_rate_hz;
+    frame_payload[len++] = (uint8_t)(telem_rate_hz >> 8);
+    for (uint16_t i = 0; i < telem_count; i++) {
+        size_t name_len = strlen(log_channel_names[telem_index[i]]);
+        if (len + name_len > sizeof(frame_payload)) {
+            break;
+        }
+        memcpy(frame_payload + len, log_channel_names[telem_index[i]], name_len);
+        len += name_len;
+    }
+    send_frame(TELEM_FRAME_SCHEMA, 0, len);
+}
+
+// esp_timer task: pace the stream at the exact rate, which the RTOS tick would round to 10 ms steps
+static void telemetry_period_callback(void *arg) {
+    xTaskNotifyGive(telem_task_handle);
+}
+
+static void telemetry_stream(void) {
+    const uint32_t schema_every = (TELEMETRY_SCHEMA_PERIOD_MS * telem_rate_hz) / 1000;
+    uint16_t seq = 0;
+    uint32_t frames = 0;
+
+    if (esp_timer_start_periodic(telem_timer, 1000000 / telem_rate_hz) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start telemetry timer");
+        telem_running = false;
+    }
+
+    while (telem_running) {
+        if (frames % (schema_every > 0 ? schema_every : 1) == 0) {
+            send_schema();
+        }
+
+        // Same unlocked snapshot of logBuffer the console views use
+        for (uint16_t i = 0; i < telem_count; i++) {
+            frame_payload[i] = logBuffer[telem_index[i]];
+        }
+        send_frame(TELEM_FRAME_DATA, seq++, telem_count);
+        frames++;
+
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+    esp_timer_stop(telem_timer);
+    ulTaskNotifyTake(pdTRUE, 0); // A period that fired while stopping must not count as the next start
+
+    uart_wait_tx_done(UART_PORT, pdMS_TO_TICKS(100));
+    uart_set_baudrate(UART_PORT, TELEMETRY_CONSOLE_BAUD);
+    esp_log_level_set("*", CONFIG_LOG_DEFAULT_LEVEL);
+    ESP_LOGI(TAG, "Telemetry stopped after %lu frames", (unsigned long)frames);
+}
+
+// Created on the first start with a static stack; parks between streams
+static void telemetry_task(void *pvParameters) {
+    telem_task_handle = xTaskGetCurrentTaskHandle(); // Before the period timer can notify it
+    while (1) {
+        telemetry_stream();
+        telem_busy = false;
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+/**
+ * @brief Start streaming
+ *
+ * @param config "<rate_hz> [CH,CH,...]", or NULL/empty for the config saved in NVS
+ */
+esp_err_t telemetry_start(const char *config) {
+    if (telem_running || telem_busy) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    char saved[TELEMETRY_CONFIG_LENGTH];
+    if (config == NULL || config[0] == '\0') {
+        if (nvs_get_telemetry_config(saved, sizeof(saved)) != ESP_OK || saved[0] == '\0') {
+            snprintf(saved, sizeof(saved), "%d", TELEMETRY_DEFAULT_RATE_HZ);
+        }
+        config = saved;
+    }
+
+    esp_err_t err = parse_config(config);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (telem_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = telemetry_period_callback,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "telem_period",
+        };
+        if (esp_timer_create(&timer_args, &telem_timer) != ESP_OK) {
+            return ESP_FAIL;
+        }
+    }
+    if (config != saved) {
+        nvs_set_telemetry_config(config);
+    }
+
+    // COBS adds at most one byte per 254, plus the delimiter
+    uint32_t bytes_per_s = (telem_count + TELEM_FRAME_OVERHEAD + telem_count / 254 + 2) * telem_rate_hz;
+    if (bytes_per_s > TELEMETRY_BAUD / 10) {
+        ESP_LOGW(TAG, "%lu B/s exceeds the link (%d B/s), frames will be delayed", (unsigned long)bytes_per_s,
+                 TELEMETRY_BAUD / 10);
+    }
+    ESP_LOGI(TAG, "Streaming %u bytes at %u Hz on %d baud", telem_count, telem_rate_hz, TELEMETRY_BAUD);
+
+    uart_wait_tx_done(UART_PORT, pdMS_TO_TICKS(100));
+    esp_log_level_set("*", ESP_LOG_NONE);
+    uart_set_baudrate(UART_PORT, TELEMETRY_BAUD);
+
+    telem_running = true;
+    telem_busy = true;
+    if (telem_task_handle != NULL) {
+        xTaskNotifyGive(telem_task_handle);
+    } else if (tasks_create(TASK_TELEMETRY, telemetry_task, NULL, &telem_task_handle) != ESP_OK) {
+        telem_running = false;
+        telem_busy = false;
+        uart_set_baudrate(UART_PORT, TELEMETRY_CONSOLE_BAUD);
+        esp_log_level_set("*", CONFIG_LOG_DEFAULT_LEVEL);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// The task restores the console baud rate and log level once its last frame is out
+void telemetry_stop(void) {
+    telem_running = false;
+}
+
+bool telemetry_active(void) {
+    return telem_running;
+}
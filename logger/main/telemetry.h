@@ -0,0 +1,28 @@
+/*
+ * telemetry.h
+ *
+ * Binary live-telemetry stream over the console UART. A low priority task
+ * samples a configurable subset of logBuffer channels at a fixed rate and
+ * sends them as COBS/CRC frames (see telemetry_frame.h). While streaming the
+ * port runs at TELEMETRY_BAUD and ESP_LOG output is muted; both are restored
+ * when the stream stops. The host receiver is tools/telemetry_rx.
+ */
+#ifndef INC_TELEMETRY_H_
+#define INC_TELEMETRY_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#define TELEMETRY_BAUD 921600
+#define TELEMETRY_CONSOLE_BAUD 115200 // Restored when the stream stops, matches uart_init()
+#define TELEMETRY_DEFAULT_RATE_HZ 50
+#define TELEMETRY_MAX_RATE_HZ 200
+#define TELEMETRY_SCHEMA_PERIOD_MS 1000 // Schema is repeated so a receiver can join at any time
+#define TELEMETRY_CONFIG_LENGTH 512     // "<rate_hz> [CH,CH,...]"
+
+esp_err_t telemetry_start(const char *config);
+void telemetry_stop(void);
+bool telemetry_active(void);
+
+#endif /* INC_TELEMETRY_H_ */
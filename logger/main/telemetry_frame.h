@@ -0,0 +1,129 @@
+/*
+ * telemetry_frame.h
+ *
+ * Framing for the binary live-telemetry stream. Each frame is
+ *
+ *   uint8_t  type        TELEM_FRAME_SCHEMA or TELEM_FRAME_DATA
+ *   uint16_t seq         little-endian, increments per data frame
+ *   uint8_t  payload[]
+ *   uint16_t crc         CRC-16/CCITT-FALSE over type..payload, little-endian
+ *
+ * COBS encoded and terminated by a single 0x00, so a receiver resynchronises
+ * on the next zero after any corruption (including console text that lands
+ * between frames).
+ *
+ * Schema payload: uint16_t rate_hz, then the comma-terminated channel name of
+ * every streamed byte, in order (same convention as the .benji2 header).
+ * Data payload: the streamed bytes of logBuffer, in schema order.
+ *
+ * Header-only and free of ESP-IDF dependencies so the host receiver shares it.
+ */
+#ifndef INC_TELEMETRY_FRAME_H_
+#define INC_TELEMETRY_FRAME_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TELEM_FRAME_SCHEMA 'S'
+#define TELEM_FRAME_DATA 'D'
+#define TELEM_FRAME_OVERHEAD 5 // type + seq + crc
+#define TELEM_MAX_PAYLOAD 2048
+#define TELEM_MAX_FRAME (TELEM_MAX_PAYLOAD + TELEM_FRAME_OVERHEAD)
+#define TELEM_MAX_ENCODED (TELEM_MAX_FRAME + TELEM_MAX_FRAME / 254 + 2) // COBS overhead + delimiter
+
+static inline uint16_t telem_crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief COBS encode len bytes and append the 0x00 delimiter
+ *
+ * @param out Must hold len + len / 254 + 2 bytes
+ * @return Encoded length including the delimiter
+ */
+static inline size_t telem_cobs_encode(const uint8_t *in, size_t len, uint8_t *out) {
+    size_t code_idx = 0;
+    size_t out_idx = 1;
+    uint8_t code = 1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_idx] = code;
+            code_idx = out_idx++;
+            code = 1;
+            continue;
+        }
+        out[out_idx++] = in[i];
+        if (++code == 0xFF) {
+            out[code_idx] = code;
+            code_idx = out_idx++;
+            code = 1;
+        }
+    }
+    out[code_idx] = code;
+    out[out_idx++] = 0;
+    return out_idx;
+}
+
+/**
+ * @brief Decode one COBS block (without its 0x00 delimiter)
+ *
+ * @return Decoded length, or 0 if the block is malformed or exceeds out_size
+ */
+static inline size_t telem_cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_size) {
+    size_t in_idx = 0;
+    size_t out_idx = 0;
+
+    while (in_idx < len) {
+        uint8_t code = in[in_idx++];
+        if (code == 0 || in_idx + code - 1 > len) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            if (out_idx >= out_size) {
+                return 0;
+            }
+            out[out_idx++] = in[in_idx++];
+        }
+        if (code != 0xFF && in_idx < len) {
+            if (out_idx >= out_size) {
+                return 0;
+            }
+            out[out_idx++] = 0;
+        }
+    }
+    return out_idx;
+}
+
+/**
+ * @brief Build and encode a complete frame
+ *
+ * @param scratch At least TELEM_MAX_FRAME bytes for the unencoded frame
+ * @param out     At least TELEM_MAX_ENCODED bytes
+ * @return Encoded length, or 0 if the payload is too large
+ */
+static inline size_t telem_frame_encode(uint8_t type, uint16_t seq, const uint8_t *payload, size_t len,
+                                        uint8_t *scratch, uint8_t *out) {
+    if (len > TELEM_MAX_PAYLOAD) {
+        return 0;
+    }
+    scratch[0] = type;
+    scratch[1] = (uint8_t)seq;
+    scratch[2] = (uint8_t)(seq >> 8);
+    for (size_t i = 0; i < len; i++) {
+        scratch[3 + i] = payload[i];
+    }
+    uint16_t crc = telem_crc16(scratch, len + 3);
+    scratch[len + 3] = (uint8_t)crc;
+    scratch[len + 4] = (uint8_t)(crc >> 8);
+    return telem_cobs_encode(scratch, len + TELEM_FRAME_OVERHEAD, out);
+}
+
+#endif /* INC_TELEMETRY_FRAME_H_ */
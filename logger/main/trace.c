@@ -0,0 +1,233 @@
+#include "trace.h"
+#include <string.h>
+#include "sdkconfig.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_freertos_hooks.h"
+#include "freertos/task.h"
+#include "prof.h"
+#include "sdcard.h"
+
+static const char *TAG = "TRACE";
+
+#define TRACE_MAX_TASKS 32 // FreeRTOS tasks named in a dump
+
+trace_event_t trace_storage[portNUM_PROCESSORS][LOGGER_TRACE ? TRACE_RING_LEN : 0];
+
+const uint32_t trace_ram_bytes = sizeof(trace_storage);
+volatile uint32_t trace_head[portNUM_PROCESSORS];
+volatile bool trace_running = false;
+
+static uint32_t anchor_cycles[portNUM_PROCESSORS];
+static int64_t anchor_us[portNUM_PROCESSORS];
+static bool hooks_registered = false;
+static TaskStatus_t task_status[TRACE_MAX_TASKS];
+
+static const char *task_names[] = {
+    #define X(name, label) label,
+    TRACE_TASKS
+    #undef X
+};
+
+static const char *isr_names[] = {
+    #define X(name, label) label,
+    TRACE_ISRS
+    #undef X
+};
+
+static const char *queue_names[] = {
+    #define X(name, label) label,
+    TRACE_QUEUES
+    #undef X
+};
+
+static const char *stage_names[] = {
+    #define X(name, desc) desc,
+    PROF_STAGES
+    #undef X
+};
+
+static const char *mark_names[] = {
+    #define X(name, label) label,
+    TRACE_MARKS
+    #undef X
+};
+
+/*
+ * Pairs this core's cycle counter with the shared esp_timer clock. Refreshed
+ * on every tick, the anchor stays within a tick of the newest events, so
+ * trace_export can place them on one timeline however often CCOUNT wrapped.
+ */
+static void IRAM_ATTR trace_set_anchor(int core) {
+    anchor_cycles[core] = esp_cpu_get_cycle_count();
+    anchor_us[core] = esp_timer_get_time();
+}
+
+// Every tick on every core, from the tick ISR: which task the scheduler is running
+static void IRAM_ATTR trace_tick_hook(void) {
+    if (!trace_running) {
+        return;
+    }
+    TaskHandle_t current = xTaskGetCurrentTaskHandle();
+    trace_event(TRACE_TASK_SAMPLE, 0, current != NULL ? (uint16_t)uxTaskGetTaskNumber(current) : 0);
+    trace_set_anchor(esp_cpu_get_core_id());
+}
+
+esp_err_t trace_start(void) {
+    if (!LOGGER_TRACE) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    trace_running = false;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        trace_head[core] = 0;
+    }
+    if (!hooks_registered) {
+        for (int core = 0; core < portNUM_PROCESSORS; core++) {
+            if (esp_register_freertos_tick_hook_for_cpu(trace_tick_hook, core) != ESP_OK) {
+                ESP_LOGW(TAG, "No tick hook on core %d: no task samples", core);
+            }
+        }
+        hooks_registered = true;
+    }
+    trace_running = true;
+    ESP_LOGI(TAG, "Tracing %d events per core", TRACE_RING_LEN);
+    return ESP_OK;
+}
+
+void trace_stop(void) {
+    if (trace_running) {
+        trace_running = false;
+        trace_set_anchor(esp_cpu_get_core_id());
+    }
+}
+
+void trace_print_status(void) {
+    printf("Trace: %s, %d events per core\n", trace_running ? "running" : "stopped", TRACE_RING_LEN);
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t head = trace_head[core];
+        printf("  Core %d: %lu recorded, %lu held\n", core, (unsigned long)head,
+               (unsigned long)(head < TRACE_RING_LEN ? head : TRACE_RING_LEN));
+    }
+}
+
+typedef void (*trace_writer_t)(const void *data, size_t len, void *ctx);
+
+static void write_name(trace_writer_t out, void *ctx, trace_name_kind_t kind, uint16_t id, const char *name) {
+    trace_file_name_t entry = {.kind = (uint8_t)kind, .id = id};
+    strncpy(entry.name, name, sizeof(entry.name) - 1);
+    out(&entry, sizeof(entry), ctx);
+}
+
+// Header, per-core anchors, name table, then each ring oldest first
+static void trace_write(trace_writer_t out, void *ctx) {
+    UBaseType_t task_count = uxTaskGetSystemState(task_status, TRACE_MAX_TASKS, NULL);
+    trace_file_header_t header = {
+        .magic = TRACE_MAGIC,
+        .version = TRACE_VERSION,
+        .cpu_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .cores = portNUM_PROCESSORS,
+        .name_count = (uint16_t)(task_count + TRACE_TASK_COUNT + TRACE_ISR_COUNT + TRACE_QUEUE_COUNT +
+                                 PROF_STAGE_COUNT + TRACE_MARK_COUNT),
+        .ring_len = TRACE_RING_LEN,
+    };
+    out(&header, sizeof(header), ctx);
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t head = trace_head[core];
+        trace_file_core_t info = {
+            .anchor_cycles = anchor_cycles[core],
+            .count = head < TRACE_RING_LEN ? head : TRACE_RING_LEN,
+            .anchor_us = anchor_us[core],
+            .lost = head > TRACE_RING_LEN ? head - TRACE_RING_LEN : 0,
+        };
+        out(&info, sizeof(info), ctx);
+    }
+
+    for (UBaseType_t i = 0; i < task_count; i++) {
+        write_name(out, ctx, TRACE_NAME_TASK_NUMBER, (uint16_t)task_status[i].xTaskNumber, task_status[i].pcTaskName);
+    }
+    for (int i = 0; i < TRACE_TASK_COUNT; i++) {
+        write_name(out, ctx, TRACE_NAME_TASK, i, task_names[i]);
+    }
+    for (int i = 0; i < TRACE_ISR_COUNT; i++) {
+        write_name(out, ctx, TRACE_NAME_ISR, i, isr_names[i]);
+    }
+    for (int i = 0; i < TRACE_QUEUE_COUNT; i++) {
+        write_name(out, ctx, TRACE_NAME_QUEUE, i, queue_names[i]);
+    }
+    for (int i = 0; i < PROF_STAGE_COUNT; i++) {
+        write_name(out, ctx, TRACE_NAME_STAGE, i, stage_names[i]);
+    }
+    for (int i = 0; i < TRACE_MARK_COUNT; i++) {
+        write_name(out, ctx, TRACE_NAME_MARK, i, mark_names[i]);
+    }
+
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t head = trace_head[core];
+        if (head == 0) {
+            continue;
+        }
+        uint32_t first = head > TRACE_RING_LEN ? head - TRACE_RING_LEN : 0;
+        for (uint32_t i = first; i < head; i++) {
+            out(&trace_storage[core][i & (TRACE_RING_LEN - 1)], sizeof(trace_event_t), ctx);
+        }
+    }
+}
+
+static void file_writer(const void *data, size_t len, void *ctx) {
+    fwrite(data, 1, len, (FILE *)ctx);
+}
+
+esp_err_t trace_save(void) {
+    char path[MAX_FILE_NAME_LENGTH];
+    trace_stop();
+    if (!sdcard_is_initialized() || sdcard_get_session_path(TRACE_SUFFIX, path, sizeof(path)) != ESP_OK) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Failed to open %s", path);
+        return ESP_FAIL;
+    }
+    trace_write(file_writer, f);
+    fclose(f);
+    ESP_LOGI(TAG, "Trace saved to %s", path);
+    return ESP_OK;
+}
+
+// 32 bytes per line so a dropped console line is easy to spot
+typedef struct {
+    uint8_t line[32];
+    size_t fill;
+} hex_state_t;
+
+static void hex_flush(hex_state_t *hex) {
+    for (size_t i = 0; i < hex->fill; i++) {
+        printf("%02x", hex->line[i]);
+    }
+    if (hex->fill > 0) {
+        printf("\n");
+    }
+    hex->fill = 0;
+}
+
+static void hex_writer(const void *data, size_t len, void *ctx) {
+    hex_state_t *hex = ctx;
+    const uint8_t *bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hex->line[hex->fill++] = bytes[i];
+        if (hex->fill == sizeof(hex->line)) {
+            hex_flush(hex);
+        }
+    }
+}
+
+void trace_dump_hex(void) {
+    hex_state_t hex = {.fill = 0};
+    trace_stop();
+    printf("BTRC-HEX\n");
+    trace_write(hex_writer, &hex);
+    hex_flush(&hex);
+    printf("BTRC-END\n");
+}
@@ -0,0 +1,200 @@
+/*
+ * trace.h
+ *
+ * Flight-recorder event trace of the pipeline: one ring per core of 8-byte
+ * events stamped with the core's cycle counter - ISR entry/exit, queue sends
+ * and receives, pipeline task work units, prof.h stage spans, custom marks,
+ * and (on the target) a tick-hook sample of the task running on each core.
+ * Writers only reserve a slot with an atomic increment, so every call is
+ * safe in ISRs and costs a few dozen cycles; the ring overwrites the oldest
+ * events until 'trace stop' freezes it.
+ *
+ * The console 'trace' command saves the rings to <log>_trace.bin or dumps
+ * them as hex; tools/trace_export converts either to Chrome trace / Perfetto
+ * JSON. Build with -DLOGGER_TRACE=0 and every hook compiles to nothing.
+ */
+#ifndef INC_TRACE_H_
+#define INC_TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "esp_err.h"
+#include "esp_cpu.h"
+#include "freertos/FreeRTOS.h"
+
+#ifndef LOGGER_TRACE
+#define LOGGER_TRACE 1
+#endif
+
+#define TRACE_RING_LEN 2048 // Events per core (power of two); 16 KiB each, reserved in .bss unless LOGGER_TRACE is 0
+#define TRACE_SUFFIX "_trace.bin"
+#define TRACE_MAGIC "BTRC"
+#define TRACE_VERSION 1
+#define TRACE_NAME_LEN 16
+
+typedef enum {
+    TRACE_TASK_SAMPLE, // Tick hook: arg = FreeRTOS task number running on this core
+    TRACE_TASK_WAKE,   // A pipeline task starts a unit of work: id = trace_task_t
+    TRACE_TASK_BLOCK,  // ...and goes back to waiting
+    TRACE_ISR_ENTER,   // id = trace_isr_t
+    TRACE_ISR_EXIT,
+    TRACE_QUEUE_SEND,  // id = trace_queue_t, arg = trace_send_t
+    TRACE_QUEUE_RECV,
+    TRACE_STAGE_BEGIN, // id = prof_stage_t
+    TRACE_STAGE_END,
+    TRACE_MARK,        // id = trace_mark_t, arg = event specific
+} trace_type_t;
+
+typedef enum {
+    TRACE_SEND_FULL,      // Not queued
+    TRACE_SEND_QUEUED,
+    TRACE_SEND_OVERWROTE, // xQueueOverwrite replaced the pending item
+} trace_send_t;
+
+// Pipeline tasks with explicit work-unit markers: name, label
+#define TRACE_TASKS \
+    X(CAN_RX,    "can_rx") \
+    X(ADC,       "adc_reader") \
+    X(GNSS,      "gnss_uart_task") \
+    X(DTC,       "dtc_wheel")
+
+#define TRACE_ISRS \
+    X(CAN,       "TWAI rx")
+
+#define TRACE_QUEUES \
+    X(CAN_RX,    "CAN rx queue") \
+    X(GNSS_FIX,  "GNSS fix")
+
+#define TRACE_MARKS \
+    X(ADC_OVERRUN, "ADC overrun") \
+    X(CAN_DROP,    "CAN frame dropped") \
+    X(GNSS_SENTENCE, "NMEA sentence")
+
+typedef enum {
+    #define X(name, label) TRACE_TASK_##name,
+    TRACE_TASKS
+    #undef X
+    TRACE_TASK_COUNT
+} trace_task_t;
+
+typedef enum {
+    #define X(name, label) TRACE_ISR_##name,
+    TRACE_ISRS
+    #undef X
+    TRACE_ISR_COUNT
+} trace_isr_t;
+
+typedef enum {
+    #define X(name, label) TRACE_QUEUE_##name,
+    TRACE_QUEUES
+    #undef X
+    TRACE_QUEUE_COUNT
+} trace_queue_t;
+
+typedef enum {
+    #define X(name, label) TRACE_MARK_##name,
+    TRACE_MARKS
+    #undef X
+    TRACE_MARK_COUNT
+} trace_mark_t;
+
+typedef struct {
+    uint32_t cycles; // esp_cpu_get_cycle_count() of the recording core
+    uint8_t type;    // trace_type_t
+    uint8_t id;
+    uint16_t arg;
+} trace_event_t;
+
+// Name kinds in the dump's name table
+typedef enum {
+    TRACE_NAME_TASK_NUMBER, // FreeRTOS task number -> task name
+    TRACE_NAME_TASK,
+    TRACE_NAME_ISR,
+    TRACE_NAME_QUEUE,
+    TRACE_NAME_STAGE,
+    TRACE_NAME_MARK,
+} trace_name_kind_t;
+
+/*
+ * Dump layout, little-endian:
+ *   trace_file_header_t
+ *   trace_file_core_t[cores]
+ *   trace_file_name_t[name_count]
+ *   per core: events[count], oldest first
+ */
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t cpu_mhz;
+    uint16_t cores;
+    uint16_t name_count;
+    uint32_t ring_len;
+} trace_file_header_t;
+
+typedef struct {
+    uint32_t anchor_cycles; // Cycle count of this core at anchor_us, taken every tick and at the stop
+    uint32_t count;         // Events that follow
+    int64_t anchor_us;      // esp_timer time
+    uint32_t lost;          // Overwritten before the dump
+    uint32_t reserved;
+} trace_file_core_t;
+
+typedef struct {
+    uint8_t kind; // trace_name_kind_t
+    uint8_t reserved;
+    uint16_t id;
+    char name[TRACE_NAME_LEN];
+} trace_file_name_t;
+
+extern trace_event_t trace_storage[portNUM_PROCESSORS][LOGGER_TRACE ? TRACE_RING_LEN : 0];
+extern volatile uint32_t trace_head[portNUM_PROCESSORS];
+extern volatile bool trace_running;
+
+static inline void trace_event(trace_type_t type, uint8_t id, uint16_t arg) {
+#if LOGGER_TRACE
+    if (!trace_running) {
+        return;
+    }
+    int core = esp_cpu_get_core_id();
+    uint32_t cycles = esp_cpu_get_cycle_count();
+    uint32_t slot = __atomic_fetch_add(&trace_head[core], 1, __ATOMIC_RELAXED);
+    trace_storage[core][slot & (TRACE_RING_LEN - 1)] = (trace_event_t){
+        .cycles = cycles,
+        .type = (uint8_t)type,
+        .id = id,
+        .arg = arg,
+    };
+#else
+    (void)type;
+    (void)id;
+    (void)arg;
+#endif
+}
+
+/**
+ * @brief Clear the rings and start recording
+ */
+esp_err_t trace_start(void);
+
+/**
+ * @brief Freeze the rings for a dump
+ */
+void trace_stop(void);
+
+/**
+ * @brief Stop the trace and write it to <log>_trace.bin
+ */
+esp_err_t trace_save(void);
+
+/**
+ * @brief Stop the trace and print it as hex lines between BTRC-HEX and BTRC-END markers
+ */
+void trace_dump_hex(void);
+
+/**
+ * @brief Print whether the trace runs and how many events each core holds
+ */
+void trace_print_status(void);
+
+#endif /* INC_TRACE_H_ */
@@ -2,32 +2,58 @@
 #include "driver/uart.h"
 #include "esp_log.h"
 #include "esp_timer.h"
-#include "esp_heap_caps.h"
 #include "esp_system.h"
+#include "freertos/semphr.h"
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <inttypes.h>
 #include "dtc.h"
 #include "sdcard.h"
-#include "esp_task_wdt.h"
 #include "log_chnl.h"
+#include "gnss.h"
+#include "laptimer.h"
+#include "telemetry.h"
+#include "can.h"
+#include "filexfer.h"
+#include "metrics.h"
+#include "memmap.h"
+#include "log_ring.h"
+#include "prof.h"
+#include "trace.h"
+#include "dlog.h"
+#include "tasks.h"
 
 static const char *TAG = "UART_MODULE";
 
 // Global variables
-SemaphoreHandle_t char_mutex = NULL;
 QueueHandle_t uart_event_queue = NULL;
 
 // Private variables
-static char last_char = '\0';
+static StreamBufferHandle_t console_stream = NULL;
+static uint8_t console_stream_storage[CONSOLE_STREAM_SIZE + 1]; // FreeRTOS keeps one byte free
+static StaticStreamBuffer_t console_stream_buffer;
+static uint32_t console_dropped = 0; // Bytes lost because the console task fell behind
+
 static TaskHandle_t dtc_info_task_handle = NULL;
-static bool dtc_info_running = false;
+static volatile bool dtc_info_running = false;
+static volatile bool dtc_info_active = false; // Display shown; cleared once the task has parked
+static SemaphoreHandle_t dtc_info_parked = NULL; // Given by the display task each time it parks
+static StaticSemaphore_t dtc_info_parked_buffer;
+
+// Bytes received but not yet consumed by the line editor (console task only)
+static uint8_t rx_chunk[RD_BUF_SIZE];
+static size_t rx_pos = 0;
+static size_t rx_len = 0;
+static int rx_pushback = -1;
 
-static bool uart_input_mode = false;
-static char input_buffer_char = '\0';
+const uint32_t console_ram_bytes = sizeof(console_stream_storage) + sizeof(console_stream_buffer) + sizeof(rx_chunk) +
+                                   sizeof(dtc_info_parked_buffer);
 
 // Private function declarations
 static void print_dtc_info(void *pvParameters);
-static void print_cpu_usage(void);
+static void print_help(void);
 
 esp_err_t uart_init(void) {
     ESP_LOGI(TAG, "Initializing UART module");
@@ -62,32 +88,25 @@ esp_err_t uart_init(void) {
         return ret;
     }
     
-    // Create mutex for character sharing between tasks
-    char_mutex = xSemaphoreCreateMutex();
-    if (char_mutex == NULL) {
-        ESP_LOGE(TAG, "Failed to create character mutex");
-        return ESP_FAIL;
+    // Hand received bytes over after a short idle gap instead of the default 10 symbols
+    ret = uart_set_rx_timeout(UART_PORT, CONSOLE_RX_TIMEOUT_SYMBOLS);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set UART RX timeout: %s", esp_err_to_name(ret));
     }
 
+    // Console bytes flow from the UART event task to the console task; wake on every byte
+    console_stream = xStreamBufferCreateStatic(CONSOLE_STREAM_SIZE, 1, console_stream_storage, &console_stream_buffer);
+    dtc_info_parked = xSemaphoreCreateBinaryStatic(&dtc_info_parked_buffer);
 
-    
     ESP_LOGI(TAG, "UART initialized successfully");
     return ESP_OK;
 }
 
 esp_err_t uart_create_tasks(void) {
-    BaseType_t result;
-
-
-    result = xTaskCreate(uart_input_task, "uart_input", 4096, NULL, 10, NULL);
-    if (result != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create uart_input_task");
+    if (tasks_create(TASK_UART_INPUT, uart_input_task, NULL, NULL) != ESP_OK) {
         return ESP_FAIL;
     }
-
-    result = xTaskCreate(uart_output_task, "uart_output", 8192, NULL, 5, NULL);
-    if (result != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create uart_output_task");
+    if (tasks_create(TASK_CONSOLE, uart_console_task, NULL, NULL) != ESP_OK) {
         return ESP_FAIL;
     }
 
@@ -95,6 +114,7 @@ esp_err_t uart_create_tasks(void) {
     return ESP_OK;
 }
 
+// Moves received bytes into the console stream buffer; never parses or sleeps
 void uart_input_task(void *pvParameters) {
     uart_event_t event;
     uint8_t data[RD_BUF_SIZE];
@@ -106,30 +126,16 @@ void uart_input_task(void *pvParameters) {
         if (xQueueReceive(uart_event_queue, &event, portMAX_DELAY)) {
             switch (event.type) {
                 case UART_DATA: {
-                    int len = uart_read_bytes(UART_PORT, data, event.size, portMAX_DELAY);
-                    if (len > 0) {
-                        xSemaphoreTake(char_mutex, portMAX_DELAY);
-                        
-                        if (uart_input_mode) {
-                            // In input mode: store each character individually for the input function
-                            for (int i = 0; i < len; i++) {
-                                input_buffer_char = data[i];
-                                // Give the input function time to process this character
-                                xSemaphoreGive(char_mutex);
-                                vTaskDelay(pdMS_TO_TICKS(5)); // Small delay to ensure character is processed
-                                xSemaphoreTake(char_mutex, portMAX_DELAY);
-                            }
-                        } else {
-                            // Normal mode: store first character for command processing
-                            last_char = data[0];
-                        }
-                        
-                        xSemaphoreGive(char_mutex);
-                        
-                        // Echo characters back in normal mode (optional)
-                        if (!uart_input_mode) {
-                            // uart_write_bytes(UART_PORT, (const char*)data, 1);
+                    size_t remaining = event.size;
+                    while (remaining > 0) {
+                        int len = uart_read_bytes(UART_PORT, data, remaining < sizeof(data) ? remaining : sizeof(data), 0);
+                        if (len <= 0) {
+                            break;
                         }
+                        size_t sent = xStreamBufferSend(console_stream, data, len, 0);
+                        console_dropped += len - sent;
+                        metrics_gauge_max(GAUGE_CONSOLE_FILL_PEAK, xStreamBufferBytesAvailable(console_stream));
+                        remaining -= len;
                     }
                     break;
                 }
@@ -151,449 +157,563 @@ void uart_input_task(void *pvParameters) {
     }
 }
 
+/**
+ * @brief Next console byte, blocking on the stream buffer for up to wait ticks
+ *
+ * Only called from the console task, which is the stream buffer's single reader.
+ *
+ * @return The byte, or -1 on timeout
+ */
+static int console_getc(TickType_t wait) {
+    if (rx_pushback >= 0) {
+        int c = rx_pushback;
+        rx_pushback = -1;
+        return c;
+    }
+    if (rx_pos >= rx_len) {
+        rx_len = xStreamBufferReceive(console_stream, rx_chunk, sizeof(rx_chunk), wait);
+        rx_pos = 0;
+        if (rx_len == 0) {
+            return -1;
+        }
+    }
+    return rx_chunk[rx_pos++];
+}
+
+/**
+ * @brief Raw read for binary console modes running on the console task
+ *
+ * Returns bytes already buffered by the line editor first, so nothing sent
+ * right after a command line is lost.
+ *
+ * @return Bytes read, 0 on timeout
+ */
+size_t uart_console_read(uint8_t *buf, size_t len, TickType_t wait) {
+    size_t n = 0;
+    while (n < len) {
+        int c = console_getc(n == 0 ? wait : 0);
+        if (c < 0) {
+            break;
+        }
+        buf[n++] = (uint8_t)c;
+    }
+    return n;
+}
+
+/**
+ * @brief Read one edited line from the console
+ *
+ * Supports backspace, Ctrl-U (erase line), Ctrl-C / ESC (cancel) and skips
+ * ANSI escape sequences such as arrow keys. Bytes after the line end stay
+ * buffered, so pasted multi-line input is not lost.
+ *
+ * @param timeout Ticks to wait for the whole line, portMAX_DELAY for no limit
+ * @return ESP_OK, ESP_ERR_TIMEOUT, or ESP_ERR_INVALID_RESPONSE if cancelled
+ */
+static esp_err_t console_read_line(char *buffer, size_t buffer_size, TickType_t timeout, bool echo) {
+    size_t index = 0;
+    TickType_t start = xTaskGetTickCount();
+    buffer[0] = '\0';
 
-void uart_output_task(void *param) {
-    ESP_LOGI(TAG, "Command processor task started");
-    
     while (1) {
-        vTaskDelay(pdMS_TO_TICKS(100));  // Check every 100ms
-        
-        // Get the last received character
-        xSemaphoreTake(char_mutex, portMAX_DELAY);
-        char input = last_char;
-        last_char = '\0';  // Clear after consuming
-        xSemaphoreGive(char_mutex);
-        
-        if (input != '\0') {
-            ESP_LOGI(TAG, "Processing input: %c", input);
-
-            // Stop DTC info task if it's running and a new command is issued (except 'd'/'D')
-            if (dtc_info_running && (input != 'd' && input != 'D')) {
-                dtc_info_running = false;
-                if (dtc_info_task_handle != NULL) {
-                    vTaskDelay(pdMS_TO_TICKS(150)); // Give task time to stop
-                }
-                printf("\033[2J\033[H"); // Clear screen
+        TickType_t wait = portMAX_DELAY;
+        if (timeout != portMAX_DELAY) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= timeout) {
+                return ESP_ERR_TIMEOUT;
             }
-            
-            switch (input) {
-                case '1':
-                    printf("=== Option 1: System Status ===\n");
-                    printf("System: Running\n");
-                    printf("Free heap: %ld bytes\n", esp_get_free_heap_size());
-                    printf("Uptime: %lld ms\n", esp_timer_get_time() / 1000);
-                    break;
-                    
-                case '2':
-                    printf("=== Option 2: Toggle LED ===\n");
-                    // Add your LED toggle code here
-                    printf("LED toggled!\n");
-                    break;
-                    
-                case '3':
-                    printf("=== Option 3: Start CAN Logging ===\n");
-                    // Uncomment your twai_init() in app_main if needed
-                    printf("CAN logging would start here\n");
-                    break;
-                    
-                case '4':
-                    printf("=== Option 4: Memory Info ===\n");
-                    printf("Total heap size: %d bytes\n", heap_caps_get_total_size(MALLOC_CAP_8BIT));
-                    printf("Free heap size: %d bytes\n", heap_caps_get_free_size(MALLOC_CAP_8BIT));
-                    printf("Largest free block: %d bytes\n", heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
-                    break;
-                    
-                case '5':  // New option for CPU usage
-                    printf("=== Option 5: CPU Usage ===\n");
-                    print_cpu_usage();
-                    break;
-                    
-                case 'a':
-                case 'A':
-                    printf("=== Option A: Report Analog ===\n");
-                    printf("Front Brake Pressure: %u\n", (logBuffer[F_BRAKEPRESSURE] << 8) | logBuffer[F_BRAKEPRESSURE1]);
-                    printf("Rear Brake Pressure:  %u\n", (logBuffer[R_BRAKEPRESSURE] << 8) | logBuffer[R_BRAKEPRESSURE1]);
-                    printf("Steering Position:    %u\n", (logBuffer[STEERING] << 8) | logBuffer[STEERING1]);
-                    printf("Front Left Shock:     %u\n", (logBuffer[FLSHOCK] << 8) | logBuffer[FLSHOCK1]);
-                    printf("Front Right Shock:    %u\n", (logBuffer[FRSHOCK] << 8) | logBuffer[FRSHOCK1]);
-                    printf("Rear Left Shock:      %u\n", (logBuffer[RLSHOCK] << 8) | logBuffer[RLSHOCK1]);
-                    printf("Rear Right Shock:     %u\n", (logBuffer[RRSHOCK] << 8) | logBuffer[RRSHOCK1]);
-                    break;
-                    
-                case 'd':
-                case 'D':
-                    if(!dtc_info_running && dtc_info_task_handle == NULL) {
-                        printf("=== Starting DTC Information Display ===\n");
-                        printf("Press any other key to stop...\n");
-                        vTaskDelay(pdMS_TO_TICKS(500));
-                        
-                        dtc_info_running = true;
-                        BaseType_t result = xTaskCreate(print_dtc_info, "dtc_info_display", 4096, NULL, 7, &dtc_info_task_handle);
-                        if (result != pdPASS) {
-                            ESP_LOGE(TAG, "Failed to create DTC info task");
-                            dtc_info_running = false;
-                        }
-                    } else if (dtc_info_running) {
-                        printf("=== Stopping DTC Information Display ===\n");
-                        dtc_info_running = false;
-                        // Wait for task to clean up
-                        while (dtc_info_task_handle != NULL) {
-                            vTaskDelay(pdMS_TO_TICKS(50));
-                        }
-                    } else {
-                        printf("DTC display is already starting/stopping...\n");
-                    }
-                    break;
+            wait = timeout - elapsed;
+        }
 
-                case 'f':
-                case 'F':
-                    printf("=== Option F: Change Log File Name ===\n");
-                    printf("Type your input and press Enter to submit, or ESC to cancel.\n");
-                    
-                    
-                    char user_input[MAX_FILE_NAME_LENGTH >> 1];
-                    esp_err_t input_result = uart_get_user_input(user_input, sizeof(user_input), "Input: ", 30000, true);
-                    
-                    switch (input_result) {
-                        case ESP_OK:
-                            nvs_set_log_name(user_input);
-                            nvs_set_testno(0);
-                            sdcard_create_numbered_log_file(user_input);
-                            printf("Starting new logfile: '%s'\n", sdcard_get_current_log_filename());
-                            break;
-                            
-                        case ESP_ERR_TIMEOUT:
-                            printf("Input timed out after 30 seconds.\n");
-                            break;
-                            
-                        case ESP_ERR_INVALID_RESPONSE:
-                            printf("Input cancelled by user (ESC pressed).\n");
-                            break;
-                            
-                        default:
-                            printf("Input failed with error: %s\n", esp_err_to_name(input_result));
-                            break;
+        int c = console_getc(wait);
+        if (c < 0) {
+            return ESP_ERR_TIMEOUT;
+        }
+
+        switch (c) {
+            case '\r':
+            case '\n':
+                buffer[index] = '\0';
+                if (echo) {
+                    printf("\n");
+                    fflush(stdout);
+                }
+                return ESP_OK;
+
+            case '\b':
+            case 127: // DEL key
+                if (index > 0) {
+                    index--;
+                    if (echo) {
+                        printf("\b \b");
+                        fflush(stdout);
                     }
-                    
-                    printf("Returning to command mode...\n");
-                    break;
-                case 'i':
-                case 'I':
-                    printf("=== Option I: Increment Log File ===\n");
-                    char buffer[32];
-                    nvs_get_log_name(buffer, sizeof(buffer));
-                    sdcard_create_numbered_log_file(buffer);
-                    printf("Starting new logfile: '%s'\n", sdcard_get_current_log_filename());
-                    break;
-                
-
-
-
-                case 'h':
-                case 'H':
-                case '?':
-                    printf("\n=== ESP32 UART Command Menu ===\n");
-                    printf("1 - Show system status\n");
-                    printf("2 - Toggle LED\n");
-                    printf("3 - Start CAN logging\n");
-                    printf("4 - Show memory info\n");
-                    printf("5 - Show CPU usage\n");
-                    printf("D - Toggle DTC info display\n");
-                    printf("F - Change log file name\n");
-                    printf("R - Restart system\n");
-                    printf("H - Show this help menu\n");
-                    printf("ESC - Clear screen\n");
-                    printf("================================\n");
-                    break;
-                case 'r':
-                case 'R':
-                    printf("=== Restarting ESP32 ===\n");
-                    vTaskDelay(pdMS_TO_TICKS(1000));
-                    esp_restart();
-                    break;
-                case 27: // ESC key
-                    printf("\033[2J\033[H"); // Clear screen and move cursor to top
-                    printf("Screen cleared!\n");
-                    break;
-                    
-                case '\r':
-                case '\n':
-                    // Ignore carriage return and newline
-                    break;
-                    
-                default:
-                    if (input >= 32 && input <= 126) { // Printable characters
-                        printf("Unknown command: '%c' (0x%02X)\n", input, input);
-                        printf("Type 'H' for help menu\n");
+                }
+                break;
+
+            case 0x15: // Ctrl-U
+                while (index > 0) {
+                    index--;
+                    if (echo) {
+                        printf("\b \b");
                     }
+                }
+                fflush(stdout);
+                break;
+
+            case 27: { // ESC: start of an escape sequence, or cancel on its own
+                int next = console_getc(pdMS_TO_TICKS(20));
+                if (next == '[') {
+                    // CSI sequence: parameters end at a byte in 0x40-0x7E
+                    do {
+                        next = console_getc(pdMS_TO_TICKS(20));
+                    } while (next >= 0 && (next < 0x40 || next > 0x7E));
                     break;
+                }
+                rx_pushback = next;
             }
+            /* fall through */
+            case 0x03: // Ctrl-C
+                buffer[0] = '\0';
+                if (echo) {
+                    printf("\n[Input cancelled]\n");
+                    fflush(stdout);
+                }
+                return ESP_ERR_INVALID_RESPONSE;
+
+            default:
+                // Only accept printable characters
+                if (c >= 32 && c <= 126) {
+                    if (index < buffer_size - 1) {
+                        buffer[index++] = c;
+                        if (echo) {
+                            putchar(c);
+                            fflush(stdout);
+                        }
+                    } else if (echo) {
+                        printf("\a"); // Line full
+                        fflush(stdout);
+                    }
+                }
+                break;
         }
     }
 }
 
-static void print_dtc_info(void *pvParameters) {
-    const TickType_t xFrequency = pdMS_TO_TICKS(500); // 500 ms
-    TickType_t xLastWakeTime = xTaskGetTickCount();
-    
-    char output_buffer[1000];
-    char temp[100];
+// Prompted line input for command handlers; runs on the console task
+esp_err_t uart_get_user_input(char *buffer, size_t buffer_size, const char *prompt, uint32_t timeout_ms, bool echo) {
+    if (buffer == NULL || buffer_size == 0) {
+        ESP_LOGE(TAG, "Invalid buffer parameters");
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    while(1){
-        // Check if task should continue running
-        if (!dtc_info_running) {
-            break; // Exit the task loop
-        }
-        
-        // Wait for the next cycle
-        vTaskDelayUntil(&xLastWakeTime, xFrequency);
+    if (prompt != NULL) {
+        printf("%s", prompt);
+        fflush(stdout);
+    }
+    esp_err_t ret = console_read_line(buffer, buffer_size, timeout_ms > 0 ? pdMS_TO_TICKS(timeout_ms) : portMAX_DELAY, echo);
+    if (ret == ESP_ERR_TIMEOUT) {
+        ESP_LOGW(TAG, "User input timeout");
+    }
+    return ret;
+}
 
-        printf("\033[2J\033[H"); // Clear screen and move cursor to top
-        size_t offset = snprintf(output_buffer, sizeof(output_buffer),
-            "\n=== DTC Information ===\n\n%-20s %-10s %10s\n===============================================\n",
-            "Device", "Status", "Time (ms)");
+static int split_args(char *line, char **argv) {
+    int argc = 0;
+    char *save;
+    for (char *tok = strtok_r(line, " \t", &save); tok != NULL && argc < CONSOLE_MAX_ARGS; tok = strtok_r(NULL, " \t", &save)) {
+        argv[argc++] = tok;
+    }
+    return argc;
+}
 
-        for (int i = 0; i < DTC_COUNT; i++) {
-            int written = snprintf(temp, sizeof(temp), "%-20s %-10s %10llu\n",
-                dtc_device_names[i] ? dtc_device_names[i] : "UNKNOWN",
-                dtc_devices[i] ? (dtc_devices[i]->errState ? "OK" : "ERROR") : "N/A",
-                dtc_devices[i] ? (pdMS_TO_TICKS(xTaskGetTickCount()) - dtc_devices[i]->prevTime) : 0);
+/* ---- Command handlers ---- */
 
-            if (offset + written < sizeof(output_buffer)) {
-                strncat(output_buffer, temp, sizeof(output_buffer) - offset - 1);
-                offset += written;
-            }
+static void cmd_help(int argc, char **argv) {
+    print_help();
+}
+
+static void cmd_status(int argc, char **argv) {
+    printf("System: Running\n");
+    printf("Free heap: %ld bytes\n", esp_get_free_heap_size());
+    printf("Uptime: %lld ms\n", esp_timer_get_time() / 1000);
+    printf("Log file: %s\n", sdcard_get_current_log_filename());
+}
+
+static void cmd_mem(int argc, char **argv) {
+    memmap_print();
+}
+
+static void cmd_cpu(int argc, char **argv) {
+    metrics_print_tasks();
+}
+
+static void cmd_metrics(int argc, char **argv) {
+    metrics_print();
+}
+
+static void cmd_tasks(int argc, char **argv) {
+    tasks_print();
+}
+
+static void cmd_jitter(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        metrics_reset_jitter();
+        printf("Sampler jitter cleared\n");
+        return;
+    }
+    metrics_print_jitter();
+}
+
+static void cmd_prof(int argc, char **argv) {
+    if (argc < 2 || strcmp(argv[1], "show") == 0) {
+        prof_print();
+        printf("Trace: %s\n", prof_trace_enabled() ? "on" : "off");
+    } else if (strcmp(argv[1], "reset") == 0) {
+        prof_reset();
+        printf("Stage profile cleared\n");
+    } else if (strcmp(argv[1], "trace") == 0 && argc > 2 &&
+               (strcmp(argv[2], "on") == 0 || strcmp(argv[2], "off") == 0)) {
+        prof_trace_enable(strcmp(argv[2], "on") == 0);
+        printf("Profile trace %s (<log>%s)\n", prof_trace_enabled() ? "on" : "off", PROF_TRACE_SUFFIX);
+    } else {
+        printf("Usage: prof [show|reset|trace on|off]\n");
+    }
+}
+
+static void cmd_trace(int argc, char **argv) {
+    if (argc < 2 || strcmp(argv[1], "status") == 0) {
+        trace_print_status();
+    } else if (strcmp(argv[1], "start") == 0) {
+        esp_err_t err = trace_start();
+        if (err != ESP_OK) {
+            printf("Trace not started: %s\n", esp_err_to_name(err));
         }
-        strcat(output_buffer, "===============================================\n");
-        printf("%s", output_buffer);
+    } else if (strcmp(argv[1], "stop") == 0) {
+        trace_stop();
+        trace_print_status();
+    } else if (strcmp(argv[1], "save") == 0) {
+        esp_err_t err = trace_save();
+        if (err != ESP_OK) {
+            printf("Trace not saved: %s\n", esp_err_to_name(err));
+        }
+    } else if (strcmp(argv[1], "dump") == 0) {
+        trace_dump_hex();
+    } else {
+        printf("Usage: trace [start|stop|status|save|dump]\n");
     }
+}
 
-    // Task is ending, clean up
-    dtc_info_task_handle = NULL;
-    vTaskDelete(NULL);
+static void cmd_analog(int argc, char **argv) {
+    printf("Front Brake Pressure: %u\n", (logBuffer[F_BRAKEPRESSURE] << 8) | logBuffer[F_BRAKEPRESSURE1]);
+    printf("Rear Brake Pressure:  %u\n", (logBuffer[R_BRAKEPRESSURE] << 8) | logBuffer[R_BRAKEPRESSURE1]);
+    printf("Steering Position:    %u\n", (logBuffer[STEERING] << 8) | logBuffer[STEERING1]);
+    printf("Front Left Shock:     %u\n", (logBuffer[FLSHOCK] << 8) | logBuffer[FLSHOCK1]);
+    printf("Front Right Shock:    %u\n", (logBuffer[FRSHOCK] << 8) | logBuffer[FRSHOCK1]);
+    printf("Rear Left Shock:      %u\n", (logBuffer[RLSHOCK] << 8) | logBuffer[RLSHOCK1]);
+    printf("Rear Right Shock:     %u\n", (logBuffer[RRSHOCK] << 8) | logBuffer[RRSHOCK1]);
 }
 
-static void print_cpu_usage(void) {
-    TaskStatus_t *pxTaskStatusArray;
-    volatile UBaseType_t uxArraySize, x;
-    uint64_t ulTotalTime, ulStatsAsPercentage;
-    
-    // Get number of tasks
-    uxArraySize = uxTaskGetNumberOfTasks();
-    
-    // Allocate array for task status
-    pxTaskStatusArray = pvPortMalloc(uxArraySize * sizeof(TaskStatus_t));
-    
-    if (pxTaskStatusArray != NULL) {
-        // Generate the status information
-        uxArraySize = uxTaskGetSystemState(pxTaskStatusArray, uxArraySize, &ulTotalTime);
-        
-        // Check if we have valid timing data
-        if (ulTotalTime == 0) {
-            printf("Error: No timing data available. Enable FreeRTOS runtime stats.\n");
-            vPortFree(pxTaskStatusArray);
+static void cmd_dtc(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "stats") == 0) {
+        DTC_Print_Stats();
+        return;
+    }
+    if (argc > 1 && strcmp(argv[1], "live") != 0) {
+        printf("Usage: dtc [live|stats]\n");
+        return;
+    }
+    if (dtc_info_active) {
+        printf("DTC display is already running\n");
+        return;
+    }
+
+    // The console task stops the display on the next key press
+    printf("=== Starting DTC Information Display ===\n");
+    printf("Press any key to stop...\n");
+    dtc_info_running = true;
+    dtc_info_active = true;
+    if (dtc_info_task_handle != NULL) {
+        xTaskNotifyGive(dtc_info_task_handle);
+    } else if (tasks_create(TASK_DTC_INFO, print_dtc_info, NULL, &dtc_info_task_handle) != ESP_OK) {
+        dtc_info_running = false;
+        dtc_info_active = false;
+    }
+}
+
+static void start_log_file(const char *name) {
+    nvs_set_log_name(name);
+    nvs_set_testno(0);
+    sdcard_create_numbered_log_file(name);
+    printf("Starting new logfile: '%s'\n", sdcard_get_current_log_filename());
+}
+
+static void cmd_file(int argc, char **argv) {
+    if (argc < 2 || strcmp(argv[1], "show") == 0) {
+        printf("Current log file: %s\n", sdcard_get_current_log_filename());
+    } else if (strcmp(argv[1], "name") == 0) {
+        if (argc > 2) {
+            start_log_file(argv[2]);
             return;
         }
-        
-        printf("\nTask Name\t\tRun Time\t\tPercentage\n");
-        printf("==============================================\n");
-        
-        // Find IDLE task runtime (CPU downtime)
-        uint64_t idle_time = 0;
-        
-        for (x = 0; x < uxArraySize; x++) {
-            if (strstr(pxTaskStatusArray[x].pcTaskName, "IDLE") != NULL) {
-                idle_time = pxTaskStatusArray[x].ulRunTimeCounter;
-            }
-            
-            // Calculate percentage with safety check
-            ulStatsAsPercentage = (pxTaskStatusArray[x].ulRunTimeCounter * 100ULL) / ulTotalTime;
-            
-            printf("%s\t\t%llu\t\t%llu%%\n", 
-                   pxTaskStatusArray[x].pcTaskName, 
-                   pxTaskStatusArray[x].ulRunTimeCounter, 
-                   ulStatsAsPercentage);
+        char user_input[MAX_FILE_NAME_LENGTH >> 1];
+        esp_err_t input_result = uart_get_user_input(user_input, sizeof(user_input), "Name: ", 30000, true);
+        if (input_result == ESP_OK && user_input[0] != '\0') {
+            start_log_file(user_input);
+        } else if (input_result == ESP_ERR_TIMEOUT) {
+            printf("Input timed out after 30 seconds.\n");
         }
+    } else if (strcmp(argv[1], "next") == 0) {
+        char buffer[32];
+        nvs_get_log_name(buffer, sizeof(buffer));
+        sdcard_create_numbered_log_file(buffer);
+        printf("Starting new logfile: '%s'\n", sdcard_get_current_log_filename());
+    } else {
+        printf("Usage: file [show|name <name>|next]\n");
+    }
+}
 
-        uint64_t idle_percentage = (idle_time * 100ULL) / ulTotalTime;
-        printf("\nTotal CPU Idle Time: %" PRIu64 " ticks (%" PRIu64 "%%)\n", idle_time, idle_percentage);
-        printf("Total Runtime: %llu ticks\n", ulTotalTime);
-        
-        vPortFree(pxTaskStatusArray);
+static void cmd_gate(int argc, char **argv) {
+    if (argc < 2 || strcmp(argv[1], "list") == 0) {
+        laptimer_print_summary();
+    } else if (strcmp(argv[1], "add") == 0) {
+        if (GNSS_Handle.fixType < 2) {
+            printf("No GNSS fix - cannot place gate\n");
+            return;
+        }
+        if (laptimer_add_gate(GNSS_Handle.lat, GNSS_Handle.lon, GNSS_Handle.fCourse) == ESP_OK) {
+            printf("Gate added at %.7f, %.7f facing %.1f deg\n", GNSS_Handle.fLat, GNSS_Handle.fLon, GNSS_Handle.fCourse);
+        }
+    } else if (strcmp(argv[1], "clear") == 0) {
+        laptimer_clear_gates();
+        printf("All lap gates cleared\n");
     } else {
-        printf("Error: Failed to allocate memory for task status array\n");
+        printf("Usage: gate [list|add|clear]\n");
     }
 }
 
-esp_err_t uart_get_user_input(char *buffer, size_t buffer_size, const char *prompt, uint32_t timeout_ms, bool echo) {
-    if (buffer == NULL || buffer_size == 0) {
-        ESP_LOGE(TAG, "Invalid buffer parameters");
-        return ESP_ERR_INVALID_ARG;
+static void cmd_laps(int argc, char **argv) {
+    laptimer_print_summary();
+}
+
+static void cmd_stream(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "stop") == 0) {
+        telemetry_stop();
+        return;
     }
-        // Subscribe current task to TWDT for this function
-    bool was_subscribed = (esp_task_wdt_status(NULL) == ESP_OK);
-    if (!was_subscribed) {
-        esp_task_wdt_add(NULL);  // Add current task
+
+    // Re-join the arguments: "<rate_hz> [CH,CH,...]"
+    char config[TELEMETRY_CONFIG_LENGTH] = "";
+    for (int i = 1; i < argc; i++) {
+        strncat(config, argv[i], sizeof(config) - strlen(config) - 2);
+        strcat(config, " ");
     }
-    
-    // Clear the buffer
-    memset(buffer, 0, buffer_size);
-    
-    // Show prompt if provided
-    if (prompt != NULL) {
-        printf("%s", prompt);
-        fflush(stdout);
+
+    printf("Switching to %d baud; receive with tools/telemetry_rx, send 'T' to stop.\n", TELEMETRY_BAUD);
+    esp_err_t err = telemetry_start(config);
+    if (err != ESP_OK) {
+        printf("Telemetry not started: %s\n", esp_err_to_name(err));
     }
-    
-    size_t index = 0;
-    TickType_t start_time = xTaskGetTickCount();
-    TickType_t timeout_ticks = pdMS_TO_TICKS(timeout_ms);
-    
-    // Enable input mode for better character handling
-    if (char_mutex != NULL) {
-        xSemaphoreTake(char_mutex, portMAX_DELAY);
-        uart_input_mode = true;
-        input_buffer_char = '\0';  // Clear input buffer
-        last_char = '\0';  // Clear last_char to prevent interference
-        xSemaphoreGive(char_mutex);
+}
+
+static void cmd_stat(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "can") == 0) {
+        can_stats_t stats;
+        can_get_stats(&stats);
+        printf("CAN frames received: %lu\n", (unsigned long)stats.rx_frames);
+        printf("CAN frames dropped:  %lu\n", (unsigned long)stats.rx_dropped);
+        printf("CAN overruns:        %lu\n", (unsigned long)stats.rx_overruns);
+        printf("RX queue high water: %lu\n", (unsigned long)stats.rx_max_queued);
+    } else if (argc > 1 && strcmp(argv[1], "dtc") == 0) {
+        DTC_Print_Stats();
+    } else if (argc > 1 && strcmp(argv[1], "console") == 0) {
+        printf("Console bytes dropped: %lu\n", (unsigned long)console_dropped);
+    } else if (argc > 1 && strcmp(argv[1], "log") == 0) {
+        dlog_stats_t stats;
+        dlog_get_stats(&stats);
+        printf("Deferred log entries:   %lu\n", (unsigned long)stats.written);
+        printf("Printed:                %lu\n", (unsigned long)stats.printed);
+        printf("Suppressed (rate/dup):  %lu\n", (unsigned long)stats.suppressed);
+        printf("Dropped (ring full):    %lu\n", (unsigned long)stats.dropped);
+        printf("Ring peak:              %u of %d\n", stats.ring_peak, DLOG_RING_LEN);
+    } else if (argc > 1 && strcmp(argv[1], "boot") == 0) {
+        log_ring_stats_t stats;
+        log_ring_get_stats(&stats);
+        printf("Boot to first sample:   %lu ms\n", (unsigned long)stats.first_sample_ms);
+        printf("Boot to storage ready:  %lu ms%s\n", (unsigned long)stats.storage_ready_ms,
+               stats.storage_ready_ms == 0 ? " (mounting)" : stats.storage_ok ? "" : " (no card)");
+        printf("Buffered until ready:   %lu records\n", (unsigned long)stats.buffered);
+        printf("Dropped (ring full):    %lu\n", (unsigned long)stats.dropped);
+        printf("Ring peak:              %lu of %d\n", (unsigned long)stats.peak, LOG_RING_RECORDS);
+        printf("Waiting now:            %lu\n", (unsigned long)stats.waiting);
+    } else {
+        printf("Usage: stat can|dtc|console|log|boot\n");
     }
-    
+}
+
+static void cmd_ls(int argc, char **argv) {
+    filexfer_list();
+}
+
+static void cmd_xfer(int argc, char **argv) {
+    esp_err_t err = filexfer_run();
+    if (err != ESP_OK) {
+        printf("File transfer failed: %s\n", esp_err_to_name(err));
+    }
+}
+
+static void cmd_clear(int argc, char **argv) {
+    printf("\033[2J\033[H"); // Clear screen and move cursor to top
+}
+
+static void cmd_restart(int argc, char **argv) {
+    printf("=== Restarting ESP32 ===\n");
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    esp_restart();
+}
+
+static const console_cmd_t console_commands[] = {
+    {"help",    "h", "",                       "Show this help", cmd_help},
+    {"status",  "1", "",                       "Show system status", cmd_status},
+    {"mem",     "4", "",                       "RAM budget per subsystem and heap", cmd_mem},
+    {"cpu",     "5", "",                       "Per-task CPU and stack over the last second", cmd_cpu},
+    {"metrics", "m", "",                       "Performance counters and task health", cmd_metrics},
+    {"tasks",   NULL, "",                      "Task table: core, priority, stack", cmd_tasks},
+    {"jitter",  NULL, "[reset]",               "Sampler period error p50/p99/max", cmd_jitter},
+    {"prof",    "p", "[show|reset|trace on|off]", "Per-stage cycle histograms", cmd_prof},
+    {"trace",   NULL, "[start|stop|status|save|dump]", "Event trace for tools/trace_export", cmd_trace},
+    {"analog",  "a", "",                       "Report analog channels", cmd_analog},
+    {"dtc",     "d", "[live|stats]",           "DTC live display or jitter statistics", cmd_dtc},
+    {"file",    "f", "[show|name <name>|next]", "Show, rename or increment the log file", cmd_file},
+    {"gate",    "g", "[list|add|clear]",       "Lap gates (first added = start/finish)", cmd_gate},
+    {"laps",    "l", "",                       "Show lap timing", cmd_laps},
+    {"stream",  "t", "<rate_hz> [CH,...]|stop", "Binary telemetry stream (no args = last config)", cmd_stream},
+    {"stat",    NULL, "can|dtc|console|log|boot", "Subsystem counters", cmd_stat},
+    {"ls",      NULL, "",                      "List files on the SD card", cmd_ls},
+    {"xfer",    NULL, "",                      "Binary file download mode (tools/benji_fetch)", cmd_xfer},
+    {"clear",   NULL, "",                      "Clear screen", cmd_clear},
+    {"restart", "r", "",                       "Restart system", cmd_restart},
+};
+#define CONSOLE_COMMAND_COUNT (sizeof(console_commands) / sizeof(console_commands[0]))
+
+static void print_help(void) {
+    printf("\n=== ESP32 Console Commands ===\n");
+    for (size_t i = 0; i < CONSOLE_COMMAND_COUNT; i++) {
+        const console_cmd_t *cmd = &console_commands[i];
+        printf("%-8s %-3s %-26s %s\n", cmd->name, cmd->alias ? cmd->alias : "", cmd->args, cmd->help);
+    }
+    printf("================================\n");
+}
+
+static void console_dispatch(char *line) {
+    char *argv[CONSOLE_MAX_ARGS];
+    int argc = split_args(line, argv);
+    if (argc == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < CONSOLE_COMMAND_COUNT; i++) {
+        const console_cmd_t *cmd = &console_commands[i];
+        if (strcasecmp(argv[0], cmd->name) == 0 || (cmd->alias != NULL && strcasecmp(argv[0], cmd->alias) == 0)) {
+            cmd->handler(argc, argv);
+            return;
+        }
+    }
+    printf("Unknown command: '%s'\n", argv[0]);
+    printf("Type 'help' for the command list\n");
+}
+
+/**
+ * @brief Console task: line editing and command dispatch
+ *
+ * Blocks on the console stream buffer, so it only runs when bytes arrive.
+ * While the binary telemetry stream or the DTC live display owns the
+ * terminal, single raw bytes control them instead of the line editor.
+ */
+void uart_console_task(void *param) {
+    static char line[CONSOLE_LINE_LENGTH];
+
+    ESP_LOGI(TAG, "Console task started");
+    print_help();
+
     while (1) {
-        esp_task_wdt_reset();
-        // Check for timeout
-        if (timeout_ms > 0 && (xTaskGetTickCount() - start_time) > timeout_ticks) {
-            ESP_LOGW(TAG, "User input timeout");
-            // Disable input mode before returning
-            if (char_mutex != NULL) {
-                xSemaphoreTake(char_mutex, portMAX_DELAY);
-                uart_input_mode = false;
-                xSemaphoreGive(char_mutex);
+        if (telemetry_active()) {
+            int c = console_getc(portMAX_DELAY);
+            if (c == 't' || c == 'T') {
+                telemetry_stop();
             }
-            return ESP_ERR_TIMEOUT;
+            continue;
         }
-        
-        // Get character from the input buffer
-        char ch = '\0';
-        if (char_mutex != NULL) {
-            xSemaphoreTake(char_mutex, portMAX_DELAY);
-            if (input_buffer_char != '\0') {
-                ch = input_buffer_char;
-                input_buffer_char = '\0';  // Consume the character
-            }
-            xSemaphoreGive(char_mutex);
+        if (dtc_info_active) {
+            console_getc(portMAX_DELAY);
+            dtc_info_running = false;
+            xTaskNotifyGive(dtc_info_task_handle);
+            // Don't print over a frame the display task is still writing
+            xSemaphoreTake(dtc_info_parked, portMAX_DELAY);
+            printf("\033[2J\033[H=== Stopped DTC Information Display ===\n");
+            continue;
         }
-        
-        if (ch != '\0') {
-            switch (ch) {
-                case '\r':  // Carriage return
-                case '\n':  // Line feed (Enter key)
-                    if (echo) {
-                        printf("\n");
-                        fflush(stdout);
-                    }
-                    buffer[index] = '\0';  // Null terminate
-                    ESP_LOGD(TAG, "User input received: '%s' (length: %zu)", buffer, index);
-                    
-                    // Disable input mode before returning
-                    if (char_mutex != NULL) {
-                        xSemaphoreTake(char_mutex, portMAX_DELAY);
-                        uart_input_mode = false;
-                        xSemaphoreGive(char_mutex);
-                    }
-                    // Cleanup: unsubscribe if we subscribed
-                    if (!was_subscribed) {
-                        esp_task_wdt_delete(NULL);
-                    }
-                    return ESP_OK;
-                    
-                case '\b':  // Backspace
-                case 127:   // DEL key
-                    if (index > 0) {
-                        index--;
-                        buffer[index] = '\0';
-                        if (echo) {
-                            printf("\b \b");  // Move back, print space, move back again
-                            fflush(stdout);
-                        }
-                    }
-                    break;
-                    
-                case 27:    // ESC key - cancel input
-                    if (echo) {
-                        printf("\n[Input cancelled]\n");
-                        fflush(stdout);
-                    }
-                    buffer[0] = '\0';
-                    
-                    // Disable input mode before returning
-                    if (char_mutex != NULL) {
-                        xSemaphoreTake(char_mutex, portMAX_DELAY);
-                        uart_input_mode = false;
-                        xSemaphoreGive(char_mutex);
-                    }
-                    // Cleanup: unsubscribe if we subscribed
-                    if (!was_subscribed) {
-                        esp_task_wdt_delete(NULL);
-                    }
-                    return ESP_ERR_INVALID_RESPONSE;
-                    
-                default:
-                    // Only accept printable characters
-                    if (ch >= 32 && ch <= 126) {
-                        if (index < buffer_size - 1) {  // Leave room for null terminator
-                            buffer[index] = ch;
-                            index++;
-                            if (echo) {
-                                printf("%c", ch);
-                                fflush(stdout);
-                            }
-                        } else {
-                            // Buffer full - beep or indicate error
-                            if (echo) {
-                                printf("\a");  // Bell character
-                                fflush(stdout);
-                            }
-                            ESP_LOGW(TAG, "Input buffer full");
-                        }
-                    }
-                    break;
-            }
+
+        printf("> ");
+        fflush(stdout);
+        if (console_read_line(line, sizeof(line), portMAX_DELAY, true) == ESP_OK) {
+            console_dispatch(line);
         }
-        
-        // Small delay to prevent excessive CPU usage
-        vTaskDelay(pdMS_TO_TICKS(5));  // 5ms delay for responsive input
     }
 }
 
-// Utility functions
-char uart_get_last_char(void) {
-    char ch = '\0';
-    if (char_mutex != NULL) {
-        xSemaphoreTake(char_mutex, portMAX_DELAY);
-        ch = last_char;
-        xSemaphoreGive(char_mutex);
-    }
-    return ch;
-}
+static void print_dtc_info(void *pvParameters) {
+    const TickType_t xFrequency = pdMS_TO_TICKS(500); // 500 ms
+    
+    char output_buffer[1000];
+    char temp[100];
+
+    while(1){
+        // Check if the display should continue; park until the next 'dtc live' if not
+        if (!dtc_info_running) {
+            dtc_info_active = false;
+            xSemaphoreGive(dtc_info_parked);
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        
+        // Wait for the next cycle; the console task notifies to stop early
+        ulTaskNotifyTake(pdTRUE, xFrequency);
+        if (!dtc_info_running) {
+            continue;
+        }
+
+        printf("\033[2J\033[H"); // Clear screen and move cursor to top
+        size_t offset = snprintf(output_buffer, sizeof(output_buffer),
+            "\n=== DTC Information ===\n\n%-20s %-10s %10s\n===============================================\n",
+            "Device", "Status", "Time (ms)");
 
-void uart_clear_last_char(void) {
-    if (char_mutex != NULL) {
-        xSemaphoreTake(char_mutex, portMAX_DELAY);
-        last_char = '\0';
-        xSemaphoreGive(char_mutex);
+        for (int i = 0; i < DTC_COUNT; i++) {
+            int written = snprintf(temp, sizeof(temp), "%-20s %-10s %10llu\n",
+                dtc_device_names[i] ? dtc_device_names[i] : "UNKNOWN",
+                dtc_devices[i] ? (dtc_devices[i]->errState ? "OK" : "ERROR") : "N/A",
+                dtc_devices[i] ? (DTC_Now_Ms() - dtc_devices[i]->prevTime) : 0);
+
+            if (offset + written < sizeof(output_buffer)) {
+                strncat(output_buffer, temp, sizeof(output_buffer) - offset - 1);
+                offset += written;
+            }
+        }
+        strcat(output_buffer, "===============================================\n");
+        printf("%s", output_buffer);
     }
 }
 
 void uart_deinit(void) {
-    if (char_mutex != NULL) {
-        vSemaphoreDelete(char_mutex);
-        char_mutex = NULL;
-    }
-    
     if (uart_event_queue != NULL) {
         uart_driver_delete(UART_PORT);
         uart_event_queue = NULL;
     }
+
+    if (console_stream != NULL) {
+        vStreamBufferDelete(console_stream);
+        console_stream = NULL;
+    }
     
     ESP_LOGI(TAG, "UART module deinitialized");
-}
\ No newline at end of file
+}
@@ -4,8 +4,8 @@
 #include <stdint.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/semphr.h"
 #include "freertos/queue.h"
+#include "freertos/stream_buffer.h"
 #include "esp_err.h"
 
 #ifdef __cplusplus
@@ -17,23 +17,32 @@ extern "C" {
 #define UART_BUF_SIZE 1024
 #define RD_BUF_SIZE 128
 #define MAX_INPUT_LENGTH 128
+#define CONSOLE_STREAM_SIZE 512  // Bytes buffered between the UART event task and the console task
+#define CONSOLE_LINE_LENGTH 256
+#define CONSOLE_MAX_ARGS 8
+#define CONSOLE_RX_TIMEOUT_SYMBOLS 2 // Idle symbols before the driver posts UART_DATA (~0.2 ms at 115200)
 
 // External variables
-extern SemaphoreHandle_t char_mutex;
 extern QueueHandle_t uart_event_queue;
 
+// Console command: argv[0] is the command name as typed
+typedef struct {
+    const char *name;
+    const char *alias; // Short form, NULL if none
+    const char *args;  // Usage shown by help
+    const char *help;
+    void (*handler)(int argc, char **argv);
+} console_cmd_t;
+
 // Function declarations
 esp_err_t uart_init(void);
 void uart_input_task(void *pvParameters);
-void uart_output_task(void *param);
+void uart_console_task(void *param);
 esp_err_t uart_create_tasks(void);
+size_t uart_console_read(uint8_t *buf, size_t len, TickType_t wait);
 esp_err_t uart_get_user_input(char *buffer, size_t buffer_size, const char *prompt, uint32_t timeout_ms, bool echo);
 void uart_deinit(void);
 
-// Utility functions
-char uart_get_last_char(void);
-void uart_clear_last_char(void);
-
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,485 @@
+#include "benji_columnar.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BENJI_HAVE_AVX2_KERNELS 1
+#endif
+
+namespace benji {
+
+namespace {
+
+constexpr size_t kBlockRows = 4096; // Row block per work item; ~650 KB of records, stays in L2
+
+// Min/max are tracked on (value ^ bias), bias being the sign bit of a signed
+// column, so one unsigned comparison orders signed and unsigned columns alike
+struct Accum {
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+
+    void push(uint64_t biased) {
+        min = std::min(min, biased);
+        max = std::max(max, biased);
+    }
+    void merge(const Accum &o) {
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+    }
+};
+
+struct Column {
+    const uint8_t *src;   // Channel bytes of record 0
+    uint8_t source_width;
+    uint8_t width;
+    bool is_signed;
+    uint64_t mask;        // Stored width
+    uint64_t bias;
+    size_t gather_rows;   // Rows a 4/8-byte gather may read without running off the mapping
+    uint8_t *dest;
+};
+
+uint64_t sign_extend(uint64_t v, unsigned bits) {
+    if (bits < 64 && (v >> (bits - 1)) & 1) {
+        v |= ~0ULL << bits;
+    }
+    return v;
+}
+
+inline void store(uint8_t *dest, size_t row, uint8_t width, uint64_t v) {
+    switch (width) {
+        case 1:
+            dest[row] = static_cast<uint8_t>(v);
+            break;
+        case 2: {
+            uint16_t x = static_cast<uint16_t>(v);
+            std::memcpy(dest + row * 2, &x, 2);
+            break;
+        }
+        case 4: {
+            uint32_t x = static_cast<uint32_t>(v);
+            std::memcpy(dest + row * 4, &x, 4);
+            break;
+        }
+        default:
+            std::memcpy(dest + row * 8, &v, 8);
+            break;
+    }
+}
+
+inline void convert_one(const Column &c, const uint8_t *p, size_t row, Accum &acc) {
+    uint64_t v = load_be(p, c.source_width);
+    if (c.is_signed) {
+        v = sign_extend(v, c.source_width * 8u);
+    }
+    v &= c.mask;
+    store(c.dest, row, c.width, v);
+    acc.push(v ^ c.bias);
+}
+
+void column_scalar(const Column &c, size_t stride, size_t r0, size_t n, Accum &acc) {
+    const uint8_t *p = c.src + r0 * stride;
+    for (size_t i = 0; i < n; i++, p += stride) {
+        convert_one(c, p, r0 + i, acc);
+    }
+}
+
+#ifdef BENJI_HAVE_AVX2_KERNELS
+
+// Each kernel converts whole vectors only and returns the rows it handled;
+// the scalar path finishes the remainder
+
+__attribute__((target("avx2"))) size_t gather_u32(const Column &c, size_t stride, size_t r0, size_t n, Accum &acc) {
+    const __m256i idx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                           _mm256_set1_epi32(static_cast<int>(stride)));
+    const __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                          3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    const __m256i bias = _mm256_set1_epi32(static_cast<int>(static_cast<uint32_t>(c.bias)));
+    __m256i vmin = _mm256_set1_epi32(-1);
+    __m256i vmax = _mm256_setzero_si256();
+    const uint8_t *p = c.src + r0 * stride;
+    uint32_t *out = reinterpret_cast<uint32_t *>(c.dest) + r0;
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8, p += 8 * stride) {
+        __m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int *>(p), idx, 1);
+        v = _mm256_shuffle_epi8(v, swap);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), v);
+        __m256i b = _mm256_xor_si256(v, bias);
+        vmin = _mm256_min_epu32(vmin, b);
+        vmax = _mm256_max_epu32(vmax, b);
+    }
+    if (i > 0) {
+        alignas(32) uint32_t lo[8], hi[8];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(lo), vmin);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(hi), vmax);
+        for (int k = 0; k < 8; k++) {
+            acc.push(lo[k]);
+            acc.push(hi[k]);
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t gather_u16(const Column &c, size_t stride, size_t r0, size_t n, Accum &acc) {
+    const __m256i idx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                           _mm256_set1_epi32(static_cast<int>(stride)));
+    // Swap the two channel bytes of each gathered word and pack them into the low 8 bytes of each lane
+    const __m256i swap = _mm256_setr_epi8(1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          1, 0, 5, 4, 9, 8, 13, 12, -1, -1, -1, -1, -1, -1, -1, -1);
+    const __m128i bias = _mm_set1_epi16(static_cast<short>(static_cast<uint16_t>(c.bias)));
+    __m128i vmin = _mm_set1_epi16(-1);
+    __m128i vmax = _mm_setzero_si128();
+    const uint8_t *p = c.src + r0 * stride;
+    uint16_t *out = reinterpret_cast<uint16_t *>(c.dest) + r0;
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8, p += 8 * stride) {
+        __m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int *>(p), idx, 1);
+        v = _mm256_shuffle_epi8(v, swap);
+        __m128i r = _mm256_castsi256_si128(_mm256_permute4x64_epi64(v, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), r);
+        __m128i b = _mm_xor_si128(r, bias);
+        vmin = _mm_min_epu16(vmin, b);
+        vmax = _mm_max_epu16(vmax, b);
+    }
+    if (i > 0) {
+        alignas(16) uint16_t lo[8], hi[8];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lo), vmin);
+        _mm_store_si128(reinterpret_cast<__m128i *>(hi), vmax);
+        for (int k = 0; k < 8; k++) {
+            acc.push(lo[k]);
+            acc.push(hi[k]);
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t gather_u8(const Column &c, size_t stride, size_t r0, size_t n, Accum &acc) {
+    const __m256i idx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                           _mm256_set1_epi32(static_cast<int>(stride)));
+    const __m256i pick = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                          0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    // Both halves of the 128-bit result hold the same 8 bytes, so min/max need no masking
+    const __m256i join = _mm256_setr_epi32(0, 4, 0, 4, 0, 4, 0, 4);
+    const __m128i bias = _mm_set1_epi8(static_cast<char>(static_cast<uint8_t>(c.bias)));
+    __m128i vmin = _mm_set1_epi8(-1);
+    __m128i vmax = _mm_setzero_si128();
+    const uint8_t *p = c.src + r0 * stride;
+    uint8_t *out = c.dest + r0;
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8, p += 8 * stride) {
+        __m256i v = _mm256_i32gather_epi32(reinterpret_cast<const int *>(p), idx, 1);
+        v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, pick), join);
+        __m128i r = _mm256_castsi256_si128(v);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i), r);
+        __m128i b = _mm_xor_si128(r, bias);
+        vmin = _mm_min_epu8(vmin, b);
+        vmax = _mm_max_epu8(vmax, b);
+    }
+    if (i > 0) {
+        alignas(16) uint8_t lo[16], hi[16];
+        _mm_store_si128(reinterpret_cast<__m128i *>(lo), vmin);
+        _mm_store_si128(reinterpret_cast<__m128i *>(hi), vmax);
+        for (int k = 0; k < 8; k++) {
+            acc.push(lo[k]);
+            acc.push(hi[k]);
+        }
+    }
+    return i;
+}
+
+__attribute__((target("avx2"))) size_t gather_u64(const Column &c, size_t stride, size_t r0, size_t n, Accum &acc) {
+    const long long s = static_cast<long long>(stride);
+    const __m256i idx = _mm256_setr_epi64x(0, s, 2 * s, 3 * s);
+    const __m256i swap = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+                                          7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const uint8_t *p = c.src + r0 * stride;
+    uint64_t *out = reinterpret_cast<uint64_t *>(c.dest) + r0;
+
+    // AVX2 has no unsigned 64-bit min/max; the values are reduced from the stored output
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, p += 4 * stride) {
+        __m256i v = _mm256_i64gather_epi64(reinterpret_cast<const long long *>(p), idx, 1);
+        v = _mm256_shuffle_epi8(v, swap);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), v);
+    }
+    for (size_t k = 0; k < i; k++) {
+        acc.push(out[k] ^ c.bias);
+    }
+    return i;
+}
+
+size_t column_simd(const Column &c, size_t stride, size_t r0, size_t n, Accum &acc) {
+    if (c.source_width != c.width || r0 >= c.gather_rows) {
+        return 0; // Odd widths need sign extension or padding: scalar only
+    }
+    n = std::min(n, c.gather_rows - r0);
+    switch (c.width) {
+        case 1:
+            return gather_u8(c, stride, r0, n, acc);
+        case 2:
+            return gather_u16(c, stride, r0, n, acc);
+        case 4:
+            return gather_u32(c, stride, r0, n, acc);
+        default:
+            return gather_u64(c, stride, r0, n, acc);
+    }
+}
+
+#else
+
+size_t column_simd(const Column &, size_t, size_t, size_t, Accum &) {
+    return 0;
+}
+
+#endif
+
+std::runtime_error sys_error(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+size_t align_up(size_t v) {
+    return (v + kColumnAlign - 1) & ~(kColumnAlign - 1);
+}
+
+} // namespace
+
+bool simd_available() {
+#ifdef BENJI_HAVE_AVX2_KERNELS
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+std::vector<ColumnSpec> column_specs(const Schema &schema, const std::string &channels, const std::string &signed_list) {
+    std::vector<Channel> selected = schema.select(channels);
+    std::vector<Channel> signed_channels = signed_list.empty() ? std::vector<Channel>() : schema.select(signed_list);
+
+    std::vector<ColumnSpec> specs;
+    for (const Channel &ch : selected) {
+        bool is_signed = std::any_of(signed_channels.begin(), signed_channels.end(),
+                                     [&](const Channel &s) { return s.offset == ch.offset; });
+        specs.push_back(ColumnSpec{ch, is_signed});
+    }
+    return specs;
+}
+
+std::vector<ColumnStats> transpose(const Log &log, const std::vector<ColumnSpec> &columns,
+                                   const std::vector<void *> &dest, Transpose method, unsigned threads) {
+    if (dest.size() != columns.size()) {
+        throw std::invalid_argument("transpose: one destination per column");
+    }
+    const size_t stride = log.schema().record_size();
+    const size_t rows = log.record_count();
+    const size_t mapped = rows * stride + log.trailing_bytes();
+
+    std::vector<Column> cols;
+    for (size_t i = 0; i < columns.size(); i++) {
+        const Channel &ch = columns[i].channel;
+        Column c;
+        c.src = log.records_begin() + ch.offset;
+        c.source_width = ch.width;
+        c.width = storage_width(ch.width);
+        c.is_signed = columns[i].is_signed;
+        c.mask = c.width == 8 ? ~0ULL : (1ULL << (c.width * 8)) - 1;
+        c.bias = c.is_signed ? 1ULL << (c.width * 8 - 1) : 0;
+        size_t read = c.width < 4 ? 4 : c.width; // u8/u16 gathers load a whole 32-bit word
+        c.gather_rows = mapped >= ch.offset + read ? (mapped - ch.offset - read) / stride + 1 : 0;
+        c.dest = static_cast<uint8_t *>(dest[i]);
+        cols.push_back(c);
+    }
+
+    const bool simd = method == Transpose::Simd && simd_available();
+    const size_t blocks = (rows + kBlockRows - 1) / kBlockRows;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, blocks)));
+
+    std::atomic<size_t> next_block{0};
+    std::vector<std::vector<Accum>> partial(threads, std::vector<Accum>(cols.size()));
+
+    auto worker = [&](unsigned t) {
+        std::vector<Accum> &acc = partial[t];
+        for (size_t b; (b = next_block.fetch_add(1, std::memory_order_relaxed)) < blocks;) {
+            size_t r0 = b * kBlockRows;
+            size_t n = std::min(kBlockRows, rows - r0);
+            if (method == Transpose::Naive) {
+                const uint8_t *rec = log.records_begin() + r0 * stride;
+                for (size_t r = 0; r < n; r++, rec += stride) {
+                    for (size_t c = 0; c < cols.size(); c++) {
+                        convert_one(cols[c], rec + columns[c].channel.offset, r0 + r, acc[c]);
+                    }
+                }
+                continue;
+            }
+            for (size_t c = 0; c < cols.size(); c++) {
+                size_t done = simd ? column_simd(cols[c], stride, r0, n, acc[c]) : 0;
+                column_scalar(cols[c], stride, r0 + done, n - done, acc[c]);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (std::thread &th : pool) {
+        th.join();
+    }
+
+    std::vector<ColumnStats> stats(cols.size());
+    for (size_t c = 0; c < cols.size(); c++) {
+        Accum total;
+        for (const std::vector<Accum> &acc : partial) {
+            total.merge(acc[c]);
+        }
+        if (rows == 0) {
+            continue;
+        }
+        unsigned bits = cols[c].width * 8u;
+        stats[c].min = total.min ^ cols[c].bias;
+        stats[c].max = total.max ^ cols[c].bias;
+        if (cols[c].is_signed) {
+            stats[c].min = sign_extend(stats[c].min, bits);
+            stats[c].max = sign_extend(stats[c].max, bits);
+        }
+    }
+    return stats;
+}
+
+std::vector<ColumnStats> write_columnar(const Log &log, const std::vector<ColumnSpec> &columns, const std::string &path,
+                                        Transpose method, unsigned threads) {
+    const size_t rows = log.record_count();
+    std::vector<size_t> offsets;
+    size_t size = align_up(sizeof(ColumnarHeader) + columns.size() * sizeof(ColumnDesc));
+    for (const ColumnSpec &spec : columns) {
+        offsets.push_back(size);
+        size += align_up(rows * storage_width(spec.channel.width));
+    }
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw sys_error(path);
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        throw sys_error(path);
+    }
+    void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        throw sys_error(path);
+    }
+    uint8_t *base = static_cast<uint8_t *>(map);
+
+    std::vector<void *> dest;
+    for (size_t off : offsets) {
+        dest.push_back(base + off);
+    }
+    std::vector<ColumnStats> stats = transpose(log, columns, dest, method, threads);
+
+    ColumnarHeader header{};
+    std::memcpy(header.magic, kColumnarMagic, sizeof(header.magic));
+    header.version = 1;
+    header.column_count = static_cast<uint32_t>(columns.size());
+    header.row_count = rows;
+    std::memcpy(base, &header, sizeof(header));
+
+    for (size_t i = 0; i < columns.size(); i++) {
+        ColumnDesc desc{};
+        const Channel &ch = columns[i].channel;
+        std::strncpy(desc.name, ch.name.c_str(), kColumnNameLength - 1);
+        desc.width = storage_width(ch.width);
+        desc.is_signed = columns[i].is_signed;
+        desc.source_width = ch.width;
+        desc.offset = offsets[i];
+        desc.min = stats[i].min;
+        desc.max = stats[i].max;
+        std::memcpy(base + sizeof(header) + i * sizeof(ColumnDesc), &desc, sizeof(desc));
+    }
+
+    munmap(map, size);
+    return stats;
+}
+
+ColumnarFile::ColumnarFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw sys_error(path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw sys_error(path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ < sizeof(ColumnarHeader)) {
+        close(fd);
+        throw std::runtime_error(path + ": not a .bcol file");
+    }
+    void *map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        throw sys_error(path);
+    }
+    base_ = static_cast<const uint8_t *>(map);
+    header_ = reinterpret_cast<const ColumnarHeader *>(base_);
+    descs_ = reinterpret_cast<const ColumnDesc *>(base_ + sizeof(ColumnarHeader));
+
+    std::string error;
+    if (std::memcmp(header_->magic, kColumnarMagic, sizeof(kColumnarMagic)) != 0 || header_->version != 1) {
+        error = "not a version 1 .bcol file";
+    } else if (sizeof(ColumnarHeader) + header_->column_count * sizeof(ColumnDesc) > size_) {
+        error = "truncated column table";
+    } else {
+        for (uint32_t i = 0; i < header_->column_count && error.empty(); i++) {
+            const ColumnDesc &d = descs_[i];
+            if (d.name[kColumnNameLength - 1] != '\0' || d.width != storage_width(d.width) ||
+                d.offset + header_->row_count * d.width > size_) {
+                error = std::string("column ") + d.name + " out of bounds";
+            }
+        }
+    }
+    if (!error.empty()) {
+        munmap(const_cast<uint8_t *>(base_), size_);
+        throw std::runtime_error(path + ": " + error);
+    }
+}
+
+ColumnarFile::~ColumnarFile() {
+    munmap(const_cast<uint8_t *>(base_), size_);
+}
+
+const ColumnDesc *ColumnarFile::find(const std::string &name) const {
+    for (uint32_t i = 0; i < header_->column_count; i++) {
+        if (name == descs_[i].name) {
+            return &descs_[i];
+        }
+    }
+    return nullptr;
+}
+
+int64_t ColumnarFile::value(const ColumnDesc &desc, uint64_t row) const {
+    const uint8_t *p = base_ + desc.offset + row * desc.width;
+    uint64_t v = 0;
+    std::memcpy(&v, p, desc.width); // Little-endian host
+    return static_cast<int64_t>(desc.is_signed ? sign_extend(v, desc.width * 8u) : v);
+}
+
+} // namespace benji
@@ -0,0 +1,123 @@
+/*
+ * benji_columnar.hpp
+ *
+ * Column-oriented container for .benji2 data (".bcol"), built for analysis
+ * tools that read a few channels over a whole session:
+ *
+ *   ColumnarHeader                       32 bytes
+ *   ColumnDesc x column_count            64 bytes each
+ *   column data, each 64-byte aligned    row_count values, little-endian,
+ *                                        1/2/4/8 bytes (signed columns are
+ *                                        sign-extended to that width)
+ *
+ * Every column carries its min/max so range queries and plot scaling need
+ * no pass over the data. The file is meant to be memory-mapped and used in
+ * place (ColumnarFile).
+ *
+ * transpose() turns the big-endian rows of a Log into native columns. The
+ * SIMD path gathers one channel from 8 (or 4) records at a time and swaps
+ * bytes with a shuffle; work is split into row blocks across threads.
+ */
+#ifndef BENJI_COLUMNAR_HPP
+#define BENJI_COLUMNAR_HPP
+
+#include "benji_log.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace benji {
+
+constexpr char kColumnarMagic[8] = {'B', 'C', 'O', 'L', 'v', '1', '\r', '\n'};
+constexpr size_t kColumnAlign = 64;
+constexpr size_t kColumnNameLength = 32;
+
+struct ColumnarHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t column_count;
+    uint64_t row_count;
+    uint64_t reserved;
+};
+
+struct ColumnDesc {
+    char name[kColumnNameLength]; // NUL-terminated
+    uint8_t width;                // Bytes per stored value: 1, 2, 4 or 8
+    uint8_t is_signed;
+    uint8_t source_width;         // Bytes in the .benji2 record
+    uint8_t reserved[5];
+    uint64_t offset;              // Of the column data from the start of the file
+    uint64_t min;                 // Raw bits; sign-extended to 64 bits for signed columns
+    uint64_t max;
+};
+
+static_assert(sizeof(ColumnarHeader) == 32, "ColumnarHeader layout");
+static_assert(sizeof(ColumnDesc) == 64, "ColumnDesc layout");
+
+struct ColumnSpec {
+    Channel channel;
+    bool is_signed = false;
+};
+
+struct ColumnStats {
+    uint64_t min = 0; // Same encoding as ColumnDesc
+    uint64_t max = 0;
+};
+
+enum class Transpose {
+    Naive,  // Row by row, every channel of a record before the next record
+    Scalar, // Column by column over cache-sized row blocks
+    Simd,   // As Scalar, with AVX2 gather + byte shuffle where available
+};
+
+inline uint8_t storage_width(uint8_t source_width) {
+    return source_width <= 1 ? 1 : source_width <= 2 ? 2 : source_width <= 4 ? 4 : 8;
+}
+
+// True when the CPU supports the Transpose::Simd kernels (otherwise Simd falls back to Scalar)
+bool simd_available();
+
+// Specs for a channel selection; names in signed_list are marked signed
+std::vector<ColumnSpec> column_specs(const Schema &schema, const std::string &channels, const std::string &signed_list);
+
+/**
+ * Transpose every record of log into dest[i] (record_count * storage_width
+ * bytes per column). threads == 0 uses the hardware concurrency.
+ */
+std::vector<ColumnStats> transpose(const Log &log, const std::vector<ColumnSpec> &columns,
+                                   const std::vector<void *> &dest, Transpose method, unsigned threads);
+
+// Convert log into a .bcol file at path; throws std::runtime_error on I/O failure
+std::vector<ColumnStats> write_columnar(const Log &log, const std::vector<ColumnSpec> &columns, const std::string &path,
+                                        Transpose method, unsigned threads);
+
+class ColumnarFile {
+public:
+    explicit ColumnarFile(const std::string &path);
+    ~ColumnarFile();
+    ColumnarFile(const ColumnarFile &) = delete;
+    ColumnarFile &operator=(const ColumnarFile &) = delete;
+
+    uint64_t row_count() const { return header_->row_count; }
+    uint32_t column_count() const { return header_->column_count; }
+    const ColumnDesc &column(uint32_t i) const { return descs_[i]; }
+
+    // nullptr if there is no such column
+    const ColumnDesc *find(const std::string &name) const;
+
+    const void *data(const ColumnDesc &desc) const { return base_ + desc.offset; }
+
+    // Value of one row, sign-extended for signed columns
+    int64_t value(const ColumnDesc &desc, uint64_t row) const;
+
+private:
+    const uint8_t *base_ = nullptr;
+    size_t size_ = 0;
+    const ColumnarHeader *header_ = nullptr;
+    const ColumnDesc *descs_ = nullptr;
+};
+
+} // namespace benji
+
+#endif // BENJI_COLUMNAR_HPP
@@ -0,0 +1,194 @@
+/*
+ * benji_convert.cpp
+ *
+ * Converts a .benji2 log into the columnar .bcol container
+ * (benji_columnar.hpp), or benchmarks the transposition strategies.
+ *
+ * Usage: benji_convert <log.benji2> <out.bcol> [options]
+ *        benji_convert <log.benji2> --bench [--threads N]
+ *   --channels A,B,FUS_*  subset of channels (default all)
+ *   --signed A,B,...      channels stored as two's complement
+ *   --threads N           worker threads (default: all cores)
+ *   --naive | --scalar    force a slower transposition (default SIMD where available)
+ *   --stats               print per-column min/max after converting
+ *   --bench               compare naive row loop, scalar and SIMD columns, 1 and N threads
+ */
+#include "benji_columnar.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char *method_name(benji::Transpose method) {
+    switch (method) {
+        case benji::Transpose::Naive:
+            return "naive row loop";
+        case benji::Transpose::Scalar:
+            return "scalar columns";
+        default:
+            return benji::simd_available() ? "SIMD columns" : "SIMD columns (no AVX2: scalar)";
+    }
+}
+
+void print_stats(const std::vector<benji::ColumnSpec> &specs, const std::vector<benji::ColumnStats> &stats) {
+    printf("\n%-20s %5s %22s %22s\n", "Column", "Bytes", "Min", "Max");
+    for (size_t i = 0; i < specs.size(); i++) {
+        const benji::ColumnSpec &s = specs[i];
+        printf("%-20s %5u ", s.channel.name.c_str(), benji::storage_width(s.channel.width));
+        if (s.is_signed) {
+            printf("%22lld %22lld\n", static_cast<long long>(stats[i].min), static_cast<long long>(stats[i].max));
+        } else {
+            printf("%22llu %22llu\n", static_cast<unsigned long long>(stats[i].min),
+                   static_cast<unsigned long long>(stats[i].max));
+        }
+    }
+}
+
+int run_bench(const benji::Log &log, const std::vector<benji::ColumnSpec> &specs, unsigned threads) {
+    const size_t rows = log.record_count();
+    const double mib = rows * log.schema().record_size() / (1024.0 * 1024.0);
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    auto make_buffers = [&](std::vector<std::vector<uint8_t>> &storage) {
+        std::vector<void *> dest;
+        storage.clear();
+        for (const benji::ColumnSpec &s : specs) {
+            storage.emplace_back(rows * benji::storage_width(s.channel.width) + 1);
+        }
+        for (std::vector<uint8_t> &buf : storage) {
+            dest.push_back(buf.data());
+        }
+        return dest;
+    };
+
+    // Reference output from the naive loop; every other run must match it byte for byte
+    std::vector<std::vector<uint8_t>> reference;
+    std::vector<benji::ColumnStats> reference_stats;
+
+    struct Run {
+        benji::Transpose method;
+        unsigned threads;
+    };
+    std::vector<Run> runs = {{benji::Transpose::Naive, 1}, {benji::Transpose::Scalar, 1}, {benji::Transpose::Simd, 1}};
+    if (threads > 1) {
+        runs.push_back({benji::Transpose::Naive, threads});
+        runs.push_back({benji::Transpose::Scalar, threads});
+        runs.push_back({benji::Transpose::Simd, threads});
+    }
+
+    printf("%zu records, %zu columns, %.1f MiB\n\n", rows, specs.size(), mib);
+    printf("%-32s %7s %10s %10s %8s\n", "Method", "Threads", "Best ms", "MiB/s", "Speedup");
+    double naive_ms = 0;
+    int failures = 0;
+    for (const Run &run : runs) {
+        std::vector<std::vector<uint8_t>> storage;
+        std::vector<void *> dest = make_buffers(storage);
+        std::vector<benji::ColumnStats> stats;
+        double best = 1e30;
+        for (int rep = 0; rep < 3; rep++) {
+            auto start = Clock::now();
+            stats = benji::transpose(log, specs, dest, run.method, run.threads);
+            best = std::min(best, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+        }
+
+        if (reference.empty()) {
+            reference = std::move(storage);
+            reference_stats = stats;
+            naive_ms = best;
+        } else {
+            bool same = storage == reference;
+            for (size_t i = 0; i < stats.size(); i++) {
+                same = same && stats[i].min == reference_stats[i].min && stats[i].max == reference_stats[i].max;
+            }
+            if (!same) {
+                printf("MISMATCH: %s with %u threads differs from the naive loop\n", method_name(run.method),
+                       run.threads);
+                failures++;
+            }
+        }
+        printf("%-32s %7u %10.1f %10.0f %7.1fx\n", method_name(run.method), run.threads, best,
+               best > 0 ? mib / (best / 1000) : 0.0, best > 0 ? naive_ms / best : 0.0);
+    }
+    return failures > 0 ? 1 : 0;
+}
+
+int usage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " <log.benji2> <out.bcol> [--channels A,PREFIX*] [--signed A,...]\n"
+              << "       [--threads N] [--naive|--scalar] [--stats]\n"
+              << "       " << argv0 << " <log.benji2> --bench [--threads N]\n";
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string in_path, out_path, channels, signed_list;
+    unsigned threads = 0;
+    benji::Transpose method = benji::Transpose::Simd;
+    bool bench = false, show_stats = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--channels" && has_value) {
+            channels = argv[++i];
+        } else if (arg == "--signed" && has_value) {
+            signed_list = argv[++i];
+        } else if (arg == "--threads" && has_value) {
+            threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--naive") {
+            method = benji::Transpose::Naive;
+        } else if (arg == "--scalar") {
+            method = benji::Transpose::Scalar;
+        } else if (arg == "--bench") {
+            bench = true;
+        } else if (arg == "--stats") {
+            show_stats = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            return usage(argv[0]);
+        } else if (in_path.empty()) {
+            in_path = arg;
+        } else {
+            out_path = arg;
+        }
+    }
+    if (in_path.empty() || (out_path.empty() && !bench)) {
+        return usage(argv[0]);
+    }
+
+    try {
+        benji::Log log(in_path);
+        std::vector<benji::ColumnSpec> specs = benji::column_specs(log.schema(), channels, signed_list);
+        if (bench) {
+            return run_bench(log, specs, threads);
+        }
+
+        log.advise_sequential();
+        auto start = Clock::now();
+        std::vector<benji::ColumnStats> stats = benji::write_columnar(log, specs, out_path, method, threads);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        double mib = log.record_count() * log.schema().record_size() / (1024.0 * 1024.0);
+        printf("%s: %zu records, %zu columns in %.3f s (%.0f MiB/s, %s)\n", out_path.c_str(), log.record_count(),
+               specs.size(), seconds, seconds > 0 ? mib / seconds : 0.0, method_name(method));
+        if (show_stats) {
+            print_stats(specs, stats);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
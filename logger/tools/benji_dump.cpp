@@ -0,0 +1,244 @@
+/*
+ * benji_dump.cpp
+ *
+ * Command-line front end for benji_log.hpp.
+ *
+ * Usage: benji_dump <log.benji2> [info|csv|check] [options]
+ *   info    schema, record count and time span (default)
+ *   csv     records as CSV
+ *   check   TS monotonicity, sample gaps, truncation and read throughput
+ *
+ *   --channels A,B,FUS_*  subset of channels (csv; default all)
+ *   --signed A,B,...      channels to print as two's complement (csv)
+ *   --from S / --to S     time range in seconds of TS (csv, check)
+ *   --out file            write to file instead of stdout
+ */
+#include "benji_log.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Buffered writer: formatting with to_chars into a large block keeps CSV output near disk speed
+class Writer {
+public:
+    explicit Writer(FILE *out) : out_(out), buf_(1 << 20) {}
+    ~Writer() { flush(); }
+
+    void put(char c) {
+        reserve(1);
+        buf_[len_++] = c;
+    }
+    void put(std::string_view s) {
+        reserve(s.size());
+        std::copy(s.begin(), s.end(), buf_.begin() + len_);
+        len_ += s.size();
+    }
+    template <typename T>
+    void num(T v) {
+        reserve(24);
+        auto res = std::to_chars(buf_.data() + len_, buf_.data() + buf_.size(), v);
+        len_ = res.ptr - buf_.data();
+    }
+    void flush() {
+        if (len_ > 0) {
+            fwrite(buf_.data(), 1, len_, out_);
+            len_ = 0;
+        }
+    }
+
+private:
+    void reserve(size_t n) {
+        if (len_ + n > buf_.size()) {
+            flush();
+            if (n > buf_.size()) {
+                buf_.resize(n);
+            }
+        }
+    }
+
+    FILE *out_;
+    std::vector<char> buf_;
+    size_t len_ = 0;
+};
+
+struct Options {
+    std::string command = "info";
+    std::string channels;
+    std::string signed_list;
+    double from_s = 0;
+    double to_s = -1;
+    std::string out_path;
+};
+
+std::pair<size_t, size_t> record_range(const benji::Log &log, const Options &opt) {
+    if (opt.from_s <= 0 && opt.to_s < 0) {
+        return {0, log.record_count()};
+    }
+    uint32_t from_ms = static_cast<uint32_t>(opt.from_s * 1000);
+    uint32_t to_ms = opt.to_s < 0 ? UINT32_MAX : static_cast<uint32_t>(opt.to_s * 1000);
+    return log.time_range(from_ms, to_ms);
+}
+
+int cmd_info(const benji::Log &log, FILE *out) {
+    const benji::Schema &schema = log.schema();
+    fprintf(out, "File:     %s (%zu bytes)\n", log.path().c_str(), log.file_size());
+    fprintf(out, "Channels: %zu in %zu-byte records\n", schema.channels().size(), schema.record_size());
+    fprintf(out, "Records:  %zu", log.record_count());
+    if (log.trailing_bytes() > 0) {
+        fprintf(out, " (+%zu byte partial record ignored)", log.trailing_bytes());
+    }
+    fprintf(out, "\n");
+
+    const benji::Channel *ts = schema.find("TS");
+    if (ts != nullptr && log.record_count() > 0) {
+        uint64_t t0 = log.record(0).raw(*ts);
+        uint64_t t1 = log.record(log.record_count() - 1).raw(*ts);
+        double span = (t1 - t0) / 1000.0;
+        fprintf(out, "Time:     %.3f s to %.3f s (%.3f s", t0 / 1000.0, t1 / 1000.0, span);
+        if (span > 0) {
+            fprintf(out, ", %.1f Hz", (log.record_count() - 1) / span);
+        }
+        fprintf(out, ")\n");
+    }
+
+    fprintf(out, "\n%-20s %6s %5s\n", "Channel", "Offset", "Bytes");
+    for (const benji::Channel &ch : schema.channels()) {
+        fprintf(out, "%-20s %6u %5u\n", ch.name.c_str(), ch.offset, ch.width);
+    }
+    return 0;
+}
+
+int cmd_csv(const benji::Log &log, const Options &opt, FILE *out) {
+    std::vector<benji::Channel> columns = log.schema().select(opt.channels);
+    std::vector<benji::Channel> signed_channels = log.schema().select(opt.signed_list);
+    std::vector<bool> is_signed(columns.size(), false);
+    if (!opt.signed_list.empty()) {
+        for (size_t i = 0; i < columns.size(); i++) {
+            is_signed[i] = std::any_of(signed_channels.begin(), signed_channels.end(),
+                                       [&](const benji::Channel &s) { return s.offset == columns[i].offset; });
+        }
+    }
+
+    auto [first, last] = record_range(log, opt);
+    log.advise_sequential();
+
+    Writer w(out);
+    for (size_t i = 0; i < columns.size(); i++) {
+        if (i > 0) {
+            w.put(',');
+        }
+        w.put(columns[i].name);
+    }
+    w.put('\n');
+
+    for (auto it = log.begin() + first, end = log.begin() + last; it != end; ++it) {
+        benji::RecordView rec = *it;
+        for (size_t i = 0; i < columns.size(); i++) {
+            if (i > 0) {
+                w.put(',');
+            }
+            if (is_signed[i]) {
+                w.num(rec.as_signed(columns[i]));
+            } else {
+                w.num(rec.raw(columns[i]));
+            }
+        }
+        w.put('\n');
+    }
+    return 0;
+}
+
+int cmd_check(const benji::Log &log, const Options &opt, FILE *out) {
+    auto [first, last] = record_range(log, opt);
+    log.advise_sequential();
+    auto start = std::chrono::steady_clock::now();
+    benji::TimingCheck check = benji::check_timing(log, first, last);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double mib = check.records * log.schema().record_size() / (1024.0 * 1024.0);
+
+    fprintf(out, "Records checked:   %zu\n", check.records);
+    fprintf(out, "TS went backwards: %zu\n", check.backwards);
+    fprintf(out, "TS repeated:       %zu\n", check.repeats);
+    if (check.records > 1 + check.backwards) {
+        fprintf(out, "Mean sample gap:   %.3f ms\n", check.mean_gap_ms);
+        fprintf(out, "Largest gap:       %llu ms before record %zu\n",
+                static_cast<unsigned long long>(check.max_gap_ms), check.max_gap_at);
+    }
+    fprintf(out, "Partial record:    %zu bytes\n", log.trailing_bytes());
+    fprintf(out, "Scan:              %.1f MiB in %.3f s (%.0f MiB/s)\n", mib, seconds,
+            seconds > 0 ? mib / seconds : 0.0);
+    return check.backwards > 0 ? 1 : 0;
+}
+
+int usage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " <log.benji2> [info|csv|check] [--channels A,B,PREFIX*] [--signed A,B]\n"
+              << "       [--from S] [--to S] [--out file]\n";
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string path;
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--channels" && has_value) {
+            opt.channels = argv[++i];
+        } else if (arg == "--signed" && has_value) {
+            opt.signed_list = argv[++i];
+        } else if (arg == "--from" && has_value) {
+            opt.from_s = std::atof(argv[++i]);
+        } else if (arg == "--to" && has_value) {
+            opt.to_s = std::atof(argv[++i]);
+        } else if (arg == "--out" && has_value) {
+            opt.out_path = argv[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            return usage(argv[0]);
+        } else if (path.empty()) {
+            path = arg;
+        } else {
+            opt.command = arg;
+        }
+    }
+    if (path.empty()) {
+        return usage(argv[0]);
+    }
+
+    FILE *out = opt.out_path.empty() ? stdout : fopen(opt.out_path.c_str(), "w");
+    if (out == nullptr) {
+        perror(opt.out_path.c_str());
+        return 1;
+    }
+
+    int result;
+    try {
+        benji::Log log(path);
+        if (opt.command == "info") {
+            result = cmd_info(log, out);
+        } else if (opt.command == "csv") {
+            result = cmd_csv(log, opt, out);
+        } else if (opt.command == "check") {
+            result = cmd_check(log, opt, out);
+        } else {
+            result = usage(argv[0]);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        result = 1;
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+    return result;
+}
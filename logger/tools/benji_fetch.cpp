@@ -0,0 +1,482 @@
+/*
+ * benji_fetch.cpp
+ *
+ * Downloads log files from the logger over its console UART, without pulling
+ * the SD card. Puts the console into 'xfer' mode, then speaks the protocol in
+ * main/filexfer_core.h: windowed CRC-checked reads, go-back-N on any bad or
+ * missing frame, and resume of partially downloaded files.
+ *
+ * Usage:
+ *   benji_fetch <port> ls
+ *   benji_fetch <port> get <name> [out] [--no-resume]
+ *   benji_fetch <port> get-all [dir]          every .benji2 file
+ * Options: --baud N (console, default 115200)
+ *
+ * Test without hardware against tools/filexfer_sim.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "filexfer_core.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int kRequestTimeoutMs = 1000;
+constexpr int kMaxRetries = 20;
+
+speed_t baud_constant(long baud) {
+    switch (baud) {
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: throw std::runtime_error("unsupported baud rate " + std::to_string(baud));
+    }
+}
+
+class SerialPort {
+public:
+    SerialPort(const std::string &path, long baud) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_NOCTTY);
+        if (fd_ < 0) {
+            throw std::runtime_error(path + ": " + std::strerror(errno));
+        }
+        set_baud(baud);
+    }
+    ~SerialPort() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+    SerialPort(const SerialPort &) = delete;
+    SerialPort &operator=(const SerialPort &) = delete;
+
+    void set_baud(long baud) {
+        termios tio{};
+        if (tcgetattr(fd_, &tio) != 0) {
+            return; // Not a tty (e.g. a pipe); nothing to configure
+        }
+        tcdrain(fd_);
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, baud_constant(baud));
+        cfsetospeed(&tio, baud_constant(baud));
+        tio.c_cc[VMIN] = 0;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd_, TCSANOW, &tio);
+    }
+
+    void write(const uint8_t *data, size_t len) {
+        while (len > 0) {
+            ssize_t n = ::write(fd_, data, len);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                throw std::runtime_error(std::string("write: ") + std::strerror(errno));
+            }
+            data += n;
+            len -= n;
+        }
+    }
+
+    void write(const std::string &text) { write(reinterpret_cast<const uint8_t *>(text.data()), text.size()); }
+
+    // Returns 0 on timeout
+    size_t read(uint8_t *buf, size_t len, int timeout_ms) {
+        pollfd pfd{fd_, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0) {
+            return 0;
+        }
+        ssize_t n = ::read(fd_, buf, len);
+        return n > 0 ? static_cast<size_t>(n) : 0;
+    }
+
+private:
+    int fd_ = -1;
+};
+
+struct Frame {
+    uint8_t type = 0;
+    uint16_t seq = 0;
+    std::vector<uint8_t> payload;
+};
+
+// COBS/CRC frame layer shared with the firmware (main/telemetry_frame.h)
+class FrameLink {
+public:
+    explicit FrameLink(SerialPort &port) : port_(port) {}
+
+    void send(uint8_t type, uint16_t seq, const std::vector<uint8_t> &payload = {}) {
+        size_t len = telem_frame_encode(type, seq, payload.data(), payload.size(), scratch_, encoded_);
+        port_.write(encoded_, len);
+    }
+
+    // Next valid frame, or nothing once timeout_ms passes without one
+    std::optional<Frame> receive(int timeout_ms) {
+        auto deadline = Clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (true) {
+            while (pos_ < len_) {
+                uint8_t byte = buf_[pos_++];
+                if (byte != 0) {
+                    if (block_.size() < TELEM_MAX_ENCODED) {
+                        block_.push_back(byte);
+                    }
+                    continue;
+                }
+                if (auto frame = decode_block()) {
+                    return frame;
+                }
+            }
+
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+            if (remaining <= 0) {
+                return std::nullopt;
+            }
+            len_ = port_.read(buf_, sizeof(buf_), static_cast<int>(remaining));
+            pos_ = 0;
+        }
+    }
+
+    unsigned long bad_frames() const { return bad_frames_; }
+
+private:
+    std::optional<Frame> decode_block() {
+        if (block_.empty()) {
+            return std::nullopt;
+        }
+        size_t len = telem_cobs_decode(block_.data(), block_.size(), frame_, sizeof(frame_));
+        block_.clear();
+        if (len < TELEM_FRAME_OVERHEAD ||
+            telem_crc16(frame_, len - 2) != static_cast<uint16_t>(frame_[len - 2] | frame_[len - 1] << 8)) {
+            bad_frames_++;
+            return std::nullopt;
+        }
+        Frame frame;
+        frame.type = frame_[0];
+        frame.seq = static_cast<uint16_t>(frame_[1] | frame_[2] << 8);
+        frame.payload.assign(frame_ + 3, frame_ + len - 2);
+        return frame;
+    }
+
+    SerialPort &port_;
+    uint8_t scratch_[TELEM_MAX_FRAME];
+    uint8_t encoded_[TELEM_MAX_ENCODED];
+    uint8_t frame_[TELEM_MAX_FRAME];
+    uint8_t buf_[4096];
+    size_t pos_ = 0;
+    size_t len_ = 0;
+    std::vector<uint8_t> block_;
+    unsigned long bad_frames_ = 0;
+};
+
+struct RemoteFile {
+    std::string name;
+    uint32_t size;
+};
+
+std::vector<uint8_t> u32_le(uint32_t v) {
+    return {static_cast<uint8_t>(v), static_cast<uint8_t>(v >> 8), static_cast<uint8_t>(v >> 16),
+            static_cast<uint8_t>(v >> 24)};
+}
+
+uint32_t crc32_of_file(const std::string &path, uint32_t length) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> buf(64 * 1024);
+    uint32_t crc = 0;
+    while (length > 0 && in) {
+        in.read(reinterpret_cast<char *>(buf.data()), std::min<size_t>(buf.size(), length));
+        auto n = static_cast<size_t>(in.gcount());
+        if (n == 0) {
+            break;
+        }
+        crc = filexfer_crc32_update(crc, buf.data(), n);
+        length -= static_cast<uint32_t>(n);
+    }
+    return crc;
+}
+
+class FileClient {
+public:
+    FileClient(SerialPort &port, long console_baud) : port_(port), link_(port) { enter_xfer_mode(console_baud); }
+
+    ~FileClient() {
+        try {
+            link_.send(FILEXFER_QUIT, next_seq());
+            link_.receive(300);
+        } catch (...) {
+        }
+    }
+
+    std::vector<RemoteFile> list() {
+        uint16_t seq = next_seq();
+        link_.send(FILEXFER_LIST, seq);
+        std::vector<RemoteFile> files;
+        while (auto frame = link_.receive(kRequestTimeoutMs)) {
+            if (frame->seq != seq) {
+                continue;
+            }
+            if (frame->type == FILEXFER_ACK) {
+                return files;
+            }
+            if (frame->type == FILEXFER_ENTRY && frame->payload.size() > 4) {
+                files.push_back({std::string(frame->payload.begin() + 4, frame->payload.end()),
+                                 filexfer_get_u32(frame->payload.data())});
+            }
+        }
+        throw std::runtime_error("no reply to LIST");
+    }
+
+    void fetch(const std::string &name, const std::string &out_path, bool resume) {
+        uint32_t size = open(name);
+
+        // Resume only if the partial local copy matches the device byte for byte
+        uint32_t offset = 0;
+        std::ifstream existing(out_path, std::ios::binary | std::ios::ate);
+        if (resume && existing) {
+            auto local = static_cast<uint32_t>(existing.tellg());
+            if (local > 0 && local <= size && check(0, local) == std::optional(crc32_of_file(out_path, local))) {
+                offset = local;
+                std::cerr << "Resuming " << name << " at " << offset << " bytes\n";
+            } else if (local > 0) {
+                std::cerr << "Local " << out_path << " does not match the device, restarting\n";
+            }
+        }
+        existing.close();
+
+        std::ofstream out(out_path, std::ios::binary | (offset > 0 ? std::ios::app : std::ios::trunc));
+        if (!out) {
+            throw std::runtime_error("cannot write " + out_path);
+        }
+
+        auto start = Clock::now();
+        uint32_t start_offset = offset;
+        int retries = 0;
+        uint16_t window = window_;
+        bool eof = false;
+        while (!eof) {
+            uint16_t seq = next_seq();
+            std::vector<uint8_t> request = u32_le(offset);
+            request.push_back(static_cast<uint8_t>(window));
+            request.push_back(static_cast<uint8_t>(window >> 8));
+            link_.send(FILEXFER_READ, seq, request);
+
+            uint16_t received = 0;
+            bool gap = false;
+            while (received < window && !gap) {
+                auto frame = link_.receive(kRequestTimeoutMs);
+                if (!frame) {
+                    gap = true; // Lost frames at the end of the window
+                    break;
+                }
+                if (frame->seq != seq || frame->type != FILEXFER_CHUNK || frame->payload.size() < 4) {
+                    continue; // Stale frame from an abandoned window
+                }
+                uint32_t chunk_offset = filexfer_get_u32(frame->payload.data());
+                if (chunk_offset != offset) {
+                    gap = true; // A frame went missing; go back to offset
+                    break;
+                }
+                size_t len = frame->payload.size() - 4;
+                if (len == 0) {
+                    eof = true;
+                    break;
+                }
+                out.write(reinterpret_cast<const char *>(frame->payload.data() + 4), len);
+                offset += static_cast<uint32_t>(len);
+                received++;
+                progress(name, offset, size);
+            }
+
+            // Only requests that make no progress count towards giving up
+            // and shrink the window so a fault that recurs at a fixed spacing cannot stall us
+            if (received > 0 || eof) {
+                retries = 0;
+                window = window_;
+            } else if (gap) {
+                if (++retries > kMaxRetries) {
+                    throw std::runtime_error("too many retries at offset " + std::to_string(offset));
+                }
+                window = std::max<uint16_t>(1, window / 2);
+            }
+        }
+        out.close();
+
+        // Whole-file check against the device
+        if (check(0, offset) != std::optional(crc32_of_file(out_path, offset))) {
+            throw std::runtime_error("CRC mismatch after download of " + name);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        auto kib_per_s = static_cast<unsigned long>((offset - start_offset) / (seconds > 0 ? seconds : 1) / 1024);
+        std::cerr << "\r" << name << ": " << offset << " bytes, " << kib_per_s << " KiB/s, CRC OK ("
+                  << link_.bad_frames() << " bad frames)\n";
+    }
+
+private:
+    void enter_xfer_mode(long console_baud) {
+        port_.write("\x03\rxfer\r"); // Ctrl-C clears any half-typed line
+        std::string text;
+        auto deadline = Clock::now() + std::chrono::seconds(3);
+        long xfer_baud = 0;
+        while (Clock::now() < deadline) {
+            uint8_t buf[256];
+            size_t n = port_.read(buf, sizeof(buf), 100);
+            text.append(reinterpret_cast<char *>(buf), n);
+            auto pos = text.find(FILEXFER_READY);
+            auto end = pos == std::string::npos ? pos : text.find('\n', pos);
+            if (end != std::string::npos) {
+                xfer_baud = std::strtol(text.c_str() + pos + std::strlen(FILEXFER_READY), nullptr, 10);
+                break;
+            }
+        }
+        if (xfer_baud == 0) {
+            throw std::runtime_error("logger did not enter xfer mode (is the console at " +
+                                     std::to_string(console_baud) + " baud?)");
+        }
+        port_.set_baud(xfer_baud);
+
+        for (int attempt = 0; attempt < 10; attempt++) {
+            uint16_t seq = next_seq();
+            link_.send(FILEXFER_PING, seq);
+            while (auto frame = link_.receive(200)) {
+                if (frame->type == FILEXFER_ACK && frame->seq == seq) {
+                    return;
+                }
+            }
+        }
+        throw std::runtime_error("no reply to PING at " + std::to_string(xfer_baud) + " baud");
+    }
+
+    uint32_t open(const std::string &name) {
+        for (int attempt = 0; attempt < 3; attempt++) {
+            uint16_t seq = next_seq();
+            link_.send(FILEXFER_OPEN, seq, std::vector<uint8_t>(name.begin(), name.end()));
+            while (auto frame = link_.receive(kRequestTimeoutMs)) {
+                if (frame->seq != seq) {
+                    continue;
+                }
+                if (frame->type == FILEXFER_ERROR) {
+                    throw std::runtime_error(name + ": " + std::string(frame->payload.begin(), frame->payload.end()));
+                }
+                if (frame->type == FILEXFER_INFO && frame->payload.size() >= 8) {
+                    window_ = static_cast<uint16_t>(frame->payload[6] | frame->payload[7] << 8);
+                    return filexfer_get_u32(frame->payload.data());
+                }
+            }
+        }
+        throw std::runtime_error("no reply to OPEN " + name);
+    }
+
+    // CRC-32 of a range on the device; nothing if the device holds fewer bytes
+    std::optional<uint32_t> check(uint32_t offset, uint32_t length) {
+        for (int attempt = 0; attempt < 3; attempt++) {
+            uint16_t seq = next_seq();
+            std::vector<uint8_t> request = u32_le(offset);
+            auto len = u32_le(length);
+            request.insert(request.end(), len.begin(), len.end());
+            link_.send(FILEXFER_CHECK, seq, request);
+            // CRC over a large file takes a while on the device
+            while (auto frame = link_.receive(kRequestTimeoutMs + static_cast<int>(length / 100))) {
+                if (frame->seq == seq && frame->type == FILEXFER_SUM && frame->payload.size() >= 8) {
+                    if (filexfer_get_u32(frame->payload.data() + 4) != length) {
+                        return std::nullopt;
+                    }
+                    return filexfer_get_u32(frame->payload.data());
+                }
+            }
+        }
+        throw std::runtime_error("no reply to CHECK");
+    }
+
+    static void progress(const std::string &name, uint32_t offset, uint32_t size) {
+        static auto last = Clock::now();
+        if (Clock::now() - last < std::chrono::milliseconds(200)) {
+            return;
+        }
+        last = Clock::now();
+        std::cerr << "\r" << name << ": " << offset << " / " << size << " bytes" << std::flush;
+    }
+
+    uint16_t next_seq() { return seq_++; }
+
+    SerialPort &port_;
+    FrameLink link_;
+    uint16_t seq_ = 1;
+    uint16_t window_ = FILEXFER_WINDOW;
+};
+
+bool ends_with(const std::string &s, const std::string &suffix) {
+    return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+int usage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " <port> ls\n"
+              << "       " << argv0 << " <port> get <name> [out] [--no-resume]\n"
+              << "       " << argv0 << " <port> get-all [dir]\n"
+              << "Options: --baud N (console baud, default 115200)\n";
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::vector<std::string> args;
+    long baud = 115200;
+    bool resume = true;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--baud" && i + 1 < argc) {
+            baud = std::strtol(argv[++i], nullptr, 10);
+        } else if (arg == "--no-resume") {
+            resume = false;
+        } else {
+            args.push_back(arg);
+        }
+    }
+    if (args.size() < 2) {
+        return usage(argv[0]);
+    }
+
+    try {
+        SerialPort port(args[0], baud);
+        FileClient client(port, baud);
+        const std::string &command = args[1];
+
+        if (command == "ls") {
+            for (const auto &file : client.list()) {
+                std::printf("%10u  %s\n", file.size, file.name.c_str());
+            }
+        } else if (command == "get" && args.size() >= 3) {
+            client.fetch(args[2], args.size() >= 4 ? args[3] : args[2], resume);
+        } else if (command == "get-all") {
+            std::string dir = args.size() >= 3 ? args[2] + "/" : "";
+            for (const auto &file : client.list()) {
+                if (ends_with(file.name, ".benji2")) {
+                    client.fetch(file.name, dir + file.name, resume);
+                }
+            }
+        } else {
+            return usage(argv[0]);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "\nbenji_fetch: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
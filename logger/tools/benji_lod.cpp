@@ -0,0 +1,452 @@
+#include "benji_lod.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace benji {
+
+namespace {
+
+constexpr size_t kBlockRows = 4096; // Row block per work item; a multiple of every in-block bucket factor
+
+// Min/max are tracked on (value ^ bias) as in benji_columnar.cpp, so signed
+// and unsigned columns share one unsigned comparison
+struct Array {
+    uint8_t *min;
+    uint8_t *max;
+    float *mean;
+};
+
+struct Column {
+    const uint8_t *src; // Channel bytes of record 0
+    uint8_t source_width;
+    uint8_t width;
+    bool is_signed;
+    uint64_t mask;
+    uint64_t bias;
+    std::vector<Array> levels;
+};
+
+struct Accum {
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+
+    void push(uint64_t biased) {
+        min = std::min(min, biased);
+        max = std::max(max, biased);
+    }
+    void merge(const Accum &o) {
+        min = std::min(min, o.min);
+        max = std::max(max, o.max);
+    }
+};
+
+uint64_t sign_extend(uint64_t v, unsigned bits) {
+    if (bits < 64 && (v >> (bits - 1)) & 1) {
+        v |= ~0ULL << bits;
+    }
+    return v;
+}
+
+inline void store_le(uint8_t *dest, uint64_t index, uint8_t width, uint64_t v) {
+    std::memcpy(dest + index * width, &v, width); // Little-endian host
+}
+
+inline uint64_t load_le(const uint8_t *src, uint64_t index, uint8_t width) {
+    uint64_t v = 0;
+    std::memcpy(&v, src + index * width, width);
+    return v;
+}
+
+// Value of a masked, sign-extended-to-width column value as a number
+inline double numeric(const Column &c, uint64_t v) {
+    return c.is_signed ? static_cast<double>(static_cast<int64_t>(sign_extend(v, c.width * 8u)))
+                       : static_cast<double>(v);
+}
+
+uint64_t bucket_rows(uint64_t factor, uint64_t bucket, uint64_t rows) {
+    return std::min(factor, rows - bucket * factor);
+}
+
+// Level 0 buckets covering records [r0, r0 + n); r0 is a multiple of kLodFanout
+void summarize_rows(const Column &c, size_t stride, uint64_t r0, uint64_t n, Accum &total) {
+    const Array &out = c.levels[0];
+    const uint8_t *p = c.src + r0 * stride;
+    for (uint64_t b = r0 / kLodFanout, end = r0 + n; b * kLodFanout < end; b++) {
+        uint64_t count = std::min(kLodFanout, end - b * kLodFanout);
+        Accum acc;
+        double sum = 0;
+        for (uint64_t i = 0; i < count; i++, p += stride) {
+            uint64_t v = load_be(p, c.source_width);
+            if (c.is_signed) {
+                v = sign_extend(v, c.source_width * 8u);
+            }
+            v &= c.mask;
+            acc.push(v ^ c.bias);
+            sum += numeric(c, v);
+        }
+        store_le(out.min, b, c.width, acc.min ^ c.bias);
+        store_le(out.max, b, c.width, acc.max ^ c.bias);
+        out.mean[b] = static_cast<float>(sum / count);
+        total.merge(acc);
+    }
+}
+
+// Level l buckets [first, last) from the buckets of level l - 1
+void summarize_level(const Column &c, const std::vector<LodLevel> &levels, uint32_t l, uint64_t first, uint64_t last,
+                     uint64_t rows) {
+    const Array &in = c.levels[l - 1];
+    const Array &out = c.levels[l];
+    const LodLevel &child = levels[l - 1];
+    for (uint64_t b = first; b < last; b++) {
+        Accum acc;
+        double sum = 0;
+        uint64_t k0 = b * kLodFanout, k1 = std::min(k0 + kLodFanout, child.buckets);
+        for (uint64_t k = k0; k < k1; k++) {
+            acc.push(load_le(in.min, k, c.width) ^ c.bias);
+            acc.push(load_le(in.max, k, c.width) ^ c.bias);
+            sum += static_cast<double>(in.mean[k]) * bucket_rows(child.factor, k, rows);
+        }
+        store_le(out.min, b, c.width, acc.min ^ c.bias);
+        store_le(out.max, b, c.width, acc.max ^ c.bias);
+        out.mean[b] = static_cast<float>(sum / bucket_rows(levels[l].factor, b, rows));
+    }
+}
+
+std::runtime_error sys_error(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+size_t align_up(size_t v) {
+    return (v + kColumnAlign - 1) & ~(kColumnAlign - 1);
+}
+
+} // namespace
+
+void write_lod(const Log &log, std::vector<ColumnSpec> columns, const std::string &path, unsigned threads) {
+    const Channel *ts = log.schema().find("TS");
+    if (ts != nullptr && std::none_of(columns.begin(), columns.end(),
+                                      [](const ColumnSpec &s) { return s.channel.name == "TS"; })) {
+        columns.insert(columns.begin(), ColumnSpec{*ts, false});
+    }
+    const uint64_t rows = log.record_count();
+    const size_t stride = log.schema().record_size();
+
+    std::vector<LodLevel> levels;
+    for (uint64_t f = kLodFanout; f <= rows; f *= kLodFanout) {
+        levels.push_back(LodLevel{f, (rows + f - 1) / f});
+        if (f > rows / kLodFanout) {
+            break;
+        }
+    }
+
+    // Layout: tables, then per level and column the min, max and mean arrays
+    const size_t tables = sizeof(LodHeader) + columns.size() * sizeof(ColumnDesc) + levels.size() * sizeof(LodLevel);
+    size_t size = align_up(tables + levels.size() * columns.size() * sizeof(LodArrays));
+    std::vector<LodArrays> arrays;
+    for (const LodLevel &level : levels) {
+        for (const ColumnSpec &spec : columns) {
+            LodArrays a;
+            a.min = size;
+            size += align_up(level.buckets * storage_width(spec.channel.width));
+            a.max = size;
+            size += align_up(level.buckets * storage_width(spec.channel.width));
+            a.mean = size;
+            size += align_up(level.buckets * sizeof(float));
+            arrays.push_back(a);
+        }
+    }
+
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw sys_error(path);
+    }
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        close(fd);
+        throw sys_error(path);
+    }
+    void *map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        throw sys_error(path);
+    }
+    uint8_t *base = static_cast<uint8_t *>(map);
+
+    std::vector<Column> cols;
+    for (size_t i = 0; i < columns.size(); i++) {
+        const Channel &ch = columns[i].channel;
+        Column c;
+        c.src = log.records_begin() + ch.offset;
+        c.source_width = ch.width;
+        c.width = storage_width(ch.width);
+        c.is_signed = columns[i].is_signed;
+        c.mask = c.width == 8 ? ~0ULL : (1ULL << (c.width * 8)) - 1;
+        c.bias = c.is_signed ? 1ULL << (c.width * 8 - 1) : 0;
+        for (size_t l = 0; l < levels.size(); l++) {
+            const LodArrays &a = arrays[l * columns.size() + i];
+            c.levels.push_back(Array{base + a.min, base + a.max, reinterpret_cast<float *>(base + a.mean)});
+        }
+        cols.push_back(std::move(c));
+    }
+
+    // Levels whose buckets fit in a row block are built block by block across threads, the rest afterwards
+    uint32_t in_block = 0;
+    while (in_block < levels.size() && levels[in_block].factor <= kBlockRows) {
+        in_block++;
+    }
+    const size_t blocks = in_block > 0 ? (rows + kBlockRows - 1) / kBlockRows : 0; // None below one bucket
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, blocks)));
+
+    std::atomic<size_t> next_block{0};
+    std::vector<std::vector<Accum>> partial(threads, std::vector<Accum>(cols.size()));
+    auto worker = [&](unsigned t) {
+        for (size_t b; (b = next_block.fetch_add(1, std::memory_order_relaxed)) < blocks;) {
+            uint64_t r0 = b * kBlockRows;
+            uint64_t n = std::min<uint64_t>(kBlockRows, rows - r0);
+            for (size_t c = 0; c < cols.size(); c++) {
+                summarize_rows(cols[c], stride, r0, n, partial[t][c]);
+                for (uint32_t l = 1; l < in_block; l++) {
+                    uint64_t f = levels[l].factor;
+                    summarize_level(cols[c], levels, l, r0 / f, (r0 + n + f - 1) / f, rows);
+                }
+            }
+        }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker, t);
+    }
+    worker(0);
+    for (std::thread &th : pool) {
+        th.join();
+    }
+    for (uint32_t l = std::max(in_block, 1u); l < levels.size(); l++) {
+        for (const Column &c : cols) {
+            summarize_level(c, levels, l, 0, levels[l].buckets, rows);
+        }
+    }
+
+    LodHeader header{};
+    std::memcpy(header.magic, kLodMagic, sizeof(header.magic));
+    header.version = 1;
+    header.column_count = static_cast<uint32_t>(cols.size());
+    header.level_count = static_cast<uint32_t>(levels.size());
+    header.fanout = kLodFanout;
+    header.source_size = log.file_size();
+    header.source_records = rows;
+    uint8_t *p = base;
+    std::memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+
+    for (size_t i = 0; i < cols.size(); i++) {
+        Accum total;
+        for (uint64_t r = 0; blocks == 0 && r < rows; r++) {
+            uint64_t v = load_be(cols[i].src + r * stride, cols[i].source_width);
+            if (cols[i].is_signed) {
+                v = sign_extend(v, cols[i].source_width * 8u);
+            }
+            total.push((v & cols[i].mask) ^ cols[i].bias);
+        }
+        for (const std::vector<Accum> &acc : partial) {
+            total.merge(acc[i]);
+        }
+        ColumnDesc desc{};
+        std::strncpy(desc.name, columns[i].channel.name.c_str(), kColumnNameLength - 1);
+        desc.width = cols[i].width;
+        desc.is_signed = cols[i].is_signed;
+        desc.source_width = cols[i].source_width;
+        if (rows > 0) {
+            desc.min = total.min ^ cols[i].bias;
+            desc.max = total.max ^ cols[i].bias;
+            if (desc.is_signed) {
+                desc.min = sign_extend(desc.min, desc.width * 8u);
+                desc.max = sign_extend(desc.max, desc.width * 8u);
+            }
+        }
+        std::memcpy(p, &desc, sizeof(desc));
+        p += sizeof(desc);
+    }
+    std::memcpy(p, levels.data(), levels.size() * sizeof(LodLevel));
+    p += levels.size() * sizeof(LodLevel);
+    std::memcpy(p, arrays.data(), arrays.size() * sizeof(LodArrays));
+
+    munmap(map, size);
+}
+
+LodFile::LodFile(const std::string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw sys_error(path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw sys_error(path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ < sizeof(LodHeader)) {
+        close(fd);
+        throw std::runtime_error(path + ": not a .lod file");
+    }
+    void *map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        throw sys_error(path);
+    }
+    base_ = static_cast<const uint8_t *>(map);
+    header_ = reinterpret_cast<const LodHeader *>(base_);
+
+    std::string error;
+    const size_t columns = header_->column_count, levels = header_->level_count;
+    const size_t tables = sizeof(LodHeader) + columns * sizeof(ColumnDesc) + levels * sizeof(LodLevel) +
+                          levels * columns * sizeof(LodArrays);
+    if (std::memcmp(header_->magic, kLodMagic, sizeof(kLodMagic)) != 0 || header_->version != 1 ||
+        header_->fanout != kLodFanout) {
+        error = "not a version 1 .lod file";
+    } else if (columns > size_ || levels > 64 || tables > size_) {
+        error = "truncated tables";
+    } else {
+        descs_ = reinterpret_cast<const ColumnDesc *>(base_ + sizeof(LodHeader));
+        levels_ = reinterpret_cast<const LodLevel *>(descs_ + columns);
+        arrays_ = reinterpret_cast<const LodArrays *>(levels_ + levels);
+        for (size_t l = 0; l < levels && error.empty(); l++) {
+            for (size_t c = 0; c < columns && error.empty(); c++) {
+                const ColumnDesc &d = descs_[c];
+                const LodArrays &a = arrays_[l * columns + c];
+                uint64_t n = levels_[l].buckets;
+                if (d.name[kColumnNameLength - 1] != '\0' || d.width != storage_width(d.width) ||
+                    a.min + n * d.width > size_ || a.max + n * d.width > size_ || a.mean + n * sizeof(float) > size_) {
+                    error = std::string("column ") + d.name + " out of bounds";
+                }
+            }
+        }
+    }
+    if (!error.empty()) {
+        munmap(const_cast<uint8_t *>(base_), size_);
+        throw std::runtime_error(path + ": " + error);
+    }
+}
+
+LodFile::~LodFile() {
+    munmap(const_cast<uint8_t *>(base_), size_);
+}
+
+int LodFile::find(const std::string &name) const {
+    for (uint32_t i = 0; i < header_->column_count; i++) {
+        if (name == descs_[i].name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int LodFile::choose_level(uint64_t rows, unsigned pixels) const {
+    int best = -1;
+    for (uint32_t l = 0; l < header_->level_count && rows / levels_[l].factor >= std::max(1u, pixels); l++) {
+        best = static_cast<int>(l);
+    }
+    return best;
+}
+
+int64_t LodFile::stored(uint64_t offset, const ColumnDesc &desc, uint64_t bucket) const {
+    uint64_t v = load_le(base_ + offset, bucket, desc.width);
+    return static_cast<int64_t>(desc.is_signed ? sign_extend(v, desc.width * 8u) : v);
+}
+
+int64_t LodFile::min(uint32_t level, uint32_t column, uint64_t bucket) const {
+    return stored(arrays(level, column).min, descs_[column], bucket);
+}
+
+int64_t LodFile::max(uint32_t level, uint32_t column, uint64_t bucket) const {
+    return stored(arrays(level, column).max, descs_[column], bucket);
+}
+
+float LodFile::mean(uint32_t level, uint32_t column, uint64_t bucket) const {
+    float v;
+    std::memcpy(&v, base_ + arrays(level, column).mean + bucket * sizeof(float), sizeof(v));
+    return v;
+}
+
+PlotSeries LodFile::query(const Log &log, const std::string &channel, uint32_t from_ms, uint32_t to_ms,
+                          unsigned pixels) const {
+    if (!matches(log)) {
+        throw std::runtime_error(log.path() + ": level-of-detail file is out of date, rebuild it");
+    }
+    int col = find(channel);
+    const Channel *ch = log.schema().find(channel);
+    const Channel *ts = log.schema().find("TS");
+    if (col < 0 || ch == nullptr || ts == nullptr) {
+        throw std::runtime_error(channel + ": not in the level-of-detail file");
+    }
+    const uint32_t column = static_cast<uint32_t>(col);
+    const ColumnDesc &desc = descs_[column];
+    auto number = [&](int64_t v) {
+        return desc.is_signed ? static_cast<double>(v) : static_cast<double>(static_cast<uint64_t>(v));
+    };
+    pixels = std::max(1u, pixels);
+
+    PlotSeries series;
+    series.rows = log.time_range(from_ms, to_ms);
+    const uint64_t first = series.rows.first, n = series.rows.second - series.rows.first;
+    series.level = choose_level(n, pixels);
+
+    if (series.level < 0) {
+        // Fewer than kLodFanout records per pixel: aggregate the records themselves
+        series.factor = 1;
+        for (uint64_t p = 0; p < pixels; p++) {
+            uint64_t r0 = first + p * n / pixels, r1 = first + (p + 1) * n / pixels;
+            if (r0 == r1) {
+                continue;
+            }
+            PlotPoint pt{r0, r1 - r0, log.record(r0).raw(*ts) / 1000.0, 0, 0, 0};
+            double sum = 0;
+            for (uint64_t r = r0; r < r1; r++) {
+                RecordView rec = log.record(r);
+                double v = number(desc.is_signed ? rec.as_signed(*ch) : static_cast<int64_t>(rec.raw(*ch)));
+                pt.min = r == r0 ? v : std::min(pt.min, v);
+                pt.max = r == r0 ? v : std::max(pt.max, v);
+                sum += v;
+            }
+            pt.mean = sum / pt.rows;
+            series.points.push_back(pt);
+        }
+        return series;
+    }
+
+    const uint32_t level = static_cast<uint32_t>(series.level);
+    const uint32_t ts_col = static_cast<uint32_t>(find("TS"));
+    const uint64_t f = levels_[level].factor;
+    series.factor = f;
+    const uint64_t b0 = first / f, nb = (first + n + f - 1) / f - b0;
+    for (uint64_t p = 0; p < pixels; p++) {
+        uint64_t k0 = b0 + p * nb / pixels, k1 = b0 + (p + 1) * nb / pixels;
+        if (k0 == k1) {
+            continue;
+        }
+        uint64_t r0 = k0 * f, r1 = std::min(k1 * f, row_count());
+        PlotPoint pt{r0, r1 - r0, static_cast<uint64_t>(min(level, ts_col, k0)) / 1000.0, 0, 0, 0};
+        double sum = 0;
+        for (uint64_t k = k0; k < k1; k++) {
+            double lo = number(min(level, column, k)), hi = number(max(level, column, k));
+            pt.min = k == k0 ? lo : std::min(pt.min, lo);
+            pt.max = k == k0 ? hi : std::max(pt.max, hi);
+            sum += static_cast<double>(mean(level, column, k)) * bucket_rows(f, k, row_count());
+        }
+        pt.mean = sum / pt.rows;
+        series.points.push_back(pt);
+    }
+    return series;
+}
+
+} // namespace benji
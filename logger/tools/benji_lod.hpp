@@ -0,0 +1,145 @@
+/*
+ * benji_lod.hpp
+ *
+ * Level-of-detail pyramid for plotting long .benji2 logs (".lod", stored
+ * next to the log as <log>.benji2.lod). Level l summarises every block of
+ * kLodFanout^(l+1) records per channel as min, max and mean:
+ *
+ *   LodHeader                            64 bytes
+ *   ColumnDesc x column_count            as in .bcol; offset unused, min/max of the whole log
+ *   LodLevel x level_count               16 bytes each
+ *   LodArrays x level_count*column_count 24 bytes each, level-major
+ *   arrays, each 64-byte aligned         min and max in the column's storage
+ *                                        width (benji_columnar.hpp encoding),
+ *                                        mean as float
+ *
+ * A plot of any window then reads at most a few buckets per pixel from the
+ * coarsest level that still has one bucket per pixel, instead of every
+ * record. TS is always included: its min per bucket is the bucket's start
+ * time, so windows are located without touching the log.
+ */
+#ifndef BENJI_LOD_HPP
+#define BENJI_LOD_HPP
+
+#include "benji_columnar.hpp"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace benji {
+
+constexpr char kLodMagic[8] = {'B', 'L', 'O', 'D', 'v', '1', '\r', '\n'};
+constexpr uint64_t kLodFanout = 16;
+
+struct LodHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t column_count;
+    uint32_t level_count;
+    uint32_t fanout;
+    uint64_t source_size; // Of the .benji2 file, to detect a stale pyramid
+    uint64_t source_records;
+    uint64_t reserved[3];
+};
+
+struct LodLevel {
+    uint64_t factor;  // Records per bucket
+    uint64_t buckets; // The last bucket may hold fewer records
+};
+
+struct LodArrays {
+    uint64_t min; // File offsets
+    uint64_t max;
+    uint64_t mean;
+};
+
+static_assert(sizeof(LodHeader) == 64, "LodHeader layout");
+static_assert(sizeof(LodLevel) == 16, "LodLevel layout");
+static_assert(sizeof(LodArrays) == 24, "LodArrays layout");
+
+inline std::string lod_path(const std::string &log_path) {
+    return log_path + ".lod";
+}
+
+/**
+ * Build the pyramid for the given columns (TS is added if missing) and write
+ * it to path. Levels stop at the first factor larger than the log.
+ * threads == 0 uses the hardware concurrency.
+ */
+void write_lod(const Log &log, std::vector<ColumnSpec> columns, const std::string &path, unsigned threads);
+
+// One plotted pixel column: the aggregate of records [first_row, first_row + rows)
+struct PlotPoint {
+    uint64_t first_row;
+    uint64_t rows;
+    double time_s; // TS of first_row
+    double min;
+    double max;
+    double mean;
+};
+
+struct PlotSeries {
+    int level;         // Pyramid level used, -1 for raw records
+    uint64_t factor;   // Records per bucket at that level (1 for raw)
+    std::pair<size_t, size_t> rows; // Records in the requested window
+    std::vector<PlotPoint> points;  // At most `pixels`
+};
+
+class LodFile {
+public:
+    explicit LodFile(const std::string &path);
+    ~LodFile();
+    LodFile(const LodFile &) = delete;
+    LodFile &operator=(const LodFile &) = delete;
+
+    uint64_t source_size() const { return header_->source_size; }
+    uint64_t row_count() const { return header_->source_records; }
+    uint32_t level_count() const { return header_->level_count; }
+    const LodLevel &level(uint32_t l) const { return levels_[l]; }
+    uint32_t column_count() const { return header_->column_count; }
+    const ColumnDesc &column(uint32_t c) const { return descs_[c]; }
+
+    // Index of the named column, or -1
+    int find(const std::string &name) const;
+
+    // True if the pyramid was built from this log as it is now
+    bool matches(const Log &log) const {
+        return source_size() == log.file_size() && row_count() == log.record_count();
+    }
+
+    // Coarsest level with at least one bucket per pixel over `rows` records, or -1 for raw
+    int choose_level(uint64_t rows, unsigned pixels) const;
+
+    // Bucket values, sign-extended for signed columns
+    int64_t min(uint32_t level, uint32_t column, uint64_t bucket) const;
+    int64_t max(uint32_t level, uint32_t column, uint64_t bucket) const;
+    float mean(uint32_t level, uint32_t column, uint64_t bucket) const;
+
+    /**
+     * Min/max/mean of channel over [from_ms, to_ms] in at most `pixels`
+     * points. Reads raw records from log only when the window holds fewer
+     * than kLodFanout records per pixel. Throws if the pyramid is stale or
+     * the channel is not in it.
+     */
+    PlotSeries query(const Log &log, const std::string &channel, uint32_t from_ms, uint32_t to_ms,
+                     unsigned pixels) const;
+
+private:
+    const LodArrays &arrays(uint32_t level, uint32_t column) const {
+        return arrays_[static_cast<size_t>(level) * header_->column_count + column];
+    }
+    int64_t stored(uint64_t offset, const ColumnDesc &desc, uint64_t bucket) const;
+
+    const uint8_t *base_ = nullptr;
+    size_t size_ = 0;
+    const LodHeader *header_ = nullptr;
+    const ColumnDesc *descs_ = nullptr;
+    const LodLevel *levels_ = nullptr;
+    const LodArrays *arrays_ = nullptr;
+};
+
+} // namespace benji
+
+#endif // BENJI_LOD_HPP
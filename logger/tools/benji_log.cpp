@@ -0,0 +1,237 @@
+#include "benji_log.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace benji {
+
+namespace {
+
+// NAME followed only by digits continues the channel whose base is NAME
+bool is_continuation(std::string_view name, std::string_view base) {
+    if (name.size() <= base.size() || name.substr(0, base.size()) != base) {
+        return false;
+    }
+    for (char c : name.substr(base.size())) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::runtime_error sys_error(const std::string &what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+Schema Schema::parse(std::string_view header) {
+    Schema schema;
+    size_t pos = 0;
+    while (pos < header.size()) {
+        size_t comma = header.find(',', pos);
+        if (comma == std::string_view::npos) {
+            comma = header.size();
+        }
+        std::string_view name = header.substr(pos, comma - pos);
+        pos = comma + 1;
+        if (name.empty()) {
+            throw std::runtime_error("empty channel name at header byte " + std::to_string(comma));
+        }
+
+        std::vector<Channel> &chs = schema.channels_;
+        if (!chs.empty() && chs.back().width < 8 && is_continuation(name, chs.back().name)) {
+            chs.back().width++;
+        } else {
+            chs.push_back(Channel{std::string(name), static_cast<uint32_t>(schema.record_size_), 1});
+        }
+        schema.record_size_++;
+    }
+    if (schema.record_size_ == 0) {
+        throw std::runtime_error("log header lists no channels");
+    }
+    return schema;
+}
+
+const Channel *Schema::find(std::string_view name) const {
+    for (const Channel &ch : channels_) {
+        if (ch.name == name) {
+            return &ch;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<Channel> Schema::select(std::string_view list) const {
+    if (list.empty()) {
+        return channels_;
+    }
+    std::vector<Channel> out;
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string_view::npos) {
+            comma = list.size();
+        }
+        std::string_view pattern = list.substr(pos, comma - pos);
+        pos = comma + 1;
+        if (pattern.empty()) {
+            continue;
+        }
+
+        bool prefix = pattern.back() == '*';
+        if (prefix) {
+            pattern.remove_suffix(1);
+        }
+        size_t before = out.size();
+        for (const Channel &ch : channels_) {
+            if (prefix ? ch.name.compare(0, pattern.size(), pattern) == 0 : ch.name == pattern) {
+                out.push_back(ch);
+            }
+        }
+        if (out.size() == before) {
+            throw std::runtime_error("no channel matches '" + std::string(pattern) + (prefix ? "*'" : "'"));
+        }
+    }
+    return out;
+}
+
+Log::Log(const std::string &path) : path_(path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw sys_error(path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw sys_error(path);
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ < 4) {
+        close(fd);
+        throw std::runtime_error(path + ": too short for a .benji2 header");
+    }
+
+    void *map = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file referenced
+    if (map == MAP_FAILED) {
+        throw sys_error(path);
+    }
+    base_ = static_cast<const uint8_t *>(map);
+
+    // Header length is written little-endian by open_log_file()
+    uint32_t header_len = base_[0] | base_[1] << 8 | base_[2] << 16 | static_cast<uint32_t>(base_[3]) << 24;
+    try {
+        if (header_len > size_ - 4) {
+            throw std::runtime_error(path + ": header length " + std::to_string(header_len) + " exceeds file size");
+        }
+        schema_ = Schema::parse(std::string_view(reinterpret_cast<const char *>(base_ + 4), header_len));
+    } catch (...) {
+        unmap();
+        throw;
+    }
+    data_offset_ = 4 + static_cast<size_t>(header_len);
+    records_ = (size_ - data_offset_) / schema_.record_size();
+    ts_ = schema_.find("TS");
+}
+
+Log::~Log() { unmap(); }
+
+Log::Log(Log &&other) noexcept
+    : path_(std::move(other.path_)), base_(other.base_), size_(other.size_), data_offset_(other.data_offset_),
+      records_(other.records_), schema_(std::move(other.schema_)), ts_(other.ts_) {
+    other.base_ = nullptr;
+    other.ts_ = nullptr;
+}
+
+Log &Log::operator=(Log &&other) noexcept {
+    if (this != &other) {
+        unmap();
+        path_ = std::move(other.path_);
+        base_ = other.base_;
+        size_ = other.size_;
+        data_offset_ = other.data_offset_;
+        records_ = other.records_;
+        schema_ = std::move(other.schema_);
+        ts_ = other.ts_;
+        other.base_ = nullptr;
+        other.ts_ = nullptr;
+    }
+    return *this;
+}
+
+void Log::unmap() {
+    if (base_ != nullptr) {
+        munmap(const_cast<uint8_t *>(base_), size_);
+        base_ = nullptr;
+    }
+}
+
+void Log::advise_sequential() const {
+    if (base_ != nullptr) {
+        madvise(const_cast<uint8_t *>(base_), size_, MADV_SEQUENTIAL);
+    }
+}
+
+std::pair<size_t, size_t> Log::time_range(uint32_t from_ms, uint32_t to_ms) const {
+    if (ts_ == nullptr) {
+        throw std::runtime_error(path_ + ": no TS channel for a time range");
+    }
+    auto first_at_least = [&](uint64_t t) {
+        size_t lo = 0, hi = records_;
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (record(mid).raw(*ts_) < t) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        return lo;
+    };
+    size_t first = first_at_least(from_ms);
+    size_t last = first_at_least(static_cast<uint64_t>(to_ms) + 1);
+    return {first, last < first ? first : last};
+}
+
+TimingCheck check_timing(const Log &log, size_t first, size_t last) {
+    const Channel *ts = log.schema().find("TS");
+    if (ts == nullptr) {
+        throw std::runtime_error(log.path() + ": no TS channel");
+    }
+
+    TimingCheck check;
+    check.records = last - first;
+    uint64_t gap_sum = 0;
+    uint64_t prev = 0;
+    for (size_t i = first; i < last; i++) {
+        uint64_t t = log.record(i).raw(*ts);
+        if (i > first) {
+            if (t < prev) {
+                check.backwards++;
+            } else {
+                if (t == prev) {
+                    check.repeats++;
+                }
+                gap_sum += t - prev;
+                if (t - prev > check.max_gap_ms) {
+                    check.max_gap_ms = t - prev;
+                    check.max_gap_at = i;
+                }
+            }
+        }
+        prev = t;
+    }
+    size_t steps = check.records > 1 ? check.records - 1 - check.backwards : 0;
+    check.mean_gap_ms = steps > 0 ? static_cast<double>(gap_sum) / steps : 0;
+    return check;
+}
+
+} // namespace benji
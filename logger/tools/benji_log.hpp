@@ -0,0 +1,186 @@
+/*
+ * benji_log.hpp
+ *
+ * Reader for the .benji2 files written by log_file_open() in main/log_file.c:
+ *
+ *   u32 header_len (little-endian)
+ *   header_len bytes of "NAME," per record byte (multi-byte channels are
+ *                    NAME, NAME1, NAME2, ...)
+ *   records of schema.record_size() bytes, multi-byte values big-endian
+ *
+ * The file is memory-mapped and records are viewed in place; nothing is
+ * copied until a value is read. A trailing partial record (power cut mid
+ * write) is ignored and reported by Log::trailing_bytes().
+ */
+#ifndef BENJI_LOG_HPP
+#define BENJI_LOG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace benji {
+
+struct Channel {
+    std::string name;
+    uint32_t offset = 0; // First byte within a record
+    uint8_t width = 1;   // Bytes, big-endian
+};
+
+class Schema {
+public:
+    // Throws std::runtime_error on an empty or malformed header
+    static Schema parse(std::string_view header);
+
+    const std::vector<Channel> &channels() const { return channels_; }
+    size_t record_size() const { return record_size_; }
+
+    // nullptr if the log has no such channel
+    const Channel *find(std::string_view name) const;
+
+    // Comma-separated names; a trailing '*' matches by prefix ("FUS_*").
+    // Empty selects every channel. Throws on names that match nothing.
+    std::vector<Channel> select(std::string_view list) const;
+
+private:
+    std::vector<Channel> channels_;
+    size_t record_size_ = 0;
+};
+
+// Unsigned big-endian load of a channel of any width up to 8 bytes
+inline uint64_t load_be(const uint8_t *p, uint8_t width) {
+    switch (width) {
+        case 1:
+            return p[0];
+        case 2:
+            return static_cast<uint16_t>(p[0] << 8 | p[1]);
+        case 4: {
+            uint32_t v;
+            std::memcpy(&v, p, 4);
+            return __builtin_bswap32(v);
+        }
+        default: {
+            uint64_t v = 0;
+            for (uint8_t i = 0; i < width; i++) {
+                v = v << 8 | p[i];
+            }
+            return v;
+        }
+    }
+}
+
+class RecordView {
+public:
+    explicit RecordView(const uint8_t *data) : data_(data) {}
+
+    const uint8_t *data() const { return data_; }
+
+    uint64_t raw(const Channel &ch) const { return load_be(data_ + ch.offset, ch.width); }
+
+    // Two's complement interpretation of the channel's width
+    int64_t as_signed(const Channel &ch) const {
+        uint64_t v = raw(ch);
+        unsigned bits = ch.width * 8u;
+        if (bits < 64 && (v >> (bits - 1)) & 1) {
+            v |= ~0ULL << bits;
+        }
+        return static_cast<int64_t>(v);
+    }
+
+    template <typename T>
+    T get(const Channel &ch) const {
+        return static_cast<T>(std::is_signed<T>::value ? static_cast<uint64_t>(as_signed(ch)) : raw(ch));
+    }
+
+private:
+    const uint8_t *data_;
+};
+
+class Log {
+public:
+    // Maps the whole file read-only; throws std::runtime_error on failure
+    explicit Log(const std::string &path);
+    ~Log();
+    Log(Log &&other) noexcept;
+    Log &operator=(Log &&other) noexcept;
+    Log(const Log &) = delete;
+    Log &operator=(const Log &) = delete;
+
+    const std::string &path() const { return path_; }
+    const Schema &schema() const { return schema_; }
+    size_t file_size() const { return size_; }
+    const uint8_t *file_data() const { return base_; } // Whole file, header included
+    size_t data_offset() const { return data_offset_; }
+    size_t record_count() const { return records_; }
+    size_t trailing_bytes() const { return size_ - data_offset_ - records_ * schema_.record_size(); }
+
+    RecordView record(size_t i) const { return RecordView(base_ + data_offset_ + i * schema_.record_size()); }
+    const uint8_t *records_begin() const { return base_ + data_offset_; }
+
+    // Index range [first, last) of records whose TS (ms) lies in [from_ms, to_ms].
+    // TS is monotonic within a session, so this is a binary search.
+    std::pair<size_t, size_t> time_range(uint32_t from_ms, uint32_t to_ms) const;
+
+    // Tell the kernel the mapping will be read front to back (more read-ahead)
+    void advise_sequential() const;
+
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = RecordView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = RecordView;
+
+        iterator(const uint8_t *p, size_t stride) : p_(p), stride_(stride) {}
+        RecordView operator*() const { return RecordView(p_); }
+        iterator &operator++() {
+            p_ += stride_;
+            return *this;
+        }
+        iterator operator+(difference_type n) const { return iterator(p_ + n * static_cast<difference_type>(stride_), stride_); }
+        difference_type operator-(const iterator &o) const { return (p_ - o.p_) / static_cast<difference_type>(stride_); }
+        bool operator==(const iterator &o) const { return p_ == o.p_; }
+        bool operator!=(const iterator &o) const { return p_ != o.p_; }
+
+    private:
+        const uint8_t *p_;
+        size_t stride_;
+    };
+
+    iterator begin() const { return iterator(records_begin(), schema_.record_size()); }
+    iterator end() const { return begin() + static_cast<std::ptrdiff_t>(records_); }
+
+private:
+    void unmap();
+
+    std::string path_;
+    const uint8_t *base_ = nullptr;
+    size_t size_ = 0;
+    size_t data_offset_ = 0;
+    size_t records_ = 0;
+    Schema schema_;
+    const Channel *ts_ = nullptr; // Points into schema_, whose vector storage survives moves
+};
+
+struct TimingCheck {
+    size_t records = 0;
+    size_t backwards = 0;     // TS lower than the record before
+    size_t repeats = 0;       // TS equal to the record before
+    uint64_t max_gap_ms = 0;
+    size_t max_gap_at = 0;    // Record after the largest gap
+    double mean_gap_ms = 0;   // Over forward steps only
+};
+
+// TS continuity over records [first, last); throws if the log has no TS channel
+TimingCheck check_timing(const Log &log, size_t first, size_t last);
+
+} // namespace benji
+
+#endif // BENJI_LOG_HPP
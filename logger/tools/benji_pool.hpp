@@ -0,0 +1,178 @@
+/*
+ * benji_pool.hpp
+ *
+ * Work-stealing thread pool for the batch tools. Every worker owns a deque:
+ * tasks submitted from a worker go to the back of its own deque and are
+ * popped from there (newest first, so a file's follow-up stages run while
+ * its data is still cached); idle workers steal the oldest task from the
+ * front of another worker's deque. Tasks may submit further tasks.
+ */
+#ifndef BENJI_POOL_HPP
+#define BENJI_POOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace benji {
+
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+
+    explicit WorkStealingPool(unsigned threads) {
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        for (unsigned i = 0; i < threads; i++) {
+            queues_.push_back(std::make_unique<Queue>());
+        }
+        for (unsigned i = 0; i < threads; i++) {
+            workers_.emplace_back([this, i] { run(i); });
+        }
+    }
+
+    ~WorkStealingPool() {
+        wait();
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (std::thread &t : workers_) {
+            t.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool &) = delete;
+    WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers_.size()); }
+
+    void submit(Task task) {
+        // From a worker of this pool: own deque. Otherwise spread round-robin.
+        size_t q = (current_pool() == this) ? current_index() : next_queue_++ % queues_.size();
+        pending_.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(queues_[q]->mutex);
+            queues_[q]->tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            queued_++;
+        }
+        wake_.notify_one();
+    }
+
+    // Block until every submitted task, including tasks they submitted, has finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(done_mutex_);
+        done_.wait(lock, [this] { return pending_.load() == 0; });
+    }
+
+    size_t steals() const { return steals_.load(); }
+
+    // First exception message thrown by a task (tasks are expected to handle their own errors)
+    std::string first_error() {
+        std::lock_guard<std::mutex> lock(done_mutex_);
+        return first_error_;
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    static WorkStealingPool *&current_pool() {
+        static thread_local WorkStealingPool *pool = nullptr;
+        return pool;
+    }
+    static size_t &current_index() {
+        static thread_local size_t index = 0;
+        return index;
+    }
+
+    bool take(size_t self, Task &task) {
+        {
+            Queue &own = *queues_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues_.size(); k++) {
+            Queue &victim = *queues_[(self + k) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                steals_.fetch_add(1);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(size_t self) {
+        current_pool() = this;
+        current_index() = self;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(wake_mutex_);
+                wake_.wait(lock, [this] { return stop_ || queued_ > 0; });
+                if (stop_ && queued_ == 0) {
+                    return;
+                }
+                queued_--; // Claim one queued task; take() below is then guaranteed to find one
+            }
+
+            Task task;
+            // Every claim matches a task pushed before queued_ was raised, so this finds one
+            while (!take(self, task)) {
+                std::this_thread::yield();
+            }
+            try {
+                task();
+            } catch (const std::exception &e) {
+                std::lock_guard<std::mutex> lock(done_mutex_);
+                if (first_error_.empty()) {
+                    first_error_ = e.what();
+                }
+            }
+            if (pending_.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(done_mutex_);
+                done_.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> next_queue_{0};
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> steals_{0};
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    size_t queued_ = 0;
+    bool stop_ = false;
+
+    std::mutex done_mutex_;
+    std::condition_variable done_;
+    std::string first_error_;
+};
+
+} // namespace benji
+
+#endif // BENJI_POOL_HPP
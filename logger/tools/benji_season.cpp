@@ -0,0 +1,401 @@
+/*
+ * benji_season.cpp
+ *
+ * Batch processor for a directory of .benji2 logs. Every log is opened and
+ * hashed, then validated (TS continuity) and converted to .bcol in parallel;
+ * once both are done a one-line summary is written. Stages run as tasks on a
+ * work-stealing pool (benji_pool.hpp), so one long session does not hold up
+ * the rest of the season.
+ *
+ * Results are cached under the file's content hash: <cache>/<hash>.bcol and
+ * <hash>.summary. A manifest of name, size and mtime avoids re-hashing
+ * unchanged files, so a re-run only opens logs that are new or modified.
+ *
+ * Usage: benji_season <dir> [options]
+ *   --cache dir    cache directory (default <dir>/.benji_cache)
+ *   --out file     season summary CSV (default <dir>/season_summary.csv)
+ *   --threads N    worker threads (default: all cores)
+ *   --force        ignore cached results
+ */
+#include "benji_columnar.hpp"
+#include "benji_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr const char *kManifestName = "manifest.tsv";
+constexpr const char *kSummaryColumns =
+    "records,duration_s,rate_hz,partial_bytes,ts_backwards,max_gap_ms,laps,top_speed_mph,status";
+
+// XXH64 (seed 0); fast enough that hashing stays well below the cost of reading the file
+uint64_t rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+uint64_t read64(const uint8_t *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint64_t xxh64(const uint8_t *p, size_t len) {
+    constexpr uint64_t P1 = 0x9E3779B185EBCA87ULL, P2 = 0xC2B2AE3D27D4EB4FULL, P3 = 0x165667B19E3779F9ULL,
+                       P4 = 0x85EBCA77C2B2AE63ULL, P5 = 0x27D4EB2F165667C5ULL;
+    auto round = [](uint64_t acc, uint64_t input) { return rotl64(acc + input * P2, 31) * P1; };
+    auto merge = [&](uint64_t acc, uint64_t v) { return (acc ^ round(0, v)) * P1 + P4; };
+
+    const uint8_t *end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        uint64_t v1 = P1 + P2, v2 = P2, v3 = 0, v4 = 0 - P1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = round(v1, read64(p));
+            v2 = round(v2, read64(p + 8));
+            v3 = round(v3, read64(p + 16));
+            v4 = round(v4, read64(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = merge(merge(merge(merge(h, v1), v2), v3), v4);
+    } else {
+        h = P5;
+    }
+    h += len;
+    for (; p + 8 <= end; p += 8) {
+        h = rotl64(h ^ round(0, read64(p)), 27) * P1 + P4;
+    }
+    if (p + 4 <= end) {
+        h = rotl64(h ^ (read32(p) * P1), 23) * P2 + P3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h = rotl64(h ^ (*p * P5), 11) * P1;
+    }
+    h ^= h >> 33;
+    h *= P2;
+    h ^= h >> 29;
+    h *= P3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string hex(uint64_t v) {
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%016" PRIx64, v);
+    return buf;
+}
+
+struct ManifestEntry {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+};
+
+// name -> entry; a missing or damaged manifest just means everything is re-hashed
+std::map<std::string, ManifestEntry> load_manifest(const fs::path &path) {
+    std::map<std::string, ManifestEntry> manifest;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string hash, name;
+        ManifestEntry e;
+        if (std::getline(fields, hash, '\t') && fields >> e.size >> e.mtime && fields.get() == '\t' &&
+            std::getline(fields, name)) {
+            e.hash = std::strtoull(hash.c_str(), nullptr, 16);
+            manifest[name] = e;
+        }
+    }
+    return manifest;
+}
+
+// Write to a temporary name and rename, so an interrupted run never leaves a truncated cache file
+void write_atomic(const fs::path &path, const std::string &contents) {
+    fs::path tmp = path;
+    tmp += ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out << contents;
+        if (!out) {
+            throw std::runtime_error(tmp.string() + ": write failed");
+        }
+    }
+    fs::rename(tmp, path);
+}
+
+bool read_line(const fs::path &path, std::string &line) {
+    std::ifstream in(path);
+    return static_cast<bool>(std::getline(in, line)) && !line.empty();
+}
+
+enum class Outcome { Pending, Cached, Processed, Failed };
+
+struct FileJob {
+    fs::path path;
+    std::string name;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    uint64_t hash = 0;
+    bool hash_known = false;
+
+    Outcome outcome = Outcome::Pending;
+    std::string summary; // kSummaryColumns, without the file name
+
+    // Working state while the file is being processed
+    std::unique_ptr<benji::Log> log;
+    std::atomic<int> stages_left{0};
+    benji::TimingCheck timing;
+    std::vector<benji::ColumnSpec> specs;
+    std::vector<benji::ColumnStats> stats;
+    std::string convert_error;
+};
+
+class Season {
+public:
+    Season(fs::path cache, unsigned threads, bool force) : cache_(std::move(cache)), pool_(threads), force_(force) {}
+
+    unsigned threads() const { return pool_.size(); }
+    size_t steals() const { return pool_.steals(); }
+
+    void run(std::vector<std::unique_ptr<FileJob>> &jobs) {
+        total_ = jobs.size();
+        for (std::unique_ptr<FileJob> &job : jobs) {
+            if (job->hash_known && load_cached(*job)) {
+                continue;
+            }
+            FileJob *j = job.get();
+            pool_.submit([this, j] { open_stage(*j); });
+        }
+        pool_.wait();
+    }
+
+private:
+    fs::path cached(const FileJob &job, const char *ext) const { return cache_ / (hex(job.hash) + ext); }
+
+    bool load_cached(FileJob &job) {
+        if (force_ || !fs::exists(cached(job, ".bcol")) || !read_line(cached(job, ".summary"), job.summary)) {
+            return false;
+        }
+        job.outcome = Outcome::Cached;
+        return true;
+    }
+
+    // Map and hash the file; on a cache miss fan out into validation and conversion
+    void open_stage(FileJob &job) {
+        try {
+            job.log = std::make_unique<benji::Log>(job.path.string());
+            job.hash = xxh64(job.log->file_data(), job.log->file_size());
+            job.hash_known = true;
+        } catch (const std::exception &e) {
+            fail(job, e.what());
+            return;
+        }
+        if (load_cached(job)) {
+            job.log.reset();
+            report(job, "cached (renamed or touched)");
+            return;
+        }
+
+        job.stages_left = 2;
+        job.log->advise_sequential();
+        pool_.submit([this, &job] {
+            job.timing = benji::check_timing(*job.log, 0, job.log->record_count());
+            finish_stage(job);
+        });
+        pool_.submit([this, &job] {
+            try {
+                job.specs = benji::column_specs(job.log->schema(), "", "");
+                fs::path tmp = cached(job, ".bcol.tmp");
+                // One thread per file: the pool already runs files side by side
+                job.stats = benji::write_columnar(*job.log, job.specs, tmp.string(), benji::Transpose::Simd, 1);
+                fs::rename(tmp, cached(job, ".bcol"));
+            } catch (const std::exception &e) {
+                job.convert_error = e.what();
+            }
+            finish_stage(job);
+        });
+    }
+
+    // The last of validation/conversion to finish writes the summary and releases the mapping
+    void finish_stage(FileJob &job) {
+        if (job.stages_left.fetch_sub(1) != 1) {
+            return;
+        }
+        if (!job.convert_error.empty()) {
+            job.log.reset();
+            fail(job, job.convert_error);
+            return;
+        }
+        job.summary = summarize(job);
+        job.log.reset();
+        try {
+            write_atomic(cached(job, ".summary"), job.summary + "\n");
+        } catch (const std::exception &e) {
+            fail(job, e.what());
+            return;
+        }
+        job.outcome = Outcome::Processed;
+        report(job, "processed");
+    }
+
+    std::string summarize(const FileJob &job) const {
+        const benji::Log &log = *job.log;
+        const benji::TimingCheck &t = job.timing;
+        double duration = 0;
+        if (const benji::Channel *ts = log.schema().find("TS"); ts != nullptr && log.record_count() > 1) {
+            uint64_t t0 = log.record(0).raw(*ts), t1 = log.record(log.record_count() - 1).raw(*ts);
+            duration = t1 > t0 ? (t1 - t0) / 1000.0 : 0;
+        }
+        auto column_max = [&](const char *name) -> std::string {
+            for (size_t i = 0; i < job.specs.size(); i++) {
+                if (job.specs[i].channel.name == name && log.record_count() > 0) {
+                    return std::to_string(job.stats[i].max);
+                }
+            }
+            return "";
+        };
+
+        std::string status = "ok";
+        if (t.backwards > 0) {
+            status = "ts backwards";
+        } else if (log.trailing_bytes() > 0) {
+            status = "partial record";
+        }
+
+        char buf[256];
+        snprintf(buf, sizeof(buf), "%zu,%.3f,%.1f,%zu,%zu,%" PRIu64 ",%s,%s,%s", log.record_count(), duration,
+                 duration > 0 ? (log.record_count() - 1) / duration : 0.0, log.trailing_bytes(), t.backwards,
+                 t.max_gap_ms, column_max("LAP_NUM").c_str(), column_max("GPS_SPD").c_str(), status.c_str());
+        return buf;
+    }
+
+    void fail(FileJob &job, std::string message) {
+        std::replace(message.begin(), message.end(), ',', ';');
+        job.summary = ",,,,,,,," + message;
+        job.outcome = Outcome::Failed;
+        report(job, "FAILED: " + message);
+    }
+
+    void report(const FileJob &job, const std::string &what) {
+        std::lock_guard<std::mutex> lock(print_mutex_);
+        printf("[%zu/%zu] %s: %s\n", ++done_, total_, job.name.c_str(), what.c_str());
+        fflush(stdout);
+    }
+
+    fs::path cache_;
+    benji::WorkStealingPool pool_;
+    bool force_;
+    std::mutex print_mutex_;
+    size_t done_ = 0;
+    size_t total_ = 0;
+};
+
+int usage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " <dir> [--cache dir] [--out summary.csv] [--threads N] [--force]\n";
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string dir, cache_dir, out_path;
+    unsigned threads = 0;
+    bool force = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--cache" && has_value) {
+            cache_dir = argv[++i];
+        } else if (arg == "--out" && has_value) {
+            out_path = argv[++i];
+        } else if (arg == "--threads" && has_value) {
+            threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--force") {
+            force = true;
+        } else if (arg.rfind("--", 0) == 0 || !dir.empty()) {
+            return usage(argv[0]);
+        } else {
+            dir = arg;
+        }
+    }
+    if (dir.empty()) {
+        return usage(argv[0]);
+    }
+    fs::path cache = cache_dir.empty() ? fs::path(dir) / ".benji_cache" : fs::path(cache_dir);
+    fs::path out = out_path.empty() ? fs::path(dir) / "season_summary.csv" : fs::path(out_path);
+
+    try {
+        fs::create_directories(cache);
+        std::map<std::string, ManifestEntry> manifest = load_manifest(cache / kManifestName);
+
+        std::vector<std::unique_ptr<FileJob>> jobs;
+        for (const fs::directory_entry &entry : fs::directory_iterator(dir)) {
+            if (!entry.is_regular_file() || entry.path().extension() != ".benji2") {
+                continue;
+            }
+            auto job = std::make_unique<FileJob>();
+            job->path = entry.path();
+            job->name = entry.path().filename().string();
+            job->size = entry.file_size();
+            job->mtime = static_cast<int64_t>(entry.last_write_time().time_since_epoch().count());
+            auto known = manifest.find(job->name);
+            if (known != manifest.end() && known->second.size == job->size && known->second.mtime == job->mtime) {
+                job->hash = known->second.hash;
+                job->hash_known = true;
+            }
+            jobs.push_back(std::move(job));
+        }
+        std::sort(jobs.begin(), jobs.end(), [](const auto &a, const auto &b) { return a->name < b->name; });
+
+        auto start = Clock::now();
+        Season season(cache, threads, force);
+        season.run(jobs);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::string manifest_text, csv = std::string("file,hash,") + kSummaryColumns + "\n";
+        size_t counts[4] = {};
+        for (const std::unique_ptr<FileJob> &job : jobs) {
+            counts[static_cast<int>(job->outcome)]++;
+            if (job->hash_known) {
+                manifest_text += hex(job->hash) + "\t" + std::to_string(job->size) + "\t" +
+                                 std::to_string(job->mtime) + "\t" + job->name + "\n";
+            }
+            csv += job->name + "," + (job->hash_known ? hex(job->hash) : "") + "," + job->summary + "\n";
+        }
+        write_atomic(cache / kManifestName, manifest_text);
+        write_atomic(out, csv);
+
+        printf("%zu files: %zu cached, %zu processed, %zu failed in %.2f s (%u threads, %zu steals)\n", jobs.size(),
+               counts[static_cast<int>(Outcome::Cached)], counts[static_cast<int>(Outcome::Processed)],
+               counts[static_cast<int>(Outcome::Failed)], seconds, season.threads(), season.steals());
+        printf("Summary: %s\n", out.string().c_str());
+        return counts[static_cast<int>(Outcome::Failed)] > 0 ? 1 : 0;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
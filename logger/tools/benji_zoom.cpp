@@ -0,0 +1,218 @@
+/*
+ * benji_zoom.cpp
+ *
+ * Builds and queries the level-of-detail pyramid of a log (benji_lod.hpp).
+ *
+ * Usage: benji_zoom <log.benji2> build [--channels A,FUS_*] [--signed A,...] [--threads N]
+ *        benji_zoom <log.benji2> query <CHANNEL> [--from S] [--to S] [--pixels N] [--check]
+ *        benji_zoom <log.benji2> bench [--pixels N]
+ *   build   write <log>.lod next to the log
+ *   query   min/max/mean of one channel per pixel as CSV; --check compares
+ *           every point with a scan of the raw records it covers
+ *   bench   random zoom windows through the pyramid vs a full scan
+ */
+#include "benji_lod.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string command;
+    std::string channel;
+    std::string channels;
+    std::string signed_list;
+    double from_s = 0;
+    double to_s = -1;
+    unsigned pixels = 1920;
+    unsigned threads = 0;
+    bool check = false;
+};
+
+double ms_since(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Aggregate of the raw records a point claims to cover
+bool point_matches(const benji::Log &log, const benji::Channel &ch, bool is_signed, const benji::PlotPoint &pt) {
+    double lo = 0, hi = 0, sum = 0;
+    for (uint64_t r = pt.first_row; r < pt.first_row + pt.rows; r++) {
+        benji::RecordView rec = log.record(r);
+        double v = is_signed ? static_cast<double>(rec.as_signed(ch)) : static_cast<double>(rec.raw(ch));
+        lo = r == pt.first_row ? v : std::min(lo, v);
+        hi = r == pt.first_row ? v : std::max(hi, v);
+        sum += v;
+    }
+    // Bucket means are stored as float
+    double tolerance = 1e-6 * std::max({1.0, std::abs(lo), std::abs(hi)});
+    return lo == pt.min && hi == pt.max && std::abs(sum / pt.rows - pt.mean) <= tolerance;
+}
+
+int cmd_build(const benji::Log &log, const Options &opt) {
+    std::vector<benji::ColumnSpec> specs = benji::column_specs(log.schema(), opt.channels, opt.signed_list);
+    std::string path = benji::lod_path(log.path());
+    log.advise_sequential();
+    auto start = Clock::now();
+    benji::write_lod(log, specs, path, opt.threads);
+    double ms = ms_since(start);
+
+    benji::LodFile lod(path);
+    double mib = log.record_count() * log.schema().record_size() / (1024.0 * 1024.0);
+    printf("%s: %u columns, %u levels in %.0f ms (%.0f MiB/s)\n", path.c_str(), lod.column_count(),
+           lod.level_count(), ms, ms > 0 ? mib / (ms / 1000) : 0.0);
+    for (uint32_t l = 0; l < lod.level_count(); l++) {
+        printf("  level %u: 1:%llu, %llu buckets\n", l, static_cast<unsigned long long>(lod.level(l).factor),
+               static_cast<unsigned long long>(lod.level(l).buckets));
+    }
+    return 0;
+}
+
+int cmd_query(const benji::Log &log, const Options &opt) {
+    benji::LodFile lod(benji::lod_path(log.path()));
+    uint32_t from_ms = static_cast<uint32_t>(opt.from_s * 1000);
+    uint32_t to_ms = opt.to_s < 0 ? UINT32_MAX : static_cast<uint32_t>(opt.to_s * 1000);
+
+    auto start = Clock::now();
+    benji::PlotSeries series = lod.query(log, opt.channel, from_ms, to_ms, opt.pixels);
+    double ms = ms_since(start);
+    fprintf(stderr, "%zu records -> %zu points from level %d%s (1:%llu) in %.3f ms\n",
+            series.rows.second - series.rows.first, series.points.size(), series.level,
+            series.level < 0 ? " = raw records" : "", static_cast<unsigned long long>(series.factor), ms);
+
+    int mismatches = 0;
+    const benji::Channel *ch = log.schema().find(opt.channel);
+    bool is_signed = lod.column(static_cast<uint32_t>(lod.find(opt.channel))).is_signed;
+    printf("time_s,min,max,mean,first_row,rows\n");
+    for (const benji::PlotPoint &pt : series.points) {
+        printf("%.3f,%.17g,%.17g,%.9g,%llu,%llu\n", pt.time_s, pt.min, pt.max, pt.mean,
+               static_cast<unsigned long long>(pt.first_row), static_cast<unsigned long long>(pt.rows));
+        if (opt.check && !point_matches(log, *ch, is_signed, pt)) {
+            fprintf(stderr, "MISMATCH at row %llu\n", static_cast<unsigned long long>(pt.first_row));
+            mismatches++;
+        }
+    }
+    if (opt.check) {
+        fprintf(stderr, "check: %zu points, %d mismatches\n", series.points.size(), mismatches);
+    }
+    return mismatches > 0 ? 1 : 0;
+}
+
+int cmd_bench(const benji::Log &log, const Options &opt) {
+    benji::LodFile lod(benji::lod_path(log.path()));
+    const benji::Channel *ts = log.schema().find("TS");
+    if (ts == nullptr || log.record_count() < 2) {
+        throw std::runtime_error("bench needs a log with TS and at least two records");
+    }
+    uint32_t t0 = static_cast<uint32_t>(log.record(0).raw(*ts));
+    uint32_t t1 = static_cast<uint32_t>(log.record(log.record_count() - 1).raw(*ts));
+
+    // Full-resolution scan of one channel: what plotting costs without the pyramid
+    const benji::ColumnDesc &desc = lod.column(lod.column_count() - 1);
+    const benji::Channel *ch = log.schema().find(desc.name);
+    auto start = Clock::now();
+    double sum = 0;
+    for (benji::RecordView rec : log) {
+        sum += static_cast<double>(rec.raw(*ch));
+    }
+    double scan_ms = ms_since(start);
+    printf("Full scan of %s: %.1f ms (%zu records, checksum %.0f)\n", desc.name, scan_ms, log.record_count(), sum);
+
+    std::mt19937 rng(1);
+    std::vector<double> times;
+    size_t points = 0;
+    int levels_used[65] = {};
+    for (int i = 0; i < 1000; i++) {
+        // Log-uniform window widths from 10 ms to the whole session
+        double decades = std::log10((t1 - t0) / 10.0 + 1);
+        double span = (t1 - t0) * std::pow(10.0, -std::uniform_real_distribution<double>(0, decades)(rng));
+        uint32_t from = t0 + static_cast<uint32_t>(std::uniform_real_distribution<double>(0, t1 - t0 - span)(rng));
+        uint32_t column = static_cast<uint32_t>(rng() % lod.column_count());
+
+        auto q = Clock::now();
+        benji::PlotSeries series =
+            lod.query(log, lod.column(column).name, from, from + static_cast<uint32_t>(span), opt.pixels);
+        times.push_back(ms_since(q));
+        points += series.points.size();
+        levels_used[series.level + 1]++;
+    }
+    std::sort(times.begin(), times.end());
+    printf("1000 random windows at %u pixels: median %.3f ms, p99 %.3f ms, max %.3f ms (%.0f points/query)\n",
+           opt.pixels, times[times.size() / 2], times[times.size() * 99 / 100], times.back(), points / 1000.0);
+    printf("Levels used:");
+    printf(" raw=%d", levels_used[0]);
+    for (uint32_t l = 0; l < lod.level_count(); l++) {
+        printf(" L%u=%d", l, levels_used[l + 1]);
+    }
+    printf("\n");
+    return 0;
+}
+
+int usage(const char *argv0) {
+    std::cerr << "Usage: " << argv0 << " <log.benji2> build [--channels A,PREFIX*] [--signed A,...] [--threads N]\n"
+              << "       " << argv0 << " <log.benji2> query <CHANNEL> [--from S] [--to S] [--pixels N] [--check]\n"
+              << "       " << argv0 << " <log.benji2> bench [--pixels N]\n";
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    std::string path;
+    Options opt;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--channels" && has_value) {
+            opt.channels = argv[++i];
+        } else if (arg == "--signed" && has_value) {
+            opt.signed_list = argv[++i];
+        } else if (arg == "--from" && has_value) {
+            opt.from_s = std::atof(argv[++i]);
+        } else if (arg == "--to" && has_value) {
+            opt.to_s = std::atof(argv[++i]);
+        } else if (arg == "--pixels" && has_value) {
+            opt.pixels = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--threads" && has_value) {
+            opt.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+        } else if (arg == "--check") {
+            opt.check = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            return usage(argv[0]);
+        } else if (path.empty()) {
+            path = arg;
+        } else if (opt.command.empty()) {
+            opt.command = arg;
+        } else {
+            opt.channel = arg;
+        }
+    }
+    if (path.empty() || opt.command.empty() || (opt.command == "query" && opt.channel.empty())) {
+        return usage(argv[0]);
+    }
+
+    try {
+        benji::Log log(path);
+        if (opt.command == "build") {
+            return cmd_build(log, opt);
+        } else if (opt.command == "query") {
+            return cmd_query(log, opt);
+        } else if (opt.command == "bench") {
+            return cmd_bench(log, opt);
+        }
+        return usage(argv[0]);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,155 @@
+/*
+ * can_socketcan.c
+ *
+ * SocketCAN transport (see can_socketcan.h). A reader thread stands in for
+ * the TWAI receive interrupt: it takes each frame off a raw CAN socket and
+ * hands it to can_rx_from_isr(), which drops it if the receive queue is
+ * full, exactly as on the target. Frames the kernel drops because the socket
+ * buffer overflowed are reported as overruns (SO_RXQ_OVFL).
+ *
+ * Frame timestamps are the kernel receive time converted to the esp_timer
+ * time base, so queueing latency is measured from arrival at the socket.
+ */
+#define _GNU_SOURCE
+#include "can_socketcan.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <net/if.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "SOCKETCAN";
+
+static int sock = -1;
+static pthread_t reader;
+
+static int64_t timespec_us(const struct timespec *ts) {
+    return (int64_t)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+// Kernel receive time (CLOCK_REALTIME) as esp_timer time
+static uint64_t arrival_us(const struct timespec *rx) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t age = timespec_us(&now) - timespec_us(rx);
+    int64_t t = esp_timer_get_time() - (age > 0 ? age : 0);
+    return t > 0 ? (uint64_t)t : 0;
+}
+
+static void *reader_thread(void *arg) {
+    (void)arg;
+    struct canfd_frame frame;
+    char control[CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t))];
+    uint32_t kernel_drops = 0;
+
+    while (1) {
+        struct iovec iov = {.iov_base = &frame, .iov_len = sizeof(frame)};
+        struct msghdr msg = {
+            .msg_iov = &iov,
+            .msg_iovlen = 1,
+            .msg_control = control,
+            .msg_controllen = sizeof(control),
+        };
+        ssize_t n = recvmsg(sock, &msg, 0);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ESP_LOGE(TAG, "recvmsg: %s", strerror(errno));
+            return NULL;
+        }
+        if (n != CAN_MTU && n != CANFD_MTU) {
+            continue;
+        }
+
+        struct timespec rx_time = {0};
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&msg); c != NULL; c = CMSG_NXTHDR(&msg, c)) {
+            if (c->cmsg_level != SOL_SOCKET) {
+                continue;
+            }
+            if (c->cmsg_type == SO_TIMESTAMPNS) {
+                memcpy(&rx_time, CMSG_DATA(c), sizeof(rx_time));
+            } else if (c->cmsg_type == SO_RXQ_OVFL) {
+                uint32_t drops;
+                memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+                if (drops != kernel_drops) {
+                    can_rx_overrun(drops - kernel_drops);
+                    kernel_drops = drops;
+                }
+            }
+        }
+
+        if (frame.can_id & (CAN_ERR_FLAG | CAN_RTR_FLAG)) {
+            continue; // The TWAI receive path only delivers data frames
+        }
+        bool extended = (frame.can_id & CAN_EFF_FLAG) != 0;
+        twai_frame_header_t header = {
+            .id = frame.can_id & (extended ? CAN_EFF_MASK : CAN_SFF_MASK),
+            .dlc = frame.len,
+            .ide = extended,
+            .fdf = n == CANFD_MTU,
+            .brs = n == CANFD_MTU && (frame.flags & CANFD_BRS) != 0,
+            .timestamp = rx_time.tv_sec != 0 ? arrival_us(&rx_time) : (uint64_t)esp_timer_get_time(),
+        };
+        can_rx_from_isr(&header, frame.data);
+    }
+}
+
+static esp_err_t socketcan_start(const can_transport_t *transport) {
+    const char *ifname = transport->config;
+    sock = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (sock < 0) {
+        ESP_LOGE(TAG, "CAN socket: %s", strerror(errno));
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    struct ifreq ifr = {0};
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+    if (ioctl(sock, SIOCGIFINDEX, &ifr) < 0) {
+        ESP_LOGE(TAG, "No CAN interface %s: %s", ifname, strerror(errno));
+        close(sock);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    int on = 1;
+    // FD frames are optional: plain CAN still works if the kernel lacks them
+    setsockopt(sock, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &on, sizeof(on));
+    setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, &on, sizeof(on));
+
+    struct sockaddr_can addr = {
+        .can_family = AF_CAN,
+        .can_ifindex = ifr.ifr_ifindex,
+    };
+    if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "bind %s: %s", ifname, strerror(errno));
+        close(sock);
+        return ESP_FAIL;
+    }
+
+    if (pthread_create(&reader, NULL, reader_thread, NULL) != 0) {
+        close(sock);
+        return ESP_ERR_NO_MEM;
+    }
+    pthread_setname_np(reader, "socketcan_rx");
+    ESP_LOGI(TAG, "Listening on %s", ifname);
+    return ESP_OK;
+}
+
+can_transport_t can_socketcan_transport(const char *ifname) {
+    return (can_transport_t){
+        .name = "SocketCAN",
+        .start = socketcan_start,
+        .config = ifname,
+    };
+}
@@ -0,0 +1,17 @@
+/*
+ * can_socketcan.h
+ *
+ * Linux SocketCAN transport for main/can.c, so the host build can receive
+ * from a real adapter or a virtual bus (vcan0) driven by cangen/canplayer.
+ */
+#ifndef CAN_SOCKETCAN_H_
+#define CAN_SOCKETCAN_H_
+
+#include "can_transport.h"
+
+/**
+ * @brief Transport reading every frame on ifname (e.g. "vcan0"); ifname must outlive it
+ */
+can_transport_t can_socketcan_transport(const char *ifname);
+
+#endif /* CAN_SOCKETCAN_H_ */
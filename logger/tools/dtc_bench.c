@@ -0,0 +1,125 @@
+/*
+ * dtc_bench.c
+ *
+ * Host benchmark of DTC timeout evaluation: the original linear scan over a
+ * per-device uint64_t ring buffer against the monotonic-deque window in
+ * main/dtc_window.h. Both see the same inter-arrival stream and their
+ * maxima are cross-checked on every evaluation.
+ *
+ * Usage: dtc_bench [devices] [evaluations]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "dtc_window.h"
+
+#define EVENTS_PER_EVAL 5 // CAN frames per device between two 20 ms DTC checks (~250 Hz sources)
+
+typedef struct {
+    uint64_t *timeBuffer;
+    uint8_t bufferIndex;
+} naive_dtc;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint64_t naive_max(const naive_dtc *d) {
+    uint64_t max_response = 0;
+    for (uint8_t i = 0; i < DTC_MEASURES; i++) {
+        if (d->timeBuffer[i] > max_response) {
+            max_response = d->timeBuffer[i];
+        }
+    }
+    return max_response;
+}
+
+int main(int argc, char **argv) {
+    int devices = argc > 1 ? atoi(argv[1]) : 20;
+    long evals = argc > 2 ? atol(argv[2]) : 200000;
+    if (devices <= 0 || evals <= 0) {
+        fprintf(stderr, "Usage: %s [devices] [evaluations]\n", argv[0]);
+        return 1;
+    }
+
+    naive_dtc *naive = calloc(devices, sizeof(naive_dtc));
+    dtc_window_t *windows = calloc(devices, sizeof(dtc_window_t));
+    for (int d = 0; d < devices; d++) {
+        naive[d].timeBuffer = malloc(DTC_MEASURES * sizeof(uint64_t));
+        for (int i = 0; i < DTC_MEASURES; i++) {
+            naive[d].timeBuffer[i] = 100;
+        }
+        dtc_window_init(&windows[d], DTC_MEASURES, 100);
+    }
+
+    // Pre-generate jittery inter-arrival times (2-12 ms) so RNG cost is not measured
+    size_t n_deltas = (size_t)devices * EVENTS_PER_EVAL * 1024;
+    uint32_t *deltas = malloc(n_deltas * sizeof(uint32_t));
+    srand(1);
+    for (size_t i = 0; i < n_deltas; i++) {
+        deltas[i] = 2 + rand() % 11;
+    }
+
+    double push_naive = 0, push_window = 0, eval_naive = 0, eval_window = 0;
+    uint64_t sink = 0, mismatches = 0;
+    size_t k = 0;
+
+    for (long e = 0; e < evals; e++) {
+        size_t k0 = k;
+        double t0 = now_s();
+        for (int d = 0; d < devices; d++) {
+            for (int j = 0; j < EVENTS_PER_EVAL; j++) {
+                naive[d].timeBuffer[naive[d].bufferIndex] = deltas[k++ % n_deltas];
+                naive[d].bufferIndex = (naive[d].bufferIndex + 1) % DTC_MEASURES;
+            }
+        }
+        double t1 = now_s();
+        k = k0;
+        for (int d = 0; d < devices; d++) {
+            for (int j = 0; j < EVENTS_PER_EVAL; j++) {
+                dtc_window_push(&windows[d], deltas[k++ % n_deltas]);
+            }
+        }
+        double t2 = now_s();
+
+        uint64_t naive_sum = 0, window_sum = 0;
+        for (int d = 0; d < devices; d++) {
+            naive_sum += naive_max(&naive[d]);
+        }
+        double t3 = now_s();
+        for (int d = 0; d < devices; d++) {
+            window_sum += dtc_window_max(&windows[d]);
+        }
+        double t4 = now_s();
+
+        if (naive_sum != window_sum) {
+            mismatches++;
+        }
+        sink += naive_sum + window_sum;
+        push_naive += t1 - t0;
+        push_window += t2 - t1;
+        eval_naive += t3 - t2;
+        eval_window += t4 - t3;
+    }
+
+    double pushes = (double)evals * devices * EVENTS_PER_EVAL;
+    double checks = (double)evals * devices;
+    printf("devices=%d evaluations=%ld window=%d\n", devices, evals, DTC_MEASURES);
+    printf("%-22s %12s %12s\n", "", "linear scan", "mono deque");
+    printf("%-22s %10.1f ns %10.1f ns\n", "push per frame", push_naive / pushes * 1e9, push_window / pushes * 1e9);
+    printf("%-22s %10.1f ns %10.1f ns\n", "evaluate per device", eval_naive / checks * 1e9, eval_window / checks * 1e9);
+    printf("%-22s %10.2f us %10.2f us\n", "20 ms check (all)", eval_naive / evals * 1e6, eval_window / evals * 1e6);
+    printf("%-22s %12zu %12zu\n", "bytes per device", DTC_MEASURES * sizeof(uint64_t), sizeof(dtc_window_t));
+    printf("max mismatches: %llu (checksum %llu)\n", (unsigned long long)mismatches, (unsigned long long)sink);
+
+    for (int d = 0; d < devices; d++) {
+        free(naive[d].timeBuffer);
+    }
+    free(naive);
+    free(windows);
+    free(deltas);
+    return mismatches == 0 ? 0 : 1;
+}
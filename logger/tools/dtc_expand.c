@@ -0,0 +1,168 @@
+/*
+ * dtc_expand.c
+ *
+ * Expands the packed DTC_MAP bitmap and DTC_HEALTH word of a .benji2 log back
+ * into one 0/1 trace per device (1 = OK, 0 = Error), named from
+ * main/dtc_devices.h. By default only records where the DTC state changes are
+ * printed.
+ *
+ * Usage: dtc_expand <log.benji2> [out.csv] [--all]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "dtc_devices.h"
+
+#define MAX_CHANNELS 1024
+#define MAX_NAME 32
+#define MAX_MAP_WORDS 8
+
+#define X(name) #name,
+static const char *device_names[] = {DTC_DEVICES};
+#undef X
+#define DEVICE_COUNT (int)(sizeof(device_names) / sizeof(device_names[0]))
+
+static char names[MAX_CHANNELS][MAX_NAME];
+static size_t channel_count = 0;
+
+static int find_channel(const char *name) {
+    for (size_t i = 0; i < channel_count; i++) {
+        if (strcmp(names[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    fprintf(stderr, "Channel %s not found in log header\n", name);
+    return -1;
+}
+
+static uint32_t read_u32(const uint8_t *rec, int off) {
+    return (uint32_t)rec[off] << 24 | (uint32_t)rec[off + 1] << 16 | (uint32_t)rec[off + 2] << 8 | rec[off + 3];
+}
+
+// DTC_MAP spans 4 bytes per status word; older logs carry more words than this build
+static int map_words(int map) {
+    size_t bytes = 1;
+    while (map + bytes < channel_count && strncmp(names[map + bytes], "DTC_MAP", 7) == 0) {
+        bytes++;
+    }
+    return (int)(bytes / 4);
+}
+
+static uint16_t read_u16(const uint8_t *rec, int off) {
+    return (uint16_t)(rec[off] << 8 | rec[off + 1]);
+}
+
+static int parse_header(FILE *in) {
+    uint8_t len_bytes[4];
+    if (fread(len_bytes, 1, 4, in) != 4) {
+        fprintf(stderr, "Failed to read header length\n");
+        return -1;
+    }
+    // Header length is written little-endian by open_log_file()
+    uint32_t header_len = len_bytes[0] | len_bytes[1] << 8 | len_bytes[2] << 16 | (uint32_t)len_bytes[3] << 24;
+
+    char *header = malloc(header_len + 1);
+    if (header == NULL || fread(header, 1, header_len, in) != header_len) {
+        fprintf(stderr, "Failed to read %u byte header\n", header_len);
+        free(header);
+        return -1;
+    }
+    header[header_len] = '\0';
+
+    for (char *tok = strtok(header, ","); tok != NULL && channel_count < MAX_CHANNELS; tok = strtok(NULL, ",")) {
+        strncpy(names[channel_count], tok, MAX_NAME - 1);
+        channel_count++;
+    }
+    free(header);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *in_path = NULL;
+    const char *out_path = NULL;
+    int all = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--all") == 0) {
+            all = 1;
+        } else if (in_path == NULL) {
+            in_path = argv[i];
+        } else {
+            out_path = argv[i];
+        }
+    }
+    if (in_path == NULL) {
+        fprintf(stderr, "Usage: %s <log.benji2> [out.csv] [--all]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(in_path, "rb");
+    if (in == NULL) {
+        perror(in_path);
+        return 1;
+    }
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (out == NULL) {
+        perror(out_path);
+        return 1;
+    }
+    if (parse_header(in) != 0) {
+        return 1;
+    }
+
+    int ts = find_channel("TS");
+    int map = find_channel("DTC_MAP");
+    int health = find_channel("DTC_HEALTH");
+    if (ts < 0 || map < 0 || health < 0) {
+        return 1;
+    }
+    int words = map_words(map);
+    if (words < 1 || words > MAX_MAP_WORDS || words * 32 < DEVICE_COUNT) {
+        fprintf(stderr, "DTC_MAP has %d words, need %d for %d devices\n", words, (DEVICE_COUNT + 31) / 32, DEVICE_COUNT);
+        return 1;
+    }
+
+    fprintf(out, "time_s");
+    for (int i = 0; i < DEVICE_COUNT; i++) {
+        fprintf(out, ",%s", device_names[i]);
+    }
+    fprintf(out, ",errors,journal_drop,wheel_stopped\n");
+
+    uint8_t *rec = malloc(channel_count);
+    uint32_t cur_map[MAX_MAP_WORDS];
+    uint32_t prev_map[MAX_MAP_WORDS] = {0};
+    uint16_t prev_health = 0;
+    size_t records = 0, written = 0;
+
+    while (fread(rec, 1, channel_count, in) == channel_count) {
+        // Most significant word first: word w (devices 32w..32w+31) sits at DTC_MAP + 4 * (words - 1 - w)
+        for (int w = 0; w < words; w++) {
+            cur_map[w] = read_u32(rec, map + 4 * (words - 1 - w));
+        }
+        uint16_t cur_health = read_u16(rec, health);
+
+        if (!all && records > 0 && memcmp(cur_map, prev_map, words * sizeof(cur_map[0])) == 0 && cur_health == prev_health) {
+            records++;
+            continue;
+        }
+        records++;
+        written++;
+        memcpy(prev_map, cur_map, words * sizeof(cur_map[0]));
+        prev_health = cur_health;
+
+        fprintf(out, "%.3f", read_u32(rec, ts) / 1000.0);
+        for (int i = 0; i < DEVICE_COUNT; i++) {
+            fprintf(out, ",%u", (unsigned)((cur_map[i / 32] >> (i % 32)) & 1));
+        }
+        fprintf(out, ",%u,%u,%u\n", cur_health & 0xFF, (cur_health >> 9) & 1, (cur_health >> 10) & 1);
+    }
+
+    fprintf(stderr, "%zu records, %zu rows written\n", records, written);
+    free(rec);
+    fclose(in);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
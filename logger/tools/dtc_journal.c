@@ -0,0 +1,168 @@
+/*
+ * dtc_journal.c
+ *
+ * Summarises a DTC transition journal (<log>_dtc.bin, see main/dtc_journal.h):
+ * every dropout interval per device plus a per-device fault table. Entries
+ * recovered from the NVS ring after a reboot carry an earlier boot id; times
+ * restart at every boot, so a change of boot id ends any open dropout.
+ *
+ * Usage: dtc_journal <log_dtc.bin> [--min-ms N] [--events]
+ *   --min-ms N  only list dropouts lasting at least N ms
+ *   --events    also print every raw transition
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "dtc_journal.h"
+
+#define MAX_DEVICES 256
+#define MAX_NAME 32
+
+typedef struct {
+    char name[MAX_NAME];
+    uint64_t error_since_us; // 0 when the device is currently OK
+    uint32_t dropouts;
+    uint64_t total_down_us;
+    uint64_t longest_us;
+    uint64_t first_us;
+} device_stats_t;
+
+static device_stats_t devices[MAX_DEVICES];
+static int device_count = 0;
+
+static int read_header(FILE *in) {
+    char magic[4];
+    uint16_t version, entry_size;
+    uint32_t names_len;
+    if (fread(magic, 1, 4, in) != 4 || memcmp(magic, DTC_JOURNAL_MAGIC, 4) != 0) {
+        fprintf(stderr, "Not a DTC journal (bad magic)\n");
+        return -1;
+    }
+    if (fread(&version, 2, 1, in) != 1 || fread(&entry_size, 2, 1, in) != 1 || fread(&names_len, 4, 1, in) != 1) {
+        fprintf(stderr, "Truncated journal header\n");
+        return -1;
+    }
+    // v1 entries are the same size with the boot byte always 0
+    if (version < 1 || version > DTC_JOURNAL_VERSION || entry_size != sizeof(dtc_journal_entry_t)) {
+        fprintf(stderr, "Unsupported journal version %u (entry size %u)\n", version, entry_size);
+        return -1;
+    }
+
+    char *names = malloc(names_len + 1);
+    if (names == NULL || fread(names, 1, names_len, in) != names_len) {
+        fprintf(stderr, "Truncated device name table\n");
+        free(names);
+        return -1;
+    }
+    names[names_len] = '\0';
+    for (char *tok = strtok(names, ","); tok != NULL && device_count < MAX_DEVICES; tok = strtok(NULL, ",")) {
+        strncpy(devices[device_count++].name, tok, MAX_NAME - 1);
+    }
+    free(names);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL;
+    uint64_t min_us = 0;
+    int show_events = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-ms") == 0 && i + 1 < argc) {
+            min_us = strtoull(argv[++i], NULL, 10) * 1000;
+        } else if (strcmp(argv[i], "--events") == 0) {
+            show_events = 1;
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s <log_dtc.bin> [--min-ms N] [--events]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        perror(path);
+        return 1;
+    }
+    if (read_header(in) != 0) {
+        return 1;
+    }
+
+    dtc_journal_entry_t e;
+    uint64_t last_us = 0;
+    size_t entries = 0;
+    size_t unknown = 0;
+    int boot = -1;
+
+    printf("Dropouts%s\n", min_us ? " (filtered)" : "");
+    printf("%-22s %12s %12s %10s %12s\n", "device", "start_s", "end_s", "length_ms", "last_gap_ms");
+    while (fread(&e, sizeof(e), 1, in) == 1) {
+        entries++;
+        last_us = e.time_us;
+        if (e.boot != boot) {
+            if (boot >= 0) {
+                printf("--- boot %u, times restart (dropouts still open are not counted) ---\n", e.boot);
+                for (int i = 0; i < device_count; i++) {
+                    devices[i].error_since_us = 0;
+                }
+            }
+            boot = e.boot;
+        }
+        // A device id past the header's name table means a corrupt or mismatched file
+        if (e.device >= device_count) {
+            unknown++;
+            continue;
+        }
+
+        device_stats_t *d = &devices[e.device];
+        if (show_events) {
+            printf("  %12.6f %-22s %s -> %s (last gap %u ms)\n", e.time_us / 1e6, d->name,
+                   e.old_state ? "OK" : "ERROR", e.new_state ? "OK" : "ERROR", e.last_delta_ms);
+        }
+        if (d->first_us == 0) {
+            d->first_us = e.time_us;
+        }
+        if (e.new_state == 0 && d->error_since_us == 0) {
+            d->error_since_us = e.time_us;
+        } else if (e.new_state == 1 && d->error_since_us != 0) {
+            uint64_t len = e.time_us - d->error_since_us;
+            d->dropouts++;
+            d->total_down_us += len;
+            if (len > d->longest_us) {
+                d->longest_us = len;
+            }
+            if (len >= min_us) {
+                // last_delta_ms of the recovery entry is the gap that just ended
+                printf("%-22s %12.6f %12.6f %10.1f %12u\n", d->name, d->error_since_us / 1e6,
+                       e.time_us / 1e6, len / 1e3, e.last_delta_ms);
+            }
+            d->error_since_us = 0;
+        }
+    }
+    fclose(in);
+
+    printf("\nPer-device summary (%zu transitions)\n", entries);
+    if (unknown > 0) {
+        printf("%zu transitions skipped: device id not in the name table\n", unknown);
+    }
+    printf("%-22s %9s %14s %12s %s\n", "device", "dropouts", "total_down_ms", "longest_ms", "state_at_end");
+    for (int i = 0; i < device_count; i++) {
+        device_stats_t *d = &devices[i];
+        if (d->first_us == 0) {
+            continue;
+        }
+        if (d->error_since_us != 0) {
+            printf("%-22s %9u %14.1f %12.1f ERROR since %.3f s\n", d->name, d->dropouts, d->total_down_us / 1e3,
+                   d->longest_us / 1e3, d->error_since_us / 1e6);
+        } else {
+            printf("%-22s %9u %14.1f %12.1f OK\n", d->name, d->dropouts, d->total_down_us / 1e3, d->longest_us / 1e3);
+        }
+    }
+    if (entries > 0) {
+        printf("Journal ends at %.3f s\n", last_us / 1e6);
+    }
+    return 0;
+}
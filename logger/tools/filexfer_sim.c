@@ -0,0 +1,189 @@
+/*
+ * filexfer_sim.c
+ *
+ * Pseudo-terminal stand-in for the logger's console, for exercising
+ * benji_fetch without hardware. Serves a local directory through the same
+ * protocol code the firmware runs (main/filexfer_core.c) and answers the
+ * console commands the client uses ('ls', 'xfer').
+ *
+ * Usage: filexfer_sim <dir> [--link path] [--corrupt N] [--drop N]
+ *   --link path  also expose the pty slave as a symlink at path
+ *   --corrupt N  flip a byte in 1 of every N frames sent, at random (exercises CRC + retry)
+ *   --drop N     silently drop 1 of every N frames sent, at random (exercises go-back-N)
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "filexfer_core.h"
+
+typedef struct {
+    int fd;
+    unsigned corrupt_every;
+    unsigned drop_every;
+    unsigned long frames;
+} sim_link_t;
+
+static size_t sim_read(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms) {
+    sim_link_t *link = ctx;
+    struct pollfd pfd = {.fd = link->fd, .events = POLLIN};
+    if (poll(&pfd, 1, (int)timeout_ms) <= 0) {
+        return 0;
+    }
+    ssize_t n = read(link->fd, buf, len);
+    return n > 0 ? (size_t)n : 0;
+}
+
+static void write_all(int fd, const uint8_t *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n <= 0) {
+            return;
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+// Every write from the server is exactly one encoded frame
+static void sim_write(void *ctx, const uint8_t *buf, size_t len) {
+    sim_link_t *link = ctx;
+    link->frames++;
+    // Random rather than periodic faults, so they cannot lock onto the window size
+    if (link->drop_every && rand() % link->drop_every == 0) {
+        return;
+    }
+    if (link->corrupt_every && rand() % link->corrupt_every == 0 && len > 2) {
+        uint8_t copy[TELEM_MAX_ENCODED];
+        memcpy(copy, buf, len);
+        copy[len / 2] = copy[len / 2] == 1 ? 2 : copy[len / 2] ^ 1; // Never introduce a 0x00
+        write_all(link->fd, copy, len);
+        return;
+    }
+    write_all(link->fd, buf, len);
+}
+
+static void console_print(int fd, const char *text) {
+    write_all(fd, (const uint8_t *)text, strlen(text));
+}
+
+static void console_ls(int fd, const char *root) {
+    char cmd[512];
+    snprintf(cmd, sizeof(cmd), "ls -l '%s' | awk 'NR>1 {printf \"%%10s  %%s\\n\", $5, $9}'", root);
+    FILE *p = popen(cmd, "r");
+    if (p == NULL) {
+        return;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), p) != NULL) {
+        size_t len = strlen(line);
+        if (len > 0 && line[len - 1] == '\n') {
+            line[len - 1] = '\0';
+        }
+        console_print(fd, line);
+        console_print(fd, "\r\n");
+    }
+    pclose(p);
+}
+
+int main(int argc, char **argv) {
+    const char *root_arg = NULL;
+    const char *link_path = NULL;
+    sim_link_t link = {0};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--link") == 0 && i + 1 < argc) {
+            link_path = argv[++i];
+        } else if (strcmp(argv[i], "--corrupt") == 0 && i + 1 < argc) {
+            link.corrupt_every = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--drop") == 0 && i + 1 < argc) {
+            link.drop_every = strtoul(argv[++i], NULL, 10);
+        } else {
+            root_arg = argv[i];
+        }
+    }
+    if (root_arg == NULL) {
+        fprintf(stderr, "Usage: %s <dir> [--link path] [--corrupt N] [--drop N]\n", argv[0]);
+        return 1;
+    }
+
+    char root[256];
+    snprintf(root, sizeof(root), "%s%s", root_arg, root_arg[strlen(root_arg) - 1] == '/' ? "" : "/");
+
+    link.fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (link.fd < 0 || grantpt(link.fd) != 0 || unlockpt(link.fd) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    const char *slave = ptsname(link.fd);
+    srand(1);
+
+    // Hold the slave open in raw mode so the client sees no echo and closing it does not hang up the master
+    int slave_fd = open(slave, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    if (slave_fd < 0 || tcgetattr(slave_fd, &tio) != 0) {
+        perror(slave);
+        return 1;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(slave_fd, TCSANOW, &tio);
+
+    if (link_path != NULL) {
+        unlink(link_path);
+        if (symlink(slave, link_path) != 0) {
+            perror(link_path);
+            return 1;
+        }
+    }
+    printf("%s\n", slave);
+    fflush(stdout);
+
+    char line[256];
+    size_t line_len = 0;
+    console_print(link.fd, "> ");
+    while (1) {
+        uint8_t c;
+        if (sim_read(&link, &c, 1, 60000) == 0) {
+            continue;
+        }
+        if (c != '\r' && c != '\n') {
+            if (line_len < sizeof(line) - 1) {
+                line[line_len++] = (char)c;
+            }
+            continue;
+        }
+        line[line_len] = '\0';
+        line_len = 0;
+
+        if (strcmp(line, "ls") == 0) {
+            console_ls(link.fd, root);
+        } else if (strcmp(line, "xfer") == 0) {
+            char ready[64];
+            snprintf(ready, sizeof(ready), "%s %d\r\n", FILEXFER_READY, 921600);
+            console_print(link.fd, ready);
+
+            const filexfer_io_t io = {
+                .read = sim_read,
+                .write = sim_write,
+                .yield = NULL,
+                .ctx = &link,
+                .root = root,
+            };
+            filexfer_stats_t stats = {0};
+            int result = filexfer_serve(&io, &stats);
+            fprintf(stderr, "Session %s: %u requests, %u chunks, %llu bytes, %u bad frames\n",
+                    result == 0 ? "closed" : "timed out", stats.requests, stats.chunks,
+                    (unsigned long long)stats.bytes, stats.bad_frames);
+        } else if (line[0] != '\0') {
+            console_print(link.fd, "Unknown command\r\n");
+        } else {
+            continue;
+        }
+        console_print(link.fd, "> ");
+    }
+}
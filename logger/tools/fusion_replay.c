@@ -0,0 +1,153 @@
+/*
+ * fusion_replay.c
+ *
+ * Host replay of a recorded .benji2 session through the on-device fusion
+ * filter (main/fusion.c). Prints the fused trajectory as CSV so it can be
+ * compared against the FUS_* channels logged on the car.
+ *
+ * Usage: fusion_replay <log.benji2> [out.csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "fusion.h"
+
+#define MAX_CHANNELS 1024
+#define MAX_NAME 32
+
+static char names[MAX_CHANNELS][MAX_NAME];
+static size_t channel_count = 0;
+
+static int find_channel(const char *name) {
+    for (size_t i = 0; i < channel_count; i++) {
+        if (strcmp(names[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    fprintf(stderr, "Channel %s not found in log header\n", name);
+    return -1;
+}
+
+static uint32_t read_u32(const uint8_t *rec, int off) {
+    return (uint32_t)rec[off] << 24 | (uint32_t)rec[off + 1] << 16 | (uint32_t)rec[off + 2] << 8 | rec[off + 3];
+}
+
+static uint16_t read_u16(const uint8_t *rec, int off) {
+    return (uint16_t)(rec[off] << 8 | rec[off + 1]);
+}
+
+static int parse_header(FILE *in) {
+    uint8_t len_bytes[4];
+    if (fread(len_bytes, 1, 4, in) != 4) {
+        fprintf(stderr, "Failed to read header length\n");
+        return -1;
+    }
+    // Header length is written little-endian by open_log_file()
+    uint32_t header_len = len_bytes[0] | len_bytes[1] << 8 | len_bytes[2] << 16 | (uint32_t)len_bytes[3] << 24;
+
+    char *header = malloc(header_len + 1);
+    if (header == NULL || fread(header, 1, header_len, in) != header_len) {
+        fprintf(stderr, "Failed to read %u byte header\n", header_len);
+        free(header);
+        return -1;
+    }
+    header[header_len] = '\0';
+
+    for (char *tok = strtok(header, ","); tok != NULL && channel_count < MAX_CHANNELS; tok = strtok(NULL, ",")) {
+        strncpy(names[channel_count], tok, MAX_NAME - 1);
+        channel_count++;
+    }
+    free(header);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <log.benji2> [out.csv]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (out == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    if (parse_header(in) != 0) {
+        return 1;
+    }
+
+    int ts = find_channel("TS");
+    int ax = find_channel("IMU_X_ACCEL");
+    int ay = find_channel("IMU_Y_ACCEL");
+    int gz = find_channel("IMU_Z_GYRO");
+    int lat = find_channel("GPS_LAT");
+    int lon = find_channel("GPS_LON");
+    int spd = find_channel("GPS_SPD");
+    int fix_type = find_channel("GPS_FIX");
+    int hdg = find_channel("GPS_HDG");
+    if (ts < 0 || ax < 0 || ay < 0 || gz < 0 || lat < 0 || lon < 0 || spd < 0 || fix_type < 0 || hdg < 0) {
+        return 1;
+    }
+
+    fusion_t f;
+    fusion_init(&f);
+
+    uint8_t *rec = malloc(channel_count);
+    int32_t prev_lat = 0, prev_lon = 0;
+    uint32_t prev_ts = 0;
+    size_t records = 0, fixes = 0;
+
+    fprintf(out, "time_s,pos_n,pos_e,vel_n,vel_e,speed,heading_deg,slip_deg\n");
+
+    while (fread(rec, 1, channel_count, in) == channel_count) {
+        records++;
+        uint32_t t_ms = read_u32(rec, ts);
+        int64_t t_us = (int64_t)t_ms * 1000;
+
+        // Records are sampled faster than the IMU; only step when time advances
+        if (t_ms != prev_ts) {
+            fusion_predict(&f, fusion_raw_accel(read_u32(rec, ax)), fusion_raw_accel(read_u32(rec, ay)),
+                           fusion_raw_gyro(read_u32(rec, gz)), t_us);
+            prev_ts = t_ms;
+        }
+
+        // GNSS channels hold their value between fixes - a change marks a new fix
+        int32_t cur_lat = (int32_t)read_u32(rec, lat);
+        int32_t cur_lon = (int32_t)read_u32(rec, lon);
+        if (cur_lat != prev_lat || cur_lon != prev_lon) {
+            fusion_gnss_fix_t fix = {
+                .lat_e7 = cur_lat,
+                .lon_e7 = cur_lon,
+                .speed_ms = (int32_t)read_u32(rec, spd) * 0.44704f, // GPS_SPD is logged in mph
+                .course_deg = read_u16(rec, hdg) / 100.0f,
+                .fix_type = rec[fix_type],
+                .time_us = t_us,
+            };
+            fusion_update_gnss(&f, &fix);
+            prev_lat = cur_lat;
+            prev_lon = cur_lon;
+            fixes++;
+        }
+
+        if (f.out.valid) {
+            fprintf(out, "%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.2f,%.2f\n", t_ms / 1000.0,
+                    f.out.pos_n, f.out.pos_e, f.out.vel_n, f.out.vel_e, f.out.speed,
+                    f.out.heading_deg, f.out.slip_deg);
+        }
+    }
+
+    fprintf(stderr, "Replayed %zu records, %zu GNSS fixes\n", records, fixes);
+    free(rec);
+    fclose(in);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
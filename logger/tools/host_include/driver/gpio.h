@@ -0,0 +1,22 @@
+/*
+ * Host driver/gpio.h: pin numbers only, for firmware headers that name pins.
+ */
+#ifndef HOST_DRIVER_GPIO_H_
+#define HOST_DRIVER_GPIO_H_
+
+typedef int gpio_num_t;
+
+#define GPIO_NUM_NC -1
+#define GPIO_NUM_4  4
+#define GPIO_NUM_5  5
+#define GPIO_NUM_6  6
+#define GPIO_NUM_7  7
+#define GPIO_NUM_8  8
+#define GPIO_NUM_9  9
+#define GPIO_NUM_10 10
+#define GPIO_NUM_11 11
+#define GPIO_NUM_18 18
+#define GPIO_NUM_47 47
+#define GPIO_NUM_48 48
+
+#endif /* HOST_DRIVER_GPIO_H_ */
@@ -0,0 +1,9 @@
+/*
+ * Host esp_attr.h: everything runs from the same memory.
+ */
+#ifndef HOST_ESP_ATTR_H_
+#define HOST_ESP_ATTR_H_
+
+#define IRAM_ATTR
+
+#endif /* HOST_ESP_ATTR_H_ */
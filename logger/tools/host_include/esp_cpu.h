@@ -0,0 +1,23 @@
+/*
+ * Host esp_cpu.h: the "cycle counter" counts nanoseconds on CLOCK_MONOTONIC,
+ * matching the 1000 MHz CPU clock in the host sdkconfig.h. Wraps every ~4.3 s
+ * like a 32-bit CCOUNT, so only short deltas are meaningful. Every thread
+ * reports core 0.
+ */
+#ifndef HOST_ESP_CPU_H_
+#define HOST_ESP_CPU_H_
+
+#include <stdint.h>
+#include <time.h>
+
+static inline uint32_t esp_cpu_get_cycle_count(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+static inline int esp_cpu_get_core_id(void) {
+    return 0;
+}
+
+#endif /* HOST_ESP_CPU_H_ */
@@ -0,0 +1,19 @@
+/*
+ * Host esp_freertos_hooks.h: there is no scheduler tick to hook, so
+ * registration succeeds and the hook never runs.
+ */
+#ifndef HOST_ESP_FREERTOS_HOOKS_H_
+#define HOST_ESP_FREERTOS_HOOKS_H_
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef void (*esp_freertos_tick_cb_t)(void);
+
+static inline esp_err_t esp_register_freertos_tick_hook_for_cpu(esp_freertos_tick_cb_t cb, UBaseType_t cpuid) {
+    (void)cb;
+    (void)cpuid;
+    return ESP_OK;
+}
+
+#endif /* HOST_ESP_FREERTOS_HOOKS_H_ */
@@ -0,0 +1,13 @@
+/*
+ * Host esp_system.h. There is no fixed heap on the host; the heap figures
+ * report 0 so snapshots are visibly not from a target.
+ */
+#ifndef HOST_ESP_SYSTEM_H_
+#define HOST_ESP_SYSTEM_H_
+
+#include <stdint.h>
+
+static inline uint32_t esp_get_free_heap_size(void) { return 0; }
+static inline uint32_t esp_get_minimum_free_heap_size(void) { return 0; }
+
+#endif /* HOST_ESP_SYSTEM_H_ */
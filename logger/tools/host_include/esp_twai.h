@@ -0,0 +1,47 @@
+/*
+ * Host esp_twai.h: the TWAI node API main/can.c uses, backed by the
+ * simulated controller in tools/host_sources.c.
+ */
+#ifndef HOST_ESP_TWAI_H_
+#define HOST_ESP_TWAI_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+typedef struct twai_node *twai_node_handle_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t dlc;
+    uint32_t ide;
+    uint32_t rtr;
+    uint32_t fdf;
+    uint32_t brs;
+    uint64_t timestamp; // Host: esp_timer_get_time() when the frame completed on the bus
+} twai_frame_header_t;
+
+typedef struct {
+    twai_frame_header_t header;
+    uint8_t *buffer;
+    size_t buffer_len;
+} twai_frame_t;
+
+typedef struct {
+    int reserved;
+} twai_rx_done_event_data_t;
+
+typedef bool (*twai_rx_done_cb_t)(twai_node_handle_t handle, const twai_rx_done_event_data_t *edata, void *user_ctx);
+
+typedef struct {
+    twai_rx_done_cb_t on_rx_done;
+} twai_event_callbacks_t;
+
+esp_err_t twai_node_register_event_callbacks(twai_node_handle_t node, const twai_event_callbacks_t *cbs,
+                                             void *user_data);
+esp_err_t twai_node_enable(twai_node_handle_t node);
+esp_err_t twai_node_disable(twai_node_handle_t node);
+esp_err_t twai_node_receive_from_isr(twai_node_handle_t node, twai_frame_t *rx_frame);
+
+#endif /* HOST_ESP_TWAI_H_ */
@@ -0,0 +1,25 @@
+/*
+ * Host esp_twai_onchip.h: node configuration for the simulated controller.
+ */
+#ifndef HOST_ESP_TWAI_ONCHIP_H_
+#define HOST_ESP_TWAI_ONCHIP_H_
+
+#include "esp_twai.h"
+#include "driver/gpio.h"
+
+typedef struct {
+    struct {
+        int tx;
+        int rx;
+        int quanta_clk_out;
+        int bus_off_indicator;
+    } io_cfg;
+    struct {
+        uint32_t bitrate;
+    } bit_timing;
+    uint32_t tx_queue_depth;
+} twai_onchip_node_config_t;
+
+esp_err_t twai_new_node_onchip(const twai_onchip_node_config_t *node_config, twai_node_handle_t *node_ret);
+
+#endif /* HOST_ESP_TWAI_ONCHIP_H_ */
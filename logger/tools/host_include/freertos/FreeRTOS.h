@@ -0,0 +1,58 @@
+/*
+ * Host FreeRTOS.h: the subset of the FreeRTOS API the logger pipeline uses,
+ * implemented on pthreads in tools/host_port.c. The tick rate matches the
+ * firmware's sdkconfig (CONFIG_FREERTOS_HZ=100), so pdMS_TO_TICKS rounds the
+ * same way on both.
+ */
+#ifndef HOST_FREERTOS_H_
+#define HOST_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h> // The ESP-IDF port pulls this in; firmware sources rely on it
+
+typedef uint32_t TickType_t;
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint8_t StackType_t;
+
+#define configTICK_RATE_HZ 100
+#define configMAX_TASK_NAME_LEN 16
+#define portNUM_PROCESSORS 2
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define pdTICKS_TO_MS(ticks) ((uint32_t)(((uint64_t)(ticks) * 1000) / configTICK_RATE_HZ))
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+#define errQUEUE_FULL 0
+
+// Critical sections are a spinlock that yields; there are no interrupts to mask
+typedef struct {
+    volatile int locked;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+
+void host_critical_enter(portMUX_TYPE *mux);
+void host_critical_exit(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)     host_critical_enter(mux)
+#define portEXIT_CRITICAL(mux)      host_critical_exit(mux)
+#define portENTER_CRITICAL_ISR(mux) host_critical_enter(mux)
+#define portEXIT_CRITICAL_ISR(mux)  host_critical_exit(mux)
+#define taskENTER_CRITICAL(mux)     host_critical_enter(mux)
+#define taskEXIT_CRITICAL(mux)      host_critical_exit(mux)
+#define portYIELD_FROM_ISR(...)     ((void)0)
+
+// ESP-IDF's FreeRTOS.h pulls these in through idf_additions.h
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#endif /* HOST_FREERTOS_H_ */
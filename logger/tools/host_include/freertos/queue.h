@@ -0,0 +1,34 @@
+/*
+ * Host queue.h: fixed-size copy-in/copy-out queues on a mutex and two
+ * condition variables. The FromISR variants never block, as on the target.
+ */
+#ifndef HOST_FREERTOS_QUEUE_H_
+#define HOST_FREERTOS_QUEUE_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait);
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_woken);
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#define xQueueSendToBack xQueueSend
+
+// Static queues are heap queues on the host; the storage is not used
+typedef struct {
+    uint8_t unused;
+} StaticQueue_t;
+
+static inline QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage,
+                                               StaticQueue_t *queue) {
+    (void)storage;
+    (void)queue;
+    return xQueueCreate(length, item_size);
+}
+
+#endif /* HOST_FREERTOS_QUEUE_H_ */
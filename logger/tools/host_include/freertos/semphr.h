@@ -0,0 +1,27 @@
+/*
+ * Host semphr.h: semaphores are zero-size queues of length one, as in
+ * FreeRTOS itself. A mutex starts given; there is no priority inheritance.
+ */
+#ifndef HOST_FREERTOS_SEMPHR_H_
+#define HOST_FREERTOS_SEMPHR_H_
+
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+
+typedef StaticQueue_t StaticSemaphore_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *mutex) {
+    (void)mutex;
+    return xSemaphoreCreateMutex();
+}
+
+#define xSemaphoreTake(sem, wait) xQueueReceive(sem, NULL, wait)
+#define xSemaphoreGive(sem) xQueueSend(sem, NULL, 0)
+#define xSemaphoreGiveFromISR(sem, woken) xQueueSendFromISR(sem, NULL, woken)
+#define vSemaphoreDelete(sem) vQueueDelete(sem)
+
+#endif /* HOST_FREERTOS_SEMPHR_H_ */
@@ -0,0 +1,71 @@
+/*
+ * Host task.h: tasks are detached pthreads. Priorities and core affinity
+ * are recorded for uxTaskGetSystemState but not enforced; run time is the
+ * thread's CPU time in microseconds.
+ */
+#ifndef HOST_FREERTOS_TASK_H_
+#define HOST_FREERTOS_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+#define tskNO_AFFINITY ((BaseType_t)0x7fffffff)
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+typedef enum {
+    eRunning,
+    eReady,
+    eBlocked,
+    eSuspended,
+    eDeleted,
+} eTaskState;
+
+typedef struct {
+    TaskHandle_t xHandle;
+    const char *pcTaskName;
+    UBaseType_t xTaskNumber;
+    eTaskState eCurrentState;
+    UBaseType_t uxCurrentPriority;
+    UBaseType_t uxBasePriority;
+    uint64_t ulRunTimeCounter;
+    StackType_t *pxStackBase;
+    uint32_t usStackHighWaterMark;
+    BaseType_t xCoreID;
+} TaskStatus_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char *name, uint32_t stack_depth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core_id);
+
+static inline BaseType_t xTaskCreate(TaskFunction_t task, const char *name, uint32_t stack_depth, void *param,
+                                     UBaseType_t priority, TaskHandle_t *created) {
+    return xTaskCreatePinnedToCore(task, name, stack_depth, param, priority, created, tskNO_AFFINITY);
+}
+
+// Static tasks get a pthread like the rest; the buffers are not used
+typedef struct {
+    uint8_t unused;
+} StaticTask_t;
+
+static inline TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t task, const char *name, uint32_t stack_depth,
+                                                         void *param, UBaseType_t priority, StackType_t *stack,
+                                                         StaticTask_t *tcb, BaseType_t core_id) {
+    TaskHandle_t created = NULL;
+    (void)stack;
+    (void)tcb;
+    if (xTaskCreatePinnedToCore(task, name, stack_depth, param, priority, &created, core_id) != pdPASS) {
+        return NULL;
+    }
+    return created;
+}
+
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment);
+#define vTaskDelayUntil(previous_wake, increment) ((void)xTaskDelayUntil(previous_wake, increment))
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+UBaseType_t uxTaskGetTaskNumber(TaskHandle_t task);
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t size, uint64_t *total_runtime);
+
+#endif /* HOST_FREERTOS_TASK_H_ */
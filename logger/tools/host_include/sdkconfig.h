@@ -0,0 +1,10 @@
+/*
+ * Host sdkconfig.h: only the options the pipeline sources read. The CPU
+ * clock is 1000 MHz so esp_cpu.h's nanosecond "cycles" convert 1:1.
+ */
+#ifndef HOST_SDKCONFIG_H_
+#define HOST_SDKCONFIG_H_
+
+#define CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ 1000
+
+#endif /* HOST_SDKCONFIG_H_ */
@@ -0,0 +1,10 @@
+/*
+ * Host sdmmc_cmd.h: the card handle type only. The host build writes logs to
+ * a directory instead of a mounted card (tools/host_sdcard.c).
+ */
+#ifndef HOST_SDMMC_CMD_H_
+#define HOST_SDMMC_CMD_H_
+
+typedef struct sdmmc_card sdmmc_card_t;
+
+#endif /* HOST_SDMMC_CMD_H_ */
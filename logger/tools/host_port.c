@@ -0,0 +1,649 @@
+/*
+ * host_port.c
+ *
+ * FreeRTOS, esp_timer and esp_log for the host build of the logger pipeline
+ * (see host_include/). Just enough of each API for the firmware sources that
+ * logger_host links; the semantics that matter to them are kept: tick rate,
+ * blocking timeouts, non-blocking FromISR calls and per-task run time.
+ *
+ * Time normally follows CLOCK_MONOTONIC from the first call. logger_replay
+ * switches to a virtual clock instead (host_port.h), which only moves when
+ * host_clock_advance() is called and fires esp_timers on the caller's thread,
+ * so a replayed session produces the same output on every run.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_port.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#define HOST_MAX_TASKS 32
+
+static struct timespec start_time;
+static pthread_once_t start_once = PTHREAD_ONCE_INIT;
+
+static bool virtual_clock = false;
+static uint64_t virtual_us = 0;
+static pthread_mutex_t virtual_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t virtual_moved = PTHREAD_COND_INITIALIZER;
+
+static void record_start(void) {
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+static uint64_t now_us(void) {
+    if (virtual_clock) {
+        return __atomic_load_n(&virtual_us, __ATOMIC_ACQUIRE);
+    }
+    pthread_once(&start_once, record_start);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)(ts.tv_sec - start_time.tv_sec) * 1000000 + (ts.tv_nsec - start_time.tv_nsec) / 1000;
+}
+
+static void sleep_until_us(uint64_t deadline_us) {
+    if (virtual_clock) {
+        pthread_mutex_lock(&virtual_lock);
+        while (virtual_us < deadline_us) {
+            pthread_cond_wait(&virtual_moved, &virtual_lock);
+        }
+        pthread_mutex_unlock(&virtual_lock);
+        return;
+    }
+    pthread_once(&start_once, record_start);
+    struct timespec ts = {
+        .tv_sec = start_time.tv_sec + (time_t)(deadline_us / 1000000),
+        .tv_nsec = start_time.tv_nsec + (long)(deadline_us % 1000000) * 1000,
+    };
+    if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000;
+    }
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+// Absolute deadline for a blocking call of `ticks`; false for portMAX_DELAY
+static bool deadline_for(TickType_t ticks, struct timespec *out) {
+    if (ticks == portMAX_DELAY) {
+        return false;
+    }
+    clock_gettime(CLOCK_MONOTONIC, out);
+    uint64_t ns = (uint64_t)ticks * (1000000000 / configTICK_RATE_HZ);
+    out->tv_sec += (time_t)(ns / 1000000000);
+    out->tv_nsec += (long)(ns % 1000000000);
+    if (out->tv_nsec >= 1000000000) {
+        out->tv_sec++;
+        out->tv_nsec -= 1000000000;
+    }
+    return true;
+}
+
+static pthread_condattr_t condattr;
+static pthread_once_t condattr_once = PTHREAD_ONCE_INIT;
+
+static void init_condattr(void) {
+    pthread_condattr_init(&condattr);
+    pthread_condattr_setclock(&condattr, CLOCK_MONOTONIC);
+}
+
+// Timed waits use the same clock as deadline_for
+static pthread_condattr_t *monotonic_condattr(void) {
+    pthread_once(&condattr_once, init_condattr);
+    return &condattr;
+}
+
+// ----------------------------------------------------------------------------
+// esp_log
+
+static esp_log_level_t log_level = ESP_LOG_INFO;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    if (tag != NULL && strcmp(tag, "*") == 0) {
+        log_level = level;
+    }
+}
+
+void host_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+    if (level > log_level) {
+        return;
+    }
+    char line[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    fprintf(stderr, "%c (%llu) %s: %s\n", letters[level], (unsigned long long)(now_us() / 1000), tag, line);
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    (void)tag;
+    if (level > log_level) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+// ----------------------------------------------------------------------------
+// Critical sections
+
+void host_critical_enter(portMUX_TYPE *mux) {
+    while (__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+}
+
+void host_critical_exit(portMUX_TYPE *mux) {
+    __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
+
+// ----------------------------------------------------------------------------
+// Tasks
+
+struct host_task {
+    pthread_t thread;
+    clockid_t cpu_clock;
+    char name[configMAX_TASK_NAME_LEN];
+    UBaseType_t number;
+    UBaseType_t priority;
+    uint32_t stack_depth;
+    BaseType_t core_id;
+    TaskFunction_t function;
+    void *param;
+};
+
+static struct host_task tasks[HOST_MAX_TASKS];
+static UBaseType_t task_count = 0;
+static pthread_mutex_t task_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *task_trampoline(void *arg) {
+    struct host_task *task = arg;
+    task->function(task->param);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_depth, void *param,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core_id) {
+    pthread_mutex_lock(&task_lock);
+    if (task_count >= HOST_MAX_TASKS) {
+        pthread_mutex_unlock(&task_lock);
+        return pdFAIL;
+    }
+    struct host_task *task = &tasks[task_count];
+    snprintf(task->name, sizeof(task->name), "%s", name);
+    task->number = task_count + 1;
+    task->priority = priority;
+    task->stack_depth = stack_depth;
+    task->core_id = core_id;
+    task->function = function;
+    task->param = param;
+
+    if (pthread_create(&task->thread, NULL, task_trampoline, task) != 0) {
+        pthread_mutex_unlock(&task_lock);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    if (pthread_getcpuclockid(task->thread, &task->cpu_clock) != 0) {
+        task->cpu_clock = (clockid_t)-1;
+    }
+    pthread_setname_np(task->thread, task->name);
+    task_count++;
+    pthread_mutex_unlock(&task_lock);
+
+    if (created != NULL) {
+        *created = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    if (task == NULL || pthread_equal(task->thread, pthread_self())) {
+        pthread_exit(NULL);
+    }
+    pthread_cancel(task->thread);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    if (ticks == 0) {
+        sched_yield();
+        return;
+    }
+    sleep_until_us(now_us() + (uint64_t)ticks * (1000000 / configTICK_RATE_HZ));
+}
+
+BaseType_t xTaskDelayUntil(TickType_t *previous_wake, TickType_t increment) {
+    TickType_t wake = *previous_wake + increment;
+    bool delayed = (int32_t)(wake - xTaskGetTickCount()) > 0;
+    if (delayed) {
+        sleep_until_us((uint64_t)wake * (1000000 / configTICK_RATE_HZ));
+    }
+    *previous_wake = wake;
+    return delayed ? pdTRUE : pdFALSE;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return (TickType_t)(now_us() / (1000000 / configTICK_RATE_HZ));
+}
+
+// NULL for threads the port did not create (main, timers)
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    TaskHandle_t current = NULL;
+    pthread_mutex_lock(&task_lock);
+    for (UBaseType_t i = 0; i < task_count; i++) {
+        if (pthread_equal(tasks[i].thread, pthread_self())) {
+            current = &tasks[i];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&task_lock);
+    return current;
+}
+
+UBaseType_t uxTaskGetTaskNumber(TaskHandle_t task) {
+    return task != NULL ? task->number : 0;
+}
+
+static uint64_t cpu_time_us(clockid_t clock) {
+    struct timespec ts;
+    if (clock == (clockid_t)-1 || clock_gettime(clock, &ts) != 0) {
+        return 0;
+    }
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// Tasks, then one IDLE entry holding the rest of portNUM_PROCESSORS cores' time
+UBaseType_t uxTaskGetSystemState(TaskStatus_t *status, UBaseType_t size, uint64_t *total_runtime) {
+    pthread_mutex_lock(&task_lock);
+    if (task_count + 1 > size) {
+        pthread_mutex_unlock(&task_lock);
+        return 0;
+    }
+    uint64_t elapsed = now_us();
+    uint64_t busy = 0;
+    for (UBaseType_t i = 0; i < task_count; i++) {
+        struct host_task *task = &tasks[i];
+        uint64_t ran = cpu_time_us(task->cpu_clock);
+        busy += ran;
+        status[i] = (TaskStatus_t){
+            .xHandle = task,
+            .pcTaskName = task->name,
+            .xTaskNumber = task->number,
+            .eCurrentState = eReady,
+            .uxCurrentPriority = task->priority,
+            .uxBasePriority = task->priority,
+            .ulRunTimeCounter = ran,
+            .usStackHighWaterMark = task->stack_depth, // Unknown on the host
+            .xCoreID = task->core_id,
+        };
+    }
+    uint64_t capacity = elapsed * portNUM_PROCESSORS;
+    status[task_count] = (TaskStatus_t){
+        .pcTaskName = "IDLE",
+        .xTaskNumber = HOST_MAX_TASKS + 1,
+        .eCurrentState = eReady,
+        .ulRunTimeCounter = capacity > busy ? capacity - busy : 0,
+        .xCoreID = tskNO_AFFINITY,
+    };
+    UBaseType_t count = task_count + 1;
+    pthread_mutex_unlock(&task_lock);
+
+    if (total_runtime != NULL) {
+        *total_runtime = elapsed;
+    }
+    return count;
+}
+
+// ----------------------------------------------------------------------------
+// Queues and semaphores
+
+struct host_queue {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t count;
+    UBaseType_t head;
+    uint8_t storage[];
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    if (length == 0) {
+        return NULL;
+    }
+    struct host_queue *queue = calloc(1, sizeof(*queue) + (size_t)length * item_size);
+    if (queue == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&queue->lock, NULL);
+    pthread_cond_init(&queue->not_empty, monotonic_condattr());
+    pthread_cond_init(&queue->not_full, monotonic_condattr());
+    queue->length = length;
+    queue->item_size = item_size;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    pthread_mutex_destroy(&queue->lock);
+    pthread_cond_destroy(&queue->not_empty);
+    pthread_cond_destroy(&queue->not_full);
+    free(queue);
+}
+
+// One wait on cond with lock held; false once the deadline has passed
+static bool wait_for(pthread_cond_t *cond, pthread_mutex_t *lock, bool timed, const struct timespec *deadline) {
+    if (!timed) {
+        return pthread_cond_wait(cond, lock) == 0;
+    }
+    return pthread_cond_timedwait(cond, lock, deadline) != ETIMEDOUT;
+}
+
+static void push_locked(struct host_queue *queue, const void *item) {
+    if (queue->item_size > 0) {
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        memcpy(queue->storage + (size_t)tail * queue->item_size, item, queue->item_size);
+    }
+    queue->count++;
+    pthread_cond_signal(&queue->not_empty);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t wait) {
+    struct timespec deadline;
+    bool timed = deadline_for(wait, &deadline);
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == queue->length) {
+        if (wait == 0 || !wait_for(&queue->not_full, &queue->lock, timed, &deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return errQUEUE_FULL;
+        }
+    }
+    push_locked(queue, item);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_woken) {
+    if (higher_priority_woken != NULL) {
+        *higher_priority_woken = pdFALSE;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t queue, const void *item) {
+    pthread_mutex_lock(&queue->lock);
+    if (queue->count == queue->length) {
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+    }
+    push_locked(queue, item);
+    pthread_mutex_unlock(&queue->lock);
+    return pdPASS;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t wait) {
+    struct timespec deadline;
+    bool timed = deadline_for(wait, &deadline);
+    pthread_mutex_lock(&queue->lock);
+    while (queue->count == 0) {
+        if (wait == 0 || !wait_for(&queue->not_empty, &queue->lock, timed, &deadline)) {
+            pthread_mutex_unlock(&queue->lock);
+            return pdFALSE;
+        }
+    }
+    if (queue->item_size > 0) {
+        memcpy(item, queue->storage + (size_t)queue->head * queue->item_size, queue->item_size);
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    pthread_cond_signal(&queue->not_full);
+    pthread_mutex_unlock(&queue->lock);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&queue->lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&queue->lock);
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    SemaphoreHandle_t mutex = xQueueCreate(1, 0);
+    if (mutex != NULL) {
+        mutex->count = 1; // Created given
+    }
+    return mutex;
+}
+
+// ----------------------------------------------------------------------------
+// esp_timer
+
+struct esp_timer {
+    esp_timer_create_args_t args;
+    pthread_t thread;
+    uint64_t period_us;
+    uint64_t next_us; // Virtual clock only
+    volatile bool running;
+    bool periodic;
+    uint32_t generation; // Bumped by every start and stop, so a stale one-shot thread never fires
+    struct esp_timer *next_virtual;
+};
+
+// One-shot timers get a detached thread per start
+typedef struct {
+    struct esp_timer *timer;
+    uint32_t generation;
+    uint64_t deadline_us;
+} once_start_t;
+
+// Running timers while on the virtual clock; fired by host_clock_advance()
+static struct esp_timer *virtual_timers = NULL;
+
+int64_t esp_timer_get_time(void) {
+    return (int64_t)now_us();
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle) {
+    if (create_args == NULL || create_args->callback == NULL || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    struct esp_timer *timer = calloc(1, sizeof(*timer));
+    if (timer == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    timer->args = *create_args;
+    *out_handle = timer;
+    return ESP_OK;
+}
+
+static void *timer_thread(void *arg) {
+    struct esp_timer *timer = arg;
+    uint64_t next = now_us() + timer->period_us;
+    while (timer->running) {
+        sleep_until_us(next);
+        if (!timer->running) {
+            break;
+        }
+        timer->args.callback(timer->args.arg);
+        next += timer->period_us;
+        uint64_t now = now_us();
+        if (timer->args.skip_unhandled_events && next < now) {
+            next = now + timer->period_us;
+        }
+    }
+    return NULL;
+}
+
+static void *once_thread(void *arg) {
+    once_start_t start = *(once_start_t *)arg;
+    free(arg);
+    sleep_until_us(start.deadline_us);
+    // Claim the expiry; fails if the timer was stopped or restarted meanwhile
+    uint32_t expected = start.generation;
+    if (__atomic_compare_exchange_n(&start.timer->generation, &expected, expected + 1, false, __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE)) {
+        start.timer->running = false;
+        start.timer->args.callback(start.timer->args.arg);
+    }
+    return NULL;
+}
+
+// Callers hold virtual_lock
+static void virtual_add(struct esp_timer *timer) {
+    timer->next_virtual = virtual_timers;
+    virtual_timers = timer;
+}
+
+// Callers hold virtual_lock
+static void virtual_remove(struct esp_timer *timer) {
+    for (struct esp_timer **link = &virtual_timers; *link != NULL; link = &(*link)->next_virtual) {
+        if (*link == timer) {
+            *link = timer->next_virtual;
+            break;
+        }
+    }
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    if (timer == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->periodic = false;
+    timer->running = true;
+    uint32_t generation = __atomic_add_fetch(&timer->generation, 1, __ATOMIC_ACQ_REL);
+    if (virtual_clock) {
+        timer->next_us = now_us() + timeout_us;
+        pthread_mutex_lock(&virtual_lock);
+        virtual_add(timer);
+        pthread_mutex_unlock(&virtual_lock);
+        return ESP_OK;
+    }
+
+    once_start_t *start = malloc(sizeof(*start));
+    pthread_t thread;
+    if (start == NULL) {
+        timer->running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    *start = (once_start_t){.timer = timer, .generation = generation, .deadline_us = now_us() + timeout_us};
+    if (pthread_create(&thread, NULL, once_thread, start) != 0) {
+        free(start);
+        timer->running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    pthread_detach(thread);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    if (timer == NULL || period_us == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->period_us = period_us;
+    timer->periodic = true;
+    timer->running = true;
+    if (virtual_clock) {
+        timer->next_us = now_us() + period_us;
+        pthread_mutex_lock(&virtual_lock);
+        virtual_add(timer);
+        pthread_mutex_unlock(&virtual_lock);
+        return ESP_OK;
+    }
+    if (pthread_create(&timer->thread, NULL, timer_thread, timer) != 0) {
+        timer->running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (timer == NULL || !timer->running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    timer->running = false;
+    __atomic_add_fetch(&timer->generation, 1, __ATOMIC_ACQ_REL);
+    if (virtual_clock) {
+        pthread_mutex_lock(&virtual_lock);
+        virtual_remove(timer);
+        pthread_mutex_unlock(&virtual_lock);
+        return ESP_OK;
+    }
+    if (!timer->periodic) {
+        return ESP_OK; // The detached thread sees the new generation and exits
+    }
+    if (!pthread_equal(timer->thread, pthread_self())) {
+        pthread_join(timer->thread, NULL);
+    }
+    return ESP_OK;
+}
+
+// ----------------------------------------------------------------------------
+// Virtual clock
+
+void host_clock_use_virtual(uint64_t start_us) {
+    virtual_us = start_us;
+    virtual_clock = true;
+}
+
+static void set_virtual_time(uint64_t time_us) {
+    pthread_mutex_lock(&virtual_lock);
+    __atomic_store_n(&virtual_us, time_us, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&virtual_moved);
+    pthread_mutex_unlock(&virtual_lock);
+}
+
+// Every period and one-shot is fired (none skipped), earliest first, with the clock at its deadline
+void host_clock_advance(uint64_t time_us) {
+    if (!virtual_clock || time_us < virtual_us) {
+        return;
+    }
+    for (;;) {
+        pthread_mutex_lock(&virtual_lock);
+        struct esp_timer *due = NULL;
+        for (struct esp_timer *timer = virtual_timers; timer != NULL; timer = timer->next_virtual) {
+            if (timer->next_us <= time_us && (due == NULL || timer->next_us < due->next_us)) {
+                due = timer;
+            }
+        }
+        if (due != NULL && !due->periodic) {
+            virtual_remove(due);
+            due->running = false;
+        }
+        pthread_mutex_unlock(&virtual_lock);
+        if (due == NULL) {
+            break;
+        }
+        set_virtual_time(due->next_us);
+        if (due->periodic) {
+            due->next_us += due->period_us;
+        }
+        due->args.callback(due->args.arg);
+    }
+    set_virtual_time(time_us);
+}
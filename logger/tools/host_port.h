@@ -0,0 +1,21 @@
+/*
+ * host_port.h
+ *
+ * Host-only controls of the FreeRTOS/esp_timer port in host_port.c.
+ */
+#ifndef HOST_PORT_H_
+#define HOST_PORT_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Stop following the wall clock: esp_timer_get_time(), tick count and delays follow host_clock_advance() from start_us. Call before anything reads the time
+ */
+void host_clock_use_virtual(uint64_t start_us);
+
+/**
+ * @brief Move the virtual clock forward to time_us, firing every esp_timer period that falls due on the way on the calling thread
+ */
+void host_clock_advance(uint64_t time_us);
+
+#endif /* HOST_PORT_H_ */
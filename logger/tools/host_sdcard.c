@@ -0,0 +1,155 @@
+/*
+ * host_sdcard.c
+ *
+ * sdcard.h for the host build: the "card" is whatever directory the log is
+ * written to (main/log_file.c does the writing), and the NVS blobs the
+ * pipeline keeps - lap gates, the DTC fallback ring and the boot count - live
+ * in RAM for the length of the run. sdcard_init(), called by main/log_ring.c's
+ * writer, stands in for the mount: it waits out the configured mount time and
+ * can cap the log's write throughput at that of a card on a slow SPI clock.
+ * The writer's memmap_boot_report() after the mount is a no-op: the RAM
+ * budget it prints comes from the ESP32 linker map.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sdcard.h"
+#include "memmap.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "host_sources.h"
+
+static lap_gate_t nvs_gates[LAP_MAX_GATES];
+static uint8_t nvs_gate_count = 0;
+static dtc_journal_ring_t nvs_ring;
+static uint32_t mount_ms = 0;
+static uint32_t card_kbps = 0;
+
+typedef struct {
+    FILE *file;       // The log as opened by log_file_open
+    uint64_t free_ns; // When the card has written everything handed to it so far
+} card_stream_t;
+
+void host_sdcard_set_model(uint32_t mount_time_ms, uint32_t kbps) {
+    mount_ms = mount_time_ms;
+    card_kbps = kbps;
+}
+
+static uint64_t card_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Each stdio buffer flush occupies the card for len / throughput
+static ssize_t card_write(void *cookie, const char *buf, size_t len) {
+    card_stream_t *card = cookie;
+    uint64_t now = card_now_ns();
+    if (card->free_ns < now) {
+        card->free_ns = now;
+    }
+    card->free_ns += (uint64_t)len * 1000000ull / card_kbps;
+    uint64_t wait_ns = card->free_ns - now;
+    struct timespec ts = {.tv_sec = wait_ns / 1000000000, .tv_nsec = wait_ns % 1000000000};
+    nanosleep(&ts, NULL);
+    return (ssize_t)fwrite(buf, 1, len, card->file);
+}
+
+// Only ftell() (SEEK_CUR, 0) is expected: the log is append-only
+static int card_seek(void *cookie, off64_t *offset, int whence) {
+    card_stream_t *card = cookie;
+    if (fseeko(card->file, *offset, whence) != 0) {
+        return -1;
+    }
+    *offset = ftello(card->file);
+    return 0;
+}
+
+static int card_close(void *cookie) {
+    card_stream_t *card = cookie;
+    int ret = fclose(card->file);
+    free(card);
+    return ret;
+}
+
+// The log file is opened before the writer starts; "mounting" only takes time
+void sdcard_init(void) {
+    vTaskDelay(pdMS_TO_TICKS(mount_ms));
+    if (card_kbps == 0) {
+        return;
+    }
+    card_stream_t *card = malloc(sizeof(*card));
+    if (card == NULL) {
+        return;
+    }
+    cookie_io_functions_t io = {.write = card_write, .seek = card_seek, .close = card_close};
+    xSemaphoreTake(log_file_mutex, portMAX_DELAY);
+    FILE *stream = log_file != NULL ? fopencookie(card, "a", io) : NULL;
+    if (stream != NULL) {
+        fflush(log_file);
+        card->file = log_file;
+        card->free_ns = 0;
+        setvbuf(stream, NULL, _IOFBF, 4096); // As log_file_open
+        log_file = stream;
+    } else {
+        free(card);
+    }
+    xSemaphoreGive(log_file_mutex);
+}
+
+// Mounted once a log is open, as on the target
+bool sdcard_is_initialized(void) {
+    return log_file != NULL;
+}
+
+// One boot per run
+esp_err_t nvs_increment_boot_count(uint8_t *boot) {
+    if (boot == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *boot = 1;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_lap_gates(const lap_gate_t *gates, uint8_t count) {
+    if ((gates == NULL && count > 0) || count > LAP_MAX_GATES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(nvs_gates, gates, count * sizeof(lap_gate_t));
+    nvs_gate_count = count;
+    return ESP_OK;
+}
+
+// count holds the capacity of gates on entry and the number loaded on return
+esp_err_t nvs_get_lap_gates(lap_gate_t *gates, uint8_t *count) {
+    if (gates == NULL || count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (*count > nvs_gate_count) {
+        *count = nvs_gate_count;
+    }
+    memcpy(gates, nvs_gates, *count * sizeof(lap_gate_t));
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_dtc_ring(const dtc_journal_ring_t *ring) {
+    if (ring == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    nvs_ring = *ring;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_dtc_ring(dtc_journal_ring_t *ring) {
+    if (ring == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *ring = nvs_ring;
+    return ESP_OK;
+}
+
+void memmap_boot_report(void) {
+}
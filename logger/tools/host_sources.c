@@ -0,0 +1,520 @@
+/*
+ * host_sources.c
+ *
+ * Stand-in sensor sources for logger_host (see host_sources.h). The CAN and
+ * GNSS signals describe the same drive - a steady right-hand lap of a 60 m
+ * radius circle at 20 m/s - so the fusion filter and the lap timer see
+ * consistent inputs.
+ */
+#define _GNU_SOURCE
+#include "host_sources.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_twai.h"
+#include "esp_twai_onchip.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "adc.h"
+#include "ina260.h"
+#include "gnss.h"
+
+static const char *TAG = "HOST_SRC";
+
+#define TRACK_RADIUS_M 60.0
+#define TRACK_SPEED_MS 20.0
+#define TRACK_LAT0 42.2936
+#define TRACK_LON0 -83.7166
+#define M_PER_DEG_LAT 111320.0
+
+#define ADC_SCAN_US 10000 // adc.c samples every 10 ms
+
+static FILE *capture_can = NULL;
+static FILE *capture_gnss = NULL;
+static FILE *capture_adc = NULL;
+static pthread_mutex_t capture_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// ----------------------------------------------------------------------------
+// Synthetic CAN bus behind a simulated TWAI controller
+
+typedef struct {
+    uint32_t id;
+    uint32_t hz;
+    uint8_t dlc;
+} can_slot_t;
+
+// Every frame record_process_can() decodes, at its rate on the car
+static const can_slot_t schedule[] = {
+    {0x360, 200, 8}, {0x361, 200, 8}, {0x362, 200, 8},                  // IMU
+    {0x363, 50, 6},  {0x364, 50, 6},  {0x365, 50, 6},  {0x366, 50, 6},  // Wheel boards
+    {0x4e2, 100, 2}, {0x4e3, 100, 2}, {0x4e4, 100, 2}, {0x4e5, 100, 2}, // Strain gauges
+    {0x3e8, 150, 8},                                                    // Engine stream, 3 sub-frames
+    {0x35F, 10, 1},                                                     // DRS
+    {0x40, 20, 3},                                                      // Shifter
+};
+#define SLOT_COUNT (sizeof(schedule) / sizeof(schedule[0]))
+
+struct twai_node {
+    uint32_t bitrate;
+    twai_event_callbacks_t callbacks;
+    void *user_data;
+    pthread_t thread;
+    volatile bool enabled;
+    twai_frame_t rx;          // Frame the "ISR" reads out
+    uint8_t rx_data[8];
+};
+
+static struct twai_node node;
+static uint32_t requested_rate = 0;
+static volatile uint32_t frames_sent = 0;
+static volatile uint64_t bus_bits = 0;
+
+void host_can_set_rate(uint32_t frames_per_s) {
+    requested_rate = frames_per_s;
+}
+
+uint32_t host_can_schedule_rate(void) {
+    uint32_t total = 0;
+    for (size_t i = 0; i < SLOT_COUNT; i++) {
+        total += schedule[i].hz;
+    }
+    return total;
+}
+
+void host_can_get_stats(host_can_stats_t *stats) {
+    stats->sent = frames_sent;
+    stats->bus_bits = bus_bits;
+    stats->bitrate = node.bitrate;
+}
+
+static void put_be32(uint8_t *p, int32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static void put_be16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+// Payload of slot at time t, in the layout record_process_can() decodes
+static void fill_payload(const can_slot_t *slot, uint32_t seq, double t, uint8_t *data) {
+    double lateral_mg = TRACK_SPEED_MS * TRACK_SPEED_MS / TRACK_RADIUS_M / 9.80665 * 1000.0;
+    double yaw_mdps = TRACK_SPEED_MS / TRACK_RADIUS_M * 57.29578 * 1000.0;
+    double wobble = sin(t * 2.0 * M_PI * 1.5);
+    memset(data, 0, 8);
+
+    switch (slot->id) {
+        case 0x360:
+            put_be32(data, (int32_t)(20 * wobble));                 // X accel (mg)
+            put_be32(data + 4, (int32_t)(lateral_mg + 30 * wobble)); // Y accel
+            break;
+        case 0x361:
+            put_be32(data, 1000);                                   // Z accel
+            put_be32(data + 4, (int32_t)(500 * wobble));            // X gyro (mdeg/s)
+            break;
+        case 0x362:
+            put_be32(data, (int32_t)(300 * wobble));                // Y gyro
+            put_be32(data + 4, (int32_t)yaw_mdps);                  // Z gyro
+            break;
+        case 0x363: case 0x364: case 0x365: case 0x366:
+            put_be16(data, (uint16_t)(TRACK_SPEED_MS / (2 * M_PI * 0.23) * 60)); // rpm
+            put_be16(data + 2, (uint16_t)(700 + 50 * wobble));     // Tyre temperature (0.1 C)
+            put_be16(data + 4, 250);                                // Ambient (0.1 C)
+            break;
+        case 0x4e2: case 0x4e3: case 0x4e4: case 0x4e5:
+            put_be16(data, (uint16_t)(2048 + 400 * wobble + (slot->id - 0x4e2) * 50));
+            break;
+        case 0x3e8:
+            data[0] = (uint8_t)(seq % 3);
+            if (data[0] == 0) {
+                put_be16(data + 1, 9000);
+                data[3] = 85;                                       // Coolant
+                put_be16(data + 5, 420);                            // Oil pressure
+            } else if (data[0] == 1) {
+                data[2] = (uint8_t)(60 + 20 * wobble);              // TPS
+                put_be16(data + 4, (uint16_t)(TRACK_SPEED_MS * 36));
+            } else {
+                data[1] = (uint8_t)(60 + 20 * wobble);              // APS
+            }
+            break;
+        case 0x35F:
+            data[0] = 0;
+            break;
+        case 0x40:
+            data[0] = 3;
+            data[1] = 1;
+            data[2] = 1;
+            break;
+    }
+}
+
+// Bits on the wire for a standard frame: 47 framing bits plus data, with worst-case stuffing
+static uint32_t frame_bits(uint8_t dlc) {
+    uint32_t raw = 47 + 8u * dlc;
+    return raw + (raw - 13) / 4;
+}
+
+static void sleep_until(int64_t deadline_us) {
+    int64_t now = esp_timer_get_time();
+    if (deadline_us > now) {
+        struct timespec ts = {
+            .tv_sec = (deadline_us - now) / 1000000,
+            .tv_nsec = (long)((deadline_us - now) % 1000000) * 1000,
+        };
+        nanosleep(&ts, NULL);
+    }
+}
+
+// The bus: frames complete in schedule order, never faster than the bitrate allows,
+// and each raises the controller's receive interrupt
+static void *can_bus_thread(void *arg) {
+    (void)arg;
+    double scale = requested_rate > 0 ? (double)requested_rate / host_can_schedule_rate() : 1.0;
+    double period_us[SLOT_COUNT];
+    double due_us[SLOT_COUNT];
+    uint32_t seq[SLOT_COUNT] = {0};
+    int64_t start = esp_timer_get_time();
+    for (size_t i = 0; i < SLOT_COUNT; i++) {
+        period_us[i] = 1e6 / (schedule[i].hz * scale);
+        due_us[i] = start + period_us[i] * (double)i / SLOT_COUNT; // Spread the slots out
+    }
+    double bus_free_us = start;
+
+    while (node.enabled) {
+        size_t next = 0;
+        for (size_t i = 1; i < SLOT_COUNT; i++) {
+            if (due_us[i] < due_us[next]) {
+                next = i;
+            }
+        }
+        const can_slot_t *slot = &schedule[next];
+        uint32_t bits = frame_bits(slot->dlc);
+        double done_us = (due_us[next] > bus_free_us ? due_us[next] : bus_free_us) + bits * 1e6 / node.bitrate;
+        sleep_until((int64_t)done_us);
+        bus_free_us = done_us;
+        due_us[next] += period_us[next];
+
+        node.rx.header = (twai_frame_header_t){
+            .id = slot->id,
+            .dlc = slot->dlc,
+            .timestamp = (uint64_t)done_us,
+        };
+        fill_payload(slot, seq[next]++, (done_us - start) / 1e6, node.rx_data);
+        pthread_mutex_lock(&capture_lock);
+        if (capture_can != NULL) {
+            fprintf(capture_can, "(%llu.%06llu) can0 %03X#", (unsigned long long)(done_us / 1e6),
+                    (unsigned long long)done_us % 1000000, (unsigned)slot->id);
+            for (uint8_t i = 0; i < slot->dlc; i++) {
+                fprintf(capture_can, "%02X", node.rx_data[i]);
+            }
+            fputc('\n', capture_can);
+        }
+        pthread_mutex_unlock(&capture_lock);
+        __atomic_fetch_add(&frames_sent, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&bus_bits, bits, __ATOMIC_RELAXED);
+
+        if (node.callbacks.on_rx_done != NULL) {
+            twai_rx_done_event_data_t edata = {0};
+            node.callbacks.on_rx_done(&node, &edata, node.user_data);
+        }
+    }
+    return NULL;
+}
+
+esp_err_t twai_new_node_onchip(const twai_onchip_node_config_t *node_config, twai_node_handle_t *node_ret) {
+    if (node_config == NULL || node_ret == NULL || node_config->bit_timing.bitrate == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    node.bitrate = node_config->bit_timing.bitrate;
+    *node_ret = &node;
+    return ESP_OK;
+}
+
+esp_err_t twai_node_register_event_callbacks(twai_node_handle_t handle, const twai_event_callbacks_t *cbs,
+                                             void *user_data) {
+    handle->callbacks = *cbs;
+    handle->user_data = user_data;
+    return ESP_OK;
+}
+
+esp_err_t twai_node_enable(twai_node_handle_t handle) {
+    uint32_t rate = requested_rate > 0 ? requested_rate : host_can_schedule_rate();
+    ESP_LOGI(TAG, "Synthetic CAN: %u frames/s at %u bit/s", (unsigned)rate, (unsigned)handle->bitrate);
+    handle->enabled = true;
+    if (pthread_create(&handle->thread, NULL, can_bus_thread, NULL) != 0) {
+        handle->enabled = false;
+        return ESP_ERR_NO_MEM;
+    }
+    pthread_setname_np(handle->thread, "twai_bus");
+    return ESP_OK;
+}
+
+esp_err_t twai_node_disable(twai_node_handle_t handle) {
+    handle->enabled = false;
+    pthread_join(handle->thread, NULL);
+    return ESP_OK;
+}
+
+esp_err_t twai_node_receive_from_isr(twai_node_handle_t handle, twai_frame_t *rx_frame) {
+    size_t len = handle->rx.header.dlc < rx_frame->buffer_len ? handle->rx.header.dlc : rx_frame->buffer_len;
+    rx_frame->header = handle->rx.header;
+    memcpy(rx_frame->buffer, handle->rx_data, len);
+    return ESP_OK;
+}
+
+// ----------------------------------------------------------------------------
+// GNSS: NMEA capture player or synthesised fixes
+
+static char **nmea_lines = NULL;
+static size_t nmea_count = 0;
+static uint32_t gnss_period_ticks = 10;
+static volatile uint32_t sentences = 0;
+
+uint32_t host_gnss_sentences(void) {
+    return sentences;
+}
+
+static void feed(const char *line) {
+    pthread_mutex_lock(&capture_lock);
+    if (capture_gnss != NULL) {
+        uint64_t now = (uint64_t)esp_timer_get_time();
+        fprintf(capture_gnss, "(%llu.%06llu) %s\n", (unsigned long long)(now / 1000000),
+                (unsigned long long)(now % 1000000), line);
+    }
+    pthread_mutex_unlock(&capture_lock);
+    gnss_process_sentence(line, strlen(line));
+    __atomic_fetch_add(&sentences, 1, __ATOMIC_RELAXED);
+}
+
+static void emit(const char *body) {
+    uint8_t checksum = 0;
+    for (const char *p = body; *p != '\0'; p++) {
+        checksum ^= (uint8_t)*p;
+    }
+    char line[128];
+    snprintf(line, sizeof(line), "$%s*%02X", body, checksum);
+    feed(line);
+}
+
+// ddmm.mmmmm / dddmm.mmmmm with hemisphere
+static void nmea_coord(char *out, size_t size, double deg, int deg_digits, char pos, char neg) {
+    char hemi = deg < 0 ? neg : pos;
+    deg = fabs(deg);
+    int whole = (int)deg;
+    snprintf(out, size, "%0*d%08.5f,%c", deg_digits, whole, (deg - whole) * 60.0, hemi);
+}
+
+static void synthesise_epoch(double t) {
+    double omega = TRACK_SPEED_MS / TRACK_RADIUS_M;
+    double heading = fmod(omega * t, 2 * M_PI);
+    double north = TRACK_RADIUS_M * sin(heading);
+    double east = -TRACK_RADIUS_M * cos(heading);
+    double lat = TRACK_LAT0 + north / M_PER_DEG_LAT;
+    double lon = TRACK_LON0 + east / (M_PER_DEG_LAT * cos(TRACK_LAT0 * M_PI / 180.0));
+
+    char lat_s[24], lon_s[24], body[112];
+    nmea_coord(lat_s, sizeof(lat_s), lat, 2, 'N', 'S');
+    nmea_coord(lon_s, sizeof(lon_s), lon, 3, 'E', 'W');
+    int secs = (int)t;
+    char time_s[16];
+    snprintf(time_s, sizeof(time_s), "%02d%02d%02d.%02d", 12 + secs / 3600, secs / 60 % 60, secs % 60,
+             (int)((t - secs) * 100));
+
+    snprintf(body, sizeof(body), "GNGGA,%s,%s,%s,1,12,0.8,250.0,M,-34.0,M,,", time_s, lat_s, lon_s);
+    emit(body);
+    snprintf(body, sizeof(body), "GNRMC,%s,A,%s,%s,%.2f,%.1f,190526,,,A", time_s, lat_s, lon_s,
+             TRACK_SPEED_MS / 0.514444, heading * 180.0 / M_PI);
+    emit(body);
+}
+
+static void gnss_task(void *pvParameters) {
+    (void)pvParameters;
+    TickType_t last_wake = xTaskGetTickCount();
+    size_t line = 0;
+    uint32_t epoch = 0;
+    while (1) {
+        if (nmea_lines == NULL) {
+            synthesise_epoch(epoch * pdTICKS_TO_MS(gnss_period_ticks) / 1000.0);
+        } else {
+            // One epoch: every sentence up to and including the next RMC, looping at the end
+            for (size_t n = 0; n < nmea_count; n++) {
+                const char *s = nmea_lines[line];
+                line = (line + 1) % nmea_count;
+                feed(s);
+                if (strstr(s, "RMC,") != NULL) {
+                    break;
+                }
+            }
+        }
+        epoch++;
+        vTaskDelayUntil(&last_wake, gnss_period_ticks);
+    }
+}
+
+static esp_err_t load_nmea(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Cannot open NMEA file %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    char buf[512];
+    size_t capacity = 0;
+    while (fgets(buf, sizeof(buf), f) != NULL) {
+        size_t len = strcspn(buf, "\r\n");
+        buf[len] = '\0';
+        if (buf[0] != '$') {
+            continue; // UBX or other binary between sentences: the firmware only parses NMEA
+        }
+        if (nmea_count == capacity) {
+            capacity = capacity ? capacity * 2 : 256;
+            nmea_lines = realloc(nmea_lines, capacity * sizeof(char *));
+        }
+        nmea_lines[nmea_count++] = strdup(buf);
+    }
+    fclose(f);
+    if (nmea_count == 0) {
+        ESP_LOGE(TAG, "No NMEA sentences in %s", path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    ESP_LOGI(TAG, "Replaying %zu NMEA sentences from %s", nmea_count, path);
+    return ESP_OK;
+}
+
+esp_err_t host_gnss_start(const char *nmea_path, uint32_t rate_hz) {
+    if (rate_hz == 0 || rate_hz > configTICK_RATE_HZ) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    gnss_period_ticks = configTICK_RATE_HZ / rate_hz;
+    if (nmea_path != NULL) {
+        esp_err_t err = load_nmea(nmea_path);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    BaseType_t result = xTaskCreate(gnss_task, "gnss", 4096, NULL, 4, NULL);
+    if (result != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create GNSS task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// ----------------------------------------------------------------------------
+// ADC and INA260
+
+static host_adc_sample_t adc_sample;
+static int64_t adc_scan_us = -1;
+static bool adc_overridden = false;
+static pthread_mutex_t adc_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void host_adc_set(const host_adc_sample_t *sample) {
+    pthread_mutex_lock(&adc_lock);
+    adc_sample = *sample;
+    adc_overridden = true;
+    pthread_mutex_unlock(&adc_lock);
+}
+
+// Test signals at the start of the current 10 ms scan, as adc.c would hold them
+static void adc_scan(host_adc_sample_t *out) {
+    pthread_mutex_lock(&adc_lock);
+    int64_t scan_us = esp_timer_get_time() / ADC_SCAN_US * ADC_SCAN_US;
+    if (!adc_overridden && scan_us != adc_scan_us) {
+        double t = scan_us / 1e6;
+        double wobble = sin(t * 2.0 * M_PI * 1.5);
+        host_adc_sample_t *s = &adc_sample;
+        s->fbp = (uint16_t)(600 + 200 * sin(t * 2.0 * M_PI * 0.2));
+        s->rbp = (uint16_t)(s->fbp * 0.7);
+        s->stp = (uint16_t)(2048 + 500); // Constant right-hand lock for the circle
+        s->fls = (uint16_t)(1900 + 80 * wobble);
+        s->frs = (uint16_t)(2200 + 80 * wobble);
+        s->rls = (uint16_t)(1950 + 60 * wobble);
+        s->rrs = (uint16_t)(2150 + 60 * wobble);
+        s->voltage_raw = (uint16_t)(12600 / 1.25 + 8 * sin(t)); // 1.25 mV/LSB
+        s->current_raw = (uint16_t)(1500 / 1.25 + 40 * sin(t * 1e6 / 3e5));
+        adc_scan_us = scan_us;
+        pthread_mutex_lock(&capture_lock);
+        if (capture_adc != NULL) {
+            fprintf(capture_adc, "%lld,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", (long long)scan_us, s->fbp, s->rbp, s->stp,
+                    s->fls, s->frs, s->rrs, s->rls, s->voltage_raw, s->current_raw);
+        }
+        pthread_mutex_unlock(&capture_lock);
+    }
+    *out = adc_sample;
+    pthread_mutex_unlock(&adc_lock);
+}
+
+esp_err_t adc_get_values(uint16_t *fbp, uint16_t *rbp, uint16_t *stp,
+                         uint16_t *fls, uint16_t *frs, uint16_t *rrs, uint16_t *rls) {
+    host_adc_sample_t s;
+    adc_scan(&s);
+    *fbp = s.fbp;
+    *rbp = s.rbp;
+    *stp = s.stp;
+    *fls = s.fls;
+    *frs = s.frs;
+    *rrs = s.rrs;
+    *rls = s.rls;
+    return ESP_OK;
+}
+
+uint16_t getVoltage(void) {
+    host_adc_sample_t s;
+    adc_scan(&s);
+    return s.voltage_raw;
+}
+
+uint16_t getCurrent(void) {
+    host_adc_sample_t s;
+    adc_scan(&s);
+    return s.current_raw;
+}
+
+// ----------------------------------------------------------------------------
+// Session capture
+
+static FILE *open_capture(const char *dir, const char *name) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        ESP_LOGE(TAG, "Cannot create %s", path);
+    }
+    return f;
+}
+
+esp_err_t host_capture_start(const char *dir) {
+    mkdir(dir, 0755);
+    capture_can = open_capture(dir, HOST_CAPTURE_CAN);
+    capture_gnss = open_capture(dir, HOST_CAPTURE_GNSS);
+    capture_adc = open_capture(dir, HOST_CAPTURE_ADC);
+    if (capture_can == NULL || capture_gnss == NULL || capture_adc == NULL) {
+        host_capture_stop();
+        return ESP_FAIL;
+    }
+    fprintf(capture_adc, "time_us,fbp,rbp,stp,fls,frs,rrs,rls,voltage_raw,current_raw\n");
+    ESP_LOGI(TAG, "Capturing CAN, GNSS and ADC to %s", dir);
+    return ESP_OK;
+}
+
+void host_capture_stop(void) {
+    FILE **files[] = {&capture_can, &capture_gnss, &capture_adc};
+    pthread_mutex_lock(&capture_lock);
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+        if (*files[i] != NULL) {
+            fclose(*files[i]);
+            *files[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&capture_lock);
+}
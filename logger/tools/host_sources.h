@@ -0,0 +1,77 @@
+/*
+ * host_sources.h
+ *
+ * Stand-in sensor sources for the host build of the logger pipeline:
+ *   - a simulated TWAI controller behind main/can.c, fed by a synthetic
+ *     generator that sends every frame main/record.c decodes on its usual
+ *     schedule (scaled to a chosen frame rate)
+ *   - an NMEA player feeding gnss_process_sentence(), from a capture file
+ *     or a synthesised lap of a circular track
+ *   - adc_get_values(), getVoltage() and getCurrent() returning smooth
+ *     test signals, one sample per 10 ms scan, or the samples of a replay
+ *   - sdcard_init() for main/log_ring.c's writer: a mount delay and a card
+ *     write throughput
+ *
+ * A capture writes what each source produced to a session directory that
+ * logger_replay reads back: candump-format CAN, timestamped NMEA and the ADC
+ * scans as CSV.
+ */
+#ifndef HOST_SOURCES_H_
+#define HOST_SOURCES_H_
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define HOST_CAPTURE_CAN "can.log"   // (sec.usec) can0 ID#DATA
+#define HOST_CAPTURE_GNSS "gnss.log" // (sec.usec) $NMEA...
+#define HOST_CAPTURE_ADC "adc.csv"   // time_us,fbp,rbp,stp,fls,frs,rrs,rls,voltage_raw,current_raw
+
+typedef struct {
+    uint32_t sent;     // Frames completed on the simulated bus
+    uint64_t bus_bits; // Including framing and worst-case bit stuffing
+    uint32_t bitrate;
+} host_can_stats_t;
+
+/**
+ * @brief Total CAN frame rate of the generator; 0 keeps the vehicle schedule. Call before can_init()
+ */
+void host_can_set_rate(uint32_t frames_per_s);
+
+/**
+ * @brief Frame rate of the unscaled vehicle schedule
+ */
+uint32_t host_can_schedule_rate(void);
+
+void host_can_get_stats(host_can_stats_t *stats);
+
+/**
+ * @brief Start the GNSS task: replay nmea_path (looped, one epoch per $GNRMC) or synthesise fixes if NULL
+ */
+esp_err_t host_gnss_start(const char *nmea_path, uint32_t rate_hz);
+
+uint32_t host_gnss_sentences(void);
+
+typedef struct {
+    uint16_t fbp, rbp, stp, fls, frs, rrs, rls; // adc_get_values() order
+    uint16_t voltage_raw;                       // getVoltage()
+    uint16_t current_raw;                       // getCurrent()
+} host_adc_sample_t;
+
+/**
+ * @brief Replace the test signals: the ADC and INA260 read back sample until the next call
+ */
+void host_adc_set(const host_adc_sample_t *sample);
+
+/**
+ * @brief Make sdcard_init() take mount_ms and then hold the log's writes to kbps KB/s (0 = unlimited)
+ */
+void host_sdcard_set_model(uint32_t mount_ms, uint32_t kbps);
+
+/**
+ * @brief Record every CAN frame, NMEA sentence and ADC scan from now on under dir (created if missing)
+ */
+esp_err_t host_capture_start(const char *dir);
+
+void host_capture_stop(void);
+
+#endif /* HOST_SOURCES_H_ */
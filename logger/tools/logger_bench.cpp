@@ -0,0 +1,402 @@
+/*
+ * logger_bench.cpp
+ *
+ * Google Benchmark microbenchmarks of the logger hot paths, built from the
+ * same main/ sources as logger_host:
+ *   - loggerEmplaceU16/U32 and a full record_pack() (logBuffer_task's loop body)
+ *   - record_process_can() per CAN ID (the CAN receive task callback)
+ *   - gnss_process_sentence() per NMEA sentence type
+ *   - DTC_CAN_Response_Measurement() and the DTC deadline wheel expiring every device
+ *   - the .benji2 channel header built by log_file_open()
+ *   - fwrite() of 160-byte records under different batching/flush/buffer policies
+ *
+ * Usage: logger_bench [--baseline base.json] [--threshold PCT] [benchmark flags]
+ *   Any --benchmark_* flag works as usual; --benchmark_out=run.json
+ *   --benchmark_out_format=json writes a result file that can later be given
+ *   as --baseline. With --baseline, each benchmark's CPU time is compared
+ *   with the stored run and the exit status is 1 if any is slower by more
+ *   than PCT percent (default 10).
+ */
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "esp_log.h"
+#include "dtc.h"
+#include "host_port.h"
+#include "gnss.h"
+#include "laptimer.h"
+#include "log_chnl.h"
+#include "log_file.h"
+#include "logger.h"
+#include "record.h"
+}
+
+namespace {
+
+// ----------------------------------------------------------------------------
+// Record packing
+
+void BM_LoggerEmplaceU16(benchmark::State &state) {
+    uint8_t record[CH_COUNT] = {};
+    size_t addr = 0;
+    uint16_t value = 0;
+    for (auto _ : state) {
+        loggerEmplaceU16(record, addr, value++);
+        addr = addr + 2 < CH_COUNT - 1 ? addr + 2 : 0;
+        benchmark::DoNotOptimize(record);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerEmplaceU16);
+
+void BM_LoggerEmplaceU32(benchmark::State &state) {
+    uint8_t record[CH_COUNT] = {};
+    size_t addr = 0;
+    uint32_t value = 0;
+    for (auto _ : state) {
+        loggerEmplaceU32(record, addr, value++);
+        addr = addr + 4 < CH_COUNT - 3 ? addr + 4 : 0;
+        benchmark::DoNotOptimize(record);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LoggerEmplaceU32);
+
+void BM_RecordPack(benchmark::State &state) {
+    uint8_t record[CH_COUNT];
+    uint32_t ts_ms = 0;
+    for (auto _ : state) {
+        record_pack(record, ts_ms++);
+        benchmark::DoNotOptimize(record);
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * CH_COUNT);
+}
+BENCHMARK(BM_RecordPack);
+
+// ----------------------------------------------------------------------------
+// CAN decode, per ID; payloads in the layout record_process_can() expects
+
+struct CanCase {
+    const char *name;
+    uint32_t id;
+    uint8_t dlc;
+    uint8_t data[8];
+};
+
+const CanCase can_cases[] = {
+    {"imu_accel_0x360", 0x360, 8, {0, 0, 0, 20, 0, 0, 2, 0xA7}},
+    {"imu_accel_gyro_0x361", 0x361, 8, {0, 0, 3, 0xE8, 0, 0, 1, 0xF4}},
+    {"imu_gyro_fusion_0x362", 0x362, 8, {0, 0, 1, 0x2C, 0, 0, 0x4A, 0x9A}}, // Closes the IMU set: runs a fusion step
+    {"wheel_0x363", 0x363, 6, {0x03, 0x3F, 0x02, 0xBC, 0x00, 0xFA}},
+    {"strain_0x4e2", 0x4e2, 2, {0x08, 0x00}},
+    {"ecu_0x3e8", 0x3e8, 8, {0, 0x23, 0x28, 85, 0, 0x01, 0xA4, 0}},
+    {"drs_0x35f", 0x35F, 1, {0}},
+    {"shifter_0x40", 0x40, 3, {3, 1, 1}},
+    {"unknown_0x7ff", 0x7ff, 8, {0}},
+};
+
+void BM_ProcessCan(benchmark::State &state, const CanCase *c) {
+    for (auto _ : state) {
+        record_process_can(c->id, c->data, c->dlc);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// ----------------------------------------------------------------------------
+// NMEA parsing
+
+std::string with_checksum(const char *body) {
+    uint8_t checksum = 0;
+    for (const char *p = body; *p != '\0'; p++) {
+        checksum ^= static_cast<uint8_t>(*p);
+    }
+    char line[160];
+    snprintf(line, sizeof(line), "$%s*%02X", body, checksum);
+    return line;
+}
+
+const std::pair<const char *, const char *> nmea_cases[] = {
+    {"GGA", "GNGGA,120000.00,4217.61600,N,08343.03972,W,1,12,0.8,250.0,M,-34.0,M,,"},
+    {"RMC", "GNRMC,120000.00,A,4217.61600,N,08343.03972,W,38.88,12.5,190526,,,A"},
+    {"GSA", "GNGSA,A,3,05,07,13,14,15,17,19,24,30,,,,1.4,0.8,1.1,1"},
+    {"GSV", "GPGSV,3,1,12,05,45,301,44,07,21,055,40,13,62,120,47,14,18,250,38,1"},
+};
+
+void BM_NmeaParse(benchmark::State &state, std::string sentence) {
+    for (auto _ : state) {
+        gnss_process_sentence(sentence.c_str(), sentence.size());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * sentence.size());
+}
+
+// ----------------------------------------------------------------------------
+// DTC and log header
+
+// The CAN receive path: window push, stats, state and a deadline re-arm per frame
+void BM_DtcResponseMeasurement(benchmark::State &state) {
+    size_t i = 0;
+    for (auto _ : state) {
+        can_dtc *dtc = dtc_devices[i];
+        DTC_CAN_Response_Measurement(dtc, dtc->prevTime + 10);
+        i = i + 1 < DTC_COUNT ? i + 1 : 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_DtcResponseMeasurement);
+
+// Virtual time (ms) by which every deadline armed so far has passed
+uint64_t dtc_latest_deadline() {
+    uint64_t latest = 0;
+    for (size_t i = 0; i < DTC_COUNT; i++) {
+        latest = std::max(latest, (uint64_t)dtc_devices[i]->windowMax + dtc_devices[i]->threshold);
+    }
+    return DTC_Now_Ms() + latest + 1;
+}
+
+// Every device goes silent: the wheel timer fires and expires all of them. Runs
+// through the host port's virtual clock, so one esp_timer dispatch is included
+void BM_DtcWheelExpiry(benchmark::State &state) {
+    host_clock_advance(dtc_latest_deadline() * 1000); // Deadlines left by the other benchmarks
+    for (auto _ : state) {
+        state.PauseTiming();
+        DTC_Init(0); // Every device healthy with the shortest deadline
+        uint64_t until_ms = dtc_latest_deadline();
+        state.ResumeTiming();
+        host_clock_advance(until_ms * 1000);
+    }
+    uint32_t status[DTC_STATUS_WORDS];
+    DTC_Get_Status(status);
+    for (uint32_t word : status) {
+        if (word != 0) {
+            state.SkipWithError("devices left healthy after their deadlines");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * DTC_COUNT);
+}
+BENCHMARK(BM_DtcWheelExpiry);
+
+void BM_LogHeaderBuild(benchmark::State &state) {
+    char header[2048];
+    for (auto _ : state) {
+        size_t len = log_file_build_header(header, sizeof(header));
+        benchmark::DoNotOptimize(len);
+        benchmark::DoNotOptimize(header);
+    }
+}
+BENCHMARK(BM_LogHeaderBuild);
+
+// ----------------------------------------------------------------------------
+// fwrite policy: records per fwrite() call, fflush() every N records (0 = never),
+// stdio buffer size. batch:1/flush:10/vbuf:4096 is what fast_log_buffer() does.
+
+void BM_Fwrite(benchmark::State &state) {
+    const size_t batch = static_cast<size_t>(state.range(0));
+    const int64_t flush_every = state.range(1);
+    const size_t vbuf = static_cast<size_t>(state.range(2));
+    const long wrap_bytes = 64L << 20; // Rewind so the file stays in the page cache
+
+    FILE *f = std::tmpfile();
+    if (f == nullptr) {
+        state.SkipWithError("tmpfile failed");
+        return;
+    }
+    std::vector<char> stdio_buffer(vbuf > 0 ? vbuf : 1);
+    setvbuf(f, vbuf > 0 ? stdio_buffer.data() : nullptr, vbuf > 0 ? _IOFBF : _IONBF, vbuf);
+    std::vector<uint8_t> pending(batch * CH_COUNT, 0x5A);
+    size_t queued = 0;
+    int64_t since_flush = 0;
+
+    for (auto _ : state) {
+        // One record per iteration, as logBuffer_task produces them
+        queued++;
+        if (queued == batch) {
+            fwrite(pending.data(), CH_COUNT, batch, f);
+            queued = 0;
+        }
+        if (flush_every > 0 && ++since_flush == flush_every) {
+            fflush(f);
+            since_flush = 0;
+        }
+        if (ftell(f) > wrap_bytes) {
+            fseek(f, 0, SEEK_SET);
+        }
+    }
+    fclose(f);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * CH_COUNT);
+}
+BENCHMARK(BM_Fwrite)
+    ->ArgNames({"batch", "flush", "vbuf"})
+    ->Args({1, 10, 4096})   // Firmware policy
+    ->Args({1, 0, 4096})    // No explicit flushes
+    ->Args({1, 0, 32768})
+    ->Args({16, 0, 4096})   // Records batched in RAM, one fwrite per 2.5 KiB
+    ->Args({64, 0, 0})      // 10 KiB writes straight to the fd
+    ->Args({64, 640, 32768});
+
+// ----------------------------------------------------------------------------
+// Baseline comparison
+
+struct Result {
+    double cpu_ns;
+};
+
+double to_ns(double value, const std::string &unit) {
+    if (unit == "us") {
+        return value * 1e3;
+    }
+    if (unit == "ms") {
+        return value * 1e6;
+    }
+    if (unit == "s") {
+        return value * 1e9;
+    }
+    return value;
+}
+
+// Google Benchmark JSON: each entry of "benchmarks" has "name", then "cpu_time" and "time_unit"
+bool load_baseline(const char *path, std::map<std::string, Result> &out) {
+    std::ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    std::stringstream ss;
+    ss << in.rdbuf();
+    const std::string text = ss.str();
+
+    auto string_after = [&](const char *key, size_t from, size_t *end) -> std::string {
+        size_t pos = text.find(key, from);
+        if (pos == std::string::npos) {
+            *end = std::string::npos;
+            return "";
+        }
+        pos = text.find('"', pos + std::strlen(key));
+        size_t close = text.find('"', pos + 1);
+        *end = close;
+        return text.substr(pos + 1, close - pos - 1);
+    };
+
+    size_t pos = text.find("\"benchmarks\"");
+    while (pos != std::string::npos) {
+        size_t end;
+        std::string name = string_after("\"name\":", pos, &end);
+        if (end == std::string::npos) {
+            break;
+        }
+        size_t cpu = text.find("\"cpu_time\":", end);
+        if (cpu == std::string::npos) {
+            break;
+        }
+        double value = std::strtod(text.c_str() + cpu + std::strlen("\"cpu_time\":"), nullptr);
+        std::string unit = string_after("\"time_unit\":", cpu, &end);
+        out[name] = {to_ns(value, unit)};
+        pos = end;
+    }
+    return true;
+}
+
+// Console output as usual, keeping every run's CPU time for the baseline comparison
+class CollectingReporter : public benchmark::ConsoleReporter {
+public:
+    std::vector<std::pair<std::string, Result>> results;
+
+    void ReportRuns(const std::vector<Run> &runs) override {
+        ConsoleReporter::ReportRuns(runs);
+        for (const Run &run : runs) {
+            if (run.error_occurred) {
+                continue;
+            }
+            double ns = run.GetAdjustedCPUTime() * 1e9 / benchmark::GetTimeUnitMultiplier(run.time_unit);
+            results.push_back({run.benchmark_name(), {ns}});
+        }
+    }
+};
+
+int compare(const char *baseline_path, double threshold_pct, const CollectingReporter &reporter) {
+    std::map<std::string, Result> baseline;
+    if (!load_baseline(baseline_path, baseline) || baseline.empty()) {
+        fprintf(stderr, "Cannot read a benchmark baseline from %s\n", baseline_path);
+        return 2;
+    }
+    int regressions = 0;
+    printf("\nAgainst %s (regression above +%.0f%%):\n", baseline_path, threshold_pct);
+    printf("%-48s %12s %12s %9s\n", "Benchmark", "base ns", "now ns", "change");
+    for (const auto &[name, now] : reporter.results) {
+        auto it = baseline.find(name);
+        if (it == baseline.end()) {
+            printf("%-48s %12s %12.1f %9s\n", name.c_str(), "-", now.cpu_ns, "new");
+            continue;
+        }
+        double change = 100.0 * (now.cpu_ns - it->second.cpu_ns) / it->second.cpu_ns;
+        bool regressed = change > threshold_pct;
+        regressions += regressed;
+        printf("%-48s %12.1f %12.1f %+8.1f%%%s\n", name.c_str(), it->second.cpu_ns, now.cpu_ns, change,
+               regressed ? "  REGRESSION" : "");
+    }
+    printf("%d regression%s\n", regressions, regressions == 1 ? "" : "s");
+    return regressions > 0 ? 1 : 0;
+}
+
+// The pipeline state the benchmarks run against, brought up as in app_main
+void pipeline_init() {
+    esp_log_level_set("*", ESP_LOG_ERROR);
+    host_clock_use_virtual(0); // The DTC wheel timer only fires when a benchmark advances the clock
+    laptimer_init();
+    DTC_Init(DTC_Now_Ms());
+    ESP_ERROR_CHECK(record_init());
+    gnss_set_fix_callback(record_process_gnss_fix);
+    ESP_ERROR_CHECK(dtc_start_timer());
+}
+
+void register_cases() {
+    for (const CanCase &c : can_cases) {
+        benchmark::RegisterBenchmark((std::string("BM_ProcessCan/") + c.name).c_str(), BM_ProcessCan, &c);
+    }
+    for (const auto &[name, body] : nmea_cases) {
+        benchmark::RegisterBenchmark((std::string("BM_NmeaParse/") + name).c_str(), BM_NmeaParse,
+                                     with_checksum(body));
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const char *baseline = nullptr;
+    double threshold = 10.0;
+    std::vector<char *> args = {argv[0]};
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = std::atof(argv[++i]);
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    int bench_argc = static_cast<int>(args.size());
+    benchmark::Initialize(&bench_argc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(bench_argc, args.data())) {
+        return 1;
+    }
+
+    pipeline_init();
+    register_cases();
+    CollectingReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+    benchmark::Shutdown();
+    return baseline != nullptr ? compare(baseline, threshold, reporter) : 0;
+}
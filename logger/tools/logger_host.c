@@ -0,0 +1,362 @@
+/*
+ * logger_host.c
+ *
+ * Runs the logger's acquisition-to-storage pipeline on a PC: main/can.c,
+ * record.c, gnss_nmea.c, log_file.c, dtc.c, dtc_journal.c, fusion.c,
+ * laptimer.c and metrics.c, built unmodified against the pthread port in
+ * host_port.c and fed by the stand-in sources in host_sources.c. Writes a
+ * normal .benji2 log (check it with benji_dump) and reports throughput and
+ * per-stage latency.
+ *
+ * Usage: logger_host [--out file.benji2] [--seconds N] [--rate HZ] [--can sim|IFACE]
+ *                    [--can-fps N] [--can-queue N] [--nmea capture.nmea] [--gnss-hz N]
+ *                    [--capture DIR] [--ring] [--mount-ms N] [--sd-kbps N] [--prof-trace]
+ *                    [--trace] [--verbose]
+ *   --rate HZ     record rate; 0 (default) runs the log task flat out like the firmware
+ *   --can IFACE   receive from a SocketCAN interface (e.g. vcan0) instead of the
+ *                 simulated TWAI bus
+ *   --can-fps N   simulated bus frame rate (default: the vehicle schedule, 1380 frames/s;
+ *                 ~8000 saturates 1 Mbit/s)
+ *   --can-queue N CAN receive queue length (default CAN_RX_QUEUE_LEN)
+ *   --nmea FILE   replay NMEA sentences (one epoch per RMC) instead of a synthetic lap
+ *   --capture DIR record the CAN frames, NMEA and ADC scans fed to the pipeline as a
+ *                 session logger_replay can play back
+ *   --ring        hand records to the log writer through main/log_ring.c, as the
+ *                 firmware does, instead of writing them from the log task
+ *   --mount-ms N  with --ring, time the writer spends "mounting" before it drains
+ *   --sd-kbps N   with --ring, card write throughput in KB/s (default unlimited);
+ *                 a 400 kHz SPI clock moves ~50 KB/s, 20 MHz a few MB/s
+ *   --prof-trace  append the per-second stage profile (main/prof.h) to <out>_prof.csv
+ *   --trace       record the event trace (main/trace.h) and save the last events to
+ *                 <out>_trace.bin for trace_export
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "can.h"
+#include "dtc.h"
+#include "dtc_journal.h"
+#include "gnss.h"
+#include "laptimer.h"
+#include "log_chnl.h"
+#include "log_file.h"
+#include "log_ring.h"
+#include "metrics.h"
+#include "prof.h"
+#include "dlog.h"
+#include "trace.h"
+#include "record.h"
+#include "host_sources.h"
+#include "can_socketcan.h"
+
+static const char *TAG = "HOST";
+
+// Log-linear latency histogram in ns: 32 sub-buckets per power of two (~3% resolution)
+#define HIST_SUB_BITS 5
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) << HIST_SUB_BITS)
+
+typedef struct {
+    const char *name;
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t samples;
+    uint64_t max_ns;
+} latency_hist_t;
+
+static unsigned hist_index(uint64_t ns) {
+    if (ns < (1u << HIST_SUB_BITS)) {
+        return (unsigned)ns;
+    }
+    unsigned e = 63 - (unsigned)__builtin_clzll(ns);
+    return ((e - HIST_SUB_BITS + 1) << HIST_SUB_BITS) + (unsigned)((ns >> (e - HIST_SUB_BITS)) & ((1u << HIST_SUB_BITS) - 1));
+}
+
+// Lower bound of a bucket
+static uint64_t hist_value(unsigned index) {
+    if (index < (1u << HIST_SUB_BITS)) {
+        return index;
+    }
+    unsigned e = (index >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+    uint64_t sub = index & ((1u << HIST_SUB_BITS) - 1);
+    return (1ull << e) | (sub << (e - HIST_SUB_BITS));
+}
+
+static void hist_add(latency_hist_t *h, uint64_t ns) {
+    __atomic_fetch_add(&h->counts[hist_index(ns)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->samples, 1, __ATOMIC_RELAXED);
+    uint64_t cur = __atomic_load_n(&h->max_ns, __ATOMIC_RELAXED);
+    while (ns > cur && !__atomic_compare_exchange_n(&h->max_ns, &cur, ns, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static double hist_percentile_us(const latency_hist_t *h, double p) {
+    uint64_t target = (uint64_t)(h->samples * p);
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen > target) {
+            return hist_value(i) / 1000.0;
+        }
+    }
+    return h->max_ns / 1000.0;
+}
+
+static latency_hist_t can_decode_hist = {.name = "CAN bus -> decoded"};
+static latency_hist_t pack_hist = {.name = "record pack"};
+static latency_hist_t write_hist = {.name = "SD write"};
+static latency_hist_t storage_hist = {.name = "CAN bus -> stored"};
+
+// Bus completion time of the oldest frame decoded since the last stored record, 0 if none
+static volatile uint64_t oldest_unstored_us = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// CAN receive task callback, as in main.c, with the frame's bus-to-decode latency
+static void process_can_message(twai_frame_t *message) {
+    record_process_can(message->header.id, message->buffer, message->header.dlc);
+    uint64_t arrived = message->header.timestamp;
+    hist_add(&can_decode_hist, ((uint64_t)esp_timer_get_time() - arrived) * 1000);
+    uint64_t none = 0;
+    __atomic_compare_exchange_n(&oldest_unstored_us, &none, arrived, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+typedef struct {
+    uint32_t rate_hz;
+    bool ring;
+    volatile bool stop;
+    SemaphoreHandle_t done;
+    uint64_t records;
+    uint64_t write_errors;
+} log_task_ctx_t;
+
+// main.c's logBuffer_task with each stage timed; without --ring it writes to the card itself
+static void log_task(void *pvParameters) {
+    log_task_ctx_t *ctx = pvParameters;
+    static uint8_t record[CH_COUNT];
+    uint64_t period_ns = ctx->rate_hz > 0 ? 1000000000ull / ctx->rate_hz : 0;
+    uint64_t next_ns = now_ns();
+
+    while (!ctx->stop) {
+        uint64_t t0 = now_ns();
+        PROF_BEGIN(RECORD_PACK);
+        record_pack(record, (uint32_t)(esp_timer_get_time() / 1000));
+        PROF_END(RECORD_PACK);
+        uint64_t t1 = now_ns();
+        esp_err_t result = ctx->ring ? (log_ring_push(record) ? ESP_OK : ESP_FAIL) : fast_log_buffer(record, CH_COUNT);
+        uint64_t t2 = now_ns();
+        metrics_inc(METRIC_RECORDS_PRODUCED);
+
+        hist_add(&pack_hist, t1 - t0);
+        hist_add(&write_hist, t2 - t1);
+        uint64_t oldest = __atomic_exchange_n(&oldest_unstored_us, 0, __ATOMIC_RELAXED);
+        if (oldest != 0 && result == ESP_OK && !ctx->ring) {
+            hist_add(&storage_hist, ((uint64_t)esp_timer_get_time() - oldest) * 1000);
+        }
+        ctx->records++;
+        if (result != ESP_OK) {
+            ctx->write_errors++;
+        }
+        if (!ctx->ring) {
+            dtc_journal_write(); // This task is the card's writer
+        }
+
+        if (period_ns > 0) {
+            next_ns += period_ns;
+            uint64_t now = now_ns();
+            if (next_ns > now) {
+                struct timespec ts = {.tv_sec = (next_ns - now) / 1000000000, .tv_nsec = (next_ns - now) % 1000000000};
+                nanosleep(&ts, NULL);
+            } else {
+                next_ns = now; // Overrun: do not try to catch up
+            }
+        }
+    }
+    xSemaphoreGive(ctx->done);
+    vTaskDelete(NULL);
+}
+
+static void print_hist(const latency_hist_t *h) {
+    if (h->samples == 0) {
+        printf("  %-20s %10s\n", h->name, "-");
+        return;
+    }
+    printf("  %-20s %10llu %10.1f %10.1f %10.1f %10.1f\n", h->name, (unsigned long long)h->samples,
+           hist_percentile_us(h, 0.50), hist_percentile_us(h, 0.99), hist_percentile_us(h, 0.999), h->max_ns / 1000.0);
+}
+
+static int usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s [--out file.benji2] [--seconds N] [--rate HZ] [--can sim|IFACE] [--can-fps N] "
+            "[--can-queue N] [--nmea file] [--gnss-hz N] [--capture dir] [--ring] [--mount-ms N] [--sd-kbps N] "
+            "[--prof-trace] [--trace] [--verbose]\n",
+            argv0);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *out_path = "host_log" LOG_TYPE;
+    const char *nmea_path = NULL;
+    const char *capture_dir = NULL;
+    double seconds = 10;
+    uint32_t gnss_hz = 10;
+    const char *can_iface = NULL;
+    uint32_t can_fps = 0;
+    uint32_t can_queue = CAN_RX_QUEUE_LEN;
+    bool verbose = false;
+    bool prof_trace = false;
+    bool trace = false;
+    uint32_t mount_ms = 0;
+    uint32_t sd_kbps = 0;
+    log_task_ctx_t ctx = {0};
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--out") == 0 && has_value) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--seconds") == 0 && has_value) {
+            seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--rate") == 0 && has_value) {
+            ctx.rate_hz = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--can") == 0 && has_value) {
+            can_iface = strcmp(argv[i + 1], "sim") == 0 ? NULL : argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "--can-queue") == 0 && has_value) {
+            can_queue = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--can-fps") == 0 && has_value) {
+            can_fps = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--nmea") == 0 && has_value) {
+            nmea_path = argv[++i];
+        } else if (strcmp(argv[i], "--gnss-hz") == 0 && has_value) {
+            gnss_hz = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--capture") == 0 && has_value) {
+            capture_dir = argv[++i];
+        } else if (strcmp(argv[i], "--ring") == 0) {
+            ctx.ring = true;
+        } else if (strcmp(argv[i], "--mount-ms") == 0 && has_value) {
+            mount_ms = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sd-kbps") == 0 && has_value) {
+            sd_kbps = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--prof-trace") == 0) {
+            prof_trace = true;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            trace = true;
+        } else if (strcmp(argv[i], "--verbose") == 0) {
+            verbose = true;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (seconds <= 0 || can_queue == 0 || can_queue > CAN_RX_QUEUE_MAX) {
+        return usage(argv[0]);
+    }
+    esp_log_level_set("*", verbose ? ESP_LOG_INFO : ESP_LOG_WARN);
+    prof_trace_enable(prof_trace);
+    if (trace && trace_start() != ESP_OK) {
+        return 1;
+    }
+
+    // Same bring-up order as app_main, minus the drivers the stand-ins replace.
+    // log_file_open appends, as the firmware never reuses a name; start fresh here
+    remove(out_path);
+    if (capture_dir != NULL && host_capture_start(capture_dir) != ESP_OK) {
+        return 1;
+    }
+    ESP_ERROR_CHECK(log_file_init());
+    ESP_ERROR_CHECK(log_file_open(out_path));
+    laptimer_init();
+    DTC_Init(DTC_Now_Ms());
+    ESP_ERROR_CHECK(dtc_journal_init());
+    ESP_ERROR_CHECK(record_init());
+    gnss_set_fix_callback(record_process_gnss_fix);
+    host_can_set_rate(can_fps);
+    can_transport_t socketcan = can_socketcan_transport(can_iface);
+    const can_transport_t *transport = can_iface != NULL ? &socketcan : &can_transport_twai;
+    if (can_init_transport(transport, (uint16_t)can_queue, process_can_message) != ESP_OK) {
+        return 1;
+    }
+    ESP_ERROR_CHECK(dtc_start_timer());
+    ESP_ERROR_CHECK(dtc_start_stats_task());
+    ESP_ERROR_CHECK(metrics_start_task());
+    ESP_ERROR_CHECK(dlog_start_task());
+    ESP_ERROR_CHECK(host_gnss_start(nmea_path, gnss_hz));
+
+    host_sdcard_set_model(mount_ms, sd_kbps);
+    if (ctx.ring && log_ring_start_writer() != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start log writer task");
+        return 1;
+    }
+
+    ctx.done = xSemaphoreCreateBinary();
+    if (ctx.done == NULL || xTaskCreate(log_task, "log buffer", 4096, &ctx, 8, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create logging task");
+        return 1;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    struct timespec run = {.tv_sec = (time_t)seconds, .tv_nsec = (long)((seconds - (time_t)seconds) * 1e9)};
+    nanosleep(&run, NULL);
+    ctx.stop = true;
+    xSemaphoreTake(ctx.done, portMAX_DELAY);
+    host_capture_stop();
+    dlog_flush();
+    if (trace) {
+        trace_save();
+    }
+    double elapsed = (esp_timer_get_time() - start_us) / 1e6;
+    log_ring_stats_t ring;
+    log_ring_get_stats(&ring);
+    while (ctx.ring && (ring.storage_ready_ms == 0 || ring.waiting > 0)) {
+        vTaskDelay(pdMS_TO_TICKS(LOG_WRITER_PERIOD_MS)); // Let the writer catch up
+        log_ring_get_stats(&ring);
+    }
+
+    xSemaphoreTake(log_file_mutex, portMAX_DELAY);
+    fflush(log_file);
+    long size = ftell(log_file);
+    xSemaphoreGive(log_file_mutex);
+
+    can_stats_t can;
+    host_can_stats_t bus;
+    can_get_stats(&can);
+    host_can_get_stats(&bus);
+    double mib = (double)ctx.records * CH_COUNT / (1024.0 * 1024.0);
+
+    printf("%s: %ld bytes, %d channels\n", out_path, size, CH_COUNT);
+    printf("Records: %llu in %.2f s = %.0f records/s, %.2f MiB/s (%llu write errors)\n",
+           (unsigned long long)ctx.records, elapsed, ctx.records / elapsed, mib / elapsed,
+           (unsigned long long)ctx.write_errors);
+    if (ctx.ring) {
+        printf("Log ring: first sample %u ms, storage ready %u ms with %u buffered, peak %u of %d, %u dropped\n",
+               (unsigned)ring.first_sample_ms, (unsigned)ring.storage_ready_ms, (unsigned)ring.buffered,
+               (unsigned)ring.peak, LOG_RING_RECORDS, (unsigned)ring.dropped);
+    }
+    if (can_iface == NULL) {
+        printf("CAN: %u frames on the bus (%.0f frames/s, %.1f%% load), ", (unsigned)bus.sent, bus.sent / elapsed,
+               100.0 * bus.bus_bits / (elapsed * bus.bitrate));
+    } else {
+        printf("CAN: %s, ", can_iface);
+    }
+    printf("%u received (%.0f frames/s), %u dropped, %u overruns, queue peak %u of %u\n", (unsigned)can.rx_frames,
+           can.rx_frames / elapsed, (unsigned)can.rx_dropped, (unsigned)can.rx_overruns, (unsigned)can.rx_max_queued,
+           (unsigned)can_queue);
+    printf("GNSS: %u sentences, DTC journal dropped %u\n", (unsigned)host_gnss_sentences(),
+           (unsigned)dtc_journal_dropped());
+    printf("Latency (us)              samples        p50        p99      p99.9        max\n");
+    print_hist(&can_decode_hist);
+    print_hist(&pack_hist);
+    print_hist(&write_hist);
+    print_hist(&storage_hist);
+    prof_print();
+    return 0;
+}
@@ -0,0 +1,526 @@
+/*
+ * logger_replay.c
+ *
+ * Deterministic replay of a recorded session through the logger pipeline:
+ * the same main/ sources as logger_host, but single-threaded on the virtual
+ * clock of host_port.c. A CAN journal (candump -l format), a GNSS capture
+ * (timestamped NMEA) and an ADC trace are merged by timestamp and fed in
+ * order - CAN frames to record_process_can() as the CAN receive task would,
+ * sentences to gnss_process_sentence(), ADC scans to the stand-in ADC - and
+ * a record is packed and written every 1/rate s of session time. Nothing
+ * depends on scheduling or the wall clock, so a session always regenerates
+ * the same .benji2 byte for byte, which is compared against a golden log.
+ *
+ * logger_host --capture DIR records a session in this layout; candump -l
+ * output from the car works as the CAN journal.
+ *
+ * Usage: logger_replay <session_dir> [--can can.log] [--gnss gnss.log] [--adc adc.csv]
+ *                      [--out file.benji2] [--golden file.benji2] [--rate HZ] [--realtime]
+ *   --rate HZ    record rate in session time (default 1000)
+ *   --realtime   pace the replay to the original timestamps instead of running flat out
+ *   --golden F   compare the output with F; exit 1 and name the first difference if
+ *                they are not identical
+ *
+ * Session time starts at the earliest timestamp in any stream. The metrics,
+ * DTC journal and statistics tasks are not run, so their channels stay 0.
+ */
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "dlog.h"
+#include "dtc.h"
+#include "gnss.h"
+#include "laptimer.h"
+#include "log_chnl.h"
+#include "log_file.h"
+#include "record.h"
+#include "host_port.h"
+#include "host_sources.h"
+
+#define MAX_LINE 512
+#define NO_EVENT INT64_MAX
+
+typedef enum {
+    STAGE_PARSE,
+    STAGE_CAN,
+    STAGE_GNSS,
+    STAGE_ADC,
+    STAGE_PACK,
+    STAGE_WRITE,
+    STAGE_COUNT
+} stage_t;
+
+static const char *const stage_names[STAGE_COUNT] = {
+    "parse input", "CAN decode", "GNSS parse", "ADC sample", "record pack", "record write",
+};
+
+static uint64_t stage_ns[STAGE_COUNT];
+static uint64_t stage_items[STAGE_COUNT];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// ----------------------------------------------------------------------------
+// Input streams: each holds its next event, parsed and timestamped
+
+typedef struct {
+    uint32_t id;
+    uint8_t len;
+    uint8_t data[64]; // Up to CAN FD
+} replay_can_frame_t;
+
+typedef struct {
+    const char *name;
+    FILE *file;
+    bool (*parse)(char *line, void *event, int64_t *time_us);
+    int64_t time_us; // Of the pending event, NO_EVENT once exhausted
+    uint64_t skipped;
+    union {
+        replay_can_frame_t can;
+        char nmea[MAX_LINE];
+        host_adc_sample_t adc;
+    } event;
+} stream_t;
+
+// "(1718000000.123456)" -> microseconds; returns the rest of the line
+static char *parse_stamp(char *line, int64_t *time_us) {
+    if (line[0] != '(') {
+        return NULL;
+    }
+    char *end;
+    long long sec = strtoll(line + 1, &end, 10);
+    if (*end != '.') {
+        return NULL;
+    }
+    char *frac = end + 1;
+    long long usec = strtoll(frac, &end, 10);
+    if (*end != ')' || end - frac != 6) {
+        return NULL;
+    }
+    *time_us = sec * 1000000 + usec;
+    return end + 1;
+}
+
+static int hex_nibble(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = (char)tolower((unsigned char)c);
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+// candump -l: "(sec.usec) can0 123#DEADBEEF", "12345678#..." (extended), "123##1..." (FD), "123#R" (RTR, skipped)
+static bool parse_can(char *line, void *event, int64_t *time_us) {
+    replay_can_frame_t *frame = event;
+    char *p = parse_stamp(line, time_us);
+    if (p == NULL) {
+        return false;
+    }
+    while (*p == ' ') {
+        p++;
+    }
+    p = strchr(p, ' '); // Interface name
+    if (p == NULL) {
+        return false;
+    }
+    char *end;
+    frame->id = (uint32_t)strtoul(p + 1, &end, 16);
+    if (*end != '#') {
+        return false;
+    }
+    p = end + 1;
+    if (*p == 'R') {
+        return false;
+    }
+    if (*p == '#') {
+        p += 2; // FD flags nibble
+    }
+    frame->len = 0;
+    while (frame->len < sizeof(frame->data)) {
+        if (*p == '.') {
+            p++;
+            continue;
+        }
+        int hi = hex_nibble(p[0]);
+        int lo = hi < 0 ? -1 : hex_nibble(p[1]);
+        if (lo < 0) {
+            break;
+        }
+        frame->data[frame->len++] = (uint8_t)(hi << 4 | lo);
+        p += 2;
+    }
+    return true;
+}
+
+// "(sec.usec) $GNRMC,..."
+static bool parse_gnss(char *line, void *event, int64_t *time_us) {
+    char *p = parse_stamp(line, time_us);
+    if (p == NULL) {
+        return false;
+    }
+    while (*p == ' ') {
+        p++;
+    }
+    if (*p != '$') {
+        return false;
+    }
+    snprintf(event, MAX_LINE, "%s", p);
+    return true;
+}
+
+// "time_us,fbp,rbp,stp,fls,frs,rrs,rls,voltage_raw,current_raw"
+static bool parse_adc(char *line, void *event, int64_t *time_us) {
+    host_adc_sample_t *s = event;
+    long long t;
+    unsigned v[9];
+    if (sscanf(line, "%lld,%u,%u,%u,%u,%u,%u,%u,%u,%u", &t, &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7],
+               &v[8]) != 10) {
+        return false;
+    }
+    *s = (host_adc_sample_t){
+        .fbp = (uint16_t)v[0], .rbp = (uint16_t)v[1], .stp = (uint16_t)v[2],
+        .fls = (uint16_t)v[3], .frs = (uint16_t)v[4], .rrs = (uint16_t)v[5], .rls = (uint16_t)v[6],
+        .voltage_raw = (uint16_t)v[7], .current_raw = (uint16_t)v[8],
+    };
+    *time_us = t;
+    return true;
+}
+
+// Read ahead to the stream's next event; blank lines, comments, headers and unusable frames are skipped
+static void stream_next(stream_t *s) {
+    uint64_t t0 = now_ns();
+    char line[MAX_LINE];
+    s->time_us = NO_EVENT;
+    while (s->file != NULL && fgets(line, sizeof(line), s->file) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#' || isalpha((unsigned char)line[0])) {
+            continue;
+        }
+        if (s->parse(line, &s->event, &s->time_us)) {
+            break;
+        }
+        s->time_us = NO_EVENT;
+        s->skipped++;
+    }
+    stage_ns[STAGE_PARSE] += now_ns() - t0;
+    stage_items[STAGE_PARSE]++;
+}
+
+static bool stream_open(stream_t *s, const char *path, bool required) {
+    s->file = fopen(path, "r");
+    if (s->file == NULL) {
+        if (required) {
+            fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+            return false;
+        }
+        fprintf(stderr, "No %s stream (%s)\n", s->name, path);
+    }
+    stream_next(s);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Golden comparison
+
+static long file_size(FILE *f) {
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    return size;
+}
+
+// Name of channel byte `index` from a .benji2 header, or "?"
+static void channel_name(const uint8_t *header, uint32_t header_len, size_t index, char *out, size_t size) {
+    size_t field = 0, start = 0;
+    for (uint32_t i = 0; i < header_len; i++) {
+        if (header[i] != ',') {
+            continue;
+        }
+        if (field++ == index) {
+            snprintf(out, size, "%.*s", (int)(i - start), (const char *)header + start);
+            return;
+        }
+        start = i + 1;
+    }
+    snprintf(out, size, "?");
+}
+
+static uint8_t *read_all(const char *path, long *size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "Cannot open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    *size = file_size(f);
+    uint8_t *data = malloc(*size > 0 ? (size_t)*size : 1);
+    if (data != NULL && fread(data, 1, (size_t)*size, f) != (size_t)*size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+// 0 if identical, 1 if they differ, -1 if a file cannot be read
+static int compare_golden(const char *out_path, const char *golden_path) {
+    long out_size, golden_size;
+    uint8_t *out = read_all(out_path, &out_size);
+    uint8_t *golden = read_all(golden_path, &golden_size);
+    if (out == NULL || golden == NULL || golden_size < 4) {
+        free(out);
+        free(golden);
+        return -1;
+    }
+    uint32_t header_len = (uint32_t)golden[0] | (uint32_t)golden[1] << 8 | (uint32_t)golden[2] << 16 |
+                          (uint32_t)golden[3] << 24;
+    long body = 4 + (long)header_len;
+    int result = 0;
+
+    if (out_size < body || memcmp(out, golden, (size_t)body) != 0) {
+        printf("Golden: channel header differs from %s\n", golden_path);
+        result = 1;
+    } else {
+        long common = (out_size < golden_size ? out_size : golden_size) - body;
+        uint64_t differing = 0;
+        long first = -1;
+        for (long rec = 0; rec + CH_COUNT <= common; rec += CH_COUNT) {
+            if (memcmp(out + body + rec, golden + body + rec, CH_COUNT) != 0) {
+                if (first < 0) {
+                    first = rec;
+                }
+                differing++;
+            }
+        }
+        if (first >= 0) {
+            size_t ch = 0;
+            while (out[body + first + ch] == golden[body + first + ch]) {
+                ch++;
+            }
+            char name[64];
+            channel_name(golden + 4, header_len, ch, name, sizeof(name));
+            printf("Golden: MISMATCH at record %ld, channel %s (byte %zu): 0x%02X, golden 0x%02X; "
+                   "%llu records differ\n",
+                   first / CH_COUNT, name, ch, out[body + first + ch], golden[body + first + ch],
+                   (unsigned long long)differing);
+            result = 1;
+        }
+        if (out_size != golden_size) {
+            printf("Golden: %ld records, golden has %ld\n", (out_size - body) / CH_COUNT,
+                   (golden_size - body) / CH_COUNT);
+            result = 1;
+        }
+        if (result == 0) {
+            printf("Golden: identical to %s (%ld records)\n", golden_path, (out_size - body) / CH_COUNT);
+        }
+    }
+    free(out);
+    free(golden);
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+
+static void pace(uint64_t wall_start_ns, int64_t session_us) {
+    uint64_t deadline = wall_start_ns + (uint64_t)session_us * 1000;
+    struct timespec ts = {.tv_sec = (time_t)(deadline / 1000000000), .tv_nsec = (long)(deadline % 1000000000)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+static int usage(const char *argv0) {
+    fprintf(stderr,
+            "Usage: %s <session_dir> [--can can.log] [--gnss gnss.log] [--adc adc.csv] [--out file.benji2] "
+            "[--golden file.benji2] [--rate HZ] [--realtime]\n",
+            argv0);
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *paths[3] = {NULL, NULL, NULL};
+    const char *out_path = "replay" LOG_TYPE;
+    const char *golden_path = NULL;
+    uint32_t rate_hz = 1000;
+    bool realtime = false;
+    const char *session = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--can") == 0 && has_value) {
+            paths[0] = argv[++i];
+        } else if (strcmp(argv[i], "--gnss") == 0 && has_value) {
+            paths[1] = argv[++i];
+        } else if (strcmp(argv[i], "--adc") == 0 && has_value) {
+            paths[2] = argv[++i];
+        } else if (strcmp(argv[i], "--out") == 0 && has_value) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--golden") == 0 && has_value) {
+            golden_path = argv[++i];
+        } else if (strcmp(argv[i], "--rate") == 0 && has_value) {
+            rate_hz = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--realtime") == 0) {
+            realtime = true;
+        } else if (argv[i][0] != '-' && session == NULL) {
+            session = argv[i];
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (rate_hz == 0 || rate_hz > 1000000 || (session == NULL && paths[0] == NULL && paths[1] == NULL &&
+                                               paths[2] == NULL)) {
+        return usage(argv[0]);
+    }
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    // Streams given explicitly must exist; those defaulted from the session directory may be absent
+    static const char *const defaults[3] = {HOST_CAPTURE_CAN, HOST_CAPTURE_GNSS, HOST_CAPTURE_ADC};
+    stream_t streams[3] = {
+        {.name = "CAN", .parse = parse_can},
+        {.name = "GNSS", .parse = parse_gnss},
+        {.name = "ADC", .parse = parse_adc},
+    };
+    char default_paths[3][512];
+    for (int i = 0; i < 3; i++) {
+        const char *path = paths[i];
+        if (path == NULL && session != NULL) {
+            snprintf(default_paths[i], sizeof(default_paths[i]), "%s/%s", session, defaults[i]);
+            path = default_paths[i];
+        }
+        if (path != NULL && !stream_open(&streams[i], path, paths[i] != NULL)) {
+            return 1;
+        }
+    }
+    stream_t *can = &streams[0], *gnss = &streams[1], *adc = &streams[2];
+
+    int64_t first_us = NO_EVENT;
+    for (int i = 0; i < 3; i++) {
+        if (streams[i].time_us < first_us) {
+            first_us = streams[i].time_us;
+        }
+    }
+    if (first_us == NO_EVENT) {
+        fprintf(stderr, "No events to replay\n");
+        return 1;
+    }
+
+    // app_main's bring-up, on session time; only the esp_timer DTC wheel runs, off the virtual clock
+    host_clock_use_virtual(0);
+    remove(out_path);
+    ESP_ERROR_CHECK(log_file_init());
+    ESP_ERROR_CHECK(log_file_open(out_path));
+    laptimer_init();
+    DTC_Init(DTC_Now_Ms());
+    ESP_ERROR_CHECK(record_init());
+    gnss_set_fix_callback(record_process_gnss_fix);
+    ESP_ERROR_CHECK(dtc_start_timer());
+
+    static uint8_t record[CH_COUNT];
+    uint64_t period_us = 1000000 / rate_hz;
+    int64_t next_record_us = 0;
+    int64_t last_us = 0;
+    uint64_t records = 0;
+    uint64_t write_errors = 0;
+    uint64_t wall_start = now_ns();
+
+    for (;;) {
+        stream_t *next = NULL;
+        for (int i = 0; i < 3; i++) {
+            if (streams[i].time_us != NO_EVENT && (next == NULL || streams[i].time_us < next->time_us)) {
+                next = &streams[i];
+            }
+        }
+        if (next == NULL && next_record_us > last_us) {
+            break; // Records cover the last input event
+        }
+
+        // Inputs stamped at a record tick are in that record
+        int64_t t = next != NULL && next->time_us - first_us <= next_record_us ? next->time_us - first_us
+                                                                               : next_record_us;
+        if (realtime) {
+            pace(wall_start, t);
+        }
+        host_clock_advance((uint64_t)t);
+
+        uint64_t t0 = now_ns();
+        if (next != NULL && next->time_us - first_us == t) {
+            last_us = t;
+            stage_t stage;
+            if (next == can) {
+                record_process_can(can->event.can.id, can->event.can.data, can->event.can.len);
+                stage = STAGE_CAN;
+            } else if (next == gnss) {
+                gnss_process_sentence(gnss->event.nmea, strlen(gnss->event.nmea));
+                stage = STAGE_GNSS;
+            } else {
+                host_adc_set(&adc->event.adc);
+                stage = STAGE_ADC;
+            }
+            stage_ns[stage] += now_ns() - t0;
+            stage_items[stage]++;
+            stream_next(next);
+            continue;
+        }
+
+        record_pack(record, (uint32_t)(t / 1000));
+        uint64_t t1 = now_ns();
+        if (fast_log_buffer(record, CH_COUNT) != ESP_OK) {
+            write_errors++;
+        }
+        stage_ns[STAGE_PACK] += t1 - t0;
+        stage_ns[STAGE_WRITE] += now_ns() - t1;
+        stage_items[STAGE_PACK]++;
+        stage_items[STAGE_WRITE]++;
+        records++;
+        next_record_us += (int64_t)period_us;
+        dlog_flush(); // No dlog or metrics task here: print deferred warnings and write laps between records
+        laptimer_write_summary();
+    }
+    double wall = (now_ns() - wall_start) / 1e9;
+
+    xSemaphoreTake(log_file_mutex, portMAX_DELAY);
+    fclose(log_file);
+    log_file = NULL;
+    xSemaphoreGive(log_file_mutex);
+    for (int i = 0; i < 3; i++) {
+        if (streams[i].file != NULL) {
+            fclose(streams[i].file);
+        }
+    }
+
+    double session_s = last_us / 1e6;
+    printf("%s: %llu records (%llu write errors) from %.2f s of session in %.3f s (%.1fx %s)\n", out_path,
+           (unsigned long long)records, (unsigned long long)write_errors, session_s, wall,
+           wall > 0 ? session_s / wall : 0.0, realtime ? "paced" : "real time");
+    printf("Inputs: %llu CAN frames, %llu NMEA sentences, %llu ADC scans (%llu lines skipped)\n",
+           (unsigned long long)stage_items[STAGE_CAN], (unsigned long long)stage_items[STAGE_GNSS],
+           (unsigned long long)stage_items[STAGE_ADC],
+           (unsigned long long)(can->skipped + gnss->skipped + adc->skipped));
+    printf("Stage                 items     total ms    ns/item      items/s\n");
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        if (stage_items[i] == 0) {
+            printf("  %-14s %10s\n", stage_names[i], "-");
+            continue;
+        }
+        double ns = (double)stage_ns[i] / stage_items[i];
+        printf("  %-14s %10llu %12.2f %10.0f %12.0f\n", stage_names[i], (unsigned long long)stage_items[i],
+               stage_ns[i] / 1e6, ns, ns > 0 ? 1e9 / ns : 0.0);
+    }
+
+    if (golden_path != NULL) {
+        int diff = compare_golden(out_path, golden_path);
+        if (diff != 0) {
+            return diff < 0 ? 2 : 1;
+        }
+    }
+    return 0;
+}
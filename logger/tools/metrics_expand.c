@@ -0,0 +1,153 @@
+/*
+ * metrics_expand.c
+ *
+ * Rebuilds the once-per-second metrics summary from the multiplexed
+ * MET_FIELD/MET_VALUE channels of a .benji2 log: each record carries one
+ * field, and every run of fields 0..N-1 is one snapshot. One CSV row is
+ * printed per snapshot, named from main/metrics_fields.h.
+ *
+ * Usage: metrics_expand <log.benji2> [out.csv]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "metrics_fields.h"
+
+#define MAX_CHANNELS 1024
+#define MAX_NAME 32
+
+#define X(name) #name,
+static const char *field_names[] = {METRICS_SUMMARY_FIELDS};
+#undef X
+#define FIELD_COUNT (int)(sizeof(field_names) / sizeof(field_names[0]))
+
+static char names[MAX_CHANNELS][MAX_NAME];
+static size_t channel_count = 0;
+
+static int find_channel(const char *name) {
+    for (size_t i = 0; i < channel_count; i++) {
+        if (strcmp(names[i], name) == 0) {
+            return (int)i;
+        }
+    }
+    fprintf(stderr, "Channel %s not found in log header\n", name);
+    return -1;
+}
+
+static uint32_t read_u32(const uint8_t *rec, int off) {
+    return (uint32_t)rec[off] << 24 | (uint32_t)rec[off + 1] << 16 | (uint32_t)rec[off + 2] << 8 | rec[off + 3];
+}
+
+static uint16_t read_u16(const uint8_t *rec, int off) {
+    return (uint16_t)(rec[off] << 8 | rec[off + 1]);
+}
+
+static int parse_header(FILE *in) {
+    uint8_t len_bytes[4];
+    if (fread(len_bytes, 1, 4, in) != 4) {
+        fprintf(stderr, "Failed to read header length\n");
+        return -1;
+    }
+    // Header length is written little-endian by open_log_file()
+    uint32_t header_len = len_bytes[0] | len_bytes[1] << 8 | len_bytes[2] << 16 | (uint32_t)len_bytes[3] << 24;
+
+    char *header = malloc(header_len + 1);
+    if (header == NULL || fread(header, 1, header_len, in) != header_len) {
+        fprintf(stderr, "Failed to read %u byte header\n", header_len);
+        free(header);
+        return -1;
+    }
+    header[header_len] = '\0';
+
+    for (char *tok = strtok(header, ","); tok != NULL && channel_count < MAX_CHANNELS; tok = strtok(NULL, ",")) {
+        strncpy(names[channel_count], tok, MAX_NAME - 1);
+        channel_count++;
+    }
+    free(header);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <log.benji2> [out.csv]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+    if (out == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+    if (parse_header(in) != 0) {
+        return 1;
+    }
+
+    int ts = find_channel("TS");
+    int field = find_channel("MET_FIELD");
+    int value = find_channel("MET_VALUE");
+    if (ts < 0 || field < 0 || value < 0) {
+        return 1;
+    }
+
+    fprintf(out, "time_s");
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        fprintf(out, ",%s", field_names[i]);
+    }
+    fprintf(out, "\n");
+
+    uint8_t *rec = malloc(channel_count);
+    uint16_t values[FIELD_COUNT];
+    int next = 0; // Field expected next; a gap in the sequence drops the partial snapshot
+    int have_prev = 0;
+    uint16_t prev_seq = 0;
+    size_t records = 0, written = 0;
+
+    while (fread(rec, 1, channel_count, in) == channel_count) {
+        records++;
+        int f = rec[field];
+        if (f >= FIELD_COUNT) {
+            next = 0;
+            continue;
+        }
+        if (f != next) {
+            next = f == 0 ? 0 : -1;
+            if (next < 0) {
+                continue;
+            }
+        }
+        values[f] = read_u16(rec, value);
+        next = f + 1;
+        if (next < FIELD_COUNT) {
+            continue;
+        }
+        next = 0;
+
+        // Each snapshot repeats until the next one is taken; print it once
+        if (have_prev && values[0] == prev_seq) {
+            continue;
+        }
+        have_prev = 1;
+        prev_seq = values[0];
+        written++;
+
+        fprintf(out, "%.3f", read_u32(rec, ts) / 1000.0);
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            fprintf(out, ",%u", values[i]);
+        }
+        fprintf(out, "\n");
+    }
+
+    fprintf(stderr, "%zu records, %zu snapshots written\n", records, written);
+    free(rec);
+    fclose(in);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
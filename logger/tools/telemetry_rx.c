@@ -0,0 +1,288 @@
+/*
+ * telemetry_rx.c
+ *
+ * Receiver for the logger's binary live-telemetry stream (console
+ * 'stream <rate_hz> [CH,...]', see main/telemetry.h). Decodes COBS/CRC frames from a serial port and
+ * writes one CSV row per data frame, flushed immediately so a plotter can
+ * tail the output. Multi-byte channels are reassembled big-endian from the
+ * per-byte names in the schema frame (NAME, NAME1, NAME2, ...).
+ *
+ * Usage: telemetry_rx <port|-> [--baud N] [--out file.csv] [--signed CH,CH,...]
+ *   -          read a captured stream from stdin instead of a serial port
+ *   --signed   channels to print as two's complement (default unsigned)
+ *
+ * On exit (Ctrl-C) a 'T' is sent to stop the stream on the logger.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <unistd.h>
+#include "telemetry_frame.h"
+
+#define MAX_COLUMNS 1024
+#define MAX_NAME 32
+#define DEFAULT_BAUD 921600
+
+typedef struct {
+    char name[MAX_NAME];
+    uint16_t offset; // First byte in the data payload
+    uint8_t width;   // Bytes, big-endian
+    int is_signed;
+} column_t;
+
+static column_t columns[MAX_COLUMNS];
+static int column_count = 0;
+static uint16_t payload_len = 0; // Data payload size the schema describes
+static uint16_t rate_hz = 0;
+static char signed_list[4096] = "";
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static speed_t baud_constant(long baud) {
+    switch (baud) {
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        case 921600: return B921600;
+        default: return 0;
+    }
+}
+
+static int open_port(const char *path, long baud) {
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror(path);
+        return -1;
+    }
+    speed_t speed = baud_constant(baud);
+    if (speed == 0) {
+        fprintf(stderr, "Unsupported baud rate %ld\n", baud);
+        close(fd);
+        return -1;
+    }
+
+    struct termios tio;
+    if (tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, speed);
+        cfsetospeed(&tio, speed);
+        tio.c_cc[VMIN] = 1;
+        tio.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+    return fd;
+}
+
+static int in_list(const char *list, const char *name) {
+    size_t len = strlen(name);
+    for (const char *p = list; (p = strstr(p, name)) != NULL; p += len) {
+        if ((p == list || p[-1] == ',') && (p[len] == ',' || p[len] == '\0')) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// NAME followed only by digits continues the column whose base is NAME
+static int is_continuation(const char *name, const char *base) {
+    size_t len = strlen(base);
+    if (strncmp(name, base, len) != 0 || name[len] == '\0') {
+        return 0;
+    }
+    for (const char *p = name + len; *p; p++) {
+        if (!isdigit((unsigned char)*p)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void parse_schema(const uint8_t *payload, size_t len, FILE *out) {
+    if (len < 2) {
+        return;
+    }
+    uint16_t new_rate = payload[0] | payload[1] << 8;
+
+    char names[TELEM_MAX_PAYLOAD + 1];
+    memcpy(names, payload + 2, len - 2);
+    names[len - 2] = '\0';
+
+    column_t parsed[MAX_COLUMNS];
+    int count = 0;
+    uint16_t offset = 0;
+    for (char *tok = strtok(names, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if (count > 0 && parsed[count - 1].width < 8 && is_continuation(tok, parsed[count - 1].name)) {
+            parsed[count - 1].width++;
+        } else if (count < MAX_COLUMNS) {
+            column_t *c = &parsed[count++];
+            strncpy(c->name, tok, MAX_NAME - 1);
+            c->name[MAX_NAME - 1] = '\0';
+            c->offset = offset;
+            c->width = 1;
+            c->is_signed = in_list(signed_list, c->name);
+        }
+        offset++;
+    }
+
+    // The schema repeats every second; only restart the CSV when it changes
+    if (count == column_count && offset == payload_len && new_rate == rate_hz &&
+        memcmp(parsed, columns, count * sizeof(column_t)) == 0) {
+        return;
+    }
+    memcpy(columns, parsed, count * sizeof(column_t));
+    column_count = count;
+    payload_len = offset;
+    rate_hz = new_rate;
+
+    fprintf(stderr, "Schema: %d channels, %u bytes per frame at %u Hz\n", column_count, payload_len, rate_hz);
+    fprintf(out, "seq");
+    for (int i = 0; i < column_count; i++) {
+        fprintf(out, ",%s", columns[i].name);
+    }
+    fprintf(out, "\n");
+    fflush(out);
+}
+
+static void write_row(uint16_t seq, const uint8_t *payload, FILE *out) {
+    fprintf(out, "%u", seq);
+    for (int i = 0; i < column_count; i++) {
+        const column_t *c = &columns[i];
+        uint64_t v = 0;
+        for (int b = 0; b < c->width; b++) {
+            v = v << 8 | payload[c->offset + b];
+        }
+        if (c->is_signed && c->width < 8 && (v >> (c->width * 8 - 1)) & 1) {
+            fprintf(out, ",%lld", (long long)(v - (1ULL << (c->width * 8))));
+        } else {
+            fprintf(out, ",%llu", (unsigned long long)v);
+        }
+    }
+    fprintf(out, "\n");
+    fflush(out);
+}
+
+int main(int argc, char **argv) {
+    const char *port = NULL;
+    const char *out_path = NULL;
+    long baud = DEFAULT_BAUD;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--baud") == 0 && i + 1 < argc) {
+            baud = strtol(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--signed") == 0 && i + 1 < argc) {
+            strncpy(signed_list, argv[++i], sizeof(signed_list) - 1);
+        } else {
+            port = argv[i];
+        }
+    }
+    if (port == NULL) {
+        fprintf(stderr, "Usage: %s <port|-> [--baud N] [--out file.csv] [--signed CH,CH,...]\n", argv[0]);
+        return 1;
+    }
+
+    int fd = strcmp(port, "-") == 0 ? STDIN_FILENO : open_port(port, baud);
+    if (fd < 0) {
+        return 1;
+    }
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (out == NULL) {
+        perror(out_path);
+        return 1;
+    }
+
+    struct sigaction sa = {0};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    static uint8_t block[TELEM_MAX_ENCODED];
+    static uint8_t frame[TELEM_MAX_FRAME];
+    size_t block_len = 0;
+    int overflow = 0;
+    unsigned long good = 0, bad = 0, lost = 0, unschemed = 0;
+    uint16_t expected_seq = 0;
+    int have_seq = 0;
+
+    uint8_t buf[4096];
+    while (!stop) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+
+        for (ssize_t i = 0; i < n; i++) {
+            if (buf[i] != 0) {
+                if (block_len < sizeof(block)) {
+                    block[block_len++] = buf[i];
+                } else {
+                    overflow = 1;
+                }
+                continue;
+            }
+
+            // Delimiter: decode and verify the block collected so far
+            size_t len = overflow ? 0 : telem_cobs_decode(block, block_len, frame, sizeof(frame));
+            int empty = block_len == 0;
+            block_len = 0;
+            overflow = 0;
+            if (empty) {
+                continue;
+            }
+            if (len < TELEM_FRAME_OVERHEAD ||
+                telem_crc16(frame, len - 2) != (uint16_t)(frame[len - 2] | frame[len - 1] << 8)) {
+                bad++;
+                continue;
+            }
+            good++;
+
+            uint16_t seq = frame[1] | frame[2] << 8;
+            const uint8_t *payload = frame + 3;
+            size_t payload_size = len - TELEM_FRAME_OVERHEAD;
+
+            if (frame[0] == TELEM_FRAME_SCHEMA) {
+                parse_schema(payload, payload_size, out);
+            } else if (frame[0] == TELEM_FRAME_DATA) {
+                if (have_seq && seq != expected_seq) {
+                    lost += (uint16_t)(seq - expected_seq);
+                }
+                expected_seq = seq + 1;
+                have_seq = 1;
+
+                if (column_count == 0 || payload_size != payload_len) {
+                    unschemed++;
+                    continue;
+                }
+                write_row(seq, payload, out);
+            }
+        }
+    }
+
+    if (fd != STDIN_FILENO) {
+        // Ask the logger to stop streaming and return the port to the console
+        write(fd, "T", 1);
+        tcdrain(fd);
+        close(fd);
+    }
+    fprintf(stderr, "%lu frames, %lu bad CRC/COBS, %lu lost (seq gaps), %lu before schema\n", good, bad, lost,
+            unschemed);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * test_dtc_window.c
+ *
+ * main/dtc_window.h against a brute-force maximum over the last `span`
+ * measurements, with the seed counting as a full window of its own value.
+ * Runs long enough to wrap the 8-bit sequence numbers several times.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "dtc_window.h"
+
+#define PUSHES 2000
+
+static int failures = 0;
+
+static uint32_t brute_max(const uint32_t *history, int pushed, int span, uint32_t seed) {
+    uint32_t max = 0;
+    for (int k = pushed - span; k < pushed; k++) {
+        uint32_t v = k < 0 ? seed : history[k];
+        if (v > max) {
+            max = v;
+        }
+    }
+    return max;
+}
+
+static void check_span(uint8_t span, uint32_t seed, uint32_t range) {
+    static uint32_t history[PUSHES];
+    dtc_window_t w;
+    dtc_window_init(&w, span, seed);
+    int effective = w.span;
+
+    if (dtc_window_max(&w) != seed) {
+        printf("span %u: max after init = %u, expected seed %u\n", span, dtc_window_max(&w), seed);
+        failures++;
+    }
+    for (int i = 0; i < PUSHES; i++) {
+        // Mostly random, with runs of rising and falling values to exercise both ends of the deque
+        uint32_t v = (uint32_t)rand() % range;
+        if (i % 300 < 40) {
+            v = (uint32_t)(i % 300) * (range / 40);
+        } else if (i % 300 < 80) {
+            v = (uint32_t)(80 - i % 300) * (range / 40);
+        }
+        history[i] = v;
+        dtc_window_push(&w, v);
+
+        uint32_t expected = brute_max(history, i + 1, effective, seed);
+        if (dtc_window_max(&w) != expected) {
+            printf("span %u, push %d: max = %u, expected %u\n", span, i, dtc_window_max(&w), expected);
+            failures++;
+            return;
+        }
+    }
+}
+
+int main(void) {
+    srand(1);
+    check_span(1, 50, 100);
+    check_span(2, 0, 100);
+    check_span(10, 1000, 100);  // Seed above every measurement: held for exactly 10 pushes
+    check_span(63, 5, 1000);
+    check_span(DTC_MEASURES, 20, 1000);
+    check_span(0, 20, 1000);    // 0 and oversized spans fall back to DTC_MEASURES
+    check_span(200, 20, 1000);
+    check_span(16, 7, 3);       // Many equal values
+
+    printf("test_dtc_window: %s\n", failures == 0 ? "OK" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
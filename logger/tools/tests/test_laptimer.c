@@ -0,0 +1,80 @@
+/*
+ * test_laptimer.c
+ *
+ * Gate-crossing math of main/laptimer.c: interpolated crossing times, the
+ * counted direction, the gate width, the re-crossing hold-off, sector order
+ * and the reset applied after the gates are cleared.
+ */
+#include <stdio.h>
+#include <stdint.h>
+
+#include "laptimer.h"
+
+#define LAT 420000000 // 42.0 N
+#define LON -830000000 // 83.0 W
+#define E7_PER_M 89.83f // Degrees e7 of latitude per metre
+
+static int failures = 0;
+
+#define CHECK_EQ(actual, expected)                                                                      \
+    do {                                                                                                \
+        long long a_ = (long long)(actual), e_ = (long long)(expected);                                 \
+        if (a_ != e_) {                                                                                 \
+            printf("%s:%d: %s = %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_);           \
+            failures++;                                                                                 \
+        }                                                                                               \
+    } while (0)
+
+// Drive straight from (lat0, lon) at t0_ms to (lat1, lon) at t1_ms
+static void drive(int32_t lat0, int32_t lat1, int32_t lon, uint32_t t0_ms, uint32_t t1_ms) {
+    laptimer_process_fix(lat0, lon, (int64_t)t0_ms * 1000);
+    laptimer_process_fix(lat1, lon, (int64_t)t1_ms * 1000);
+}
+
+int main(void) {
+    laptimer_init();
+    laptimer_clear_gates();
+    CHECK_EQ(laptimer_add_gate(LAT, LON, 0.0f), ESP_OK); // Start/finish across a northbound track
+
+    // Northbound, halfway between two fixes 100 ms apart: starts the first lap
+    drive(LAT - 900, LAT + 900, LON, 1000, 1100);
+    CHECK_EQ(lap_status.last_cross_ms, 1050);
+    CHECK_EQ(lap_status.sector, 1);
+    CHECK_EQ(lap_status.lap, 0);
+
+    // Southbound crossings are not counted
+    drive(LAT + 900, LAT - 900, LON, 7000, 7100);
+    CHECK_EQ(lap_status.last_cross_ms, 1050);
+
+    // Passing 20 m beside the line misses a gate 12 m either side
+    int32_t beside = LON + (int32_t)(20.0f * E7_PER_M / 0.7431f); // cos(42 deg)
+    drive(LAT - 900, LAT + 900, beside, 8000, 8100);
+    CHECK_EQ(lap_status.last_cross_ms, 1050);
+
+    // A quarter of the way between fixes: closes lap 1
+    drive(LAT - 450, LAT + 1350, LON, 10000, 10100);
+    CHECK_EQ(lap_status.lap, 1);
+    CHECK_EQ(lap_status.last_lap_ms, 10025 - 1050);
+    CHECK_EQ(lap_status.best_lap_ms, 10025 - 1050);
+
+    // Crossing again within LAP_MIN_CROSS_INTERVAL_MS is held off
+    drive(LAT - 900, LAT + 900, LON, 12000, 12100);
+    CHECK_EQ(lap_status.lap, 1);
+
+    // A split 1 km up the road: sector 2 begins there
+    CHECK_EQ(laptimer_add_gate(LAT + 89830, LON, 0.0f), ESP_OK);
+    drive(LAT + 89830 - 900, LAT + 89830 + 900, LON, 20000, 20100);
+    CHECK_EQ(lap_status.sector, 2);
+    CHECK_EQ(lap_status.last_cross_ms, 20050);
+
+    // Clearing the gates resets the lap in progress on the next fix
+    laptimer_clear_gates();
+    laptimer_process_fix(LAT, LON, 21000000);
+    CHECK_EQ(lap_status.sector, 0);
+    drive(LAT - 900, LAT + 900, LON, 30000, 30100);
+    CHECK_EQ(lap_status.last_cross_ms, 20050);
+
+    laptimer_write_summary(); // Drain the queued lap
+    printf("test_laptimer: %s\n", failures == 0 ? "OK" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/*
+ * test_telemetry_frame.c
+ *
+ * COBS and CRC-16 framing of main/telemetry_frame.h: reference vectors,
+ * round trips around the 254-byte COBS block boundary, and rejection of
+ * malformed or corrupted frames.
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "telemetry_frame.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+    do {                                                                    \
+        if (!(cond)) {                                                      \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            failures++;                                                     \
+        }                                                                   \
+    } while (0)
+
+static void check_cobs_vector(const uint8_t *in, size_t len, const uint8_t *expected, size_t expected_len) {
+    uint8_t out[32];
+    size_t n = telem_cobs_encode(in, len, out);
+    CHECK(n == expected_len && memcmp(out, expected, n) == 0);
+}
+
+static void check_round_trip(size_t len, int zeros) {
+    static uint8_t in[TELEM_MAX_FRAME], enc[TELEM_MAX_ENCODED], dec[TELEM_MAX_FRAME];
+    for (size_t i = 0; i < len; i++) {
+        in[i] = zeros ? (uint8_t)(rand() % 4) : (uint8_t)(1 + rand() % 255);
+    }
+    size_t n = telem_cobs_encode(in, len, enc);
+    CHECK(n <= len + len / 254 + 2);
+    CHECK(enc[n - 1] == 0);
+    CHECK(memchr(enc, 0, n - 1) == NULL); // The delimiter is the only zero
+    CHECK(telem_cobs_decode(enc, n - 1, dec, sizeof(dec)) == len);
+    CHECK(memcmp(in, dec, len) == 0);
+}
+
+int main(void) {
+    // CRC-16/CCITT-FALSE check value
+    CHECK(telem_crc16((const uint8_t *)"123456789", 9) == 0x29B1);
+    CHECK(telem_crc16(NULL, 0) == 0xFFFF);
+
+    // COBS reference vectors
+    check_cobs_vector((const uint8_t[]){0x00}, 1, (const uint8_t[]){0x01, 0x01, 0x00}, 3);
+    check_cobs_vector((const uint8_t[]){0x00, 0x00}, 2, (const uint8_t[]){0x01, 0x01, 0x01, 0x00}, 4);
+    check_cobs_vector((const uint8_t[]){0x11, 0x22, 0x00, 0x33}, 4,
+                      (const uint8_t[]){0x03, 0x11, 0x22, 0x02, 0x33, 0x00}, 6);
+    check_cobs_vector((const uint8_t[]){0x11, 0x00, 0x00, 0x00}, 4,
+                      (const uint8_t[]){0x02, 0x11, 0x01, 0x01, 0x01, 0x00}, 6);
+
+    srand(1);
+    for (size_t len = 0; len < 600; len++) {
+        check_round_trip(len, 0);
+        check_round_trip(len, 1);
+    }
+    check_round_trip(TELEM_MAX_FRAME, 0);
+
+    // Malformed blocks: a code running past the end, an embedded zero, output too small
+    uint8_t dec[16];
+    CHECK(telem_cobs_decode((const uint8_t[]){0x05, 0x11, 0x22}, 3, dec, sizeof(dec)) == 0);
+    CHECK(telem_cobs_decode((const uint8_t[]){0x02, 0x11, 0x00, 0x11}, 4, dec, sizeof(dec)) == 0);
+    CHECK(telem_cobs_decode((const uint8_t[]){0x04, 0x11, 0x22, 0x33}, 4, dec, 2) == 0);
+
+    // Whole frame: the CRC covers type, seq and payload, and catches a flipped bit
+    static uint8_t scratch[TELEM_MAX_FRAME], enc[TELEM_MAX_ENCODED], frame[TELEM_MAX_FRAME];
+    const uint8_t payload[] = {0x00, 0x01, 0x02, 0x00, 0xFF};
+    size_t n = telem_frame_encode(TELEM_FRAME_DATA, 0x1234, payload, sizeof(payload), scratch, enc);
+    size_t len = telem_cobs_decode(enc, n - 1, frame, sizeof(frame));
+    CHECK(len == sizeof(payload) + TELEM_FRAME_OVERHEAD);
+    CHECK(frame[0] == TELEM_FRAME_DATA && frame[1] == 0x34 && frame[2] == 0x12);
+    CHECK(memcmp(frame + 3, payload, sizeof(payload)) == 0);
+    uint16_t crc = (uint16_t)(frame[len - 2] | frame[len - 1] << 8);
+    CHECK(crc == telem_crc16(frame, len - 2));
+    frame[4] ^= 0x10;
+    CHECK(crc != telem_crc16(frame, len - 2));
+
+    CHECK(telem_frame_encode(TELEM_FRAME_DATA, 0, frame, TELEM_MAX_PAYLOAD + 1, scratch, enc) == 0);
+
+    printf("test_telemetry_frame: %s\n", failures == 0 ? "OK" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
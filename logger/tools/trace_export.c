@@ -0,0 +1,474 @@
+/*
+ * trace_export.c
+ *
+ * Converts an event trace (see main/trace.h) into Chrome trace JSON, which
+ * chrome://tracing and ui.perfetto.dev open directly. Reads either the
+ * binary <log>_trace.bin written by 'trace save', or a console log holding
+ * the BTRC-HEX ... BTRC-END block printed by 'trace dump'.
+ *
+ * Layout of the output:
+ *   "Pipeline tasks"  one row per task, a slice per unit of work (wake to block)
+ *   "Core N"          running task (tick samples), ISRs, prof.h stages,
+ *                     queue sends/receives and marks recorded on that core
+ * Queue receives carry the send-to-receive latency of the item they took;
+ * a summary per core and queue goes to stderr.
+ *
+ * Usage: trace_export <trace.bin|console.log> [out.json]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "trace.h"
+#include "prof.h"
+
+#define MAX_CORES 8
+#define MAX_NAMES 256
+#define MAX_PENDING 256 // Queued items awaiting a receive, per queue
+
+typedef struct {
+    double ts_us;
+    int core;
+    uint32_t seq; // Position in the core's ring, to keep same-timestamp events in order
+    trace_event_t ev;
+} timed_event_t;
+
+typedef struct {
+    double sent_us[MAX_PENDING];
+    int head, count;
+    uint32_t sends, full, overwritten, receives, matched;
+    double latency_sum, latency_max;
+} queue_state_t;
+
+static trace_file_header_t header;
+static trace_file_core_t cores[MAX_CORES];
+static trace_file_name_t names[MAX_NAMES];
+static int name_count = 0;
+static timed_event_t *events = NULL;
+static size_t event_count = 0;
+
+// ----------------------------------------------------------------------------
+// Input
+
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *in = fopen(path, "rb");
+    if (in == NULL) {
+        perror(path);
+        return NULL;
+    }
+    fseek(in, 0, SEEK_END);
+    long len = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    uint8_t *data = malloc(len > 0 ? (size_t)len : 1);
+    if (data == NULL || fread(data, 1, (size_t)len, in) != (size_t)len) {
+        fprintf(stderr, "%s: read failed\n", path);
+        free(data);
+        fclose(in);
+        return NULL;
+    }
+    fclose(in);
+    *size = (size_t)len;
+    return data;
+}
+
+static int hex_value(char c) {
+    return isdigit((unsigned char)c) ? c - '0' : tolower((unsigned char)c) - 'a' + 10;
+}
+
+// Decodes the hex lines between BTRC-HEX and BTRC-END in place; other console output is skipped
+static int decode_hex_dump(uint8_t *text, size_t *out_size) {
+    char *start = strstr((char *)text, "BTRC-HEX");
+    if (start == NULL) {
+        return -1;
+    }
+    size_t out = 0;
+    int skipped = 0;
+    char *line = strchr(start, '\n');
+    while (line != NULL) {
+        line++;
+        char *end = strchr(line, '\n');
+        size_t len = end != NULL ? (size_t)(end - line) : strlen(line);
+        while (len > 0 && isspace((unsigned char)line[len - 1])) {
+            len--;
+        }
+        if (len >= 8 && strncmp(line, "BTRC-END", 8) == 0) {
+            if (skipped > 0) {
+                fprintf(stderr, "Skipped %d non-hex lines inside the dump\n", skipped);
+            }
+            *out_size = out;
+            return 0;
+        }
+        size_t i = 0;
+        while (i < len && isxdigit((unsigned char)line[i])) {
+            i++;
+        }
+        if (len > 0 && i == len && len % 2 == 0) {
+            for (i = 0; i < len; i += 2) {
+                text[out++] = (uint8_t)(hex_value(line[i]) << 4 | hex_value(line[i + 1]));
+            }
+        } else if (len > 0) {
+            skipped++;
+        }
+        line = end;
+    }
+    fprintf(stderr, "Hex dump has no BTRC-END line (truncated capture?)\n");
+    return -1;
+}
+
+static const char *lookup_name(trace_name_kind_t kind, unsigned id) {
+    for (int i = 0; i < name_count; i++) {
+        if (names[i].kind == kind && names[i].id == id) {
+            return names[i].name;
+        }
+    }
+    return NULL;
+}
+
+static int compare_events(const void *a, const void *b) {
+    const timed_event_t *x = a, *y = b;
+    if (x->ts_us != y->ts_us) {
+        return x->ts_us < y->ts_us ? -1 : 1;
+    }
+    if (x->core != y->core) {
+        return x->core - y->core;
+    }
+    return x->seq < y->seq ? -1 : 1;
+}
+
+/*
+ * Rebuilds 64-bit time per core from consecutive 32-bit cycle deltas (events
+ * are never a full wrap apart while the tick hook samples), then places the
+ * core on the esp_timer clock through its anchor, taken near the newest event.
+ */
+static int parse_trace(const uint8_t *data, size_t size) {
+    size_t pos = 0;
+    if (size < sizeof(header)) {
+        fprintf(stderr, "Truncated trace header\n");
+        return -1;
+    }
+    memcpy(&header, data, sizeof(header));
+    pos += sizeof(header);
+    if (memcmp(header.magic, TRACE_MAGIC, 4) != 0 || header.version != TRACE_VERSION) {
+        fprintf(stderr, "Not a version %d event trace\n", TRACE_VERSION);
+        return -1;
+    }
+    if (header.cores == 0 || header.cores > MAX_CORES || header.name_count > MAX_NAMES || header.cpu_mhz == 0) {
+        fprintf(stderr, "Implausible trace header (%u cores, %u names)\n", header.cores, header.name_count);
+        return -1;
+    }
+    size_t total = 0;
+    for (int c = 0; c < header.cores; c++) {
+        if (pos + sizeof(trace_file_core_t) > size) {
+            fprintf(stderr, "Truncated core table\n");
+            return -1;
+        }
+        memcpy(&cores[c], data + pos, sizeof(trace_file_core_t));
+        pos += sizeof(trace_file_core_t);
+        total += cores[c].count;
+    }
+    name_count = header.name_count;
+    if (pos + name_count * sizeof(trace_file_name_t) > size) {
+        fprintf(stderr, "Truncated name table\n");
+        return -1;
+    }
+    memcpy(names, data + pos, name_count * sizeof(trace_file_name_t));
+    pos += name_count * sizeof(trace_file_name_t);
+    for (int i = 0; i < name_count; i++) {
+        names[i].name[TRACE_NAME_LEN - 1] = '\0';
+    }
+
+    events = malloc((total > 0 ? total : 1) * sizeof(timed_event_t));
+    if (events == NULL) {
+        return -1;
+    }
+    for (int c = 0; c < header.cores; c++) {
+        uint32_t count = cores[c].count;
+        if (pos + count * sizeof(trace_event_t) > size) {
+            fprintf(stderr, "Core %d: %u events announced, file truncated\n", c, count);
+            return -1;
+        }
+        if (count == 0) {
+            continue;
+        }
+        const trace_event_t *raw = (const trace_event_t *)(data + pos);
+        pos += count * sizeof(trace_event_t);
+
+        int64_t cycles = 0; // Relative to the oldest event
+        size_t first = event_count;
+        for (uint32_t i = 0; i < count; i++) {
+            if (i > 0) {
+                cycles += (int32_t)(raw[i].cycles - raw[i - 1].cycles);
+            }
+            events[event_count++] = (timed_event_t){.ts_us = (double)cycles, .core = c, .seq = i, .ev = raw[i]};
+        }
+        int64_t anchor = cycles + (int32_t)(cores[c].anchor_cycles - raw[count - 1].cycles);
+        for (size_t i = first; i < event_count; i++) {
+            events[i].ts_us = cores[c].anchor_us + (events[i].ts_us - anchor) / header.cpu_mhz;
+        }
+    }
+    qsort(events, event_count, sizeof(timed_event_t), compare_events);
+    return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Output
+
+static FILE *out;
+static int first_record = 1;
+
+static void json_name(const char *s) {
+    fputc('"', out);
+    for (; *s != '\0'; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', out);
+        }
+        fputc(*s, out);
+    }
+    fputc('"', out);
+}
+
+static void begin_record(void) {
+    fputs(first_record ? "\n" : ",\n", out);
+    first_record = 0;
+}
+
+static void metadata(const char *what, int pid, int tid, const char *name) {
+    begin_record();
+    fprintf(out, "{\"ph\":\"M\",\"name\":\"%s\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", what, pid, tid);
+    json_name(name);
+    fputs("}}", out);
+}
+
+static void slice(const char *name, const char *cat, int pid, int tid, double start_us, double end_us) {
+    begin_record();
+    fputs("{\"ph\":\"X\",\"name\":", out);
+    json_name(name);
+    fprintf(out, ",\"cat\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", cat, pid, tid, start_us,
+            end_us - start_us);
+}
+
+// Instant event; args_json is the inside of the args object
+static void instant(const char *name, const char *cat, int pid, int tid, double ts_us, const char *args_json) {
+    begin_record();
+    fputs("{\"ph\":\"i\",\"s\":\"t\",\"name\":", out);
+    json_name(name);
+    fprintf(out, ",\"cat\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f,\"args\":{%s}}", cat, pid, tid, ts_us, args_json);
+}
+
+// Rows inside each "Core N" process
+enum { TID_RUNNING = 1, TID_ISR, TID_QUEUE, TID_MARK, TID_STAGE };
+
+static const char *name_or(trace_name_kind_t kind, unsigned id, char *buf, size_t size, const char *prefix) {
+    const char *name = lookup_name(kind, id);
+    if (name != NULL) {
+        return name;
+    }
+    snprintf(buf, size, "%s %u", prefix, id);
+    return buf;
+}
+
+static void export_json(void) {
+    static double open_task[256], open_isr[MAX_CORES][256], open_stage[MAX_CORES][256];
+    static queue_state_t queues[256];
+    double sample_start[MAX_CORES];
+    int sample_task[MAX_CORES];
+    char buf[64], label[80], args[96];
+
+    for (int i = 0; i < 256; i++) {
+        open_task[i] = -1;
+        for (int c = 0; c < MAX_CORES; c++) {
+            open_isr[c][i] = open_stage[c][i] = -1;
+        }
+    }
+    for (int c = 0; c < MAX_CORES; c++) {
+        sample_task[c] = -1;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", out);
+    metadata("process_name", 0, 0, "Pipeline tasks");
+    for (int i = 0; i < name_count; i++) {
+        if (names[i].kind == TRACE_NAME_TASK) {
+            metadata("thread_name", 0, names[i].id + 1, names[i].name);
+        }
+    }
+    for (int c = 0; c < header.cores; c++) {
+        snprintf(buf, sizeof(buf), "Core %d", c);
+        metadata("process_name", c + 1, 0, buf);
+        metadata("thread_name", c + 1, TID_RUNNING, "Running task");
+        metadata("thread_name", c + 1, TID_ISR, "ISR");
+        metadata("thread_name", c + 1, TID_QUEUE, "Queues");
+        metadata("thread_name", c + 1, TID_MARK, "Marks");
+        for (int i = 0; i < name_count; i++) {
+            if (names[i].kind == TRACE_NAME_STAGE) {
+                metadata("thread_name", c + 1, TID_STAGE + names[i].id, names[i].name);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < event_count; i++) {
+        const timed_event_t *e = &events[i];
+        const int pid = e->core + 1;
+        const uint8_t id = e->ev.id;
+        const double ts = e->ts_us;
+        switch (e->ev.type) {
+            case TRACE_TASK_SAMPLE:
+                // One slice per run of identical samples
+                if (sample_task[e->core] != e->ev.arg) {
+                    if (sample_task[e->core] >= 0) {
+                        slice(name_or(TRACE_NAME_TASK_NUMBER, sample_task[e->core], buf, sizeof(buf), "task"),
+                              "sched", pid, TID_RUNNING, sample_start[e->core], ts);
+                    }
+                    sample_task[e->core] = e->ev.arg;
+                    sample_start[e->core] = ts;
+                }
+                break;
+            case TRACE_TASK_WAKE:
+                open_task[id] = ts;
+                break;
+            case TRACE_TASK_BLOCK:
+                if (open_task[id] >= 0) {
+                    slice(name_or(TRACE_NAME_TASK, id, buf, sizeof(buf), "task"), "task", 0, id + 1, open_task[id], ts);
+                    open_task[id] = -1;
+                }
+                break;
+            case TRACE_ISR_ENTER:
+                open_isr[e->core][id] = ts;
+                break;
+            case TRACE_ISR_EXIT:
+                if (open_isr[e->core][id] >= 0) {
+                    slice(name_or(TRACE_NAME_ISR, id, buf, sizeof(buf), "isr"), "isr", pid, TID_ISR,
+                          open_isr[e->core][id], ts);
+                    open_isr[e->core][id] = -1;
+                }
+                break;
+            case TRACE_STAGE_BEGIN:
+                open_stage[e->core][id] = ts;
+                break;
+            case TRACE_STAGE_END:
+                if (open_stage[e->core][id] >= 0) {
+                    slice(name_or(TRACE_NAME_STAGE, id, buf, sizeof(buf), "stage"), "stage", pid, TID_STAGE + id,
+                          open_stage[e->core][id], ts);
+                    open_stage[e->core][id] = -1;
+                }
+                break;
+            case TRACE_QUEUE_SEND: {
+                queue_state_t *q = &queues[id];
+                const char *result = e->ev.arg == TRACE_SEND_FULL ? "full" :
+                                     e->ev.arg == TRACE_SEND_OVERWROTE ? "overwrote" : "queued";
+                q->sends++;
+                if (e->ev.arg == TRACE_SEND_FULL) {
+                    q->full++;
+                } else {
+                    if (e->ev.arg == TRACE_SEND_OVERWROTE && q->count > 0) {
+                        // The replaced item is the newest pending one
+                        q->count--;
+                        q->overwritten++;
+                    }
+                    if (q->count < MAX_PENDING) {
+                        q->sent_us[(q->head + q->count++) % MAX_PENDING] = ts;
+                    }
+                }
+                snprintf(args, sizeof(args), "\"result\":\"%s\",\"pending\":%d", result, q->count);
+                snprintf(label, sizeof(label), "send %s", name_or(TRACE_NAME_QUEUE, id, buf, sizeof(buf), "queue"));
+                instant(label, "queue", pid, TID_QUEUE, ts, args);
+                break;
+            }
+            case TRACE_QUEUE_RECV: {
+                queue_state_t *q = &queues[id];
+                q->receives++;
+                if (q->count > 0) {
+                    double latency = ts - q->sent_us[q->head];
+                    q->head = (q->head + 1) % MAX_PENDING;
+                    q->count--;
+                    q->matched++;
+                    q->latency_sum += latency;
+                    if (latency > q->latency_max) {
+                        q->latency_max = latency;
+                    }
+                    snprintf(args, sizeof(args), "\"latency_us\":%.3f", latency);
+                } else {
+                    // The send predates the oldest surviving event
+                    snprintf(args, sizeof(args), "\"latency_us\":null");
+                }
+                snprintf(label, sizeof(label), "recv %s", name_or(TRACE_NAME_QUEUE, id, buf, sizeof(buf), "queue"));
+                instant(label, "queue", pid, TID_QUEUE, ts, args);
+                break;
+            }
+            case TRACE_MARK:
+                snprintf(args, sizeof(args), "\"arg\":%u", e->ev.arg);
+                instant(name_or(TRACE_NAME_MARK, id, buf, sizeof(buf), "mark"), "mark", pid, TID_MARK, ts, args);
+                break;
+            default:
+                break;
+        }
+    }
+    for (int c = 0; c < header.cores; c++) {
+        if (sample_task[c] >= 0) {
+            slice(name_or(TRACE_NAME_TASK_NUMBER, sample_task[c], buf, sizeof(buf), "task"), "sched", c + 1,
+                  TID_RUNNING, sample_start[c], events[event_count - 1].ts_us);
+        }
+    }
+    fputs("\n]}\n", out);
+
+    for (int c = 0; c < header.cores; c++) {
+        fprintf(stderr, "Core %d: %u events (%u overwritten before the dump)\n", c, cores[c].count, cores[c].lost);
+    }
+    if (event_count > 0) {
+        fprintf(stderr, "Span: %.3f ms\n", (events[event_count - 1].ts_us - events[0].ts_us) / 1000.0);
+    }
+    for (int i = 0; i < name_count; i++) {
+        if (names[i].kind != TRACE_NAME_QUEUE) {
+            continue;
+        }
+        const queue_state_t *q = &queues[names[i].id];
+        fprintf(stderr, "%-16s %u sends (%u full, %u overwritten), %u receives", names[i].name, q->sends, q->full,
+                q->overwritten, q->receives);
+        if (q->matched > 0) {
+            fprintf(stderr, ", latency mean %.1f us, max %.1f us", q->latency_sum / q->matched, q->latency_max);
+        }
+        fprintf(stderr, "\n");
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s <trace.bin|console.log> [out.json]\n", argv[0]);
+        return 2;
+    }
+    size_t size;
+    uint8_t *data = read_file(argv[1], &size);
+    if (data == NULL) {
+        return 2;
+    }
+    if (size < 4 || memcmp(data, TRACE_MAGIC, 4) != 0) {
+        // Console capture: NUL-terminate for the line scan
+        uint8_t *text = realloc(data, size + 1);
+        if (text == NULL) {
+            free(data);
+            return 2;
+        }
+        data = text;
+        data[size] = '\0';
+        if (decode_hex_dump(data, &size) != 0) {
+            fprintf(stderr, "%s: neither a trace file nor a console log with a 'trace dump'\n", argv[1]);
+            return 2;
+        }
+    }
+    if (parse_trace(data, size) != 0) {
+        return 2;
+    }
+
+    out = stdout;
+    if (argc == 3 && (out = fopen(argv[2], "w")) == NULL) {
+        perror(argv[2]);
+        return 2;
+    }
+    export_json();
+    if (out != stdout) {
+        fclose(out);
+    }
+    free(events);
+    free(data);
+    return 0;
+}